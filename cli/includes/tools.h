@@ -16,7 +16,13 @@
 ///
 #pragma once
 
+#include "hprof.h"
 #include "types.h"
 #include "objects_index.h"
+#include "array_waste_report.h"
 
 void print_object(const hprof::heap_item_ptr_t& item, const hprof::objects_index_t& objects, int max_level);
+void print_array_waste_report(const hprof::array_waste_report_t& report);
+void print_row(const std::vector<std::string>& values);
+void print_aggregate_rows(const std::vector<hprof::aggregate_row_t>& rows);
+void print_explain(const std::vector<hprof::explain_node_t>& nodes, bool analyzed);
@@ -14,10 +14,17 @@
 ///  limitations under the License.
 ///
 #include <hprof_file.h>
+#include <query_projection.h>
+#include <query_sample.h>
 
 #include <iostream>
 #include <chrono>
+#include <cmath>
 #include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <cstdlib>
+#include <limits>
 
 #include "language_driver.h"
 #include "tools.h"
@@ -29,18 +36,54 @@ using std::chrono::milliseconds;
 
 using namespace hprof;
 
+// Token of the query being run, Ctrl+C cancels it and quits when there is none
+static std::atomic<query_token_t*> g_running_query { nullptr };
+
+static void on_interrupt(int) {
+    auto token = g_running_query.load();
+    if (token == nullptr) {
+        std::_Exit(130);
+    }
+    token->cancel();
+}
+
 int main(int argc, char* argv[]) {
     
-    if (argc == 1) {
+    load_options_t options;
+    const char* file_name = nullptr;
+    // Results printed before asking to continue, zero prints everything
+    size_t page_size = 0;
+    // Queries running longer print what they found so far, zero means no limit
+    milliseconds budget { 0 };
+    for (int index = 1; index < argc; ++index) {
+        std::string arg { argv[index] };
+        if (arg == "--dedup-arrays") {
+            options.deduplicate_arrays = true;
+        } else if (arg == "--threads" && index + 1 < argc) {
+            options.query_threads = std::strtoul(argv[++index], nullptr, 10);
+        } else if (arg == "--query-cache" && index + 1 < argc) {
+            options.query_cache_size = std::strtoul(argv[++index], nullptr, 10) << 20;
+        } else if (arg == "--strings-cache" && index + 1 < argc) {
+            options.strings_cache_size = std::strtoul(argv[++index], nullptr, 10) << 20;
+        } else if (arg == "--page" && index + 1 < argc) {
+            page_size = std::strtoul(argv[++index], nullptr, 10);
+        } else if (arg == "--budget" && index + 1 < argc) {
+            budget = milliseconds { std::strtoul(argv[++index], nullptr, 10) };
+        } else {
+            file_name = argv[index];
+        }
+    }
+
+    if (file_name == nullptr) {
         std::cerr << "Specify hprof file name" << std::endl;
         return -1;
     }
     
     auto start = steady_clock::now();
-    std::cout << "Loading heap dump from: " << argv[1] << std::endl;
+    std::cout << "Loading heap dump from: " << file_name << std::endl;
 
     auto reader_factory = data_reader_factory_t::create();
-    file_t file { argv[1] };
+    file_t file { file_name };
     auto hprof = file.read_dump(*reader_factory, [] (auto phase, auto progress) { 
         switch (phase) {
             case file_t::PHASE_READ:
@@ -54,7 +97,7 @@ int main(int argc, char* argv[]) {
                 break;
         }
         std::cout << " " << progress << "%                                    \r"; 
-    });
+    }, options);
 
     std::cout << std::endl;
     auto spent_time = steady_clock::now() - start;
@@ -72,9 +115,13 @@ int main(int argc, char* argv[]) {
         return -1;
     }
 
+    std::signal(SIGINT, on_interrupt);
+
     language_driver driver {};
-    std::vector<heap_item_ptr_t> result;
+    std::vector<heap_item_ptr_t> page;
+    std::shared_ptr<query_token_t> token;
     do {
+        g_running_query = nullptr;
         std::cout << ">> ";
         std::string query_text;
         std::getline(std::cin, query_text);
@@ -83,27 +130,118 @@ int main(int argc, char* argv[]) {
             break;
         }
 
+        if (query_text == "report arrays") {
+            array_waste_report_t report;
+            if (report.collect(*hprof)) {
+                print_array_waste_report(report);
+            } else {
+                std::cout << "Failed" << std::endl;
+            }
+            continue;
+        }
+
         if (!driver.parse(query_text)) {
+            for (auto& error : driver.errors()) {
+                std::cout << "Error: " << error.message << std::endl;
+            }
             continue;
         }
 
         start = steady_clock::now();
-        if (hprof->query(driver.query(), result)) {
-            std::cout << "Results: " << result.size() << std::endl << std::endl;
+        token = std::make_shared<query_token_t>();
+        if (budget.count() != 0) {
+            token->set_budget(budget);
+        }
+        driver.query().token = token;
+        g_running_query = token.get();
+
+        if (driver.query().explain != query_t::EXPLAIN_NONE) {
+            std::vector<explain_node_t> nodes;
+            if (hprof->explain(driver.query(), nodes)) {
+                print_explain(nodes, driver.query().explain == query_t::EXPLAIN_ANALYZE);
+            } else {
+                std::cout << (token->cancelled() ? "Cancelled" : "Failed") << std::endl;
+            }
+            continue;
+        }
 
-            for (auto& item : result) {
-                print_object(item, hprof->objects_index(), 3);
+        // Results are pulled page by page, the scan stops when the user does
+        auto cursor = hprof->open(driver.query());
+        if (driver.query().action == query_t::ACTION_CREATE_INDEX) {
+            page.clear();
+            std::cout << (cursor->fetch(0, page) ? "Index created" : "Failed") << std::endl;
+            continue;
+        }
+
+        size_t printed = 0;
+        bool failed = false;
+        bool truncated = false;
+        if (driver.query().action == query_t::ACTION_AGGREGATE) {
+            std::vector<aggregate_row_t> rows;
+            failed = !hprof->aggregate(driver.query(), rows);
+            truncated = token->expired();
+            print_aggregate_rows(rows);
+            printed = rows.size();
+        }
+
+        // Projections print only the requested fields of every match
+        std::unique_ptr<query_projection_t> projection;
+        std::vector<std::string> row;
+        if (!driver.query().projections.empty()) {
+            projection = std::make_unique<query_projection_t>(driver.query(), hprof->objects_index(), hprof->classes_index());
+            projection->columns(row);
+            print_row(row);
+        }
+
+        while (!cursor->done()) {
+            page.clear();
+            if (!cursor->fetch(page_size != 0 ? page_size : std::numeric_limits<size_t>::max(), page)) {
+                failed = true;
+                break;
             }
+
+            for (auto& item : page) {
+                if (projection != nullptr) {
+                    projection->row(item, row);
+                    print_row(row);
+                } else {
+                    print_object(item, hprof->objects_index(), 3);
+                }
+            }
+            printed += page.size();
+
+            if (page_size != 0 && !page.empty() && !cursor->done()) {
+                std::cout << "-- " << printed << " results, Enter for more, q to stop --" << std::endl;
+                std::string answer;
+                std::getline(std::cin, answer);
+                if (answer == "q") {
+                    break;
+                }
+            }
+        }
+
+        truncated = truncated || cursor->truncated();
+        if (failed) {
+            std::cout << (token->cancelled() ? "Cancelled" : "Failed");
         } else {
-            std::cout << "Failed";
+            std::cout << std::endl << "Results: " << printed << (truncated ? " (time budget is spent, results are partial)" : "") << std::endl;
+        }
+
+        // Matches of a sample tell how many the whole heap has when none of them were skipped
+        query_sample_t sample { driver.query().sample, driver.query().sample_seed };
+        if (!failed && !truncated && !sample.all() && driver.query().action == query_t::ACTION_SHOW &&
+                cursor->done() && driver.query().offset == 0 && printed < driver.query().limit) {
+            double total = 0;
+            double error = 0;
+            sample.estimate_count(printed, total, error);
+            std::cout << "Sampled " << sample.fraction() * 100 << "% of candidates, about " << std::llround(total)
+                      << " +-" << std::llround(error) << " matches in total" << std::endl;
         }
 
         auto spent_time = steady_clock::now() - start;
         std::cout << std::endl
                   << "Execution time " << duration_cast<seconds>(spent_time).count() << "s "
                   << (duration_cast<milliseconds>(spent_time).count() % 1000) << "ms " << std::endl;
-
-        result.clear();
     } while (true);
 
 
@@ -15,11 +15,14 @@
 ///
 #include "hprof.h"
 #include "types.h"
+#include "types/text_kernels.h"
+#include "query_profiler.h"
 #include "tools.h"
 
 #include <iostream>
 #include <type_traits>
 #include <cassert>
+#include <iomanip>
 
 using namespace hprof;
 
@@ -75,7 +78,7 @@ static void print_field_value(const field_value_t& field, const objects_index_t&
             std::cout << (int) static_cast<jvm_byte_t>(field);
             break;
         case jvm_type_t::JVM_TYPE_CHAR:
-            std::cout << static_cast<jvm_char_t>(field);
+            std::cout << "'" << text_kernels_t::to_utf8(static_cast<jvm_char_t>(field)) << "'";
             break;
         case jvm_type_t::JVM_TYPE_SHORT:
             std::cout << static_cast<jvm_short_t>(field);
@@ -170,7 +173,7 @@ static void print_primitive_array(const primitives_array_info_t* array, const ob
                 std::cout << (static_cast<jvm_bool_t>(item) ? "true" : "false");
                 break;
             case jvm_type_t::JVM_TYPE_CHAR:
-                std::wcout << "'"<< (wchar_t) static_cast<jvm_char_t>(item) << "'";
+                std::cout << "'" << text_kernels_t::to_utf8(static_cast<jvm_char_t>(item)) << "'";
                 break;
             case jvm_type_t::JVM_TYPE_FLOAT:
                 std::cout << static_cast<jvm_float_t>(item);
@@ -277,3 +280,66 @@ void print_object(const heap_item_ptr_t& item, const objects_index_t& objects, i
             break;
     }
 }
+
+void print_array_waste_report(const array_waste_report_t& report) {
+    std::cout << std::setw(10) << "type" << std::setw(12) << "arrays" << std::setw(14) << "bytes"
+              << std::setw(12) << "zeroed" << std::setw(14) << "zeroed bytes"
+              << std::setw(12) << "constant" << std::setw(16) << "constant bytes"
+              << std::setw(16) << "mostly constant" << std::setw(22) << "mostly constant bytes" << std::endl;
+    for (auto& entry : report.entries()) {
+        std::cout << std::setw(10);
+        print_type(entry.type);
+        std::cout << std::setw(12) << entry.arrays << std::setw(14) << entry.bytes
+                  << std::setw(12) << entry.zeroed_arrays << std::setw(14) << entry.zeroed_bytes
+                  << std::setw(12) << entry.constant_arrays << std::setw(16) << entry.constant_bytes
+                  << std::setw(16) << entry.mostly_constant_arrays << std::setw(22) << entry.mostly_constant_bytes << std::endl;
+    }
+    std::cout << std::endl << "Wasted: " << report.wasted_bytes() << " bytes" << std::endl;
+}
+
+void print_row(const std::vector<std::string>& values) {
+    for (auto& value : values) {
+        if (&value != &values.front()) {
+            std::cout << " | ";
+        }
+        std::cout << value;
+    }
+    std::cout << std::endl;
+}
+
+void print_aggregate_rows(const std::vector<aggregate_row_t>& rows) {
+    for (auto& row : rows) {
+        if (!row.group.empty()) {
+            std::cout << row.group << " |";
+        }
+        for (auto& value : row.values) {
+            std::cout << ' ';
+            if (value.empty) {
+                std::cout << "null";
+                continue;
+            }
+            // Values of a sample are printed with their 95% confidence intervals
+            if (value.estimated) {
+                std::cout << '~';
+            }
+            if (value.integral) {
+                std::cout << value.int_value;
+            } else {
+                std::cout << std::setprecision(17) << value.double_value;
+            }
+            if (value.estimated) {
+                std::cout << " +-" << std::setprecision(6) << value.error;
+            }
+        }
+        std::cout << std::endl;
+    }
+}
+
+void print_explain(const std::vector<explain_node_t>& nodes, bool analyzed) {
+    std::string line;
+    for (auto& node : nodes) {
+        line.clear();
+        query_profiler_t::format(node, analyzed, line);
+        std::cout << line << std::endl;
+    }
+}
@@ -0,0 +1,54 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#pragma once
+
+#include "hprof.h"
+
+#include <vector>
+
+namespace hprof {
+    /// Memory held by primitive arrays which carry no information: arrays filled with zeros
+    /// and arrays where every item has the same value. Arrays where one value holds most items
+    /// are listed apart and are not counted as wasted.
+    class array_waste_report_t {
+    public:
+        struct entry_t {
+            jvm_type_t::type_spec type;
+            size_t arrays;
+            size_t bytes;
+            size_t zeroed_arrays;
+            size_t zeroed_bytes;
+            size_t constant_arrays;
+            size_t constant_bytes;
+            size_t mostly_constant_arrays;
+            size_t mostly_constant_bytes;
+        };
+
+        static constexpr double DEFAULT_DOMINANT_SHARE = 0.9;
+    public:
+        /// Arrays are mostly constant when one value holds at least the share of items, the share is above one half
+        explicit array_waste_report_t(double dominant_share = DEFAULT_DOMINANT_SHARE);
+
+        void add(const primitives_array_info_t& array);
+        bool collect(const heap_profile_t& profile);
+
+        std::vector<entry_t> entries() const;
+        size_t wasted_bytes() const;
+    private:
+        double _dominant_share;
+        entry_t _entries[jvm_type_t::JVM_TYPE_LONG + 1];
+    };
+}
@@ -0,0 +1,91 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#pragma once
+
+#include "hprof.h"
+
+#include <unordered_map>
+#include <vector>
+
+namespace hprof {
+    /// Secondary index over a primitive field of a class and its subclasses. Items are numbered in
+    /// the order the class index scan visits them. Lookups return every item a comparison can
+    /// match and may return more, the scan still checks each returned item with the filter
+    class field_index_t {
+    public:
+        enum kind_t {
+            KIND_HASH,
+            KIND_SORTED,
+            KIND_BITMAP
+        };
+
+        /// Automatic kind is a bitmap up to this number of distinct values
+        static const size_t BITMAP_MAX_VALUES = 64;
+        /// Explicit bitmap indexes are refused above this number of distinct values
+        static const size_t BITMAP_LIMIT_VALUES = 256;
+    public:
+        field_index_t(const std::string& class_name, const class_hierarchy_t& hierarchy, const std::string& field) :
+            _class_name(class_name), _hierarchy(hierarchy), _field(field), _kind(KIND_SORTED) {}
+
+        /// Items are instances of the hierarchy in the class index order, false when the kind doesn't fit the values
+        bool build(std::vector<const heap_item_ptr_t*>&& items, query_t::index_t kind);
+
+        kind_t kind() const { return _kind; }
+        const std::string& class_name() const { return _class_name; }
+        const class_hierarchy_t& hierarchy() const { return _hierarchy; }
+        const std::string& field() const { return _field; }
+        size_t size() const { return _items.size(); }
+
+        /// Every interval lies within the indexed hierarchy
+        bool covers(const std::vector<class_hierarchy_t>& hierarchies) const;
+
+        /// Upper bound of items the lookup returns, false when the index can't answer the comparison
+        bool estimate(column_kernels_t::compare_t compare, const filter_comp_value_t& literal, size_t& count) const;
+        /// Appends candidates in the scan order
+        void lookup(column_kernels_t::compare_t compare, const filter_comp_value_t& literal, std::vector<const heap_item_ptr_t*>& out) const;
+    private:
+        /// Closed intervals of integral and floating point keys covering every match
+        struct range_t {
+            bool integral;
+            int64_t first;
+            int64_t last;
+            bool floating;
+            double low;
+            double high;
+        };
+
+        static bool range(column_kernels_t::compare_t compare, const filter_comp_value_t& literal, range_t& result);
+        bool answers(column_kernels_t::compare_t compare) const;
+        void collect(const range_t& range, std::vector<u_int32_t>& ordinals) const;
+    private:
+        std::string _class_name;
+        class_hierarchy_t _hierarchy;
+        std::string _field;
+        kind_t _kind;
+        std::vector<const heap_item_ptr_t*> _items;
+
+        // Integral and boolean fields, sorted by value for KIND_SORTED
+        std::vector<std::pair<int64_t, u_int32_t>> _integral;
+        // KIND_HASH
+        std::unordered_map<int64_t, std::vector<u_int32_t>> _hashed;
+        // KIND_BITMAP, a bit per item for every distinct value
+        std::vector<int64_t> _values;
+        std::vector<std::vector<u_int64_t>> _bitmaps;
+        std::vector<size_t> _counts;
+        // Float and double fields of every kind, sorted by value without NaNs
+        std::vector<std::pair<double, u_int32_t>> _floating;
+    };
+}
@@ -0,0 +1,65 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#pragma once
+
+#include "filters/base.h"
+
+#include <vector>
+
+namespace hprof {
+    /// Filter tree flattened into a linear program over a single result register.
+    /// AND/OR become conditional jumps, bound instanceof checks run inline,
+    /// other filters are called through their virtual operator()
+    class filter_program_t {
+    public:
+        enum opcode_t : u_int8_t {
+            OP_CALL,
+            OP_INSTANCE_OF,
+            OP_NOT,
+            OP_JUMP_UNLESS_MATCH,
+            OP_JUMP_UNLESS_NO_MATCH
+        };
+
+        struct instruction_t {
+            opcode_t opcode;
+            /// Jump target or the first hierarchy of OP_INSTANCE_OF
+            u_int32_t first;
+            /// Hierarchies count of OP_INSTANCE_OF
+            u_int32_t count;
+            const filter_t* filter;
+        };
+    public:
+        /// Empty program matches everything, like a query without a filter
+        void compile(const filter_t* filter);
+
+        filter_t::filter_result_t operator()(const heap_item_ptr_t& item, const objects_index_t& objects) const;
+
+        void call(const filter_t& filter);
+        void instance_of(const std::vector<class_hierarchy_t>& hierarchies);
+        void negate();
+        /// Returns the jump to be pointed past the right operand with land()
+        size_t jump_unless(filter_t::filter_result_t result);
+        void land(size_t jump);
+
+        size_t size() const { return _code.size(); }
+        const instruction_t& operator[](size_t index) const { return _code[index]; }
+    private:
+        bool is_instance_of(const heap_item_ptr_t& item, const instruction_t& instruction) const;
+    private:
+        std::vector<instruction_t> _code;
+        std::vector<class_hierarchy_t> _hierarchies;
+    };
+}
@@ -25,6 +25,28 @@ namespace hprof {
             filter_apply_to_field_t(field_fetcher_t *fetcher, std::unique_ptr<filter_t>&& filter) :
                 filter_by_field_t(fetcher), _filter(std::move(filter)) {}
             virtual ~filter_apply_to_field_t() {}
+
+            virtual void bind(const classes_index_t& classes) override {
+                filter_by_field_t::bind(classes);
+                _filter->bind(classes);
+            }
+
+            virtual void bind_objects(const objects_index_t& objects) override {
+                _filter->bind_objects(objects);
+            }
+
+            virtual u_int32_t cost() const override { return filter_by_field_t::cost() + _filter->cost(); }
+
+            virtual bool key(std::string& out) const override {
+                out += "field(";
+                _field_fetcher->key(out);
+                out += ',';
+                if (!_filter->key(out)) {
+                    return false;
+                }
+                out += ')';
+                return true;
+            }
         protected:
             virtual bool match(const field_value_t& field, const objects_index_t& objects) const {
                 if (field.type() != jvm_type_t::JVM_TYPE_OBJECT) {
@@ -0,0 +1,580 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#pragma once
+
+#include "filters/base.h"
+#include "filters/filter_comp_value.h"
+#include "types/array_kernels.h"
+#include "types/text_kernels.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <vector>
+
+namespace hprof {
+    class filter_by_array_t : public filter_t {
+    public:
+        enum compare_t {
+            COMPARE_EQUALS,
+            COMPARE_NOT_EQUALS,
+            COMPARE_LESS,
+            COMPARE_LESS_OR_EQUALS,
+            COMPARE_GREATER,
+            COMPARE_GREATER_OR_EQUALS
+        };
+    public:
+        virtual ~filter_by_array_t() {}
+
+        virtual filter_result_t operator()(const heap_item_ptr_t& item, const objects_index_t&) const override {
+            if (item == nullptr || item->type() != heap_item_t::PrimitivesArray) {
+                return NoMatch;
+            }
+
+            const primitives_array_info_t* array = static_cast<const primitives_array_info_t*>(*item);
+            if (array->length() == 0) {
+                return NoMatch;
+            }
+
+            return match(*array) ? Match : NoMatch;
+        }
+
+        virtual u_int32_t cost() const override { return 8; }
+    protected:
+        virtual bool match(const primitives_array_info_t& array) const = 0;
+
+        static size_t data_size(const primitives_array_info_t& array) {
+            return array.length() * jvm_type_t::size(array.item_type(), array.id_size());
+        }
+    public:
+        template<typename T>
+        static bool satisfies(compare_t compare, const filter_comp_value_t& expected, T value) {
+            switch (compare) {
+                case COMPARE_EQUALS:
+                    return expected == value;
+                case COMPARE_NOT_EQUALS:
+                    return expected != value;
+                case COMPARE_LESS:
+                    return value < expected;
+                case COMPARE_LESS_OR_EQUALS:
+                    return value <= expected;
+                case COMPARE_GREATER:
+                    return value > expected;
+                case COMPARE_GREATER_OR_EQUALS:
+                    return value >= expected;
+            }
+            return false;
+        }
+
+        static void append_key(std::string& out, compare_t compare, const filter_comp_value_t& value) {
+            static const char* compares[] = { "eq", "ne", "lt", "le", "gt", "ge" };
+            out += compares[compare];
+            out += '(';
+            hprof::append_key(out, value);
+            out += ')';
+        }
+    };
+
+    class filter_array_zeroed_t : public filter_by_array_t {
+    public:
+        virtual ~filter_array_zeroed_t() {}
+
+        virtual bool key(std::string& out) const override {
+            out += "array.zeroed";
+            return true;
+        }
+    protected:
+        virtual bool match(const primitives_array_info_t& array) const override {
+            return array_kernels_t::is_zeroed(array.data(), data_size(array));
+        }
+    };
+
+    class filter_array_constant_t : public filter_by_array_t {
+    public:
+        virtual ~filter_array_constant_t() {}
+
+        virtual bool key(std::string& out) const override {
+            out += "array.constant";
+            return true;
+        }
+    protected:
+        virtual bool match(const primitives_array_info_t& array) const override {
+            return array_kernels_t::is_constant(array.data(), data_size(array), jvm_type_t::size(array.item_type(), array.id_size()));
+        }
+    };
+
+    /// One value holds at least the share of items, the share is above one half
+    class filter_array_mostly_constant_t : public filter_by_array_t {
+    public:
+        explicit filter_array_mostly_constant_t(double share) : _share(share) {}
+        virtual ~filter_array_mostly_constant_t() {}
+
+        virtual bool key(std::string& out) const override {
+            out += "array.constant(";
+            hprof::append_key(out, filter_comp_value_t { _share });
+            out += ')';
+            return true;
+        }
+    protected:
+        virtual bool match(const primitives_array_info_t& array) const override {
+            return array_kernels_t::dominant_share(array.item_type(), array.data(), array.length()) >= _share;
+        }
+    private:
+        double _share;
+    };
+
+    class filter_array_value_t : public filter_by_array_t {
+    public:
+        enum aggregate_t {
+            AGGREGATE_MIN,
+            AGGREGATE_MAX,
+            AGGREGATE_SUM
+        };
+
+    public:
+        filter_array_value_t(aggregate_t aggregate, compare_t compare, const filter_comp_value_t& value) :
+            _aggregate(aggregate), _compare(compare), _value(value) {}
+        virtual ~filter_array_value_t() {}
+
+        virtual bool key(std::string& out) const override {
+            static const char* aggregates[] = { "min", "max", "sum" };
+            out += "array.";
+            out += aggregates[_aggregate];
+            out += '.';
+            append_key(out, _compare, _value);
+            return true;
+        }
+    protected:
+        virtual bool match(const primitives_array_info_t& array) const override {
+            switch (array.item_type()) {
+                case jvm_type_t::JVM_TYPE_FLOAT:
+                case jvm_type_t::JVM_TYPE_DOUBLE: {
+                    array_summary_t<double> summary;
+                    if (!array_kernels_t::summarize(array.item_type(), array.data(), array.length(), summary)) {
+                        return false;
+                    }
+                    return compare(select(summary));
+                }
+                default: {
+                    array_summary_t<int64_t> summary;
+                    if (!array_kernels_t::summarize(array.item_type(), array.data(), array.length(), summary)) {
+                        return false;
+                    }
+                    return compare(select(summary));
+                }
+            }
+        }
+    private:
+        template<typename T>
+        T select(const array_summary_t<T>& summary) const {
+            switch (_aggregate) {
+                case AGGREGATE_MIN:
+                    return summary.min;
+                case AGGREGATE_MAX:
+                    return summary.max;
+                case AGGREGATE_SUM:
+                    return summary.sum;
+            }
+            return summary.sum;
+        }
+
+        template<typename T>
+        bool compare(T value) const {
+            return satisfies(_compare, _value, value);
+        }
+    private:
+        aggregate_t _aggregate;
+        compare_t _compare;
+        filter_comp_value_t _value;
+    };
+
+    /// Arrays of both kinds by the number of items, empty arrays included
+    class filter_array_length_t : public filter_t {
+    public:
+        filter_array_length_t(filter_by_array_t::compare_t compare, const filter_comp_value_t& value) : _compare(compare), _value(value) {}
+        virtual ~filter_array_length_t() {}
+
+        virtual filter_result_t operator()(const heap_item_ptr_t& item, const objects_index_t&) const override {
+            if (item == nullptr) {
+                return NoMatch;
+            }
+
+            size_t length = 0;
+            switch (item->type()) {
+                case heap_item_t::PrimitivesArray:
+                    length = static_cast<const primitives_array_info_t*>(*item)->length();
+                    break;
+                case heap_item_t::ObjectsArray:
+                    length = static_cast<const objects_array_info_t*>(*item)->length();
+                    break;
+                default:
+                    return NoMatch;
+            }
+            return filter_by_array_t::satisfies(_compare, _value, static_cast<int64_t>(length)) ? Match : NoMatch;
+        }
+
+        virtual bool key(std::string& out) const override {
+            out += "array.length.";
+            filter_by_array_t::append_key(out, _compare, _value);
+            return true;
+        }
+    private:
+        filter_by_array_t::compare_t _compare;
+        filter_comp_value_t _value;
+    };
+
+    /// Primitive arrays of the item type, JVM_TYPE_OBJECT stands for arrays of objects
+    class filter_array_of_t : public filter_t {
+    public:
+        explicit filter_array_of_t(jvm_type_t type) : _type(type) {}
+        virtual ~filter_array_of_t() {}
+
+        virtual filter_result_t operator()(const heap_item_ptr_t& item, const objects_index_t&) const override {
+            if (item == nullptr) {
+                return NoMatch;
+            }
+
+            switch (item->type()) {
+                case heap_item_t::PrimitivesArray:
+                    return static_cast<const primitives_array_info_t*>(*item)->item_type() == _type ? Match : NoMatch;
+                case heap_item_t::ObjectsArray:
+                    return _type == jvm_type_t::JVM_TYPE_OBJECT ? Match : NoMatch;
+                default:
+                    return NoMatch;
+            }
+        }
+
+        virtual bool key(std::string& out) const override {
+            out += "array.of(";
+            out += std::to_string(static_cast<int>(static_cast<jvm_type_t::type_spec>(_type)));
+            out += ')';
+            return true;
+        }
+
+        /// Java names of item types, any case. JVM_TYPE_UNKNOWN for other names
+        static jvm_type_t::type_spec type_by_name(const std::string& name) {
+            static const std::pair<const char*, jvm_type_t::type_spec> types[] = {
+                { "boolean", jvm_type_t::JVM_TYPE_BOOL }, { "byte", jvm_type_t::JVM_TYPE_BYTE },
+                { "char", jvm_type_t::JVM_TYPE_CHAR }, { "short", jvm_type_t::JVM_TYPE_SHORT },
+                { "int", jvm_type_t::JVM_TYPE_INT }, { "long", jvm_type_t::JVM_TYPE_LONG },
+                { "float", jvm_type_t::JVM_TYPE_FLOAT }, { "double", jvm_type_t::JVM_TYPE_DOUBLE },
+                { "object", jvm_type_t::JVM_TYPE_OBJECT }
+            };
+
+            std::string lower { name };
+            std::transform(std::begin(lower), std::end(lower), std::begin(lower), [] (char chr) { return static_cast<char>(std::tolower(chr)); });
+            for (auto& type : types) {
+                if (lower == type.first) {
+                    return type.second;
+                }
+            }
+            return jvm_type_t::JVM_TYPE_UNKNOWN;
+        }
+    private:
+        jvm_type_t _type;
+    };
+
+    /// Some item of a primitive array compares to the value. Orderings are decided by the minimum or
+    /// the maximum of the array, equal items are looked for in the payload with the vectorized search
+    class filter_array_any_t : public filter_by_array_t {
+    public:
+        filter_array_any_t(compare_t compare, const filter_comp_value_t& value) : _compare(compare), _value(value) {}
+        virtual ~filter_array_any_t() {}
+
+        virtual bool key(std::string& out) const override {
+            out += "array.any.";
+            append_key(out, _compare, _value);
+            return true;
+        }
+    protected:
+        virtual bool match(const primitives_array_info_t& array) const override {
+            if (_compare == COMPARE_EQUALS) {
+                return contains(array);
+            }
+
+            switch (array.item_type()) {
+                case jvm_type_t::JVM_TYPE_FLOAT:
+                case jvm_type_t::JVM_TYPE_DOUBLE: {
+                    array_summary_t<double> summary;
+                    return array_kernels_t::summarize(array.item_type(), array.data(), array.length(), summary) && match(summary);
+                }
+                default: {
+                    array_summary_t<int64_t> summary;
+                    return array_kernels_t::summarize(array.item_type(), array.data(), array.length(), summary) && match(summary);
+                }
+            }
+        }
+    private:
+        template<typename T>
+        bool match(const array_summary_t<T>& summary) const {
+            switch (_compare) {
+                case COMPARE_NOT_EQUALS:
+                    return satisfies(COMPARE_NOT_EQUALS, _value, summary.min) || satisfies(COMPARE_NOT_EQUALS, _value, summary.max);
+                case COMPARE_LESS:
+                case COMPARE_LESS_OR_EQUALS:
+                    return satisfies(_compare, _value, summary.min);
+                case COMPARE_GREATER:
+                case COMPARE_GREATER_OR_EQUALS:
+                    return satisfies(_compare, _value, summary.max);
+                case COMPARE_EQUALS:
+                    break;
+            }
+            return false;
+        }
+
+        /// The value is written as a big-endian item, a value out of the item range can't be found
+        bool contains(const primitives_array_info_t& array) const {
+            size_t item_size = jvm_type_t::size(array.item_type(), array.id_size());
+            switch (array.item_type()) {
+                case jvm_type_t::JVM_TYPE_FLOAT: {
+                    double expected = 0;
+                    if (!as_double(expected)) {
+                        return false;
+                    }
+                    // NaN and values a float can't hold never equal an item
+                    jvm_float_t narrowed = static_cast<jvm_float_t>(expected);
+                    if (narrowed != expected) {
+                        return false;
+                    }
+                    u_int32_t bits;
+                    std::memcpy(&bits, &narrowed, sizeof(bits));
+                    return contains_bits(array, bits, 0x80000000u, item_size);
+                }
+                case jvm_type_t::JVM_TYPE_DOUBLE: {
+                    double expected = 0;
+                    if (!as_double(expected) || expected != expected) {
+                        return false;
+                    }
+                    u_int64_t bits;
+                    std::memcpy(&bits, &expected, sizeof(bits));
+                    return contains_bits(array, bits, 0x8000000000000000ull, item_size);
+                }
+                default: {
+                    int64_t expected = 0;
+                    if (!as_int(expected) || !in_range(array.item_type(), expected)) {
+                        return false;
+                    }
+                    u_int8_t item[8];
+                    store_be(static_cast<u_int64_t>(expected), item, item_size);
+                    return array_kernels_t::contains_item(array.data(), array.length(), item, item_size);
+                }
+            }
+        }
+
+        /// Floating point zeros are equal whatever the sign is
+        static bool contains_bits(const primitives_array_info_t& array, u_int64_t bits, u_int64_t sign, size_t item_size) {
+            u_int8_t item[8];
+            store_be(bits, item, item_size);
+            if (array_kernels_t::contains_item(array.data(), array.length(), item, item_size)) {
+                return true;
+            }
+            if ((bits & ~sign) != 0) {
+                return false;
+            }
+            store_be(bits ^ sign, item, item_size);
+            return array_kernels_t::contains_item(array.data(), array.length(), item, item_size);
+        }
+
+        static void store_be(u_int64_t value, u_int8_t* out, size_t size) {
+            for (size_t index = size; index > 0; --index) {
+                out[index - 1] = static_cast<u_int8_t>(value);
+                value >>= 8;
+            }
+        }
+
+        static bool in_range(jvm_type_t type, int64_t value) {
+            switch (type) {
+                case jvm_type_t::JVM_TYPE_BOOL:
+                    return value == 0 || value == 1;
+                case jvm_type_t::JVM_TYPE_BYTE:
+                    return value >= std::numeric_limits<jvm_byte_t>::min() && value <= std::numeric_limits<jvm_byte_t>::max();
+                case jvm_type_t::JVM_TYPE_CHAR:
+                    return value >= std::numeric_limits<jvm_char_t>::min() && value <= std::numeric_limits<jvm_char_t>::max();
+                case jvm_type_t::JVM_TYPE_SHORT:
+                    return value >= std::numeric_limits<jvm_short_t>::min() && value <= std::numeric_limits<jvm_short_t>::max();
+                case jvm_type_t::JVM_TYPE_INT:
+                    return value >= std::numeric_limits<jvm_int_t>::min() && value <= std::numeric_limits<jvm_int_t>::max();
+                case jvm_type_t::JVM_TYPE_LONG:
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        /// Doubles are truncated the same way the comparison operators do
+        bool as_int(int64_t& value) const {
+            switch (_value.type) {
+                case filter_comp_value_t::TYPE_INT:
+                    value = _value.int_value;
+                    return true;
+                case filter_comp_value_t::TYPE_DOUBLE:
+                    value = static_cast<int64_t>(_value.double_value);
+                    return true;
+                case filter_comp_value_t::TYPE_BOOL:
+                    value = _value.bool_value ? 1 : 0;
+                    return true;
+                case filter_comp_value_t::TYPE_TEXT:
+                    break;
+            }
+            return false;
+        }
+
+        bool as_double(double& value) const {
+            switch (_value.type) {
+                case filter_comp_value_t::TYPE_INT:
+                    value = static_cast<double>(_value.int_value);
+                    return true;
+                case filter_comp_value_t::TYPE_DOUBLE:
+                    value = _value.double_value;
+                    return true;
+                case filter_comp_value_t::TYPE_BOOL:
+                case filter_comp_value_t::TYPE_TEXT:
+                    break;
+            }
+            return false;
+        }
+    private:
+        compare_t _compare;
+        filter_comp_value_t _value;
+    };
+
+    /// Some item of an object array is an instance of the class or of its subclasses. The class is resolved
+    /// once into a bitset over class hierarchy numbers, an item costs a lookup of the object and a bit test
+    class filter_array_any_instance_of_t : public filter_t {
+    public:
+        explicit filter_array_any_instance_of_t(const std::string& name) : _class_name(name), _bound(false) {}
+        virtual ~filter_array_any_instance_of_t() {}
+
+        virtual filter_result_t operator()(const heap_item_ptr_t& item, const objects_index_t& objects) const override {
+            if (item == nullptr || item->type() != heap_item_t::ObjectsArray) {
+                return NoMatch;
+            }
+
+            auto array = static_cast<const objects_array_info_t*>(*item);
+            for (auto it = array->begin(); it != array->end(); ++it) {
+                if (*it == 0) {
+                    continue;
+                }
+                auto element = objects.find_object(*it);
+                if (element != nullptr && is_instance(element)) {
+                    return Match;
+                }
+            }
+            return NoMatch;
+        }
+
+        virtual u_int32_t cost() const override { return 32; }
+
+        virtual bool key(std::string& out) const override {
+            out += "array.any.instanceof(";
+            out += std::to_string(_class_name.size());
+            out += ':';
+            out += _class_name;
+            out += ')';
+            return true;
+        }
+
+        /// Unnumbered classes keep the lookup by name
+        virtual void bind(const classes_index_t& classes) override {
+            std::vector<heap_item_ptr_t> found;
+            classes.find_classes(_class_name, found);
+
+            _classes.assign(classes.count_classes() / 64 + 1, 0);
+            _bound = true;
+            for (auto& item : found) {
+                const class_hierarchy_t& hierarchy = static_cast<const class_info_t*>(*item)->hierarchy();
+                if (hierarchy.enter == 0) {
+                    _bound = false;
+                    break;
+                }
+                u_int32_t last = std::min<u_int32_t>(hierarchy.exit, static_cast<u_int32_t>(_classes.size() * 64 - 1));
+                for (u_int32_t index = hierarchy.enter; index <= last; ++index) {
+                    _classes[index / 64] |= 1ull << (index % 64);
+                }
+            }
+        }
+    private:
+        bool is_instance(const heap_item_ptr_t& item) const {
+            const class_info_t* cls = nullptr;
+            switch (item->type()) {
+                case heap_item_t::Object:
+                    cls = static_cast<const instance_info_t*>(*item)->get_class();
+                    break;
+                case heap_item_t::String:
+                    cls = static_cast<const string_info_t*>(*item)->get_class();
+                    break;
+                default:
+                    return false;
+            }
+            if (cls == nullptr) {
+                return false;
+            }
+
+            u_int32_t enter = cls->hierarchy().enter;
+            if (_bound && enter != 0) {
+                return enter / 64 < _classes.size() && (_classes[enter / 64] & (1ull << (enter % 64))) != 0;
+            }
+
+            for (; cls != nullptr; cls = cls->super()) {
+                if (cls->name() == _class_name) {
+                    return true;
+                }
+            }
+            return false;
+        }
+    private:
+        std::string _class_name;
+        bool _bound;
+        // Bit per class hierarchy number
+        std::vector<u_int64_t> _classes;
+    };
+
+    /// Text in char[] payloads as big-endian UTF-16 or in byte[] payloads as Latin-1 or UTF-8, found without decoding
+    class filter_array_contains_text_t : public filter_by_array_t {
+    public:
+        explicit filter_array_contains_text_t(const std::string& text) : _text(text), _valid(text_kernels_t::encode_needle(text, _needle)) {}
+        virtual ~filter_array_contains_text_t() {}
+
+        virtual bool key(std::string& out) const override {
+            out += "array.contains(t";
+            out += std::to_string(_text.size());
+            out += ':';
+            out += _text;
+            out += ')';
+            return true;
+        }
+    protected:
+        virtual bool match(const primitives_array_info_t& array) const override {
+            if (!_valid) {
+                return false;
+            }
+
+            switch (array.item_type()) {
+                case jvm_type_t::JVM_TYPE_CHAR:
+                    return text_kernels_t::contains(array.data(), data_size(array), _needle.utf16be, 2);
+                case jvm_type_t::JVM_TYPE_BYTE:
+                    return (!_needle.wide && text_kernels_t::contains(array.data(), data_size(array), _needle.latin1, 1)) ||
+                           text_kernels_t::contains(array.data(), data_size(array), _text, 1);
+                default:
+                    return false;
+            }
+        }
+    private:
+        std::string _text;
+        text_needle_t _needle;
+        bool _valid;
+    };
+}
@@ -15,10 +15,17 @@
 ///
 #pragma once
 
+#include "objects_index.h"
 #include "types/fields.h"
 #include "filters/field_fetcher.h"
+#include "types/column_kernels.h"
+
+#include <limits>
+#include <mutex>
 
 namespace hprof {
+    class filter_program_t;
+
     class filter_t {
     public:
         enum filter_result_t : int {
@@ -29,6 +36,58 @@ namespace hprof {
     public:
         virtual ~filter_t() {}
         virtual filter_result_t operator()(const heap_item_ptr_t& item, const objects_index_t& objects) const = 0;
+        /// Called once per query before the scan, lets filters resolve names against the profile
+        virtual void bind(const classes_index_t&) {}
+        /// Called once per query before the scan, lets filters resolve literals to objects
+        virtual void bind_objects(const objects_index_t&) {}
+        /// Returns true when only instances of classes within the appended hierarchies can match
+        virtual bool restrict_classes(std::vector<class_hierarchy_t>&) const { return false; }
+        /// Relative cost of a single check
+        virtual u_int32_t cost() const { return 1; }
+        /// Appends the filter to the flat program evaluated by the scan, leaves are called as is
+        virtual void compile(filter_program_t& program) const;
+        /// Evaluates up to column_kernels_t::BATCH_SIZE instances of the same class at once, a bit per
+        /// matching item. Returns false when items have to be checked one by one
+        virtual bool select(const heap_item_ptr_t* const*, size_t, u_int64_t*) const { return false; }
+        /// Appends canonical text of the filter, filters with equal keys match the same items.
+        /// Returns false when the filter can't be keyed and its results must not be cached
+        virtual bool key(std::string&) const { return false; }
+
+        /// Upper bound of matching items, unknown when the filter doesn't restrict classes
+        size_t estimate(const classes_index_t& classes) const {
+            std::vector<class_hierarchy_t> hierarchies;
+            if (!restrict_classes(hierarchies)) {
+                return std::numeric_limits<size_t>::max();
+            }
+
+            class_hierarchy_t::merge(hierarchies);
+            size_t result = 0;
+            for (auto& hierarchy : hierarchies) {
+                result += classes.count_instances(hierarchy);
+            }
+            return result;
+        }
+
+        /// Binds the tree on the first plan of the query only, cursors opened by earlier plans read the bound state
+        void bind_once(const classes_index_t& classes) {
+            std::lock_guard<std::mutex> lock { _bind_lock };
+            if (_classes_bound_to != &classes) {
+                bind(classes);
+                _classes_bound_to = &classes;
+            }
+        }
+
+        void bind_objects_once(const objects_index_t& objects) {
+            std::lock_guard<std::mutex> lock { _bind_lock };
+            if (_objects_bound_to != &objects) {
+                bind_objects(objects);
+                _objects_bound_to = &objects;
+            }
+        }
+    private:
+        std::mutex _bind_lock;
+        const classes_index_t* _classes_bound_to = nullptr;
+        const objects_index_t* _objects_bound_to = nullptr;
     };
 
     class filter_fetch_all_t : public filter_t {
@@ -37,11 +96,16 @@ namespace hprof {
         virtual filter_result_t operator()(const heap_item_ptr_t&, const objects_index_t&) const override {
             return Match;
         }
+
+        virtual bool key(std::string& out) const override {
+            out += "all";
+            return true;
+        }
     };
 
     class filter_by_field_t : public filter_t {
     public:
-        explicit filter_by_field_t(field_fetcher_t *fetcher) : _field_fetcher(fetcher) {}
+        explicit filter_by_field_t(field_fetcher_t *fetcher) : _field_fetcher(fetcher), _bound(false) {}
         virtual ~filter_by_field_t() {}
 
         virtual filter_result_t operator()(const heap_item_ptr_t& item, const objects_index_t& objects) const override {
@@ -49,16 +113,86 @@ namespace hprof {
                 return NoMatch;
             }
 
+            if (_bound) {
+                const instance_info_t* instance = as_instance(item);
+                if (!has_field(instance->get_class())) {
+                    return NoMatch;
+                }
+            }
+
             if (_field_fetcher->apply(item, objects, [this, &objects] (auto& field) -> bool { return this->match(field, objects); })) {
                 return Match;
             }
 
             return NoMatch;
         }
+
+        /// Only classes declaring the first field and their subclasses can match
+        virtual void bind(const classes_index_t& classes) override {
+            _hierarchies.clear();
+            _bound = false;
+            if (_field_fetcher->depth() == 0) {
+                return;
+            }
+
+            _field_fetcher->bind(classes);
+
+            std::vector<heap_item_ptr_t> found;
+            classes.find_declaring_classes(_field_fetcher->first(), found);
+
+            _hierarchies.clear();
+            _bound = true;
+            for (auto& item : found) {
+                const class_hierarchy_t& hierarchy = static_cast<const class_info_t*>(*item)->hierarchy();
+                if (hierarchy.enter == 0) {
+                    _bound = false;
+                    break;
+                }
+                _hierarchies.push_back(hierarchy);
+            }
+            class_hierarchy_t::merge(_hierarchies);
+        }
+
+        virtual bool restrict_classes(std::vector<class_hierarchy_t>& hierarchies) const override {
+            if (!_bound) {
+                return false;
+            }
+            hierarchies.insert(hierarchies.end(), _hierarchies.begin(), _hierarchies.end());
+            return true;
+        }
+
+        virtual u_int32_t cost() const override { return 1 + 2 * static_cast<u_int32_t>(_field_fetcher->depth()); }
+
+        const field_fetcher_t& field() const { return *_field_fetcher; }
+
+        /// Objects and strings, null for other items
+        static const instance_info_t* as_instance(const heap_item_ptr_t& item) {
+            switch (item->type()) {
+                case heap_item_t::Object:
+                    return static_cast<const instance_info_t*>(*item);
+                case heap_item_t::String:
+                    return static_cast<const string_info_t*>(*item);
+                default:
+                    return nullptr;
+            }
+        }
     protected:
         virtual bool match(const field_value_t& field, const objects_index_t& objects) const = 0;
 
+        bool has_field(const class_info_t* cls) const {
+            if (cls == nullptr || cls->hierarchy().enter == 0) {
+                return true;
+            }
+            for (auto& hierarchy : _hierarchies) {
+                if (hierarchy.contains(cls->hierarchy())) {
+                    return true;
+                }
+            }
+            return false;
+        }
     protected:
         std::unique_ptr<field_fetcher_t> _field_fetcher;
+        bool _bound;
+        std::vector<class_hierarchy_t> _hierarchies;
     };
 }
@@ -20,245 +20,339 @@
 
 #include "types/string_instance.h"
 
+#include <algorithm>
+#include <functional>
+#include <limits>
+
 namespace hprof {
 
+    /// Literal conversions and type checks are resolved once when the filter is created,
+    /// every field type gets its own comparison routine so the check is a single indirect call
     class filter_compare_field_t : public filter_by_field_t {
     public:
-        filter_compare_field_t(field_fetcher_t *fetcher, const filter_comp_value_t& value) : filter_by_field_t(fetcher), _value(value) {}
         virtual ~filter_compare_field_t() {}
-    protected:
-        filter_comp_value_t _value;
-    };
 
-    class filter_compare_equals_field_t : public filter_compare_field_t {
-    public:
-        filter_compare_equals_field_t(field_fetcher_t *fetcher, const filter_comp_value_t& value) : filter_compare_field_t(fetcher, value) {}
-        virtual ~filter_compare_equals_field_t() {}
+        virtual bool key(std::string& out) const override {
+            static const char* names[] = { "eq", "ne", "lt", "le", "gt", "ge" };
+            out += names[_compare];
+            out += '(';
+            _field_fetcher->key(out);
+            out += ',';
+            out += _literal_key;
+            out += ')';
+            return true;
+        }
+
+        /// String equality is reduced to comparing ids of the strings holding the literal
+        virtual void bind_objects(const objects_index_t& objects) override {
+            _string_ids.clear();
+            _strings_bound = _has_text && objects.find_strings(_text_value, _string_ids);
+        }
 
+        column_kernels_t::compare_t comparison() const { return _compare; }
+        const filter_comp_value_t& value() const { return _value; }
     protected:
-        virtual bool match(const field_value_t& field, const objects_index_t& objects) const {
-            switch (field.type()) {
-                case jvm_type_t::JVM_TYPE_UNKNOWN:
-                    return false;
-                case jvm_type_t::JVM_TYPE_BOOL: {
-                    if (_value.type != filter_comp_value_t::TYPE_BOOL) {
-                        return false;
+        using matcher_t = bool (*)(const filter_compare_field_t&, const field_value_t&, const objects_index_t&);
+
+        filter_compare_field_t(field_fetcher_t *fetcher, column_kernels_t::compare_t compare, const filter_comp_value_t& value) : 
+            filter_by_field_t(fetcher), _compare(compare), _value(value), _double_literal(value.type == filter_comp_value_t::TYPE_DOUBLE),
+            _int_value(0), _double_value(0), _bool_value(false), _has_text(false), _strings_bound(false) {
+            append_key(_literal_key, value);
+            switch (value.type) {
+                case filter_comp_value_t::TYPE_INT:
+                    _int_value = value.int_value;
+                    _double_value = value.int_value;
+                    break;
+                case filter_comp_value_t::TYPE_DOUBLE:
+                    _int_value = static_cast<int64_t>(value.double_value);
+                    _double_value = value.double_value;
+                    break;
+                case filter_comp_value_t::TYPE_BOOL:
+                    _bool_value = value.bool_value;
+                    break;
+                case filter_comp_value_t::TYPE_TEXT:
+                    _has_text = value.text_value != nullptr;
+                    if (_has_text) {
+                        _text_value = value.text_value;
                     }
-                    return _value.bool_value == static_cast<jvm_bool_t>(field);
+                    break;
+            }
+        }
+
+        virtual bool match(const field_value_t& field, const objects_index_t& objects) const override {
+            return _matchers[static_cast<jvm_type_t::type_spec>(field.type())](*this, field, objects);
+        }
+
+        /// Single field of primitive type is gathered into a column, the column gets the
+        /// same literal conversions as match() does
+        virtual bool select(const heap_item_ptr_t* const* items, size_t count, u_int64_t* selection) const override {
+            if (!_bound || _field_fetcher->depth() != 1 || count == 0 || count > column_kernels_t::BATCH_SIZE) {
+                return false;
+            }
+
+            const instance_info_t* first = as_instance(*items[0]);
+            if (first == nullptr) {
+                return false;
+            }
+
+            auto& fields = first->fields();
+            auto field = has_field(first->get_class()) ? _field_fetcher->find_first(*first) : std::end(fields);
+            if (field == std::end(fields) || _matchers[static_cast<jvm_type_t::type_spec>(field->type())] == &never) {
+                column_kernels_t::fill(selection, count, false);
+                return true;
+            }
+
+            jvm_type_t type = field->type();
+            if (type == jvm_type_t::JVM_TYPE_OBJECT) {
+                return false;
+            }
+
+            const u_int8_t* rows[column_kernels_t::BATCH_SIZE];
+            for (size_t index = 0; index < count; ++index) {
+                const instance_info_t* instance = as_instance(*items[index]);
+                if (instance == nullptr) {
+                    return false;
                 }
+                rows[index] = instance->data();
+            }
+
+            size_t offset = field->offset();
+            switch (type) {
+                case jvm_type_t::JVM_TYPE_BOOL:
+                    select_int32(type, rows, count, offset, _bool_value ? 1 : 0, selection);
+                    return true;
                 case jvm_type_t::JVM_TYPE_BYTE:
-                    return _value == static_cast<int64_t>(static_cast<jvm_byte_t>(field));
                 case jvm_type_t::JVM_TYPE_SHORT:
-                    return _value == static_cast<int64_t>(static_cast<jvm_short_t>(field));
                 case jvm_type_t::JVM_TYPE_CHAR:
-                    return _value == static_cast<int64_t>(static_cast<jvm_char_t>(field));
                 case jvm_type_t::JVM_TYPE_INT:
-                    return _value == static_cast<int64_t>(static_cast<jvm_int_t>(field));
+                    if (!_double_literal || is_equality()) {
+                        select_int32(type, rows, count, offset, _int_value, selection);
+                        return true;
+                    }
+                    break;
                 case jvm_type_t::JVM_TYPE_LONG:
-                    return _value == static_cast<jvm_long_t>(field);
+                    if (!_double_literal || is_equality()) {
+                        int64_t column[column_kernels_t::BATCH_SIZE];
+                        column_kernels_t::gather(type, rows, count, offset, column);
+                        column_kernels_t::select(_compare, column, count, _int_value, selection);
+                        return true;
+                    }
+                    break;
                 case jvm_type_t::JVM_TYPE_FLOAT:
-                    return _value == static_cast<jvm_float_t>(field);
-                case jvm_type_t::JVM_TYPE_DOUBLE:
-                    return _value == static_cast<jvm_double_t>(field);
-                case jvm_type_t::JVM_TYPE_OBJECT: {
-                    if (_value.type != filter_comp_value_t::TYPE_TEXT) {
-                        return false;
+                    if (!_double_literal) {
+                        // float field is compared with the literal converted to float
+                        select_double(type, rows, count, offset, static_cast<jvm_float_t>(_int_value), selection);
+                        return true;
                     }
+                    break;
+                default:
+                    break;
+            }
+            select_double(type, rows, count, offset, _double_value, selection);
+            return true;
+        }
 
-                    jvm_id_t id = static_cast<jvm_id_t>(field);
-                    if (id == 0) {
-                        return false;
-                    }
+        /// Fills the per type table, equality operators also accept booleans and strings,
+        /// integral fields are compared with the truncated literal for equality only
+        template<typename compare_op, bool equality>
+        void resolve(const filter_comp_value_t& value) {
+            for (auto& matcher : _matchers) {
+                matcher = &never;
+            }
 
-                    auto value = objects.find_object(id);
-                    if (value == nullptr) {
-                        return _value.text_value == nullptr;
+            switch (value.type) {
+                case filter_comp_value_t::TYPE_BOOL:
+                    if (equality) {
+                        _matchers[jvm_type_t::JVM_TYPE_BOOL] = &compare_bool<compare_op>;
                     }
-
-                    if (value->type() != heap_item_t::String) {
-                        return false;
+                    break;
+                case filter_comp_value_t::TYPE_TEXT:
+                    if (equality) {
+                        _matchers[jvm_type_t::JVM_TYPE_OBJECT] = &compare_text<compare_op()(0, 0)>;
                     }
-                    
-                    const string_info_t* str = static_cast<const string_info_t*>(*value);
-                    return str->value() == _value.text_value;
+                    break;
+                case filter_comp_value_t::TYPE_INT:
+                    resolve_numbers<compare_op, int64_t, int64_t>();
+                    break;
+                case filter_comp_value_t::TYPE_DOUBLE:
+                    if (equality) {
+                        resolve_numbers<compare_op, int64_t, double>();
+                    } else {
+                        resolve_numbers<compare_op, double, double>();
+                    }
+                    break;
+            }
+        }
+    private:
+        bool is_equality() const {
+            return _compare == column_kernels_t::COMPARE_EQUALS || _compare == column_kernels_t::COMPARE_NOT_EQUALS;
+        }
+
+        /// Literals out of int range select all or nothing
+        void select_int32(jvm_type_t type, const u_int8_t* const* rows, size_t count, size_t offset, int64_t literal, u_int64_t* selection) const {
+            if (literal < std::numeric_limits<int32_t>::min() || literal > std::numeric_limits<int32_t>::max()) {
+                bool above = literal > 0;
+                switch (_compare) {
+                    case column_kernels_t::COMPARE_EQUALS:
+                        column_kernels_t::fill(selection, count, false);
+                        return;
+                    case column_kernels_t::COMPARE_NOT_EQUALS:
+                        column_kernels_t::fill(selection, count, true);
+                        return;
+                    case column_kernels_t::COMPARE_LESS:
+                    case column_kernels_t::COMPARE_LESS_OR_EQUALS:
+                        column_kernels_t::fill(selection, count, above);
+                        return;
+                    case column_kernels_t::COMPARE_GREATER:
+                    case column_kernels_t::COMPARE_GREATER_OR_EQUALS:
+                        column_kernels_t::fill(selection, count, !above);
+                        return;
                 }
             }
+
+            int32_t column[column_kernels_t::BATCH_SIZE];
+            column_kernels_t::gather(type, rows, count, offset, column);
+            column_kernels_t::select(_compare, column, count, static_cast<int32_t>(literal), selection);
         }
-    };
 
-    class filter_compare_not_equals_field_t : public filter_compare_field_t {
-    public:
-        filter_compare_not_equals_field_t(field_fetcher_t *fetcher, const filter_comp_value_t& value) : filter_compare_field_t(fetcher, value) {}
-        virtual ~filter_compare_not_equals_field_t() {}
+        void select_double(jvm_type_t type, const u_int8_t* const* rows, size_t count, size_t offset, double literal, u_int64_t* selection) const {
+            double column[column_kernels_t::BATCH_SIZE];
+            column_kernels_t::gather(type, rows, count, offset, column);
+            column_kernels_t::select(_compare, column, count, literal, selection);
+        }
 
-    protected:
-        virtual bool match(const field_value_t& field, const objects_index_t& objects) const {
-            switch (field.type()) {
-                case jvm_type_t::JVM_TYPE_UNKNOWN:
-                    return false;
-                case jvm_type_t::JVM_TYPE_BOOL: {
-                    if (_value.type != filter_comp_value_t::TYPE_BOOL) {
-                        return false;
-                    }
-                    return _value.bool_value != static_cast<jvm_bool_t>(field);
-                }
-                case jvm_type_t::JVM_TYPE_BYTE:
-                    return _value != static_cast<int64_t>(static_cast<jvm_byte_t>(field));
-                case jvm_type_t::JVM_TYPE_SHORT:
-                    return _value != static_cast<int64_t>(static_cast<jvm_short_t>(field));
-                case jvm_type_t::JVM_TYPE_CHAR:
-                    return _value != static_cast<int64_t>(static_cast<jvm_char_t>(field));
-                case jvm_type_t::JVM_TYPE_INT:
-                    return _value != static_cast<int64_t>(static_cast<jvm_int_t>(field));
-                case jvm_type_t::JVM_TYPE_LONG:
-                    return _value != static_cast<jvm_long_t>(field);
-                case jvm_type_t::JVM_TYPE_FLOAT:
-                    return _value != static_cast<jvm_float_t>(field);
-                case jvm_type_t::JVM_TYPE_DOUBLE:
-                    return _value != static_cast<jvm_double_t>(field);
-                case jvm_type_t::JVM_TYPE_OBJECT: {
-                    if (_value.type != filter_comp_value_t::TYPE_TEXT) {
-                        return false;
-                    }
+        /// Integral fields are widened to int64, floating point fields are compared as is
+        template<typename compare_op, typename integral_literal_t, typename floating_literal_t>
+        void resolve_numbers() {
+            _matchers[jvm_type_t::JVM_TYPE_BYTE] = &compare_number<compare_op, jvm_byte_t, int64_t, integral_literal_t>;
+            _matchers[jvm_type_t::JVM_TYPE_SHORT] = &compare_number<compare_op, jvm_short_t, int64_t, integral_literal_t>;
+            _matchers[jvm_type_t::JVM_TYPE_CHAR] = &compare_number<compare_op, jvm_char_t, int64_t, integral_literal_t>;
+            _matchers[jvm_type_t::JVM_TYPE_INT] = &compare_number<compare_op, jvm_int_t, int64_t, integral_literal_t>;
+            _matchers[jvm_type_t::JVM_TYPE_LONG] = &compare_number<compare_op, jvm_long_t, jvm_long_t, integral_literal_t>;
+            _matchers[jvm_type_t::JVM_TYPE_FLOAT] = &compare_number<compare_op, jvm_float_t, jvm_float_t, floating_literal_t>;
+            _matchers[jvm_type_t::JVM_TYPE_DOUBLE] = &compare_number<compare_op, jvm_double_t, jvm_double_t, floating_literal_t>;
+        }
 
-                    jvm_id_t id = static_cast<jvm_id_t>(field);
-                    if (id == 0) {
-                        return false;
-                    }
+        template<typename T>
+        T literal() const;
 
-                    auto value = objects.find_object(id);
-                    if (value == nullptr) {
-                        return _value.text_value != nullptr;
-                    }
+        static bool never(const filter_compare_field_t&, const field_value_t&, const objects_index_t&) {
+            return false;
+        }
 
-                    if (value->type() != heap_item_t::String) {
-                        return false;
-                    }
+        template<typename compare_op, typename field_type_t, typename widened_t, typename literal_t>
+        static bool compare_number(const filter_compare_field_t& filter, const field_value_t& field, const objects_index_t&) {
+            return compare_op()(static_cast<widened_t>(static_cast<field_type_t>(field)), filter.literal<literal_t>());
+        }
+
+        template<typename compare_op>
+        static bool compare_bool(const filter_compare_field_t& filter, const field_value_t& field, const objects_index_t&) {
+            return compare_op()(filter._bool_value, static_cast<jvm_bool_t>(field));
+        }
+
+        /// Null references never match, a dangling reference only equals to the null literal
+        template<bool equals>
+        static bool compare_text(const filter_compare_field_t& filter, const field_value_t& field, const objects_index_t& objects) {
+            jvm_id_t id = static_cast<jvm_id_t>(field);
+            if (id == 0) {
+                return false;
+            }
 
-                    const string_info_t* str = static_cast<const string_info_t*>(*value);
-                    return str->value() != _value.text_value;
+            if (filter._strings_bound) {
+                if (std::binary_search(std::begin(filter._string_ids), std::end(filter._string_ids), id)) {
+                    return equals;
+                }
+                if (equals) {
+                    return false;
                 }
+                auto value = objects.find_object(id);
+                return value == nullptr || value->type() == heap_item_t::String;
+            }
+
+            auto value = objects.find_object(id);
+            if (value == nullptr) {
+                return equals != filter._has_text;
+            }
+
+            if (value->type() != heap_item_t::String || !filter._has_text) {
+                return false;
             }
+
+            const string_info_t* str = static_cast<const string_info_t*>(*value);
+            return (str->value() == filter._text_value) == equals;
         }
+    private:
+        column_kernels_t::compare_t _compare;
+        filter_comp_value_t _value;
+        bool _double_literal;
+        matcher_t _matchers[jvm_type_t::JVM_TYPE_LONG + 1];
+        int64_t _int_value;
+        double _double_value;
+        bool _bool_value;
+        bool _has_text;
+        std::string _text_value;
+        std::string _literal_key;
+        bool _strings_bound;
+        std::vector<jvm_id_t> _string_ids;
     };
 
-    class filter_compare_less_field_t : public filter_compare_field_t {
+    template<>
+    inline int64_t filter_compare_field_t::literal<int64_t>() const { return _int_value; }
+
+    template<>
+    inline double filter_compare_field_t::literal<double>() const { return _double_value; }
+
+    class filter_compare_equals_field_t : public filter_compare_field_t {
     public:
-        filter_compare_less_field_t(field_fetcher_t *fetcher, const filter_comp_value_t& value) : filter_compare_field_t(fetcher, value) {}
-        virtual ~filter_compare_less_field_t() {}
+        filter_compare_equals_field_t(field_fetcher_t *fetcher, const filter_comp_value_t& value) : 
+            filter_compare_field_t(fetcher, column_kernels_t::COMPARE_EQUALS, value) {
+            resolve<std::equal_to<>, true>(value);
+        }
+        virtual ~filter_compare_equals_field_t() {}
+    };
 
-    protected:
-        virtual bool match(const field_value_t& field, const objects_index_t&) const {
-            switch (field.type()) {
-                case jvm_type_t::JVM_TYPE_UNKNOWN:
-                case jvm_type_t::JVM_TYPE_BOOL:
-                case jvm_type_t::JVM_TYPE_OBJECT:
-                    return false;
-                case jvm_type_t::JVM_TYPE_BYTE:
-                    return static_cast<int64_t>(static_cast<jvm_byte_t>(field)) < _value;
-                case jvm_type_t::JVM_TYPE_SHORT:
-                    return static_cast<int64_t>(static_cast<jvm_short_t>(field)) < _value;
-                case jvm_type_t::JVM_TYPE_CHAR:
-                    return static_cast<int64_t>(static_cast<jvm_char_t>(field)) < _value;
-                case jvm_type_t::JVM_TYPE_INT:
-                    return static_cast<int64_t>(static_cast<jvm_int_t>(field)) < _value;
-                case jvm_type_t::JVM_TYPE_LONG:
-                    return static_cast<jvm_long_t>(field) < _value;
-                case jvm_type_t::JVM_TYPE_FLOAT:
-                    return static_cast<jvm_float_t>(field) < _value;
-                case jvm_type_t::JVM_TYPE_DOUBLE:
-                    return static_cast<jvm_double_t>(field) < _value;
-            }
+    class filter_compare_not_equals_field_t : public filter_compare_field_t {
+    public:
+        filter_compare_not_equals_field_t(field_fetcher_t *fetcher, const filter_comp_value_t& value) : 
+            filter_compare_field_t(fetcher, column_kernels_t::COMPARE_NOT_EQUALS, value) {
+            resolve<std::not_equal_to<>, true>(value);
         }
+        virtual ~filter_compare_not_equals_field_t() {}
     };
 
-    class filter_compare_less_or_equals_field_t : public filter_compare_field_t {
+    class filter_compare_less_field_t : public filter_compare_field_t {
     public:
-        filter_compare_less_or_equals_field_t(field_fetcher_t *fetcher, const filter_comp_value_t& value) : filter_compare_field_t(fetcher, value) {}
-        virtual ~filter_compare_less_or_equals_field_t() {}
+        filter_compare_less_field_t(field_fetcher_t *fetcher, const filter_comp_value_t& value) : 
+            filter_compare_field_t(fetcher, column_kernels_t::COMPARE_LESS, value) {
+            resolve<std::less<>, false>(value);
+        }
+        virtual ~filter_compare_less_field_t() {}
+    };
 
-    protected:
-        virtual bool match(const field_value_t& field, const objects_index_t&) const {
-            switch (field.type()) {
-                case jvm_type_t::JVM_TYPE_UNKNOWN:
-                case jvm_type_t::JVM_TYPE_BOOL:
-                case jvm_type_t::JVM_TYPE_OBJECT:
-                    return false;
-                case jvm_type_t::JVM_TYPE_BYTE:
-                    return static_cast<int64_t>(static_cast<jvm_byte_t>(field)) <= _value;
-                case jvm_type_t::JVM_TYPE_SHORT:
-                    return static_cast<int64_t>(static_cast<jvm_short_t>(field)) <= _value;
-                case jvm_type_t::JVM_TYPE_CHAR:
-                    return static_cast<int64_t>(static_cast<jvm_char_t>(field)) <= _value;
-                case jvm_type_t::JVM_TYPE_INT:
-                    return static_cast<int64_t>(static_cast<jvm_int_t>(field)) <= _value;
-                case jvm_type_t::JVM_TYPE_LONG:
-                    return static_cast<jvm_long_t>(field) <= _value;
-                case jvm_type_t::JVM_TYPE_FLOAT:
-                    return static_cast<jvm_float_t>(field) <= _value;
-                case jvm_type_t::JVM_TYPE_DOUBLE:
-                    return static_cast<jvm_double_t>(field) <= _value;
-            }
+    class filter_compare_less_or_equals_field_t : public filter_compare_field_t {
+    public:
+        filter_compare_less_or_equals_field_t(field_fetcher_t *fetcher, const filter_comp_value_t& value) : 
+            filter_compare_field_t(fetcher, column_kernels_t::COMPARE_LESS_OR_EQUALS, value) {
+            resolve<std::less_equal<>, false>(value);
         }
+        virtual ~filter_compare_less_or_equals_field_t() {}
     };
 
     class filter_compare_greater_field_t : public filter_compare_field_t {
     public:
-        filter_compare_greater_field_t(field_fetcher_t *fetcher, const filter_comp_value_t& value) : filter_compare_field_t(fetcher, value) {}
-        virtual ~filter_compare_greater_field_t() {}
-
-    protected:
-        virtual bool match(const field_value_t& field, const objects_index_t&) const {
-            switch (field.type()) {
-                case jvm_type_t::JVM_TYPE_UNKNOWN:
-                case jvm_type_t::JVM_TYPE_BOOL:
-                case jvm_type_t::JVM_TYPE_OBJECT:
-                    return false;
-                case jvm_type_t::JVM_TYPE_BYTE:
-                    return static_cast<int64_t>(static_cast<jvm_byte_t>(field)) > _value;
-                case jvm_type_t::JVM_TYPE_SHORT:
-                    return static_cast<int64_t>(static_cast<jvm_short_t>(field)) > _value;
-                case jvm_type_t::JVM_TYPE_CHAR:
-                    return static_cast<int64_t>(static_cast<jvm_char_t>(field)) > _value;
-                case jvm_type_t::JVM_TYPE_INT:
-                    return static_cast<int64_t>(static_cast<jvm_int_t>(field)) > _value;
-                case jvm_type_t::JVM_TYPE_LONG:
-                    return static_cast<jvm_long_t>(field) > _value;
-                case jvm_type_t::JVM_TYPE_FLOAT:
-                    return static_cast<jvm_float_t>(field) > _value;
-                case jvm_type_t::JVM_TYPE_DOUBLE:
-                    return static_cast<jvm_double_t>(field) > _value;
-            }
+        filter_compare_greater_field_t(field_fetcher_t *fetcher, const filter_comp_value_t& value) : 
+            filter_compare_field_t(fetcher, column_kernels_t::COMPARE_GREATER, value) {
+            resolve<std::greater<>, false>(value);
         }
+        virtual ~filter_compare_greater_field_t() {}
     };
 
     class filter_compare_greater_or_equals_field_t : public filter_compare_field_t {
     public:
-        filter_compare_greater_or_equals_field_t(field_fetcher_t *fetcher, const filter_comp_value_t& value) : filter_compare_field_t(fetcher, value) {}
-        virtual ~filter_compare_greater_or_equals_field_t() {}
-
-    protected:
-        virtual bool match(const field_value_t& field, const objects_index_t&) const {
-            switch (field.type()) {
-                case jvm_type_t::JVM_TYPE_UNKNOWN:
-                case jvm_type_t::JVM_TYPE_BOOL:
-                case jvm_type_t::JVM_TYPE_OBJECT:
-                    return false;
-                case jvm_type_t::JVM_TYPE_BYTE:
-                    return static_cast<int64_t>(static_cast<jvm_byte_t>(field)) >= _value;
-                case jvm_type_t::JVM_TYPE_SHORT:
-                    return static_cast<int64_t>(static_cast<jvm_short_t>(field)) >= _value;
-                case jvm_type_t::JVM_TYPE_CHAR:
-                    return static_cast<int64_t>(static_cast<jvm_char_t>(field)) >= _value;
-                case jvm_type_t::JVM_TYPE_INT:
-                    return static_cast<int64_t>(static_cast<jvm_int_t>(field)) >= _value;
-                case jvm_type_t::JVM_TYPE_LONG:
-                    return static_cast<jvm_long_t>(field) >= _value;
-                case jvm_type_t::JVM_TYPE_FLOAT:
-                    return static_cast<jvm_float_t>(field) >= _value;
-                case jvm_type_t::JVM_TYPE_DOUBLE:
-                    return static_cast<jvm_double_t>(field) >= _value;
-            }
+        filter_compare_greater_or_equals_field_t(field_fetcher_t *fetcher, const filter_comp_value_t& value) : 
+            filter_compare_field_t(fetcher, column_kernels_t::COMPARE_GREATER_OR_EQUALS, value) {
+            resolve<std::greater_equal<>, false>(value);
         }
+        virtual ~filter_compare_greater_or_equals_field_t() {}
     };
 }
@@ -18,15 +18,18 @@
 #include "types/instance.h"
 #include "objects_index.h"
 
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <vector>
 #include <string>
 
 namespace hprof {
     class field_fetcher_t {
     public:
-        field_fetcher_t() {}
+        field_fetcher_t() : _classes_count(0), _bound_to(nullptr) {}
 
-        explicit field_fetcher_t(const char* field_name) {
+        explicit field_fetcher_t(const char* field_name) : _classes_count(0), _bound_to(nullptr) {
             _fields.emplace_back(field_name);
         }
 
@@ -34,13 +37,46 @@ namespace hprof {
             _fields.emplace(std::begin(_fields), field_name);
         }
 
+        const std::string& first() const { return _fields.front(); }
+        size_t depth() const { return _fields.size(); }
+
+        /// Dotted field path
+        void key(std::string& out) const {
+            for (auto& field : _fields) {
+                if (&field != &_fields.front()) {
+                    out += '.';
+                }
+                out += field;
+            }
+        }
+
+        /// Prepares per-class slots for every step of the path, slots are resolved when a class is seen first time.
+        /// Binding to the same classes again keeps the slots, cursors of the query may be reading them
+        void bind(const classes_index_t& classes) {
+            std::lock_guard<std::mutex> lock { _bind_lock };
+            if (_bound_to == &classes) {
+                return;
+            }
+
+            _bound_to = &classes;
+            _classes_count = classes.count_classes() + 1;
+            _slots.reset(new (std::nothrow) std::atomic<u_int64_t>[_classes_count * _fields.size()]);
+            if (_slots == nullptr) {
+                _classes_count = 0;
+                return;
+            }
+            for (size_t index = 0; index < _classes_count * _fields.size(); ++index) {
+                _slots[index].store(SLOT_UNRESOLVED, std::memory_order_relaxed);
+            }
+        }
+
         template<typename action_t>
         bool apply(const heap_item_ptr_t& object, const objects_index_t& helper, const action_t& action) const {
             if (_fields.empty()) {
                 return false;
             }
             
-            auto it = std::begin(_fields);
+            size_t step = 0;
             heap_item_ptr_t item = object;
             for (;;) {
                 const instance_info_t* instance = nullptr;
@@ -63,13 +99,13 @@ namespace hprof {
                 assert(instance != nullptr);
 
                 auto& fields = instance->fields();
-                auto field = fields.find(*it);
+                auto field = find(*instance, step);
                 
                 if (field == std::end(fields)) {
                     return false;
                 }
                 
-                if (++it == std::end(_fields)) {
+                if (++step == _fields.size()) {
                     return action(*field);
                 }
 
@@ -82,7 +118,54 @@ namespace hprof {
 
             return false;
         }
+
+        /// Field of the first step, resolved through the class slot when bound
+        fields_values_t::iterator find_first(const instance_info_t& instance) const {
+            return find(instance, 0);
+        }
+    private:
+        enum : u_int64_t {
+            SLOT_UNRESOLVED = 0,
+            SLOT_ABSENT = 1,
+            SLOT_PRESENT = 2
+        };
+
+        fields_values_t::iterator find(const instance_info_t& instance, size_t step) const {
+            auto& fields = instance.fields();
+            const class_info_t* cls = instance.get_class();
+            u_int32_t enter = cls != nullptr ? cls->hierarchy().enter : 0;
+            if (enter == 0 || enter >= _classes_count) {
+                return fields.find(_fields[step]);
+            }
+
+            std::atomic<u_int64_t>& slot = _slots[step * _classes_count + enter];
+            u_int64_t value = slot.load(std::memory_order_relaxed);
+            if (value == SLOT_UNRESOLVED) {
+                // Same order as instance_info_impl_t::set_class flattens fields
+                value = SLOT_ABSENT;
+                u_int64_t index = 0;
+                for (const class_info_t* current = cls; current != nullptr && value == SLOT_ABSENT; current = current->super()) {
+                    for (auto& spec : current->fields()) {
+                        if (spec.name() == _fields[step]) {
+                            value = SLOT_PRESENT | (index << 2);
+                            break;
+                        }
+                        ++index;
+                    }
+                }
+                slot.store(value, std::memory_order_relaxed);
+            }
+
+            if (value == SLOT_ABSENT) {
+                return fields.end();
+            }
+            return fields[value >> 2];
+        }
     private:
         std::vector<std::string> _fields;
+        size_t _classes_count;
+        std::unique_ptr<std::atomic<u_int64_t>[]> _slots;
+        std::mutex _bind_lock;
+        const classes_index_t* _bound_to;
     };
 }
@@ -17,6 +17,8 @@
 
 #include <iostream>
 #include <cstring>
+#include <cstdio>
+#include <string>
 
 namespace hprof {
     struct filter_comp_value_t {
@@ -36,6 +38,8 @@ namespace hprof {
 
         explicit filter_comp_value_t(int value) : type(TYPE_INT), int_value(value) {}
 
+        explicit filter_comp_value_t(int64_t value) : type(TYPE_INT), int_value(value) {}
+
         explicit filter_comp_value_t(bool value) : type(TYPE_BOOL), bool_value(value) {}
 
         explicit filter_comp_value_t(double value) : type(TYPE_DOUBLE), double_value(value) {}
@@ -127,6 +131,35 @@ namespace hprof {
         return out;
     }
 
+    /// Appends the literal with its type, doubles are written exactly
+    inline void append_key(std::string& out, const filter_comp_value_t& value) {
+        switch(value.type) {
+            case filter_comp_value_t::TYPE_INT:
+                out += 'i';
+                out += std::to_string(value.int_value);
+                break;
+            case filter_comp_value_t::TYPE_DOUBLE: {
+                char buffer[64];
+                std::snprintf(buffer, sizeof(buffer), "d%a", value.double_value);
+                out += buffer;
+                break;
+            }
+            case filter_comp_value_t::TYPE_BOOL:
+                out += value.bool_value ? "b1" : "b0";
+                break;
+            case filter_comp_value_t::TYPE_TEXT:
+                if (value.text_value == nullptr) {
+                    out += 'n';
+                } else {
+                    out += 't';
+                    out += std::to_string(std::strlen(value.text_value));
+                    out += ':';
+                    out += value.text_value;
+                }
+                break;
+        }
+    }
+
     inline bool operator==(const filter_comp_value_t& left, int64_t value) {
         switch (left.type) {
             case filter_comp_value_t::TYPE_BOOL:
@@ -16,17 +16,74 @@
 #pragma once
 
 #include "filters/base.h"
+#include "filter_program.h"
 
-#include <iostream>
+#include <vector>
 
 namespace hprof {
     class filter_instance_of_t : public filter_t {
     public:
-        explicit filter_instance_of_t(const std::string& name) : _class_name(name) {}
+        explicit filter_instance_of_t(const std::string& name) : _class_name(name), _bound(false) {}
         virtual ~filter_instance_of_t() {}
         virtual filter_result_t operator()(const heap_item_ptr_t& item, const objects_index_t&) const override {
+            return is_instance(item) ? Match : NoMatch;
+        }
+
+        virtual bool key(std::string& out) const override {
+            out += "instanceof(";
+            out += std::to_string(_class_name.size());
+            out += ':';
+            out += _class_name;
+            out += ')';
+            return true;
+        }
+
+        /// Resolves the class name to hierarchy intervals, unnumbered classes keep the lookup by name
+        virtual void bind(const classes_index_t& classes) override {
+            std::vector<heap_item_ptr_t> found;
+            classes.find_classes(_class_name, found);
+
+            _hierarchies.clear();
+            _bound = true;
+            for (auto& item : found) {
+                const class_hierarchy_t& hierarchy = static_cast<const class_info_t*>(*item)->hierarchy();
+                if (hierarchy.enter == 0) {
+                    _bound = false;
+                    break;
+                }
+                _hierarchies.push_back(hierarchy);
+            }
+        }
+
+        /// Bound checks don't need the virtual call
+        virtual void compile(filter_program_t& program) const override {
+            if (_bound) {
+                program.instance_of(_hierarchies);
+            } else {
+                program.call(*this);
+            }
+        }
+
+        /// All items of a batch share the class, so they all match or none does
+        virtual bool select(const heap_item_ptr_t* const* items, size_t count, u_int64_t* selection) const override {
+            if (!_bound || count == 0) {
+                return false;
+            }
+            column_kernels_t::fill(selection, count, is_instance(*items[0]));
+            return true;
+        }
+
+        virtual bool restrict_classes(std::vector<class_hierarchy_t>& hierarchies) const override {
+            if (!_bound) {
+                return false;
+            }
+            hierarchies.insert(hierarchies.end(), _hierarchies.begin(), _hierarchies.end());
+            return true;
+        }
+    private:
+        bool is_instance(const heap_item_ptr_t& item) const {
             if (item == nullptr) {
-                return NoMatch;
+                return false;
             }
 
             const class_info_t* cls = nullptr;
@@ -44,17 +101,33 @@ namespace hprof {
                     break;
             }
 
+            if (cls == nullptr) {
+                return false;
+            }
+
+            if (_bound) {
+                const class_hierarchy_t& hierarchy = cls->hierarchy();
+                for (auto& parent : _hierarchies) {
+                    if (parent.contains(hierarchy)) {
+                        return true;
+                    }
+                }
+                return false;
+            }
+
             while(cls != nullptr) {
                 // TODO: fuzzy case insensitive comparaison
                 if (cls->name() == _class_name) {
-                    return Match;
+                    return true;
                 }
 
                 cls = cls->super();
             }
-            return NoMatch;
+            return false;
         }
     private:
         std::string _class_name;
+        bool _bound;
+        std::vector<class_hierarchy_t> _hierarchies;
     };
 }
@@ -16,9 +16,49 @@
 #pragma once
 
 #include "filters/base.h"
+#include "filter_program.h"
+#include <algorithm>
 #include <cassert>
+#include <string>
+#include <vector>
 
 namespace hprof {
+    /// Operands of nested operations of the same kind are keyed as one sorted list,
+    /// so neither order nor grouping of AND/OR operands changes the key
+    template<typename operation_t>
+    bool operands_key(const char* name, const filter_t& left, const filter_t& right, std::string& out) {
+        std::vector<const filter_t*> pending { &right, &left };
+        std::vector<std::string> keys;
+        while (!pending.empty()) {
+            const filter_t* filter = pending.back();
+            pending.pop_back();
+
+            auto operation = dynamic_cast<const operation_t*>(filter);
+            if (operation != nullptr) {
+                pending.push_back(&operation->right());
+                pending.push_back(&operation->left());
+                continue;
+            }
+
+            keys.emplace_back();
+            if (!filter->key(keys.back())) {
+                return false;
+            }
+        }
+
+        std::sort(std::begin(keys), std::end(keys));
+        out += name;
+        out += '(';
+        for (auto& key : keys) {
+            if (&key != &keys.front()) {
+                out += ',';
+            }
+            out += key;
+        }
+        out += ')';
+        return true;
+    }
+
     class filter_not_t : public filter_t {
     public:
         filter_not_t(std::unique_ptr<filter_t>&& src) : _filter(std::move(src)) {}
@@ -37,6 +77,40 @@ namespace hprof {
             }
             assert(false);
         }
+
+        virtual void bind(const classes_index_t& classes) override {
+            _filter->bind(classes);
+        }
+
+        virtual void bind_objects(const objects_index_t& objects) override {
+            _filter->bind_objects(objects);
+        }
+
+        virtual u_int32_t cost() const override { return _filter->cost(); }
+
+        virtual void compile(filter_program_t& program) const override {
+            _filter->compile(program);
+            program.negate();
+        }
+
+        virtual bool select(const heap_item_ptr_t* const* items, size_t count, u_int64_t* selection) const override {
+            if (!_filter->select(items, count, selection)) {
+                return false;
+            }
+            column_kernels_t::negate(selection, count);
+            return true;
+        }
+
+        virtual bool key(std::string& out) const override {
+            out += "not(";
+            if (!_filter->key(out)) {
+                return false;
+            }
+            out += ')';
+            return true;
+        }
+
+        const filter_t& filter() const { return *_filter; }
     private:
         std::unique_ptr<filter_t> _filter;
     };
@@ -52,16 +126,59 @@ namespace hprof {
         virtual ~filter_and_t() {}
         filter_result_t operator()(const heap_item_ptr_t& item, const objects_index_t& objects) const override {
             auto left_result = (*_left)(item, objects);
-            if (left_result == Fail) {
-                return Fail;
+            if (left_result != Match) {
+                return left_result;
+            }
+            return (*_right)(item, objects);
+        }
+
+        /// The operand rejecting more items goes first, the cheaper one on a tie
+        virtual void bind(const classes_index_t& classes) override {
+            _left->bind(classes);
+            _right->bind(classes);
+
+            size_t left_estimate = _left->estimate(classes);
+            size_t right_estimate = _right->estimate(classes);
+            if (right_estimate < left_estimate || (right_estimate == left_estimate && _right->cost() < _left->cost())) {
+                std::swap(_left, _right);
+            }
+        }
+
+        virtual void bind_objects(const objects_index_t& objects) override {
+            _left->bind_objects(objects);
+            _right->bind_objects(objects);
+        }
+
+        virtual u_int32_t cost() const override { return _left->cost() + _right->cost(); }
+
+        virtual void compile(filter_program_t& program) const override {
+            _left->compile(program);
+            size_t jump = program.jump_unless(Match);
+            _right->compile(program);
+            program.land(jump);
+        }
+
+        virtual bool select(const heap_item_ptr_t* const* items, size_t count, u_int64_t* selection) const override {
+            u_int64_t right[column_kernels_t::BATCH_SIZE / 64];
+            if (!_left->select(items, count, selection) || !_right->select(items, count, right)) {
+                return false;
             }
-            auto right_result = (*_right)(item, objects);
-            if (right_result == Fail) {
-                return Fail;
+            for (size_t index = 0; index < column_kernels_t::selection_size(count); ++index) {
+                selection[index] &= right[index];
             }
+            return true;
+        }
+
+        virtual bool restrict_classes(std::vector<class_hierarchy_t>& hierarchies) const override {
+            return _left->restrict_classes(hierarchies) || _right->restrict_classes(hierarchies);
+        }
 
-            return left_result == Match && right_result == Match ? Match : NoMatch;
+        virtual bool key(std::string& out) const override {
+            return operands_key<filter_and_t>("and", *_left, *_right, out);
         }
+
+        const filter_t& left() const { return *_left; }
+        const filter_t& right() const { return *_right; }
     private:
         std::unique_ptr<filter_t> _left;
         std::unique_ptr<filter_t> _right;
@@ -76,16 +193,66 @@ namespace hprof {
         virtual ~filter_or_t() {}
         filter_result_t operator()(const heap_item_ptr_t& item, const objects_index_t& objects) const override {
             auto left_result = (*_left)(item, objects);
-            if (left_result == Fail) {
-                return Fail;
+            if (left_result != NoMatch) {
+                return left_result;
+            }
+            return (*_right)(item, objects);
+        }
+
+        /// The cheaper operand goes first, the one matching more items on a tie
+        virtual void bind(const classes_index_t& classes) override {
+            _left->bind(classes);
+            _right->bind(classes);
+
+            u_int32_t left_cost = _left->cost();
+            u_int32_t right_cost = _right->cost();
+            if (right_cost < left_cost || (right_cost == left_cost && _right->estimate(classes) > _left->estimate(classes))) {
+                std::swap(_left, _right);
+            }
+        }
+
+        virtual void bind_objects(const objects_index_t& objects) override {
+            _left->bind_objects(objects);
+            _right->bind_objects(objects);
+        }
+
+        virtual u_int32_t cost() const override { return _left->cost() + _right->cost(); }
+
+        virtual void compile(filter_program_t& program) const override {
+            _left->compile(program);
+            size_t jump = program.jump_unless(NoMatch);
+            _right->compile(program);
+            program.land(jump);
+        }
+
+        virtual bool select(const heap_item_ptr_t* const* items, size_t count, u_int64_t* selection) const override {
+            u_int64_t right[column_kernels_t::BATCH_SIZE / 64];
+            if (!_left->select(items, count, selection) || !_right->select(items, count, right)) {
+                return false;
             }
-            auto right_result = (*_right)(item, objects);
-            if (right_result == Fail) {
-                return Fail;
+            for (size_t index = 0; index < column_kernels_t::selection_size(count); ++index) {
+                selection[index] |= right[index];
             }
+            return true;
+        }
 
-            return (left_result == Match || right_result == Match) ? Match : NoMatch;
+        virtual bool restrict_classes(std::vector<class_hierarchy_t>& hierarchies) const override {
+            std::vector<class_hierarchy_t> left;
+            std::vector<class_hierarchy_t> right;
+            if (!_left->restrict_classes(left) || !_right->restrict_classes(right)) {
+                return false;
+            }
+            hierarchies.insert(hierarchies.end(), left.begin(), left.end());
+            hierarchies.insert(hierarchies.end(), right.begin(), right.end());
+            return true;
         }
+
+        virtual bool key(std::string& out) const override {
+            return operands_key<filter_or_t>("or", *_left, *_right, out);
+        }
+
+        const filter_t& left() const { return *_left; }
+        const filter_t& right() const { return *_right; }
     private:
         std::unique_ptr<filter_t> _left;
         std::unique_ptr<filter_t> _right;
@@ -0,0 +1,63 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#pragma once
+
+#include "filters/base.h"
+#include "types/text_pattern.h"
+
+namespace hprof {
+    /// Field refers to a String matching the pattern, null and non-string references never match
+    class filter_text_field_t : public filter_by_field_t {
+    public:
+        filter_text_field_t(field_fetcher_t *fetcher, text_pattern_t::kind_t kind, const std::string& pattern) :
+            filter_by_field_t(fetcher), _pattern(kind, pattern) {}
+        virtual ~filter_text_field_t() {}
+
+        virtual u_int32_t cost() const override { return filter_by_field_t::cost() + 8; }
+
+        virtual bool key(std::string& out) const override {
+            static const char* names[] = { "contains", "like", "matches" };
+            out += names[_pattern.kind()];
+            out += '(';
+            _field_fetcher->key(out);
+            out += ",t";
+            out += std::to_string(_pattern.pattern().size());
+            out += ':';
+            out += _pattern.pattern();
+            out += ')';
+            return true;
+        }
+    protected:
+        virtual bool match(const field_value_t& field, const objects_index_t& objects) const override {
+            if (field.type() != jvm_type_t::JVM_TYPE_OBJECT) {
+                return false;
+            }
+
+            jvm_id_t id = static_cast<jvm_id_t>(field);
+            if (id == 0) {
+                return false;
+            }
+
+            auto value = objects.find_object(id);
+            if (value == nullptr || value->type() != heap_item_t::String) {
+                return false;
+            }
+            return _pattern.match(*static_cast<const string_info_t*>(*value));
+        }
+    private:
+        text_pattern_t _pattern;
+    };
+}
@@ -16,11 +16,18 @@
 #pragma once
 
 #include "hprof.h"
+#include "field_index.h"
+#include "query_cache.h"
+#include "query_cursor.h"
+#include "query_planner.h"
+#include "query_pool.h"
+#include "query_profiler.h"
 #include "types/gc_root.h"
 
 #include <unordered_map>
 #include <vector>
 #include <algorithm>
+#include <mutex>
 
 namespace hprof {
     class heap_profile_impl_t : public heap_profile_t, public objects_index_t, public classes_index_t {
@@ -35,23 +42,94 @@ namespace hprof {
         virtual const std::string& error_message() const override { return _error_message; }
         
         virtual heap_item_ptr_t find_object(jvm_id_t id) const override;
+        /// The index is built by the first lookup
+        virtual bool find_strings(const std::string& value, std::vector<jvm_id_t>& result) const override;
+        /// The index is built by the first lookup
+        virtual bool find_referrers(jvm_id_t id, incoming_links_t& links) const override;
         virtual heap_item_ptr_t find_class(jvm_id_t id) const override;
+        virtual void find_classes(const std::string& name, std::vector<heap_item_ptr_t>& result) const override;
+        virtual void find_declaring_classes(const std::string& field_name, std::vector<heap_item_ptr_t>& result) const override;
+        virtual size_t count_instances(const class_hierarchy_t& hierarchy) const override;
+        virtual size_t count_classes() const override { return _classes.size(); }
 
         virtual bool query(const query_t& query, std::vector<heap_item_ptr_t>& result) const override;
+        virtual bool query(const query_t& query, const query_callback_t& callback) const override;
+        virtual std::unique_ptr<query_cursor_t> open(const query_t& query) const override;
+        virtual bool aggregate(const query_t& query, std::vector<aggregate_row_t>& rows) const override;
+        virtual bool explain(const query_t& query, std::vector<explain_node_t>& nodes) const override;
 
         virtual const objects_index_t& objects_index() const override { return *this; }
         virtual const classes_index_t& classes_index() const override { return *this; }
 
+        /// Queries are split into chunks and run on the pool, zero threads means one per hardware thread
+        void set_query_threads(size_t threads);
+        /// Results of repeated queries are kept up to the given number of bytes, zero disables the cache
+        void set_query_cache_size(size_t bytes);
+        const query_cache_t* query_cache() const { return _cache.get(); }
+        /// Builds an index on the field for every class of the name, false when a class or a primitive field is missing
+        bool create_index(const std::string& class_name, const std::string& field, query_t::index_t kind) const;
+        size_t count_indexes() const;
+
         void add(jvm_id_t id, const heap_item_ptr_t& item);
+        /// Builds lookup indexes, must be called after the last item is added
+        void build_indexes();
     private:
-        bool query_classes(const filter_t& filter, std::vector<heap_item_ptr_t>& result) const;
-        bool query_instances(const filter_t& filter, std::vector<heap_item_ptr_t>& result) const;
-        
+        /// Subqueries run under the token of the outer query instead of their own
+        /// Profiled queries skip the cache
+        std::unique_ptr<query_cursor_t> open(const query_t& query, const query_token_t* token, query_profiler_t* profiler = nullptr) const;
+        std::unique_ptr<query_cursor_t> open_ordered(const query_t& query, const query_token_t* token, query_profiler_t* profiler = nullptr) const;
+        bool aggregate_rows(const query_t& query, std::vector<aggregate_row_t>& rows, query_profiler_t* profiler) const;
+        /// Binds the filter and picks the way to enumerate candidates
+        query_plan_t plan(const query_t& query) const;
+        /// The profiler takes the place of the filter program when given
+        std::unique_ptr<query_cursor_impl_t> scan(const query_t& query, size_t offset, size_t limit, const query_token_t* token, query_profiler_t* profiler = nullptr) const;
+        /// Nodes of the scan, the subquery and the filter, counters are taken from the profiler when given
+        void explain_scan(const query_t& query, size_t depth, const query_profiler_t* profiler, std::vector<explain_node_t>& nodes) const;
+        void query_classes(const query_t& query, query_cursor_impl_t& cursor) const;
+        void query_instances(const query_t& query, query_cursor_impl_t& cursor) const;
+
+        void query_class_instances(const query_t& query, query_cursor_impl_t& cursor) const;
+        void query_indexed(const query_t& query, query_cursor_impl_t& cursor) const;
+        void query_related(const query_t& query, query_cursor_impl_t& cursor, query_profiler_t* profiler) const;
+        query_cursor_impl_t::chunk_result_t query_items(const query_t& query, const query_plan_t& plan, const query_token_t* token, const heap_item_ptr_t* const* items, size_t count, query_cache_t::items_t& result) const;
+        query_cursor_impl_t::chunk_result_t query_batch(const query_t& query, const query_plan_t& plan, const query_token_t* token, const heap_item_ptr_t* const* items, size_t count, query_cache_t::items_t& result) const;
+
+        static bool in_heaps(u_int32_t heaps, int32_t heap_type);
+        void build_strings_index() const;
+        void build_referrers_index() const;
+        /// Holders of the id, sorted by the holder id
+        void referrers_of(jvm_id_t id, std::vector<const heap_item_ptr_t*>& result) const;
+        const heap_item_ptr_t* locate(jvm_id_t id) const;
     private:
+        using heap_partition_t = std::vector<heap_item_ptr_t>;
+
+        // Items scanned by one pool task
+        static const size_t CHUNK_SIZE = 16384;
+        // Matches handed to a query callback at once
+        static const size_t PAGE_SIZE = 1024;
+
         bool _has_error;
         std::string _error_message;
         std::unordered_map<jvm_id_t, heap_item_ptr_t> _objects;
         std::unordered_map<jvm_id_t, heap_item_ptr_t> _classes;
+        // Objects split by heap_info_t::HEAP_* so heap scoped queries skip other heaps
+        heap_partition_t _heaps[heap_info_t::HEAP_IMAGE + 1];
+        // Instances by class_hierarchy_t::enter of their class, points into _heaps
+        std::vector<std::vector<const heap_item_ptr_t*>> _class_instances;
+        // Number of instances of classes numbered below the index
+        std::vector<size_t> _class_instances_before;
         gc_roots_t _roots;
+        std::unique_ptr<query_pool_t> _pool;
+        std::unique_ptr<query_cache_t> _cache;
+        // Created by queries, so they can be added to a loaded profile. Indexes are never dropped
+        mutable std::mutex _indexes_lock;
+        mutable std::vector<std::unique_ptr<field_index_t>> _indexes;
+        // String objects by the hash of their payload bytes, so building it decodes no string.
+        // Only strings needed by a query make it worth building
+        mutable std::once_flag _strings_once;
+        mutable std::vector<std::pair<size_t, const heap_item_ptr_t*>> _strings;
+        // Reverse references as (referent id, holder) sorted by the referent, a holder is listed once a referent
+        mutable std::once_flag _referrers_once;
+        mutable std::vector<std::pair<jvm_id_t, const heap_item_ptr_t*>> _referrers;
     };
 }
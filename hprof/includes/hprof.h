@@ -23,39 +23,201 @@
 #include "filters/instance_of.h"
 #include "filters/logical.h"
 #include "filters/comparation.h"
+#include "filters/text_match.h"
+#include "filters/array.h"
 
+#include <atomic>
 #include <chrono>
 #include <functional>
+#include <limits>
+#include <memory>
 
 namespace hprof {
 
+    /// Cooperative stop of a running query, scans look at it every few thousand items.
+    /// A cancelled query fails, a query out of its time budget returns what it found so far.
+    class query_token_t {
+    public:
+        using steady_clock_t = std::chrono::steady_clock;
+    public:
+        void cancel() { _cancelled = true; }
+        /// Budget counts from now, a zero budget expires at once. Safe to call while the query runs
+        void set_budget(steady_clock_t::duration budget) {
+            _deadline.store((steady_clock_t::now() + budget).time_since_epoch().count(), std::memory_order_relaxed);
+        }
+
+        bool cancelled() const { return _cancelled; }
+        bool expired() const {
+            auto deadline = _deadline.load(std::memory_order_relaxed);
+            return deadline != NO_DEADLINE && steady_clock_t::now().time_since_epoch().count() >= deadline;
+        }
+        bool stopped() const { return cancelled() || expired(); }
+    private:
+        using ticks_t = steady_clock_t::rep;
+
+        static constexpr ticks_t NO_DEADLINE = std::numeric_limits<ticks_t>::max();
+
+        std::atomic<bool> _cancelled { false };
+        // Ticks of steady_clock_t since its epoch, written by the thread setting the budget and read by scans
+        std::atomic<ticks_t> _deadline { NO_DEADLINE };
+    };
+
     struct query_t {
         enum action_t {
-            ACTION_SHOW
+            ACTION_SHOW,
+            ACTION_CREATE_INDEX,
+            ACTION_AGGREGATE
         } action;
         enum source_t {
             SOURCE_OBJECTS,
             SOURCE_CLASSES
         } source;
+        // Mask of (1 << heap_info_t::HEAP_*), zero means all heaps
+        u_int32_t heaps = 0;
         std::unique_ptr<filter_t> filter;
+        // Matches skipped before the first returned one
+        size_t offset = 0;
+        size_t limit = std::numeric_limits<size_t>::max();
+        // CREATE INDEX target, the automatic kind is picked by the number of distinct values
+        enum index_t {
+            INDEX_AUTO,
+            INDEX_HASH,
+            INDEX_SORTED,
+            INDEX_BITMAP
+        } index = INDEX_AUTO;
+        std::string index_class {};
+        std::string index_field {};
+        // SELECT list of ACTION_AGGREGATE, COUNT(*) has no field
+        enum aggregate_t {
+            AGGREGATE_COUNT,
+            AGGREGATE_SUM,
+            AGGREGATE_MIN,
+            AGGREGATE_MAX
+        };
+        struct aggregation_t {
+            aggregate_t function;
+            std::unique_ptr<field_fetcher_t> field;
+        };
+        std::vector<aggregation_t> aggregations {};
+        enum group_t {
+            GROUP_NONE,
+            GROUP_CLASS,
+            GROUP_FIELD
+        } group = GROUP_NONE;
+        std::unique_ptr<field_fetcher_t> group_field {};
+        // ORDER BY of ACTION_SHOW, items without the key come last in both directions
+        enum order_t {
+            ORDER_NONE,
+            ORDER_FIELD,
+            ORDER_SIZE,
+            ORDER_LENGTH
+        } order = ORDER_NONE;
+        std::unique_ptr<field_fetcher_t> order_field {};
+        bool order_descending = false;
+        // SHOW object.a, object.b FROM, matches are reported as rows of these fields instead of objects
+        std::vector<std::unique_ptr<field_fetcher_t>> projections {};
+        // REFERRING TO (subquery) and REFERENCED BY (subquery), matches are looked for among
+        // holders or among referents of the subquery results instead of the whole heap
+        enum relation_t {
+            RELATION_NONE,
+            RELATION_REFERRING_TO,
+            RELATION_REFERENCED_BY
+        } relation = RELATION_NONE;
+        std::unique_ptr<query_t> related {};
+        // EXPLAIN reports the plan instead of matches, EXPLAIN ANALYZE runs the query with counters on every operator
+        enum explain_t {
+            EXPLAIN_NONE,
+            EXPLAIN_PLAN,
+            EXPLAIN_ANALYZE
+        } explain = EXPLAIN_NONE;
+        // SAMPLE n%, the fraction of candidates checked. Candidates are picked by a hash of their ids and the seed,
+        // counts and sums of aggregates are scaled up to all candidates
+        double sample = 1.0;
+        u_int64_t sample_seed = 0;
+        // Shared with the code that may stop the query, subqueries run under the token of the outer query
+        std::shared_ptr<query_token_t> token {};
+    };
+
+    struct aggregate_value_t {
+        /// No item of the group had a numeric value
+        bool empty;
+        bool integral;
+        int64_t int_value;
+        double double_value;
+        /// Scaled up from a sample, error is the half width of the 95% confidence interval
+        bool estimated;
+        double error;
+    };
+
+    /// Values follow query_t::aggregations
+    struct aggregate_row_t {
+        std::string group;
+        std::vector<aggregate_value_t> values;
+    };
+
+    /// Operator of an explained query, nodes are listed depth first
+    struct explain_node_t {
+        size_t depth;
+        std::string name;
+        /// Upper bound of items the operator gets, unknown is max
+        size_t estimated;
+        // Counters of EXPLAIN ANALYZE, zero for a plain EXPLAIN
+        size_t items_in;
+        size_t items_out;
+        size_t find_object_calls;
+        size_t strings_decoded;
+        /// Wall time of the whole query for the first node, time inside the operator summed over threads for others
+        std::chrono::nanoseconds time;
+    };
+
+    /// Pulls query results page by page, the scan goes only as far as the pages need
+    class query_cursor_t {
+    public:
+        virtual ~query_cursor_t() {}
+        /// Appends up to count next matches to page, false if the query failed
+        virtual bool fetch(size_t count, std::vector<heap_item_ptr_t>& page) = 0;
+        virtual bool done() const = 0;
+        /// The time budget ran out, pages hold only the matches found before it
+        virtual bool truncated() const { return false; }
     };
 
     class heap_profile_t {
+    public:
+        using query_callback_t = std::function<bool(const heap_item_ptr_t& item)>;
     public:
         virtual ~heap_profile_t() {}
         virtual bool has_errors() const = 0;
         virtual const std::string& error_message() const = 0;
         virtual bool query(const query_t& query, std::vector<heap_item_ptr_t>& result) const = 0;
+        /// Scan stops when the callback returns false
+        virtual bool query(const query_t& query, const query_callback_t& callback) const = 0;
+        /// The query must outlive the cursor
+        virtual std::unique_ptr<query_cursor_t> open(const query_t& query) const = 0;
+        /// Rows of ACTION_AGGREGATE ordered by group, OFFSET and LIMIT apply to rows
+        virtual bool aggregate(const query_t& query, std::vector<aggregate_row_t>& rows) const = 0;
+        /// Operators of the query plan, EXPLAIN ANALYZE runs the query and drops its results
+        virtual bool explain(const query_t& query, std::vector<explain_node_t>& nodes) const = 0;
         virtual const objects_index_t& objects_index() const = 0;
         virtual const classes_index_t& classes_index() const = 0;
     };
 
+    struct load_options_t {
+        // Identical primitive array payloads are stored once and shared between arrays
+        bool deduplicate_arrays = false;
+        // Threads running queries, zero means one per hardware thread
+        size_t query_threads = 0;
+        // Bytes kept for results of repeated queries, zero disables the cache
+        size_t query_cache_size = 64 << 20;
+        // Bytes kept for decoded string values, zero decodes a value on every read
+        size_t strings_cache_size = 16 << 20;
+    };
+
     class data_reader_t {
     public:
         using progress_callback = std::function<void(u_int32_t done, u_int32_t total)>;
     public:
         virtual ~data_reader_t() {}
-        virtual std::unique_ptr<heap_profile_t> build(hprof_istream_t&, const progress_callback& callback) const = 0;
+        virtual std::unique_ptr<heap_profile_t> build(hprof_istream_t&, const load_options_t& options, const progress_callback& callback) const = 0;
     };
 
     class data_reader_factory_t {
@@ -36,7 +36,7 @@ namespace hprof {
         explicit file_t(const std::string& name);
         virtual ~file_t();
 
-        std::unique_ptr<heap_profile_t> read_dump(const data_reader_factory_t&, const progress_callback&) const;
+        std::unique_ptr<heap_profile_t> read_dump(const data_reader_factory_t&, const progress_callback&, const load_options_t& options = load_options_t {}) const;
     private:
         std::string _file_name;
     };
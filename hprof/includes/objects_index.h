@@ -23,6 +23,10 @@ namespace hprof {
         virtual ~objects_index_t() {}
         // FIXME: Probably it is possible to find more convinient result type
         virtual heap_item_ptr_t find_object(jvm_id_t id) const = 0;
+        /// Ids of String objects holding exactly the value in ascending order, false when strings aren't indexed
+        virtual bool find_strings(const std::string&, std::vector<jvm_id_t>&) const { return false; }
+        /// Objects and classes holding the id in a field or an array item, false when references aren't indexed
+        virtual bool find_referrers(jvm_id_t, incoming_links_t&) const { return false; }
     };
 
     class classes_index_t {
@@ -30,5 +34,13 @@ namespace hprof {
         virtual ~classes_index_t() {}
         // FIXME: Probably it is possible to find more convinient result type
         virtual heap_item_ptr_t find_class(jvm_id_t id) const = 0;
+        /// All classes with exactly this name, there could be several loaded by different class loaders
+        virtual void find_classes(const std::string& name, std::vector<heap_item_ptr_t>& result) const = 0;
+        /// Classes having the field among their own instance fields
+        virtual void find_declaring_classes(const std::string& field_name, std::vector<heap_item_ptr_t>& result) const = 0;
+        /// Number of instances of classes within the hierarchy
+        virtual size_t count_instances(const class_hierarchy_t& hierarchy) const = 0;
+        /// Classes are numbered by class_hierarchy_t::enter in [1, count_classes()]
+        virtual size_t count_classes() const = 0;
     };
 }
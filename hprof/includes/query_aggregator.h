@@ -0,0 +1,75 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#pragma once
+
+#include "hprof.h"
+#include "query_sample.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace hprof {
+    /// Hash aggregation for ACTION_AGGREGATE. Every scan chunk fills its own partial, partials are
+    /// merged in chunk order at the end so results don't depend on the number of threads.
+    /// Counts and sums of a sampled query are scaled up, minimums and maximums are the ones of the sample
+    class query_aggregator_t {
+    public:
+        struct state_t {
+            bool has_int;
+            int64_t int_value;
+            bool has_double;
+            double double_value;
+            // Sum of squared values for confidence intervals of sampled sums
+            double squares;
+        };
+
+        struct group_t {
+            size_t count;
+            std::vector<state_t> states;
+        };
+
+        struct partial_t {
+            // Groups by class are keyed by the class until the end, names are taken once
+            std::unordered_map<const class_info_t*, group_t> classes;
+            std::unordered_map<std::string, group_t> groups;
+        };
+    public:
+        /// Binds fields of the query, the query has to outlive the aggregator
+        query_aggregator_t(const query_t& query, const objects_index_t& objects, const classes_index_t& classes);
+
+        void add(const heap_item_ptr_t& item, partial_t& partial) const;
+        void merge(partial_t&& partial);
+        void finish(size_t offset, size_t limit, std::vector<aggregate_row_t>& rows);
+    private:
+        group_t& find_group(const heap_item_ptr_t& item, partial_t& partial) const;
+        void merge_group(group_t&& from, group_t& to) const;
+        aggregate_value_t value_of(const group_t& group, size_t index) const;
+        aggregate_value_t exact_value_of(const group_t& group, size_t index) const;
+
+        static void accumulate(query_t::aggregate_t function, const field_value_t& value, state_t& state);
+        static void add_int(query_t::aggregate_t function, int64_t value, state_t& state);
+        static void add_double(query_t::aggregate_t function, double value, state_t& state);
+        static void combine_int(query_t::aggregate_t function, int64_t value, state_t& state);
+        static void combine_double(query_t::aggregate_t function, double value, state_t& state);
+    private:
+        const query_t& _query;
+        const objects_index_t& _objects;
+        const classes_index_t& _classes;
+        query_sample_t _sample;
+        partial_t _total;
+    };
+}
@@ -0,0 +1,71 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#pragma once
+
+#include "hprof.h"
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace hprof {
+    /// Results of recent queries keyed by the normalized query. The profile never changes
+    /// after it's loaded, so entries stay valid until they are evicted by newer ones
+    class query_cache_t {
+    public:
+        /// Items point into the profile storage, 8 bytes a result
+        using items_t = std::vector<const heap_item_ptr_t*>;
+
+        struct entry_t {
+            items_t items;
+            /// Items are the whole result, otherwise they are its first items in scan order
+            bool complete;
+        };
+    public:
+        /// Capacity in bytes, zero disables the cache
+        explicit query_cache_t(size_t capacity) : _capacity(capacity), _used(0) {}
+        query_cache_t(const query_cache_t&) = delete;
+
+        query_cache_t& operator=(const query_cache_t&) = delete;
+
+        /// Source, heaps and filter of the query, false when the filter can't be keyed
+        static bool key(const query_t& query, std::string& key);
+        /// Memory taken by an entry, used against the capacity
+        static size_t cost(const std::string& key, const entry_t& entry);
+
+        size_t capacity() const { return _capacity; }
+        size_t used() const;
+        size_t entries() const;
+
+        /// Found entry becomes the most recently used one
+        std::shared_ptr<const entry_t> find(const std::string& key);
+        /// Shorter prefixes never replace a longer or a complete result
+        void store(const std::string& key, std::shared_ptr<const entry_t>&& entry);
+        /// Drops every entry, results of later queries may come in another order
+        void clear();
+    private:
+        using lru_t = std::list<std::pair<std::string, std::shared_ptr<const entry_t>>>;
+    private:
+        mutable std::mutex _lock;
+        size_t _capacity;
+        size_t _used;
+        lru_t _lru;
+        std::unordered_map<std::string, lru_t::iterator> _entries;
+    };
+}
@@ -0,0 +1,112 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#pragma once
+
+#include "hprof.h"
+#include "query_cache.h"
+#include "query_planner.h"
+#include "query_pool.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace hprof {
+    /// Runs scan chunks lazily in waves, results are merged in chunk order so pages
+    /// come out the same as of a serial scan. A wave is one chunk without a pool and
+    /// grows twice per wave with it, so a small LIMIT scans only the first chunks.
+    /// The token is looked at before every chunk, chunks look at it themselves while they scan
+    class query_cursor_impl_t : public query_cursor_t {
+    public:
+        /// A chunk stopped by the budget keeps the matches found so far, a cancelled one fails
+        enum chunk_result_t { Scanned, Cut, Failed };
+        /// Appends matches of one chunk to out
+        using chunk_t = std::function<chunk_result_t(query_cache_t::items_t& out)>;
+        /// Takes matches of one chunk on the thread that scanned it
+        using consumer_t = std::function<void(size_t chunk, const query_cache_t::items_t& matches)>;
+    public:
+        query_cursor_impl_t(query_pool_t* pool, query_plan_t&& plan, size_t offset, size_t limit, const query_token_t* token = nullptr);
+        virtual ~query_cursor_impl_t();
+
+        /// Chunks refer to the plan, it stays at the same address for the cursor life
+        const query_plan_t& plan() const { return _plan; }
+        const query_token_t* token() const { return _token; }
+        void add(chunk_t&& chunk) { _chunks.push_back(std::move(chunk)); }
+        /// Scanned matches are stored to the cache when the cursor is destroyed
+        void record(query_cache_t* cache, std::string&& key);
+
+        virtual bool fetch(size_t count, std::vector<heap_item_ptr_t>& page) override;
+        virtual bool done() const override;
+        virtual bool truncated() const override { return _truncated; }
+
+        /// Scans every chunk left at once, matches are handed to the consumer instead of pages
+        bool drain(const consumer_t& consume);
+        size_t chunks() const { return _chunks.size(); }
+    private:
+        bool scan(size_t wanted);
+        /// Fails the cursor on cancel and drops chunks left when the budget is over
+        bool stopped();
+        /// Folds the results of one wave, false if a chunk failed
+        bool finish(bool failed, bool cut);
+    private:
+        query_pool_t* _pool;
+        query_plan_t _plan;
+        std::vector<chunk_t> _chunks;
+        size_t _next_chunk;
+        size_t _wave;
+        // Matches of the last wave not yet fetched start at _ready_pos
+        query_cache_t::items_t _ready;
+        size_t _ready_pos;
+        size_t _skip;
+        size_t _left;
+        bool _failed;
+        const query_token_t* _token;
+        bool _truncated;
+
+        query_cache_t* _cache;
+        std::string _cache_key;
+        query_cache_t::items_t _recorded;
+    };
+
+    /// Result of a statement returning no items
+    class query_status_cursor_impl_t : public query_cursor_t {
+    public:
+        explicit query_status_cursor_impl_t(bool succeed) : _succeed(succeed) {}
+        virtual ~query_status_cursor_impl_t() {}
+
+        virtual bool fetch(size_t, std::vector<heap_item_ptr_t>&) override { return _succeed; }
+        virtual bool done() const override { return true; }
+    private:
+        bool _succeed;
+    };
+
+    /// Pages of a cached or an ordered result
+    class query_cache_cursor_impl_t : public query_cursor_t {
+    public:
+        query_cache_cursor_impl_t(std::shared_ptr<const query_cache_t::entry_t>&& entry, size_t offset, size_t limit, bool truncated = false);
+        virtual ~query_cache_cursor_impl_t() {}
+
+        virtual bool fetch(size_t count, std::vector<heap_item_ptr_t>& page) override;
+        virtual bool done() const override { return _next == _last; }
+        virtual bool truncated() const override { return _truncated; }
+    private:
+        std::shared_ptr<const query_cache_t::entry_t> _entry;
+        size_t _next;
+        size_t _last;
+        bool _truncated;
+    };
+}
@@ -0,0 +1,61 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#pragma once
+
+#include "hprof.h"
+#include "field_index.h"
+#include "filter_program.h"
+#include "query_sample.h"
+
+#include <vector>
+
+namespace hprof {
+    struct query_plan_t {
+        /// Items are taken from per-class instance lists instead of scanning heaps
+        bool use_class_index;
+        /// Merged class intervals visited when the class index is used
+        std::vector<class_hierarchy_t> hierarchies;
+        /// Upper bound of items the scan visits
+        size_t estimated_items;
+        /// Bound filter flattened for the scan
+        filter_program_t program;
+        /// Index narrowing the class index scan down by one of AND-ed comparisons, null when none fits
+        const field_index_t* index;
+        const filter_compare_field_t* index_filter;
+        /// Instances of one class are checked by columns when the filter allows, off under EXPLAIN ANALYZE
+        bool use_columns;
+        /// Candidates left out of the sample are skipped before the filter
+        query_sample_t sample;
+    };
+
+    /// Binds the query filter to the profile, orders AND/OR operands and picks the
+    /// cheapest way to enumerate candidates
+    class query_planner_t {
+    public:
+        query_planner_t(const classes_index_t& classes, size_t objects_count, size_t classes_count,
+                        const std::vector<const field_index_t*>& indexes = {}) : 
+            _classes(classes), _objects_count(objects_count), _classes_count(classes_count), _indexes(indexes) {}
+
+        query_plan_t plan(const query_t& query) const;
+    private:
+        void pick_index(const filter_t* filter, query_plan_t& plan) const;
+    private:
+        const classes_index_t& _classes;
+        size_t _objects_count;
+        size_t _classes_count;
+        std::vector<const field_index_t*> _indexes;
+    };
+}
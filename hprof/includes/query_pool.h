@@ -0,0 +1,71 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#pragma once
+
+#include "types.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace hprof {
+    /// Work-stealing pool for query chunks. Chunks are dealt to per-thread queues, a thread
+    /// takes its own chunks from the front and steals from the back of other queues.
+    /// The thread calling run() works as one of the pool threads
+    class query_pool_t {
+    public:
+        using task_t = std::function<void(size_t chunk)>;
+    public:
+        /// Zero threads means one per hardware thread
+        explicit query_pool_t(size_t threads);
+        query_pool_t(const query_pool_t&) = delete;
+        ~query_pool_t();
+
+        query_pool_t& operator=(const query_pool_t&) = delete;
+
+        size_t threads() const { return _threads; }
+
+        /// Calls task for every chunk in [0, chunks) and returns when all of them are done
+        void run(size_t chunks, const task_t& task);
+    private:
+        struct queue_t {
+            std::mutex lock;
+            std::deque<size_t> chunks;
+        };
+
+        void worker(size_t index);
+        void work(size_t index);
+        bool take(size_t index, size_t& chunk);
+    private:
+        size_t _threads;
+        std::unique_ptr<queue_t[]> _queues;
+        std::vector<std::thread> _workers;
+
+        std::mutex _run_lock;
+        std::mutex _lock;
+        std::condition_variable _wake;
+        std::condition_variable _done;
+        u_int64_t _generation;
+        bool _stop;
+        const task_t* _task;
+        std::atomic<size_t> _pending;
+    };
+}
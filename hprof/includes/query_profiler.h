@@ -0,0 +1,99 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#pragma once
+
+#include "hprof.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace hprof {
+    /// Stands for the query filter under EXPLAIN ANALYZE. Walks the bound filter tree node by node,
+    /// AND/OR short-circuit as they do in the program, and counts items, find_object calls,
+    /// decoded strings and time of every node. Counters of a node include its operands.
+    /// Every scanning thread counts into its own block, blocks are summed when counters are read
+    class query_profiler_t : public filter_t {
+    public:
+        query_profiler_t();
+        query_profiler_t(const query_profiler_t&) = delete;
+        virtual ~query_profiler_t() {}
+
+        query_profiler_t& operator=(const query_profiler_t&) = delete;
+
+        /// Null filter matches everything, the filter has to be bound and outlive the profiler
+        void attach(const filter_t* filter);
+
+        virtual filter_result_t operator()(const heap_item_ptr_t& item, const objects_index_t& objects) const override;
+
+        /// Items checked and matched over the whole scan
+        size_t scanned() const { return total(_nodes.size()).items_in; }
+        size_t matched() const { return total(_nodes.size()).items_out; }
+        /// Time spent in the filter summed over threads
+        std::chrono::nanoseconds time() const { return std::chrono::nanoseconds { total(_nodes.size()).nanoseconds }; }
+
+        /// Profiler of the subquery of REFERRING TO and REFERENCED BY, created on the first call
+        query_profiler_t* related();
+        const query_profiler_t* related() const { return _related.get(); }
+
+        /// Appends a node per filter operator, the root one at the depth
+        void report(size_t depth, const classes_index_t& classes, std::vector<explain_node_t>& nodes) const;
+
+        /// One line of the plan tree, counters are printed for analyzed queries only
+        static void format(const explain_node_t& node, bool analyzed, std::string& out);
+    private:
+        enum kind_t {
+            KIND_AND,
+            KIND_OR,
+            KIND_NOT,
+            KIND_LEAF
+        };
+
+        struct node_t {
+            kind_t kind;
+            const filter_t* filter;
+            size_t depth;
+            // Operands of AND/OR, NOT has the left one only
+            size_t left;
+            size_t right;
+        };
+
+        struct counters_t {
+            size_t items_in = 0;
+            size_t items_out = 0;
+            size_t find_object_calls = 0;
+            size_t strings_decoded = 0;
+            int64_t nanoseconds = 0;
+        };
+
+        // Counters of every node of one thread, the whole scan ones go last
+        using thread_counters_t = std::vector<counters_t>;
+    private:
+        size_t add(const filter_t* filter, size_t depth);
+        filter_result_t evaluate(size_t index, const heap_item_ptr_t& item, const objects_index_t& objects, thread_counters_t& counters) const;
+        /// Block of the calling thread, registered on its first item
+        thread_counters_t& local() const;
+        counters_t total(size_t index) const;
+    private:
+        std::vector<node_t> _nodes;
+        // Tells blocks cached by threads for an earlier attach or another profiler apart
+        u_int64_t _run;
+        mutable std::mutex _threads_lock;
+        mutable std::vector<std::unique_ptr<thread_counters_t>> _threads;
+        std::unique_ptr<query_profiler_t> _related;
+    };
+}
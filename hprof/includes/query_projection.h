@@ -0,0 +1,44 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#pragma once
+
+#include "hprof.h"
+
+#include <string>
+#include <vector>
+
+namespace hprof {
+    /// Flat rows of SHOW object.a, object.b.c FROM ..., only the projected paths are read
+    class query_projection_t {
+    public:
+        /// Binds fields of the query, the query has to outlive the projection
+        query_projection_t(const query_t& query, const objects_index_t& objects, const classes_index_t& classes);
+
+        /// Dotted paths of the projected fields
+        void columns(std::vector<std::string>& names) const;
+        /// Replaces values with the fields of the item, a field the item doesn't have is "<none>"
+        void row(const heap_item_ptr_t& item, std::vector<std::string>& values) const;
+
+        /// Same text for the same value, strings are quoted and other objects are named by their class
+        static std::string render(const field_value_t& value, const objects_index_t& objects, const classes_index_t& classes);
+        /// Name of the class of an object, array types are named by their items
+        static std::string class_name(const heap_item_ptr_t& item, const classes_index_t& classes);
+    private:
+        const query_t& _query;
+        const objects_index_t& _objects;
+        const classes_index_t& _classes;
+    };
+}
@@ -0,0 +1,75 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#pragma once
+
+#include "types.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace hprof {
+    /// Bernoulli sample of query candidates. A candidate is kept when the hash of its id falls
+    /// below the threshold, so the same ids are picked whatever the scan order or the number of threads
+    class query_sample_t {
+    public:
+        /// Fractions of one and above keep every candidate
+        explicit query_sample_t(double fraction = 1.0, u_int64_t seed = 0) : 
+            _fraction(std::min(std::max(fraction, 0.0), 1.0)), _threshold(threshold_of(_fraction)), _seed(seed) {}
+
+        bool all() const { return _threshold == std::numeric_limits<u_int64_t>::max(); }
+        double fraction() const { return _fraction; }
+        u_int64_t threshold() const { return _threshold; }
+        u_int64_t seed() const { return _seed; }
+
+        bool contains(jvm_id_t id) const {
+            return all() || mix(id ^ _seed) < _threshold;
+        }
+
+        /// Horvitz-Thompson estimates of totals over all candidates and the half widths of their 95% confidence intervals
+        void estimate_count(size_t matches, double& total, double& error) const {
+            estimate_sum(static_cast<double>(matches), static_cast<double>(matches), total, error);
+        }
+
+        /// Squares is the sum of squared values of the sample
+        void estimate_sum(double sum, double squares, double& total, double& error) const {
+            if (all() || _fraction == 0) {
+                total = sum;
+                error = 0;
+                return;
+            }
+            total = sum / _fraction;
+            error = Z_95 * std::sqrt((1 - _fraction) * squares) / _fraction;
+        }
+    private:
+        static u_int64_t threshold_of(double fraction) {
+            return fraction >= 1 ? std::numeric_limits<u_int64_t>::max() : static_cast<u_int64_t>(std::ldexp(fraction, 64));
+        }
+
+        /// Finalizer of SplitMix64, ids are aligned addresses and have to be spread over all bits
+        static u_int64_t mix(u_int64_t value) {
+            value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+            value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+            return value ^ (value >> 31);
+        }
+    private:
+        static constexpr double Z_95 = 1.959963984540054;
+
+        double _fraction;
+        u_int64_t _threshold;
+        u_int64_t _seed;
+    };
+}
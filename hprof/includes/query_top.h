@@ -0,0 +1,68 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#pragma once
+
+#include "hprof.h"
+#include "query_cache.h"
+
+#include <mutex>
+#include <vector>
+
+namespace hprof {
+    /// Best offset + limit matches of an ordered query. Scan chunks keep bounded heaps of their
+    /// own and merge them into the shared one, ties keep the scan order
+    class query_top_t {
+    public:
+        /// Binds the order field, the query has to outlive the top
+        query_top_t(const query_t& query, const objects_index_t& objects, const classes_index_t& classes, size_t count);
+
+        /// Called from scan threads with matches of one chunk
+        void add(size_t chunk, const query_cache_t::items_t& matches);
+        /// Kept matches in the query order
+        void finish(query_cache_t::items_t& items);
+
+        /// Instance fields payload or array data size, zero for classes
+        static size_t shallow_size(const heap_item_ptr_t& item);
+    private:
+        struct key_t {
+            bool missing;
+            bool integral;
+            int64_t int_value;
+            double double_value;
+        };
+
+        struct entry_t {
+            key_t key;
+            size_t chunk;
+            size_t index;
+            const heap_item_ptr_t* item;
+        };
+    private:
+        key_t key_of(const heap_item_ptr_t& item) const;
+        /// Strict order of results, the first entry is returned first
+        bool before(const entry_t& left, const entry_t& right) const;
+        void push(entry_t&& entry, std::vector<entry_t>& heap) const;
+
+        static int compare(const key_t& left, const key_t& right);
+    private:
+        const query_t& _query;
+        const objects_index_t& _objects;
+        size_t _count;
+        std::mutex _lock;
+        // The worst kept entry is on the top
+        std::vector<entry_t> _heap;
+    };
+}
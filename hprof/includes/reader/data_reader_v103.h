@@ -32,7 +32,7 @@ namespace hprof {
     public:
         data_reader_v103_t() {}
         virtual ~data_reader_v103_t() {}
-        virtual std::unique_ptr<heap_profile_t> build(hprof_istream_t& in, const progress_callback& callback) const override;
+        virtual std::unique_ptr<heap_profile_t> build(hprof_istream_t& in, const load_options_t& options, const progress_callback& callback) const override;
     private:
         enum hprof_tag_t : u_int8_t {
             TAG_UTF8_STRING = 0x01,
@@ -189,8 +189,18 @@ namespace hprof {
             bool _error_occurred;
         };
 
+        // The table holds every block until loading ends, then only arrays keep them
+        struct shared_payload_t {
+            payload_block_t block;
+            size_t size;
+        };
+
         struct heap_profile_data_t {
             u_int8_t id_size;
+            bool deduplicate_arrays;
+            int32_t heap_type;
+            std::unordered_multimap<u_int64_t, shared_payload_t> payloads;
+            std::vector<u_int8_t> payload_buffer;
             std::unordered_map<jvm_id_t, std::string> strings;
             std::unordered_map<jvm_id_t, loaded_class_t> loaded_class;
             std::vector<instance_info_impl_ptr_t> instances;
@@ -210,8 +220,9 @@ namespace hprof {
         bool read_class_dump(hprof_section_reader& reader, u_int8_t id_size, const std::unordered_map<jvm_id_t, std::string>& strings, std::vector<class_info_impl_ptr_t>& classes) const;
         bool read_instance_dump(hprof_section_reader& reader, u_int8_t id_size, std::vector<instance_info_impl_ptr_t>& objects) const;
         bool read_objects_array_dump(hprof_section_reader& reader, u_int8_t id_size, std::vector<objects_array_info_impl_ptr_t>& objects) const;
-        bool read_primitives_array_dump(hprof_section_reader& reader, u_int8_t id_size, std::vector<primitives_array_info_impl_ptr_t>& objects) const;
+        bool read_primitives_array_dump(hprof_section_reader& reader, heap_profile_data_t& data) const;
+        const payload_block_t* find_shared_payload(heap_profile_data_t& data, const u_int8_t* payload, size_t size) const;
         bool read_gc_root(hprof_gc_tag_t subtype, hprof_section_reader& reader, std::vector<gc_root_impl_ptr_t>& roots) const;
-        bool prepare(heap_profile_data_t& data, heap_profile_impl_t& hprof, const progress_callback& callback) const;
+        bool prepare(heap_profile_data_t& data, heap_profile_impl_t& hprof, const load_options_t& options, const progress_callback& callback) const;
     };
 }
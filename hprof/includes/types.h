@@ -145,15 +145,34 @@ namespace hprof {
 
     using strings_map_t = std::unordered_map<jvm_id_t, std::string>;
 
+    /// Pre-order numbering of the class tree. A class is a subclass of other when its enter lies
+    /// within the other's [enter, exit]. Zero enter means the class wasn't numbered
+    struct class_hierarchy_t {
+        u_int32_t enter;
+        u_int32_t exit;
+
+        bool contains(const class_hierarchy_t& other) const {
+            return enter != 0 && enter <= other.enter && other.enter <= exit;
+        }
+
+        /// Sorts and joins nested or overlapping intervals
+        static void merge(std::vector<class_hierarchy_t>& hierarchies);
+    };
+
     struct heap_info_t {
         enum : int {
             HEAP_UNKNOWN = 0,
             HEAP_APP,
             HEAP_SYSTEM,
-            HEAP_ZYGOTE
+            HEAP_ZYGOTE,
+            HEAP_IMAGE
         };
         int32_t type;
         jvm_id_t name;
+
+        static const char* name_of(int32_t type);
+        /// Returns -1 for unknown names
+        static int32_t by_name(const std::string& name);
     };
 
     class gc_root_t {
@@ -350,7 +369,7 @@ namespace hprof {
         virtual ~fields_values_t();
         virtual size_t count() const = 0;
         virtual fields_values_t::iterator operator[](size_t index) const = 0;
-        virtual fields_values_t::iterator find(std::string name) const = 0;
+        virtual fields_values_t::iterator find(const std::string& name) const = 0;
         virtual fields_values_t::iterator begin() const = 0;
         virtual fields_values_t::iterator end() const = 0;
     };
@@ -379,6 +398,7 @@ namespace hprof {
         virtual size_t instance_size() const = 0;
         virtual const fields_spec_t& fields() const = 0;
         virtual const fields_values_t& static_fields() const = 0;
+        virtual const class_hierarchy_t& hierarchy() const = 0;
     };
 
     class instance_info_t : public virtual object_info_t {
@@ -388,12 +408,26 @@ namespace hprof {
         virtual int32_t stack_trace_id() const = 0;
         virtual const class_info_t* get_class() const = 0;
         virtual const fields_values_t& fields() const = 0;
+        /// Raw fields payload in dump byte order, fields are at their value offsets
+        virtual const u_int8_t* data() const = 0;
     };
 
     class string_info_t : public virtual instance_info_t {
+    public:
+        enum encoding_t {
+            /// char[] value
+            ENCODING_UTF16_BE,
+            /// byte[] value of a compact string, coder is UTF16
+            ENCODING_UTF16_LE,
+            /// byte[] value of a compact string, coder is LATIN1
+            ENCODING_LATIN1
+        };
     public:
         virtual ~string_info_t();
-        virtual const std::string& value() const = 0;
+        /// Decoded on every call unless the strings cache of the profile still holds it
+        virtual std::string value() const = 0;
+        /// Value bytes as they are in the dump, false when the string has no value
+        virtual bool payload(const u_int8_t*& data, size_t& size, encoding_t& encoding) const = 0;
     };
 
     class primitives_array_info_t : public virtual object_info_t {
@@ -422,6 +456,7 @@ namespace hprof {
         virtual iterator begin() const = 0;
         virtual iterator end() const = 0;
         virtual iterator operator[](size_t index) const = 0;
+        virtual const u_int8_t* data() const = 0;
     };
 
     class objects_array_info_t : public virtual object_info_t {
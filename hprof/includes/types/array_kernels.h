@@ -0,0 +1,66 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#pragma once
+
+#include "types.h"
+
+#include <vector>
+
+namespace hprof {
+    template<typename T>
+    struct array_summary_t {
+        T min;
+        T max;
+        T sum;
+    };
+
+    /// Kernels work directly on the big-endian array payload as it was read from the dump.
+    /// AVX2 and SSE4.1 implementations are picked at runtime, scalar code is used otherwise.
+    class array_kernels_t {
+    public:
+        enum isa_t {
+            ISA_SCALAR,
+            ISA_SSE41,
+            ISA_AVX2
+        };
+    public:
+        static bool is_zeroed(const u_int8_t* data, size_t data_size);
+        static bool is_constant(const u_int8_t* data, size_t data_size, size_t item_size);
+
+        /// Integral item types only (bool, byte, char, short, int, long)
+        static bool summarize(jvm_type_t type, const u_int8_t* data, size_t length, array_summary_t<int64_t>& summary);
+        /// Any numeric item type, integral values are converted to double
+        static bool summarize(jvm_type_t type, const u_int8_t* data, size_t length, array_summary_t<double>& summary);
+
+        /// Population of raw byte values over the whole payload
+        static void bytes_histogram(const u_int8_t* data, size_t data_size, size_t (&bins)[256]);
+        /// Equal width buckets over [min, max] for integral item types, values out of range are ignored
+        static bool histogram(jvm_type_t type, const u_int8_t* data, size_t length, int64_t min, int64_t max, std::vector<size_t>& bins);
+        /// Share of items holding the most frequent value when it holds over half of them, zero otherwise.
+        /// Found by narrowing the fullest histogram bucket, float and double items are compared by their bits
+        static double dominant_share(jvm_type_t type, const u_int8_t* data, size_t length);
+
+        /// Looks for an item equal to the given one byte by byte, both are big-endian as in the dump.
+        /// Item size is 1, 2, 4 or 8
+        static bool contains_item(const u_int8_t* data, size_t length, const u_int8_t* item, size_t item_size);
+
+        /// Fast non-cryptographic hash of the payload (MurmurHash64A), equal hashes still need memcmp
+        static u_int64_t hash(const u_int8_t* data, size_t data_size);
+
+        static isa_t isa();
+        static void force_isa(isa_t isa);
+    };
+}
@@ -72,6 +72,9 @@ namespace hprof {
         virtual const fields_values_t& static_fields() const override { return _static_fields; }
         void add_static_field(const field_spec_impl_t& field) { _static_fields.add(field); }
         u_int8_t* data() { return _data; }
+
+        virtual const class_hierarchy_t& hierarchy() const override { return _hierarchy; }
+        void set_hierarchy(const class_hierarchy_t& hierarchy) { _hierarchy = hierarchy; }
     public:
         static class_info_impl_ptr_t create(u_int8_t id_size, jvm_id_t id, size_t data_size) {
             auto mem = new (std::nothrow) u_int8_t[sizeof(class_info_impl_t) + data_size];
@@ -80,7 +83,7 @@ namespace hprof {
     private:
         class_info_impl_t(u_int8_t id_size, jvm_id_t id) : 
             object_info_impl_t(id_size, id), _super_id(0), _class_loader_id(0), _name_id(0), _seq_number(0), _stack_trace_id(0), _size(0), 
-            _fields(id_size), _data(reinterpret_cast<u_int8_t*>(this) + sizeof(class_info_impl_t)), _static_fields(id_size, _data) {}
+            _hierarchy { 0, 0 }, _fields(id_size), _data(reinterpret_cast<u_int8_t*>(this) + sizeof(class_info_impl_t)), _static_fields(id_size, _data) {}
     private:
         jvm_id_t _super_id;
         heap_item_ptr_t _super_class;
@@ -91,6 +94,7 @@ namespace hprof {
         int32_t _seq_number;
         int32_t _stack_trace_id;
         size_t _size;
+        class_hierarchy_t _hierarchy;
         fields_spec_impl_t _fields;
         u_int8_t* _data;
         fields_values_impl_t _static_fields;
@@ -0,0 +1,56 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#pragma once
+
+#include "types.h"
+
+namespace hprof {
+    /// Columnar evaluation of field predicates. A field is gathered from a batch of instances
+    /// of the same class into a column, the column is compared with SSE4.1/AVX2 picked the
+    /// same way as for array_kernels_t, and the result is a selection bitmap
+    class column_kernels_t {
+    public:
+        enum compare_t {
+            COMPARE_EQUALS,
+            COMPARE_NOT_EQUALS,
+            COMPARE_LESS,
+            COMPARE_LESS_OR_EQUALS,
+            COMPARE_GREATER,
+            COMPARE_GREATER_OR_EQUALS
+        };
+
+        static const size_t BATCH_SIZE = 1024;
+    public:
+        /// Words of a selection bitmap for count items
+        static size_t selection_size(size_t count) { return (count + 63) / 64; }
+        /// Selects all or none of count items
+        static void fill(u_int64_t* selection, size_t count, bool value);
+        /// Flips first count bits
+        static void negate(u_int64_t* selection, size_t count);
+
+        /// Reads the big-endian field at offset of every row. Integral types up to int
+        /// for int32_t, any integral type for int64_t, any numeric type for double
+        static bool gather(jvm_type_t type, const u_int8_t* const* rows, size_t count, size_t offset, int32_t* column);
+        static bool gather(jvm_type_t type, const u_int8_t* const* rows, size_t count, size_t offset, int64_t* column);
+        static bool gather(jvm_type_t type, const u_int8_t* const* rows, size_t count, size_t offset, double* column);
+
+        /// Sets bit i of the selection when column[i] compares to the literal, other bits are cleared.
+        /// Floating point comparisons follow C++ rules for NaN
+        static void select(compare_t compare, const int32_t* column, size_t count, int32_t literal, u_int64_t* selection);
+        static void select(compare_t compare, const int64_t* column, size_t count, int64_t literal, u_int64_t* selection);
+        static void select(compare_t compare, const double* column, size_t count, double literal, u_int64_t* selection);
+    };
+}
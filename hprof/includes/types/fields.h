@@ -84,13 +84,14 @@ namespace hprof {
         field_value_impl_t(const field_spec_t& field, size_t id_size, const u_int8_t* data) 
             :  field_value_impl_t(field.name(), field.type(), field.offset(), id_size, data) {}
 
+        /// Name isn't copied, it has to outlive the value
         field_value_impl_t(const std::string& name, jvm_type_t type, size_t offset, size_t id_size, const u_int8_t* data) 
-            : value_reader_t(data + offset, jvm_type_t::size(type, id_size)), _name(name), _type(type), _offset(offset) {}
+            : value_reader_t(data + offset, jvm_type_t::size(type, id_size)), _name(&name), _type(type), _offset(offset) {}
 
-        field_value_impl_t() : value_reader_t(nullptr, 0), _type(jvm_type_t::JVM_TYPE_UNKNOWN), _offset(0) {}
+        field_value_impl_t() : value_reader_t(nullptr, 0), _name(&empty_name()), _type(jvm_type_t::JVM_TYPE_UNKNOWN), _offset(0) {}
         virtual ~field_value_impl_t() {}
 
-        virtual const std::string& name() const override { return _name; }
+        virtual const std::string& name() const override { return *_name; }
         virtual jvm_type_t type() const override { return _type; }
         virtual size_t offset() const override { return _offset; }
         
@@ -105,7 +106,12 @@ namespace hprof {
         virtual operator jvm_long_t() const override { return value_reader_t::operator jvm_long_t(); }
         
     private:
-        std::string _name;
+        static const std::string& empty_name() {
+            static const std::string name;
+            return name;
+        }
+    private:
+        const std::string* _name;
         jvm_type_t _type;
         size_t _offset;
     };
@@ -127,7 +133,7 @@ namespace hprof {
             return end();
         }
 
-        virtual fields_values_t::iterator find(std::string name) const override {
+        virtual fields_values_t::iterator find(const std::string& name) const override {
             for (auto it = std::begin(_fields); it != std::end(_fields); ++it) {
                 if (it->name() == name) {
                     return iterator { _id_size, it, _data };
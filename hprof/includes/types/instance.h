@@ -30,7 +30,6 @@ namespace hprof {
     using instance_info_impl_ptr_t = std::unique_ptr<instance_info_impl_t, instance_info_impl_t_deleter>;
 
     class instance_info_impl_t : public virtual instance_info_t, public object_info_impl_t {
-        friend class string_info_impl_t;
     public:
         instance_info_impl_t(const instance_info_impl_t&) = delete;
         instance_info_impl_t(instance_info_impl_t&&) = default;
@@ -48,7 +47,7 @@ namespace hprof {
         virtual const fields_values_t& fields() const override { return _fields; }
         virtual int32_t has_link_to(jvm_id_t id) const override;
         u_int8_t* data() { return _data; }
-        const u_int8_t* data() const { return _data; }
+        virtual const u_int8_t* data() const override { return _data; }
         size_t data_size() const { return _data_size; }
     public:
         static instance_info_impl_ptr_t create(u_int8_t id_size, jvm_id_t id, size_t data_size);
@@ -56,10 +55,6 @@ namespace hprof {
         instance_info_impl_t(u_int8_t id_size, jvm_id_t id, size_t data_size) :  
             object_info_impl_t(id_size, id), _class_id(0), _stack_trace_id(0), _data_size(data_size),
             _data(reinterpret_cast<u_int8_t *>(this) + sizeof(instance_info_impl_t)), _fields(id_size, _data) {}
-        
-        instance_info_impl_t(const instance_info_impl_t& src, u_int8_t* data) : 
-            object_info_impl_t(src), _class_id(src._class_id), _stack_trace_id(src._stack_trace_id), 
-            _class(src._class), _data_size(src._data_size), _data(data), _fields(src._fields, data) {}
     private:
         jvm_id_t _class_id;
         int32_t _stack_trace_id;
@@ -19,9 +19,37 @@
 #include "types/object.h"
 #include "types/value_reader.h"
 
+#include <atomic>
 #include <iostream>
 
 namespace hprof {
+    /// Bytes of arrays deduplicated at load time. The number of holders is kept in front of the bytes,
+    /// so arrays owning their payload pay nothing for sharing. The bytes never change once copied in
+    class payload_block_t {
+    public:
+        payload_block_t() : _data(nullptr) {}
+        /// Copies the bytes, data() is null when out of memory
+        payload_block_t(const u_int8_t* bytes, size_t size);
+        payload_block_t(const payload_block_t& other) : _data(other._data) { retain(_data); }
+        ~payload_block_t() { release(_data); }
+
+        payload_block_t& operator=(const payload_block_t& other);
+
+        const u_int8_t* data() const { return _data; }
+
+        static void retain(const u_int8_t* data);
+        /// The last holder frees the block
+        static void release(const u_int8_t* data);
+    private:
+        struct alignas(16) header_t {
+            std::atomic<size_t> holders;
+        };
+
+        static header_t* header_of(const u_int8_t* data);
+    private:
+        const u_int8_t* _data;
+    };
+
     class primitives_array_info_impl_t;
 
     class primitives_array_info_impl_t_deleter {
@@ -88,11 +116,11 @@ namespace hprof {
         };
     public:
         primitives_array_info_impl_t(const primitives_array_info_impl_t&) = delete;
-        primitives_array_info_impl_t(primitives_array_info_impl_t&&) = default;
+        primitives_array_info_impl_t(primitives_array_info_impl_t&&) = delete;
         virtual ~primitives_array_info_impl_t();
 
         primitives_array_info_impl_t& operator=(const primitives_array_info_impl_t&) = delete;
-        primitives_array_info_impl_t& operator=(primitives_array_info_impl_t&&) = default;
+        primitives_array_info_impl_t& operator=(primitives_array_info_impl_t&&) = delete;
 
         virtual int32_t has_link_to(jvm_id_t) const override { return 0; }
 
@@ -109,19 +137,34 @@ namespace hprof {
             return end();
         }
 
-        u_int8_t* data() { return _data; }
+        virtual const u_int8_t* data() const override { return _data; }
+        /// Only a payload owned by the array can be written, a shared one is null
+        u_int8_t* data() { return shared() ? nullptr : inline_data(); }
+        /// Payload is a block deduplicated with other arrays
+        bool shared() const { return _data != inline_data(); }
     public:
         static primitives_array_info_impl_ptr_t create(u_int8_t id_size, jvm_id_t id, jvm_type_t type, size_t length, size_t data_size) {
             auto mem = new (std::nothrow) u_int8_t[sizeof(primitives_array_info_impl_t) + data_size];
             return primitives_array_info_impl_ptr_t { new (mem) primitives_array_info_impl_t(id_size, id, type, length, data_size) };
         }
+
+        /// Array holds the block shared with other arrays of equal bytes until it is destroyed
+        static primitives_array_info_impl_ptr_t create(u_int8_t id_size, jvm_id_t id, jvm_type_t type, size_t length, const payload_block_t& payload, size_t data_size) {
+            auto mem = new (std::nothrow) u_int8_t[sizeof(primitives_array_info_impl_t)];
+            return primitives_array_info_impl_ptr_t { new (mem) primitives_array_info_impl_t(id_size, id, type, length, payload.data(), data_size) };
+        }
     private:
         primitives_array_info_impl_t(u_int8_t id_size, jvm_id_t id, jvm_type_t type, size_t length, size_t data_size) : 
-        object_info_impl_t(id_size, id), _data(reinterpret_cast<u_int8_t*>(this) + sizeof(primitives_array_info_impl_t)), 
-        _data_size(data_size), _length(length), _type(type) {}
-    
+        object_info_impl_t(id_size, id), _data(inline_data()), _data_size(data_size), _length(length), _type(type) {}
+
+        primitives_array_info_impl_t(u_int8_t id_size, jvm_id_t id, jvm_type_t type, size_t length, const u_int8_t* shared, size_t data_size) :
+        object_info_impl_t(id_size, id), _data(shared), _data_size(data_size), _length(length), _type(type) {
+            payload_block_t::retain(shared);
+        }
+
+        u_int8_t* inline_data() const { return reinterpret_cast<u_int8_t*>(const_cast<primitives_array_info_impl_t*>(this)) + sizeof(primitives_array_info_impl_t); }
     private:
-        u_int8_t* _data;
+        const u_int8_t* _data;
         size_t _data_size;
         size_t _length;
         jvm_type_t _type;
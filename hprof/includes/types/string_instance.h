@@ -19,10 +19,71 @@
 #include "types/primitives_array.h"
 #include "hprof.h"
 
-#include <codecvt>
-#include <locale>
+#include <list>
+#include <mutex>
+#include <unordered_map>
 
 namespace hprof {
+    /// Decoded string values shared by all strings of a profile. Values are keyed by the
+    /// payload of the backing array, so strings borrowing the same array are decoded once.
+    /// Arrays of different types share one payload when their bytes are equal, so the key
+    /// holds the encoding and the length as well.
+    /// The map is split into shards picked by the key hash, so query threads rarely wait for each other.
+    /// Every shard holds an even part of the byte budget and evicts its least recently used values
+    class strings_cache_t {
+    public:
+        using encoding_t = string_info_t::encoding_t;
+
+        static const size_t DEFAULT_SIZE = 16 << 20;
+    public:
+        /// Zero bytes decodes every value anew
+        explicit strings_cache_t(size_t bytes = DEFAULT_SIZE);
+
+        /// A copy, the cached value may be evicted by another thread right after
+        std::string value(const primitives_array_info_t& array, encoding_t encoding);
+        size_t size() const;
+        /// Approximate memory held by the values, never above the budget
+        size_t bytes() const;
+        /// Values decoded by the calling thread so far, EXPLAIN ANALYZE charges them to filters
+        static size_t thread_decodes();
+    private:
+        struct key_t {
+            const u_int8_t* data;
+            size_t length;
+            encoding_t encoding;
+
+            bool operator==(const key_t& other) const {
+                return data == other.data && length == other.length && encoding == other.encoding;
+            }
+        };
+
+        struct key_hash_t {
+            size_t operator()(const key_t& key) const {
+                return std::hash<const u_int8_t*>()(key.data) ^ (key.length << 2) ^ static_cast<size_t>(key.encoding);
+            }
+        };
+
+        // Most recently used first
+        using entries_t = std::list<std::pair<key_t, std::string>>;
+
+        struct alignas(64) shard_t {
+            mutable std::mutex lock;
+            entries_t entries;
+            std::unordered_map<key_t, entries_t::iterator, key_hash_t> values;
+            size_t bytes = 0;
+        };
+
+        static const size_t SHARDS_BITS = 6;
+        static const size_t SHARDS_COUNT = 1 << SHARDS_BITS;
+
+        static std::string decode(const primitives_array_info_t& array, encoding_t encoding);
+        static size_t cost_of(const std::string& value);
+        shard_t& shard_of(const u_int8_t* data);
+    private:
+        size_t _shard_budget;
+        shard_t _shards[SHARDS_COUNT];
+    };
+
     class string_info_impl_t;
 
     class string_info_impl_t_deleter {
@@ -32,9 +93,9 @@ namespace hprof {
 
     using string_info_impl_ptr_t = std::unique_ptr<string_info_impl_t, string_info_impl_t_deleter>;
 
-    class string_info_impl_t : public virtual string_info_t, public instance_info_impl_t {
-    public:
-        using text_converter = std::wstring_convert<std::codecvt_utf8_utf16<char16_t, 0x10ffff, std::little_endian>, char16_t>;
+    /// String keeps the original instance and the char[] it refers to,
+    /// value is decoded on first access only
+    class string_info_impl_t : public virtual string_info_t {
     public:
         string_info_impl_t(const string_info_impl_t&) = delete;
         string_info_impl_t(string_info_impl_t&&) = default;
@@ -44,18 +105,33 @@ namespace hprof {
         string_info_impl_t& operator=(const string_info_impl_t&) = delete;
         string_info_impl_t& operator=(string_info_impl_t&&) = default;
 
-        virtual const std::string& value() const override { return _value; }
+        virtual jvm_id_t id() const override { return _instance->id(); }
+        virtual u_int8_t id_size() const override { return _instance->id_size(); }
+        virtual int32_t heap_type() const override { return _instance->heap_type(); }
+        virtual int32_t has_link_to(jvm_id_t id) const override { return _instance->has_link_to(id); }
+        virtual const std::vector<std::unique_ptr<gc_root_t>>& gc_roots() const override { return _instance->gc_roots(); }
+
+        virtual jvm_id_t class_id() const override { return _instance->class_id(); }
+        virtual int32_t stack_trace_id() const override { return _instance->stack_trace_id(); }
+        virtual const class_info_t* get_class() const override { return _instance->get_class(); }
+        virtual const fields_values_t& fields() const override { return _instance->fields(); }
+        virtual const u_int8_t* data() const override { return _instance->data(); }
+
+        virtual std::string value() const override;
+        virtual bool payload(const u_int8_t*& data, size_t& size, encoding_t& encoding) const override;
+
+        const instance_info_impl_t& instance() const { return *_instance; }
     public:
-        static string_info_impl_ptr_t create(const instance_info_impl_t& instance, const objects_index_t& objects) {
-            auto mem = new (std::nothrow) u_int8_t[instance.data_size() + sizeof(string_info_impl_t)];
-            // copy old data
-            std::memcpy(mem + sizeof(string_info_impl_t), instance.data(), instance.data_size());
-            return string_info_impl_ptr_t { new (mem) string_info_impl_t(instance, objects) };
-        }
+        static string_info_impl_ptr_t create(instance_info_impl_ptr_t&& instance, const objects_index_t& objects, const std::shared_ptr<strings_cache_t>& cache);
     private:
-        string_info_impl_t(const instance_info_impl_t& obj, const objects_index_t& objects);
+        string_info_impl_t(instance_info_impl_ptr_t&& instance, const heap_item_ptr_t& value, strings_cache_t::encoding_t encoding, const std::shared_ptr<strings_cache_t>& cache) :
+            _instance(std::move(instance)), _value(value), _encoding(encoding), _cache(cache) {}
+
+        static bool find_value(const instance_info_impl_t& instance, const objects_index_t& objects, heap_item_ptr_t& value, strings_cache_t::encoding_t& encoding);
     private:
-        std::string _value;
-        static text_converter _converter;
+        instance_info_impl_ptr_t _instance;
+        heap_item_ptr_t _value;
+        strings_cache_t::encoding_t _encoding;
+        std::shared_ptr<strings_cache_t> _cache;
     };
 }
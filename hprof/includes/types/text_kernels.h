@@ -0,0 +1,50 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#pragma once
+
+#include "types.h"
+
+#include <string>
+
+namespace hprof {
+    /// A UTF-8 text in every payload encoding, for a search in strings that aren't decoded yet
+    struct text_needle_t {
+        std::string latin1;
+        std::string utf16be;
+        std::string utf16le;
+        /// Some character is out of Latin-1, no Latin-1 payload holds the text
+        bool wide;
+    };
+
+    /// Transcoding of java string payloads to UTF-8. Runs of ASCII are converted with
+    /// SSE4.1/AVX2 picked the same way as for array_kernels_t, unpaired surrogates become U+FFFD
+    class text_kernels_t {
+    public:
+        /// Appends length code units of big-endian UTF-16 (char[] payload as it is in the dump)
+        static void utf16be_to_utf8(const u_int8_t* data, size_t length, std::string& out);
+        /// Appends length code units of little-endian UTF-16 (compact string byte[] with UTF16 coder)
+        static void utf16le_to_utf8(const u_int8_t* data, size_t length, std::string& out);
+        /// Appends length Latin-1 characters (compact string byte[] with LATIN1 coder)
+        static void latin1_to_utf8(const u_int8_t* data, size_t length, std::string& out);
+
+        static std::string to_utf8(jvm_char_t chr);
+
+        /// False for invalid UTF-8 and for U+FFFD, decoding turns broken UTF-16 into it so a payload search can't find it
+        static bool encode_needle(const std::string& utf8, text_needle_t& needle);
+        /// Looks for the needle at offsets that are multiples of step, 1 for Latin-1 and 2 for UTF-16 payloads
+        static bool contains(const u_int8_t* data, size_t size, const std::string& needle, size_t step);
+    };
+}
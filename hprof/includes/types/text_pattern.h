@@ -0,0 +1,59 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#pragma once
+
+#include "types.h"
+#include "types/text_kernels.h"
+
+#include <regex>
+#include <string>
+
+namespace hprof {
+    /// CONTAINS, LIKE and MATCHES over strings. Every match holds the required text, so strings are
+    /// searched for it in their undecoded payload first and only candidates are decoded
+    class text_pattern_t {
+    public:
+        enum kind_t {
+            /// Plain substring
+            KIND_CONTAINS,
+            /// Whole text, % is any run of characters, _ is a single one and \ escapes the next character
+            KIND_LIKE,
+            /// ECMAScript regular expression found anywhere in the text
+            KIND_REGEX
+        };
+    public:
+        /// Regular expressions have to be valid
+        text_pattern_t(kind_t kind, const std::string& pattern);
+
+        kind_t kind() const { return _kind; }
+        const std::string& pattern() const { return _pattern; }
+        const std::string& required() const { return _required; }
+
+        bool match(const string_info_t& str) const;
+        bool match(const std::string& text) const;
+
+        /// The longest text every match contains, empty when nothing is known
+        static std::string required_text(kind_t kind, const std::string& pattern);
+        static bool like(const std::string& pattern, const std::string& text);
+    private:
+        kind_t _kind;
+        std::string _pattern;
+        std::string _required;
+        bool _searchable;
+        text_needle_t _needle;
+        std::regex _regex;
+    };
+}
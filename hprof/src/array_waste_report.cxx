@@ -0,0 +1,86 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#include "array_waste_report.h"
+#include "types/array_kernels.h"
+
+using namespace hprof;
+
+namespace {
+    class filter_primitives_arrays_t : public filter_t {
+    public:
+        virtual filter_result_t operator()(const heap_item_ptr_t& item, const objects_index_t&) const override {
+            return item->type() == heap_item_t::PrimitivesArray ? Match : NoMatch;
+        }
+    };
+}
+
+constexpr double array_waste_report_t::DEFAULT_DOMINANT_SHARE;
+
+array_waste_report_t::array_waste_report_t(double dominant_share) : _dominant_share(dominant_share) {
+    for (size_t index = 0; index < sizeof(_entries) / sizeof(_entries[0]); ++index) {
+        _entries[index] = entry_t { static_cast<jvm_type_t::type_spec>(index), 0, 0, 0, 0, 0, 0, 0, 0 };
+    }
+}
+
+void array_waste_report_t::add(const primitives_array_info_t& array) {
+    entry_t& entry = _entries[array.item_type()];
+    size_t item_size = jvm_type_t::size(array.item_type(), array.id_size());
+    size_t data_size = array.length() * item_size;
+
+    ++entry.arrays;
+    entry.bytes += data_size;
+
+    if (array.length() == 0) {
+        return;
+    }
+
+    if (array_kernels_t::is_zeroed(array.data(), data_size)) {
+        ++entry.zeroed_arrays;
+        entry.zeroed_bytes += data_size;
+    } else if (array.length() > 1 && array_kernels_t::is_constant(array.data(), data_size, item_size)) {
+        ++entry.constant_arrays;
+        entry.constant_bytes += data_size;
+    } else if (array_kernels_t::dominant_share(array.item_type(), array.data(), array.length()) >= _dominant_share) {
+        ++entry.mostly_constant_arrays;
+        entry.mostly_constant_bytes += data_size;
+    }
+}
+
+bool array_waste_report_t::collect(const heap_profile_t& profile) {
+    query_t query { query_t::ACTION_SHOW, query_t::SOURCE_OBJECTS, 0, std::make_unique<filter_primitives_arrays_t>() };
+    return profile.query(query, [this] (const heap_item_ptr_t& item) {
+        add(*static_cast<const primitives_array_info_t*>(*item));
+        return true;
+    });
+}
+
+std::vector<array_waste_report_t::entry_t> array_waste_report_t::entries() const {
+    std::vector<entry_t> result;
+    for (auto& entry : _entries) {
+        if (entry.arrays != 0) {
+            result.push_back(entry);
+        }
+    }
+    return result;
+}
+
+size_t array_waste_report_t::wasted_bytes() const {
+    size_t result = 0;
+    for (auto& entry : _entries) {
+        result += entry.zeroed_bytes + entry.constant_bytes;
+    }
+    return result;
+}
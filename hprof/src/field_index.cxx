@@ -0,0 +1,346 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#include "field_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace hprof;
+
+const size_t field_index_t::BITMAP_MAX_VALUES;
+const size_t field_index_t::BITMAP_LIMIT_VALUES;
+
+bool field_index_t::build(std::vector<const heap_item_ptr_t*>&& items, query_t::index_t kind) {
+    _items = std::move(items);
+    _integral.clear();
+    _hashed.clear();
+    _values.clear();
+    _bitmaps.clear();
+    _counts.clear();
+    _floating.clear();
+
+    field_fetcher_t fetcher { _field.c_str() };
+    for (u_int32_t ordinal = 0; ordinal < _items.size(); ++ordinal) {
+        const instance_info_t* instance = filter_by_field_t::as_instance(*_items[ordinal]);
+        if (instance == nullptr) {
+            continue;
+        }
+
+        auto field = fetcher.find_first(*instance);
+        if (field == std::end(instance->fields())) {
+            continue;
+        }
+
+        switch (field->type()) {
+            case jvm_type_t::JVM_TYPE_BOOL:
+                _integral.emplace_back(static_cast<jvm_bool_t>(*field), ordinal);
+                break;
+            case jvm_type_t::JVM_TYPE_BYTE:
+                _integral.emplace_back(static_cast<jvm_byte_t>(*field), ordinal);
+                break;
+            case jvm_type_t::JVM_TYPE_CHAR:
+                _integral.emplace_back(static_cast<jvm_char_t>(*field), ordinal);
+                break;
+            case jvm_type_t::JVM_TYPE_SHORT:
+                _integral.emplace_back(static_cast<jvm_short_t>(*field), ordinal);
+                break;
+            case jvm_type_t::JVM_TYPE_INT:
+                _integral.emplace_back(static_cast<jvm_int_t>(*field), ordinal);
+                break;
+            case jvm_type_t::JVM_TYPE_LONG:
+                _integral.emplace_back(static_cast<jvm_long_t>(*field), ordinal);
+                break;
+            case jvm_type_t::JVM_TYPE_FLOAT:
+            case jvm_type_t::JVM_TYPE_DOUBLE: {
+                // NaN fails every comparison the index answers
+                double value = field->type() == jvm_type_t::JVM_TYPE_FLOAT ? static_cast<jvm_float_t>(*field) : static_cast<jvm_double_t>(*field);
+                if (!std::isnan(value)) {
+                    _floating.emplace_back(value, ordinal);
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+    std::sort(std::begin(_floating), std::end(_floating));
+
+    if (kind == query_t::INDEX_HASH) {
+        _kind = KIND_HASH;
+        for (auto& entry : _integral) {
+            _hashed[entry.first].push_back(entry.second);
+        }
+        decltype(_integral) {}.swap(_integral);
+        return true;
+    }
+
+    std::sort(std::begin(_integral), std::end(_integral));
+    _kind = KIND_SORTED;
+    if (kind == query_t::INDEX_SORTED) {
+        return true;
+    }
+
+    for (auto& entry : _integral) {
+        if (_values.empty() || _values.back() != entry.first) {
+            _values.push_back(entry.first);
+        }
+    }
+
+    size_t limit = kind == query_t::INDEX_BITMAP ? BITMAP_LIMIT_VALUES : BITMAP_MAX_VALUES;
+    if (_values.size() > limit) {
+        _values.clear();
+        return kind != query_t::INDEX_BITMAP;
+    }
+
+    _kind = KIND_BITMAP;
+    _bitmaps.assign(_values.size(), std::vector<u_int64_t>((_items.size() + 63) / 64, 0));
+    _counts.assign(_values.size(), 0);
+    size_t value = 0;
+    for (auto& entry : _integral) {
+        while (_values[value] != entry.first) {
+            ++value;
+        }
+        _bitmaps[value][entry.second / 64] |= 1ull << (entry.second % 64);
+        ++_counts[value];
+    }
+    decltype(_integral) {}.swap(_integral);
+    return true;
+}
+
+bool field_index_t::covers(const std::vector<class_hierarchy_t>& hierarchies) const {
+    for (auto& hierarchy : hierarchies) {
+        if (_hierarchy.enter == 0 || hierarchy.enter < _hierarchy.enter || hierarchy.exit > _hierarchy.exit) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool field_index_t::answers(column_kernels_t::compare_t compare) const {
+    switch (compare) {
+        case column_kernels_t::COMPARE_EQUALS:
+            return true;
+        case column_kernels_t::COMPARE_NOT_EQUALS:
+            return false;
+        default:
+            return _kind != KIND_HASH;
+    }
+}
+
+bool field_index_t::range(column_kernels_t::compare_t compare, const filter_comp_value_t& literal, range_t& result) {
+    const int64_t min = std::numeric_limits<int64_t>::min();
+    const int64_t max = std::numeric_limits<int64_t>::max();
+    const double infinity = std::numeric_limits<double>::infinity();
+
+    result = range_t { false, 0, 0, false, 0, 0 };
+    switch (literal.type) {
+        case filter_comp_value_t::TYPE_BOOL:
+            // Only boolean fields are compared with boolean literals
+            if (compare != column_kernels_t::COMPARE_EQUALS) {
+                return false;
+            }
+            result.integral = true;
+            result.first = result.last = literal.bool_value ? 1 : 0;
+            return true;
+        case filter_comp_value_t::TYPE_TEXT:
+            return false;
+        case filter_comp_value_t::TYPE_INT: {
+            int64_t value = literal.int_value;
+            result.integral = true;
+            switch (compare) {
+                case column_kernels_t::COMPARE_EQUALS:
+                    result.first = result.last = value;
+                    break;
+                case column_kernels_t::COMPARE_LESS:
+                    result.integral = value != min;
+                    result.first = min;
+                    result.last = value - (value != min ? 1 : 0);
+                    break;
+                case column_kernels_t::COMPARE_LESS_OR_EQUALS:
+                    result.first = min;
+                    result.last = value;
+                    break;
+                case column_kernels_t::COMPARE_GREATER:
+                    result.integral = value != max;
+                    result.first = value + (value != max ? 1 : 0);
+                    result.last = max;
+                    break;
+                case column_kernels_t::COMPARE_GREATER_OR_EQUALS:
+                    result.first = value;
+                    result.last = max;
+                    break;
+                default:
+                    return false;
+            }
+            break;
+        }
+        case filter_comp_value_t::TYPE_DOUBLE: {
+            double value = literal.double_value;
+            // Integral fields take the truncated literal, out of range literals are left to the scan
+            if (std::isnan(value) || std::abs(value) >= std::ldexp(1.0, 62)) {
+                return false;
+            }
+            // Widened integral fields are rounded to double, the margin covers the rounding
+            int64_t margin = static_cast<int64_t>(std::ldexp(std::abs(value), -50)) + 2;
+            result.integral = true;
+            switch (compare) {
+                case column_kernels_t::COMPARE_EQUALS:
+                    result.first = result.last = static_cast<int64_t>(value);
+                    break;
+                case column_kernels_t::COMPARE_LESS:
+                case column_kernels_t::COMPARE_LESS_OR_EQUALS:
+                    result.first = min;
+                    result.last = static_cast<int64_t>(std::floor(value)) + margin;
+                    break;
+                case column_kernels_t::COMPARE_GREATER:
+                case column_kernels_t::COMPARE_GREATER_OR_EQUALS:
+                    result.first = static_cast<int64_t>(std::ceil(value)) - margin;
+                    result.last = max;
+                    break;
+                default:
+                    return false;
+            }
+            break;
+        }
+    }
+
+    // Float fields compare with the literal rounded to float, the margin covers the rounding
+    double value = literal.type == filter_comp_value_t::TYPE_INT ? static_cast<double>(literal.int_value) : literal.double_value;
+    double margin = std::isinf(value) ? infinity : std::ldexp(std::abs(value), -20);
+    result.floating = true;
+    switch (compare) {
+        case column_kernels_t::COMPARE_EQUALS:
+            result.low = value - margin;
+            result.high = value + margin;
+            break;
+        case column_kernels_t::COMPARE_LESS:
+        case column_kernels_t::COMPARE_LESS_OR_EQUALS:
+            result.low = -infinity;
+            result.high = value + margin;
+            break;
+        default:
+            result.low = value - margin;
+            result.high = infinity;
+            break;
+    }
+    if (std::isnan(result.low) || std::isnan(result.high)) {
+        result.low = -infinity;
+        result.high = infinity;
+    }
+    return true;
+}
+
+bool field_index_t::estimate(column_kernels_t::compare_t compare, const filter_comp_value_t& literal, size_t& count) const {
+    range_t bounds;
+    if (!answers(compare) || !range(compare, literal, bounds)) {
+        return false;
+    }
+
+    count = 0;
+    if (bounds.integral) {
+        switch (_kind) {
+            case KIND_HASH: {
+                auto it = _hashed.find(bounds.first);
+                count += it != std::end(_hashed) ? it->second.size() : 0;
+                break;
+            }
+            case KIND_SORTED: {
+                auto first = std::lower_bound(std::begin(_integral), std::end(_integral), std::make_pair(bounds.first, u_int32_t { 0 }));
+                auto last = std::upper_bound(first, std::end(_integral), std::make_pair(bounds.last, std::numeric_limits<u_int32_t>::max()));
+                count += std::distance(first, last);
+                break;
+            }
+            case KIND_BITMAP:
+                for (size_t index = 0; index < _values.size(); ++index) {
+                    if (bounds.first <= _values[index] && _values[index] <= bounds.last) {
+                        count += _counts[index];
+                    }
+                }
+                break;
+        }
+    }
+
+    if (bounds.floating) {
+        auto first = std::lower_bound(std::begin(_floating), std::end(_floating), std::make_pair(bounds.low, u_int32_t { 0 }));
+        auto last = std::upper_bound(first, std::end(_floating), std::make_pair(bounds.high, std::numeric_limits<u_int32_t>::max()));
+        count += std::distance(first, last);
+    }
+    return true;
+}
+
+void field_index_t::lookup(column_kernels_t::compare_t compare, const filter_comp_value_t& literal, std::vector<const heap_item_ptr_t*>& out) const {
+    range_t bounds;
+    if (!answers(compare) || !range(compare, literal, bounds)) {
+        // The index can't narrow the comparison down, every item is a candidate
+        out.insert(std::end(out), std::begin(_items), std::end(_items));
+        return;
+    }
+
+    std::vector<u_int32_t> ordinals;
+    collect(bounds, ordinals);
+    std::sort(std::begin(ordinals), std::end(ordinals));
+    out.reserve(out.size() + ordinals.size());
+    for (auto ordinal : ordinals) {
+        out.push_back(_items[ordinal]);
+    }
+}
+
+void field_index_t::collect(const range_t& bounds, std::vector<u_int32_t>& ordinals) const {
+    if (bounds.integral) {
+        switch (_kind) {
+            case KIND_HASH: {
+                auto it = _hashed.find(bounds.first);
+                if (it != std::end(_hashed)) {
+                    ordinals.insert(std::end(ordinals), std::begin(it->second), std::end(it->second));
+                }
+                break;
+            }
+            case KIND_SORTED: {
+                auto first = std::lower_bound(std::begin(_integral), std::end(_integral), std::make_pair(bounds.first, u_int32_t { 0 }));
+                auto last = std::upper_bound(first, std::end(_integral), std::make_pair(bounds.last, std::numeric_limits<u_int32_t>::max()));
+                for (auto it = first; it != last; ++it) {
+                    ordinals.push_back(it->second);
+                }
+                break;
+            }
+            case KIND_BITMAP: {
+                std::vector<u_int64_t> selection((_items.size() + 63) / 64, 0);
+                for (size_t index = 0; index < _values.size(); ++index) {
+                    if (bounds.first <= _values[index] && _values[index] <= bounds.last) {
+                        for (size_t word = 0; word < selection.size(); ++word) {
+                            selection[word] |= _bitmaps[index][word];
+                        }
+                    }
+                }
+                for (size_t word = 0; word < selection.size(); ++word) {
+                    for (u_int64_t bits = selection[word]; bits != 0; bits &= bits - 1) {
+                        ordinals.push_back(static_cast<u_int32_t>(word * 64 + __builtin_ctzll(bits)));
+                    }
+                }
+                break;
+            }
+        }
+    }
+
+    if (bounds.floating) {
+        auto first = std::lower_bound(std::begin(_floating), std::end(_floating), std::make_pair(bounds.low, u_int32_t { 0 }));
+        auto last = std::upper_bound(first, std::end(_floating), std::make_pair(bounds.high, std::numeric_limits<u_int32_t>::max()));
+        for (auto it = first; it != last; ++it) {
+            ordinals.push_back(it->second);
+        }
+    }
+}
@@ -0,0 +1,118 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#include "filter_program.h"
+
+using namespace hprof;
+
+void filter_t::compile(filter_program_t& program) const {
+    program.call(*this);
+}
+
+void filter_program_t::compile(const filter_t* filter) {
+    _code.clear();
+    _hierarchies.clear();
+    if (filter != nullptr) {
+        filter->compile(*this);
+    }
+}
+
+filter_t::filter_result_t filter_program_t::operator()(const heap_item_ptr_t& item, const objects_index_t& objects) const {
+    filter_t::filter_result_t result = filter_t::Match;
+    size_t size = _code.size();
+    size_t pc = 0;
+    while (pc < size) {
+        const instruction_t& instruction = _code[pc];
+        switch (instruction.opcode) {
+            case OP_CALL:
+                result = (*instruction.filter)(item, objects);
+                ++pc;
+                break;
+            case OP_INSTANCE_OF:
+                result = is_instance_of(item, instruction) ? filter_t::Match : filter_t::NoMatch;
+                ++pc;
+                break;
+            case OP_NOT:
+                if (result != filter_t::Fail) {
+                    result = result == filter_t::Match ? filter_t::NoMatch : filter_t::Match;
+                }
+                ++pc;
+                break;
+            case OP_JUMP_UNLESS_MATCH:
+                pc = result != filter_t::Match ? instruction.first : pc + 1;
+                break;
+            case OP_JUMP_UNLESS_NO_MATCH:
+                pc = result != filter_t::NoMatch ? instruction.first : pc + 1;
+                break;
+        }
+    }
+    return result;
+}
+
+void filter_program_t::call(const filter_t& filter) {
+    _code.push_back({ OP_CALL, 0, 0, &filter });
+}
+
+void filter_program_t::instance_of(const std::vector<class_hierarchy_t>& hierarchies) {
+    _code.push_back({ OP_INSTANCE_OF, static_cast<u_int32_t>(_hierarchies.size()), static_cast<u_int32_t>(hierarchies.size()), nullptr });
+    _hierarchies.insert(_hierarchies.end(), hierarchies.begin(), hierarchies.end());
+}
+
+void filter_program_t::negate() {
+    _code.push_back({ OP_NOT, 0, 0, nullptr });
+}
+
+size_t filter_program_t::jump_unless(filter_t::filter_result_t result) {
+    _code.push_back({ result == filter_t::Match ? OP_JUMP_UNLESS_MATCH : OP_JUMP_UNLESS_NO_MATCH, 0, 0, nullptr });
+    return _code.size() - 1;
+}
+
+void filter_program_t::land(size_t jump) {
+    _code[jump].first = static_cast<u_int32_t>(_code.size());
+}
+
+bool filter_program_t::is_instance_of(const heap_item_ptr_t& item, const instruction_t& instruction) const {
+    if (item == nullptr) {
+        return false;
+    }
+
+    const class_info_t* cls = nullptr;
+    switch (item->type()) {
+        case heap_item_t::Object:
+            cls = static_cast<const instance_info_t*>(*item)->get_class();
+            break;
+        case heap_item_t::String:
+            cls = static_cast<const string_info_t*>(*item)->get_class();
+            break;
+        case heap_item_t::Class:
+        case heap_item_t::PrimitivesArray:
+        case heap_item_t::ObjectsArray:
+            break;
+    }
+
+    if (cls == nullptr) {
+        return false;
+    }
+
+    const class_hierarchy_t& hierarchy = cls->hierarchy();
+    const class_hierarchy_t* parent = _hierarchies.data() + instruction.first;
+    const class_hierarchy_t* last = parent + instruction.count;
+    for (; parent != last; ++parent) {
+        if (parent->contains(hierarchy)) {
+            return true;
+        }
+    }
+    return false;
+}
@@ -14,10 +14,143 @@
 ///  limitations under the License.
 ///
 #include "heap_profile.h"
+#include "query_aggregator.h"
+#include "query_top.h"
+#include "types/text_kernels.h"
 #include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
 
 using namespace hprof;
 
+const size_t heap_profile_impl_t::CHUNK_SIZE;
+const size_t heap_profile_impl_t::PAGE_SIZE;
+
+// Items scanned between looks at the query token, a power of two
+static const size_t TOKEN_CHECK_INTERVAL = 4096;
+
+/// A stopped chunk fails when cancelled and keeps the matches found so far when out of its budget
+static bool stop_requested(const query_token_t* token, size_t index) {
+    return token != nullptr && (index & (TOKEN_CHECK_INTERVAL - 1)) == 0 && token->stopped();
+}
+
+static query_cursor_impl_t::chunk_result_t stopped_chunk(const query_token_t* token) {
+    return token->cancelled() ? query_cursor_impl_t::Failed : query_cursor_impl_t::Cut;
+}
+
+static int32_t heap_type_of(const heap_item_ptr_t& item) {
+    switch (item->type()) {
+        case heap_item_t::Class:
+            return static_cast<const class_info_t *>(*item)->heap_type();
+        case heap_item_t::Object:
+            return static_cast<const instance_info_t *>(*item)->heap_type();
+        case heap_item_t::String:
+            return static_cast<const string_info_t *>(*item)->heap_type();
+        case heap_item_t::PrimitivesArray:
+            return static_cast<const primitives_array_info_t *>(*item)->heap_type();
+        case heap_item_t::ObjectsArray:
+            return static_cast<const objects_array_info_t *>(*item)->heap_type();
+    }
+    return heap_info_t::HEAP_UNKNOWN;
+}
+
+/// Strings without a value read as an empty Latin-1 payload, like their empty value
+static void payload_of(const string_info_t* str, const u_int8_t*& data, size_t& size, string_info_t::encoding_t& encoding) {
+    if (!str->payload(data, size, encoding)) {
+        data = nullptr;
+        size = 0;
+        encoding = string_info_t::ENCODING_LATIN1;
+    }
+}
+
+/// FNV-1a of the payload bytes, equal texts of different encodings hash apart
+static size_t payload_hash(const u_int8_t* data, size_t size, string_info_t::encoding_t encoding) {
+    u_int64_t hash = 0xcbf29ce484222325ULL ^ static_cast<u_int64_t>(encoding);
+    for (size_t index = 0; index < size; ++index) {
+        hash = (hash ^ data[index]) * 0x100000001b3ULL;
+    }
+    return static_cast<size_t>(hash);
+}
+
+static void decode_payload(const u_int8_t* data, size_t size, string_info_t::encoding_t encoding, std::string& out) {
+    switch (encoding) {
+        case string_info_t::ENCODING_UTF16_BE:
+            text_kernels_t::utf16be_to_utf8(data, size / 2, out);
+            break;
+        case string_info_t::ENCODING_UTF16_LE:
+            text_kernels_t::utf16le_to_utf8(data, size / 2, out);
+            break;
+        case string_info_t::ENCODING_LATIN1:
+            text_kernels_t::latin1_to_utf8(data, size, out);
+            break;
+    }
+}
+
+static const class_info_t* class_of(const heap_item_ptr_t& item) {
+    switch (item->type()) {
+        case heap_item_t::Object:
+            return static_cast<const instance_info_t *>(*item)->get_class();
+        case heap_item_t::String:
+            return static_cast<const string_info_t *>(*item)->get_class();
+        default:
+            return nullptr;
+    }
+}
+
+static const object_info_t* object_of(const heap_item_ptr_t& item) {
+    switch (item->type()) {
+        case heap_item_t::Class:
+            return static_cast<const class_info_t *>(*item);
+        case heap_item_t::Object:
+            return static_cast<const instance_info_t *>(*item);
+        case heap_item_t::String:
+            return static_cast<const string_info_t *>(*item);
+        case heap_item_t::PrimitivesArray:
+            return static_cast<const primitives_array_info_t *>(*item);
+        case heap_item_t::ObjectsArray:
+            return static_cast<const objects_array_info_t *>(*item);
+    }
+    return nullptr;
+}
+
+/// Ids held in instance and static fields or in array items, the class of an object isn't a reference
+static void references_of(const heap_item_ptr_t& item, std::vector<jvm_id_t>& result) {
+    auto add_fields = [&result] (const fields_values_t& fields) {
+        for (auto& field : fields) {
+            if (field.type() == jvm_type_t::JVM_TYPE_OBJECT && static_cast<jvm_id_t>(field) != 0) {
+                result.push_back(static_cast<jvm_id_t>(field));
+            }
+        }
+    };
+
+    switch (item->type()) {
+        case heap_item_t::Class:
+            add_fields(static_cast<const class_info_t *>(*item)->static_fields());
+            break;
+        case heap_item_t::Object:
+            add_fields(static_cast<const instance_info_t *>(*item)->fields());
+            break;
+        case heap_item_t::String:
+            add_fields(static_cast<const string_info_t *>(*item)->fields());
+            break;
+        case heap_item_t::ObjectsArray: {
+            auto array = static_cast<const objects_array_info_t *>(*item);
+            for (auto it = array->begin(); it != array->end(); ++it) {
+                if (*it != 0) {
+                    result.push_back(*it);
+                }
+            }
+            break;
+        }
+        case heap_item_t::PrimitivesArray:
+            break;
+    }
+}
+
 heap_profile_impl_t::heap_profile_impl_t(gc_roots_t&& roots) : _has_error(false) {
     _roots = std::move(roots);
 }
@@ -33,6 +166,62 @@ heap_item_ptr_t heap_profile_impl_t::find_object(jvm_id_t id) const {
     return it->second;
 }
 
+bool heap_profile_impl_t::find_strings(const std::string& value, std::vector<jvm_id_t>& result) const {
+    std::call_once(_strings_once, [this] () { build_strings_index(); });
+
+    const u_int8_t* data = nullptr;
+    size_t size = 0;
+    string_info_t::encoding_t encoding = string_info_t::ENCODING_LATIN1;
+    text_needle_t needle;
+    if (!text_kernels_t::encode_needle(value, needle)) {
+        // Only a decoded value can hold U+FFFD, values are decoded apart from the strings cache
+        std::string decoded;
+        for (auto& entry : _strings) {
+            const string_info_t* str = static_cast<const string_info_t*>(**entry.second);
+            payload_of(str, data, size, encoding);
+            decoded.clear();
+            decode_payload(data, size, encoding, decoded);
+            if (decoded == value) {
+                result.push_back(str->id());
+            }
+        }
+        std::sort(std::begin(result), std::end(result));
+        return true;
+    }
+
+    // The literal is encoded once per encoding, bucket matches are confirmed by their bytes
+    const std::string* encoded[] = { &needle.utf16be, &needle.utf16le, needle.wide ? nullptr : &needle.latin1 };
+    for (auto target : { string_info_t::ENCODING_UTF16_BE, string_info_t::ENCODING_UTF16_LE, string_info_t::ENCODING_LATIN1 }) {
+        const std::string* bytes = encoded[target];
+        if (bytes == nullptr) {
+            continue;
+        }
+
+        size_t hash = payload_hash(reinterpret_cast<const u_int8_t*>(bytes->data()), bytes->size(), target);
+        auto first = std::lower_bound(std::begin(_strings), std::end(_strings), hash,
+            [] (auto& entry, size_t key) { return entry.first < key; });
+        for (auto it = first; it != std::end(_strings) && it->first == hash; ++it) {
+            const string_info_t* str = static_cast<const string_info_t*>(**it->second);
+            payload_of(str, data, size, encoding);
+            if (encoding == target && size == bytes->size() && (size == 0 || std::memcmp(data, bytes->data(), size) == 0)) {
+                result.push_back(str->id());
+            }
+        }
+    }
+    std::sort(std::begin(result), std::end(result));
+    return true;
+}
+
+bool heap_profile_impl_t::find_referrers(jvm_id_t id, incoming_links_t& links) const {
+    std::vector<const heap_item_ptr_t*> referrers;
+    referrers_of(id, referrers);
+    for (auto referrer : referrers) {
+        auto object = object_of(*referrer);
+        links.insert(link_t { object->id(), static_cast<decltype(link_t::type)>(object->has_link_to(id)) });
+    }
+    return true;
+}
+
 heap_item_ptr_t heap_profile_impl_t::find_class(jvm_id_t id) const {
     auto it = _classes.find(id);
     if (it == std::end(_classes)) {
@@ -42,50 +231,727 @@ heap_item_ptr_t heap_profile_impl_t::find_class(jvm_id_t id) const {
     return it->second;
 }
 
+void heap_profile_impl_t::find_classes(const std::string& name, std::vector<heap_item_ptr_t>& result) const {
+    for (auto& item : _classes) {
+        if (static_cast<const class_info_t *>(*item.second)->name() == name) {
+            result.push_back(item.second);
+        }
+    }
+}
+
+void heap_profile_impl_t::find_declaring_classes(const std::string& field_name, std::vector<heap_item_ptr_t>& result) const {
+    for (auto& item : _classes) {
+        auto& fields = static_cast<const class_info_t *>(*item.second)->fields();
+        if (fields.find(field_name) != std::end(fields)) {
+            result.push_back(item.second);
+        }
+    }
+}
+
+size_t heap_profile_impl_t::count_instances(const class_hierarchy_t& hierarchy) const {
+    if (hierarchy.enter == 0 || _class_instances_before.empty()) {
+        return 0;
+    }
+
+    size_t first = std::min<size_t>(hierarchy.enter, _class_instances_before.size() - 1);
+    size_t last = std::min<size_t>(static_cast<size_t>(hierarchy.exit) + 1, _class_instances_before.size() - 1);
+    return first < last ? _class_instances_before[last] - _class_instances_before[first] : 0;
+}
+
 bool heap_profile_impl_t::query(const query_t& query, std::vector<heap_item_ptr_t>& result) const {
+    return open(query)->fetch(std::numeric_limits<size_t>::max(), result);
+}
+
+bool heap_profile_impl_t::query(const query_t& query, const query_callback_t& callback) const {
+    auto cursor = open(query);
+    std::vector<heap_item_ptr_t> page;
+    while (!cursor->done()) {
+        page.clear();
+        if (!cursor->fetch(PAGE_SIZE, page)) {
+            return false;
+        }
+        for (auto& item : page) {
+            if (!callback(item)) {
+                return true;
+            }
+        }
+    }
+    return true;
+}
+
+std::unique_ptr<query_cursor_t> heap_profile_impl_t::open(const query_t& query) const {
+    return open(query, query.token.get());
+}
+
+std::unique_ptr<query_cursor_t> heap_profile_impl_t::open(const query_t& query, const query_token_t* token, query_profiler_t* profiler) const {
+    if (query.action == query_t::ACTION_CREATE_INDEX) {
+        return std::make_unique<query_status_cursor_impl_t>(create_index(query.index_class, query.index_field, query.index));
+    }
+    if (query.action == query_t::ACTION_AGGREGATE || query.explain != query_t::EXPLAIN_NONE) {
+        // Aggregates and explained queries are rows, not items
+        return std::make_unique<query_status_cursor_impl_t>(false);
+    }
+
+    if (query.order != query_t::ORDER_NONE) {
+        return open_ordered(query, token, profiler);
+    }
+
+    // A complete result or a long enough prefix of it serves the query without a scan
+    std::string key;
+    bool cacheable = profiler == nullptr && _cache != nullptr && _cache->capacity() != 0 && query_cache_t::key(query, key);
+    if (cacheable) {
+        auto entry = _cache->find(key);
+        if (entry != nullptr && (entry->complete || (query.offset <= entry->items.size() && query.limit <= entry->items.size() - query.offset))) {
+            return std::make_unique<query_cache_cursor_impl_t>(std::move(entry), query.offset, query.limit);
+        }
+    }
+
+    auto cursor = scan(query, query.offset, query.limit, token, profiler);
+    if (cacheable) {
+        cursor->record(_cache.get(), std::move(key));
+    }
+    return cursor;
+}
+
+/// Every match is scanned, only offset + limit best of them are kept
+std::unique_ptr<query_cursor_t> heap_profile_impl_t::open_ordered(const query_t& query, const query_token_t* token, query_profiler_t* profiler) const {
+    size_t count = query.offset + std::min(query.limit, std::numeric_limits<size_t>::max() - query.offset);
+    auto cursor = scan(query, 0, std::numeric_limits<size_t>::max(), token, profiler);
+    query_top_t top { query, *this, *this, count };
+    bool succeed = cursor->drain([&top] (size_t chunk, const query_cache_t::items_t& matches) {
+        top.add(chunk, matches);
+    });
+    if (!succeed) {
+        return std::make_unique<query_status_cursor_impl_t>(false);
+    }
+
+    auto entry = std::make_shared<query_cache_t::entry_t>();
+    entry->complete = true;
+    top.finish(entry->items);
+    return std::make_unique<query_cache_cursor_impl_t>(std::move(entry), query.offset, query.limit, cursor->truncated());
+}
+
+bool heap_profile_impl_t::aggregate(const query_t& query, std::vector<aggregate_row_t>& rows) const {
+    if (query.action != query_t::ACTION_AGGREGATE || query.explain != query_t::EXPLAIN_NONE) {
+        return false;
+    }
+    return aggregate_rows(query, rows, nullptr);
+}
+
+bool heap_profile_impl_t::aggregate_rows(const query_t& query, std::vector<aggregate_row_t>& rows, query_profiler_t* profiler) const {
+    // LIMIT and OFFSET apply to groups, every match is aggregated. Out of the
+    // time budget rows hold matches scanned so far
+    auto cursor = scan(query, 0, std::numeric_limits<size_t>::max(), query.token.get(), profiler);
+    query_aggregator_t aggregator { query, *this, *this };
+    std::vector<query_aggregator_t::partial_t> partials { cursor->chunks() };
+    bool succeed = cursor->drain([&aggregator, &partials] (size_t chunk, const query_cache_t::items_t& matches) {
+        for (auto match : matches) {
+            aggregator.add(*match, partials[chunk]);
+        }
+    });
+    if (!succeed) {
+        return false;
+    }
+
+    for (auto& partial : partials) {
+        aggregator.merge(std::move(partial));
+    }
+    aggregator.finish(query.offset, query.limit, rows);
+    return true;
+}
+
+bool heap_profile_impl_t::explain(const query_t& query, std::vector<explain_node_t>& nodes) const {
+    if (query.action == query_t::ACTION_CREATE_INDEX) {
+        return false;
+    }
+
+    // Aggregation and ordering take matches of the scan below them
+    size_t unknown = std::numeric_limits<size_t>::max();
+    size_t first = nodes.size();
+    size_t depth = 0;
+    if (query.action == query_t::ACTION_AGGREGATE) {
+        static const char* groups[] = { "aggregate", "aggregate group by class", "aggregate group by field " };
+        std::string name = groups[query.group];
+        if (query.group == query_t::GROUP_FIELD) {
+            query.group_field->key(name);
+        }
+        nodes.push_back({ depth++, std::move(name), unknown, 0, 0, 0, 0, {} });
+    } else if (query.order != query_t::ORDER_NONE) {
+        static const char* orders[] = { "", "field ", "shallow size", "array length" };
+        size_t count = query.offset + std::min(query.limit, std::numeric_limits<size_t>::max() - query.offset);
+        std::string name = count == unknown ? "sort by " : "top " + std::to_string(count) + " by ";
+        name += orders[query.order];
+        if (query.order == query_t::ORDER_FIELD) {
+            query.order_field->key(name);
+        }
+        name += query.order_descending ? " desc" : " asc";
+        nodes.push_back({ depth++, std::move(name), unknown, 0, 0, 0, 0, {} });
+    }
+
+    if (query.explain != query_t::EXPLAIN_ANALYZE) {
+        explain_scan(query, depth, nullptr, nodes);
+        return true;
+    }
+
+    // Results are dropped, only counters are kept
+    query_profiler_t profiler;
+    auto start = std::chrono::steady_clock::now();
+    size_t produced = 0;
+    bool succeed = false;
+    if (query.action == query_t::ACTION_AGGREGATE) {
+        std::vector<aggregate_row_t> rows;
+        succeed = aggregate_rows(query, rows, &profiler);
+        produced = rows.size();
+    } else {
+        std::unique_ptr<query_cursor_t> cursor;
+        if (query.order != query_t::ORDER_NONE) {
+            cursor = open_ordered(query, query.token.get(), &profiler);
+        } else {
+            cursor = scan(query, query.offset, query.limit, query.token.get(), &profiler);
+        }
+        std::vector<heap_item_ptr_t> results;
+        succeed = cursor->fetch(std::numeric_limits<size_t>::max(), results);
+        produced = results.size();
+    }
+    if (!succeed) {
+        nodes.resize(first);
+        return false;
+    }
+    auto spent = std::chrono::steady_clock::now() - start;
+
+    if (depth != 0) {
+        nodes[first].items_in = profiler.matched();
+        nodes[first].items_out = produced;
+    }
+    explain_scan(query, depth, &profiler, nodes);
+    nodes[first].time = std::chrono::duration_cast<std::chrono::nanoseconds>(spent);
+    return true;
+}
+
+void heap_profile_impl_t::explain_scan(const query_t& query, size_t depth, const query_profiler_t* profiler, std::vector<explain_node_t>& nodes) const {
+    auto plan = this->plan(query);
+
+    explain_node_t scan { depth, {}, plan.estimated_items, 0, 0, 0, 0, {} };
+    if (query.relation != query_t::RELATION_NONE) {
+        scan.name = query.relation == query_t::RELATION_REFERRING_TO ? "scan holders of subquery results" : "scan referents of subquery results";
+        scan.estimated = std::numeric_limits<size_t>::max();
+    } else if (query.source == query_t::SOURCE_CLASSES) {
+        scan.name = "scan classes";
+    } else if (plan.use_class_index && plan.index != nullptr) {
+        scan.name = "index lookup on field " + plan.index->field();
+    } else if (plan.use_class_index) {
+        scan.name = "scan class index over " + std::to_string(plan.hierarchies.size()) + " class ranges";
+    } else {
+        scan.name = "scan heaps";
+    }
+    if (!plan.sample.all()) {
+        char sample[32];
+        std::snprintf(sample, sizeof(sample), " sampling %g%%", plan.sample.fraction() * 100);
+        scan.name += sample;
+    }
+
+    if (profiler != nullptr) {
+        scan.items_in = profiler->scanned();
+        scan.items_out = profiler->matched();
+        scan.time = profiler->time();
+    }
+    nodes.push_back(std::move(scan));
+
+    if (query.related != nullptr) {
+        size_t related = nodes.size();
+        explain_scan(*query.related, depth + 1, profiler != nullptr ? profiler->related() : nullptr, nodes);
+        nodes[related].name.insert(0, "subquery ");
+    }
+
+    if (profiler != nullptr) {
+        profiler->report(depth + 1, *this, nodes);
+    } else {
+        query_profiler_t described;
+        described.attach(query.filter.get());
+        described.report(depth + 1, *this, nodes);
+    }
+}
+
+query_plan_t heap_profile_impl_t::plan(const query_t& query) const {
+    std::vector<const field_index_t*> indexes;
+    {
+        std::lock_guard<std::mutex> lock { _indexes_lock };
+        for (auto& index : _indexes) {
+            indexes.push_back(index.get());
+        }
+    }
+
+    if (query.filter != nullptr) {
+        query.filter->bind_objects_once(*this);
+    }
+
+    query_planner_t planner { *this, _objects.size(), _classes.size(), indexes };
+    return planner.plan(query);
+}
+
+std::unique_ptr<query_cursor_impl_t> heap_profile_impl_t::scan(const query_t& query, size_t offset, size_t limit, const query_token_t* token, query_profiler_t* profiler) const {
+    auto plan = this->plan(query);
+    if (profiler != nullptr) {
+        profiler->attach(query.filter.get());
+        plan.program.compile(profiler);
+        plan.use_columns = false;
+    }
+    auto cursor = std::make_unique<query_cursor_impl_t>(_pool.get(), std::move(plan), offset, limit, token);
+
+    if (query.relation != query_t::RELATION_NONE) {
+        query_related(query, *cursor, profiler != nullptr ? profiler->related() : nullptr);
+        return cursor;
+    }
+
     switch (query.source) {
         case query_t::SOURCE_CLASSES:
-            return query_classes(*query.filter, result);
+            query_classes(query, *cursor);
+            break;
         case query_t::SOURCE_OBJECTS:
-            return query_instances(*query.filter, result);
+            if (cursor->plan().use_class_index && !_class_instances.empty()) {
+                if (cursor->plan().index != nullptr) {
+                    query_indexed(query, *cursor);
+                } else {
+                    query_class_instances(query, *cursor);
+                }
+            } else {
+                query_instances(query, *cursor);
+            }
+            break;
     }
 
-    return false;
+    return cursor;
 }
 
 void heap_profile_impl_t::add(jvm_id_t id, const heap_item_ptr_t& item) {
-    if (item->type() == heap_item_t::Class) _classes.emplace(id, item);
-    else _objects.emplace(id, item);
+    if (item->type() == heap_item_t::Class) {
+        _classes.emplace(id, item);
+        return;
+    }
+
+    if (!_objects.emplace(id, item).second) {
+        return;
+    }
+
+    int32_t heap_type = heap_type_of(item);
+    if (heap_type < heap_info_t::HEAP_UNKNOWN || heap_type > heap_info_t::HEAP_IMAGE) {
+        heap_type = heap_info_t::HEAP_UNKNOWN;
+    }
+    _heaps[heap_type].push_back(item);
 }
 
-bool heap_profile_impl_t::query_classes(const filter_t& filter, std::vector<heap_item_ptr_t>& result) const {
-    for (auto item : _classes) {
-        switch (filter(item.second, *this)) {
-            case filter_t::Match:
-                result.push_back(item.second);
+void heap_profile_impl_t::build_indexes() {
+    _class_instances.clear();
+    _class_instances.resize(_classes.size() + 1);
+    for (auto& partition : _heaps) {
+        for (auto& item : partition) {
+            auto cls = class_of(item);
+            if (cls == nullptr) {
                 continue;
-            case filter_t::NoMatch:
+            }
+
+            u_int32_t enter = cls->hierarchy().enter;
+            if (enter == 0 || enter >= _class_instances.size()) {
                 continue;
-            case filter_t::Fail:
-                return false;
+            }
+            _class_instances[enter].push_back(&item);
         }
-        assert(false);
+    }
+
+    _class_instances_before.resize(_class_instances.size() + 1);
+    _class_instances_before[0] = 0;
+    for (size_t index = 0; index < _class_instances.size(); ++index) {
+        _class_instances_before[index + 1] = _class_instances_before[index] + _class_instances[index].size();
+    }
+}
+
+void heap_profile_impl_t::set_query_threads(size_t threads) {
+    _pool = std::make_unique<query_pool_t>(threads);
+}
+
+void heap_profile_impl_t::set_query_cache_size(size_t bytes) {
+    _cache = std::make_unique<query_cache_t>(bytes);
+}
+
+bool heap_profile_impl_t::create_index(const std::string& class_name, const std::string& field, query_t::index_t kind) const {
+    std::vector<heap_item_ptr_t> found;
+    find_classes(class_name, found);
+    if (found.empty() || _class_instances.empty()) {
+        return false;
+    }
+
+    std::vector<std::unique_ptr<field_index_t>> created;
+    for (auto& item : found) {
+        auto cls = static_cast<const class_info_t*>(*item);
+        auto& hierarchy = cls->hierarchy();
+        if (hierarchy.enter == 0) {
+            return false;
+        }
+
+        bool primitive = false;
+        for (const class_info_t* current = cls; current != nullptr && !primitive; current = current->super()) {
+            for (auto& spec : current->fields()) {
+                if (spec.name() == field) {
+                    primitive = spec.type() != jvm_type_t::JVM_TYPE_OBJECT;
+                    break;
+                }
+            }
+        }
+        if (!primitive) {
+            return false;
+        }
+
+        std::vector<const heap_item_ptr_t*> items;
+        u_int32_t last = std::min<u_int32_t>(hierarchy.exit, _class_instances.size() - 1);
+        for (u_int32_t index = hierarchy.enter; index <= last; ++index) {
+            items.insert(std::end(items), std::begin(_class_instances[index]), std::end(_class_instances[index]));
+        }
+
+        auto index = std::make_unique<field_index_t>(cls->name(), hierarchy, field);
+        if (!index->build(std::move(items), kind)) {
+            return false;
+        }
+        created.push_back(std::move(index));
+    }
+
+    std::lock_guard<std::mutex> lock { _indexes_lock };
+    for (auto& index : created) {
+        _indexes.push_back(std::move(index));
+    }
+
+    // Indexed scans return results in the class index order, cached ones may have another
+    if (_cache != nullptr) {
+        _cache->clear();
     }
     return true;
 }
 
-bool heap_profile_impl_t::query_instances(const filter_t& filter, std::vector<heap_item_ptr_t>& result) const {
-    for (auto& item : _objects) {
-        switch (filter(item.second, *this)) {
+void heap_profile_impl_t::build_strings_index() const {
+    std::vector<const heap_item_ptr_t*> strings;
+    for (auto& partition : _heaps) {
+        for (auto& item : partition) {
+            if (item->type() == heap_item_t::String) {
+                strings.push_back(&item);
+            }
+        }
+    }
+
+    _strings.resize(strings.size());
+    auto hash_chunk = [this, &strings] (size_t chunk) {
+        size_t last = std::min(strings.size(), (chunk + 1) * CHUNK_SIZE);
+        const u_int8_t* data = nullptr;
+        size_t size = 0;
+        string_info_t::encoding_t encoding = string_info_t::ENCODING_LATIN1;
+        for (size_t index = chunk * CHUNK_SIZE; index < last; ++index) {
+            payload_of(static_cast<const string_info_t*>(**strings[index]), data, size, encoding);
+            _strings[index] = { payload_hash(data, size, encoding), strings[index] };
+        }
+    };
+
+    size_t chunks = (strings.size() + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    if (_pool != nullptr) {
+        _pool->run(chunks, hash_chunk);
+    } else {
+        for (size_t chunk = 0; chunk < chunks; ++chunk) {
+            hash_chunk(chunk);
+        }
+    }
+
+    std::sort(std::begin(_strings), std::end(_strings), [] (auto& left, auto& right) { return left.first < right.first; });
+}
+
+void heap_profile_impl_t::build_referrers_index() const {
+    std::vector<const heap_item_ptr_t*> holders;
+    for (auto& partition : _heaps) {
+        for (auto& item : partition) {
+            if (item->type() != heap_item_t::PrimitivesArray) {
+                holders.push_back(&item);
+            }
+        }
+    }
+    for (auto& item : _classes) {
+        holders.push_back(&item.second);
+    }
+
+    size_t chunks = (holders.size() + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    std::vector<std::vector<std::pair<jvm_id_t, const heap_item_ptr_t*>>> partials { chunks };
+    auto collect_chunk = [&holders, &partials] (size_t chunk) {
+        std::vector<jvm_id_t> references;
+        size_t last = std::min(holders.size(), (chunk + 1) * CHUNK_SIZE);
+        for (size_t index = chunk * CHUNK_SIZE; index < last; ++index) {
+            references.clear();
+            references_of(*holders[index], references);
+            std::sort(std::begin(references), std::end(references));
+            references.erase(std::unique(std::begin(references), std::end(references)), std::end(references));
+            for (jvm_id_t id : references) {
+                partials[chunk].emplace_back(id, holders[index]);
+            }
+        }
+    };
+
+    if (_pool != nullptr) {
+        _pool->run(chunks, collect_chunk);
+    } else {
+        for (size_t chunk = 0; chunk < chunks; ++chunk) {
+            collect_chunk(chunk);
+        }
+    }
+
+    size_t total = 0;
+    for (auto& partial : partials) {
+        total += partial.size();
+    }
+    _referrers.reserve(total);
+    for (auto& partial : partials) {
+        _referrers.insert(std::end(_referrers), std::begin(partial), std::end(partial));
+        partial = {};
+    }
+    std::sort(std::begin(_referrers), std::end(_referrers), [] (auto& left, auto& right) { return left.first < right.first; });
+}
+
+void heap_profile_impl_t::referrers_of(jvm_id_t id, std::vector<const heap_item_ptr_t*>& result) const {
+    std::call_once(_referrers_once, [this] () { build_referrers_index(); });
+
+    auto first = std::lower_bound(std::begin(_referrers), std::end(_referrers), id,
+        [] (auto& entry, jvm_id_t key) { return entry.first < key; });
+    for (auto it = first; it != std::end(_referrers) && it->first == id; ++it) {
+        result.push_back(it->second);
+    }
+}
+
+const heap_item_ptr_t* heap_profile_impl_t::locate(jvm_id_t id) const {
+    auto object = _objects.find(id);
+    if (object != std::end(_objects)) {
+        return &object->second;
+    }
+
+    auto cls = _classes.find(id);
+    return cls != std::end(_classes) ? &cls->second : nullptr;
+}
+
+size_t heap_profile_impl_t::count_indexes() const {
+    std::lock_guard<std::mutex> lock { _indexes_lock };
+    return _indexes.size();
+}
+
+bool heap_profile_impl_t::in_heaps(u_int32_t heaps, int32_t heap_type) {
+    return heaps == 0 || (heaps & (1u << heap_type)) != 0;
+}
+
+void heap_profile_impl_t::query_classes(const query_t& query, query_cursor_impl_t& cursor) const {
+    auto& plan = cursor.plan();
+    auto token = cursor.token();
+    cursor.add([this, &query, &plan, token] (query_cache_t::items_t& out) {
+        size_t index = 0;
+        for (auto& item : _classes) {
+            if (stop_requested(token, index++)) {
+                return stopped_chunk(token);
+            }
+            if (!in_heaps(query.heaps, heap_type_of(item.second)) || !plan.sample.contains(item.first)) {
+                continue;
+            }
+
+            switch (plan.program(item.second, *this)) {
+                case filter_t::Match:
+                    out.push_back(&item.second);
+                    continue;
+                case filter_t::NoMatch:
+                    continue;
+                case filter_t::Fail:
+                    return query_cursor_impl_t::Failed;
+            }
+            assert(false);
+        }
+        return query_cursor_impl_t::Scanned;
+    });
+}
+
+void heap_profile_impl_t::query_instances(const query_t& query, query_cursor_impl_t& cursor) const {
+    auto& plan = cursor.plan();
+    auto token = cursor.token();
+    for (int32_t heap_type = heap_info_t::HEAP_UNKNOWN; heap_type <= heap_info_t::HEAP_IMAGE; ++heap_type) {
+        if (!in_heaps(query.heaps, heap_type)) {
+            continue;
+        }
+
+        auto& partition = _heaps[heap_type];
+        for (size_t first = 0; first < partition.size(); first += CHUNK_SIZE) {
+            const heap_item_ptr_t* items = partition.data() + first;
+            size_t count = std::min(CHUNK_SIZE, partition.size() - first);
+            cursor.add([this, &plan, token, items, count] (query_cache_t::items_t& out) {
+                for (size_t index = 0; index < count; ++index) {
+                    if (stop_requested(token, index)) {
+                        return stopped_chunk(token);
+                    }
+                    auto& item = items[index];
+                    if (!plan.sample.contains(object_of(item)->id())) {
+                        continue;
+                    }
+                    switch (plan.program(item, *this)) {
+                        case filter_t::Match:
+                            out.push_back(&item);
+                            continue;
+                        case filter_t::NoMatch:
+                            continue;
+                        case filter_t::Fail:
+                            return query_cursor_impl_t::Failed;
+                    }
+                    assert(false);
+                }
+                return query_cursor_impl_t::Scanned;
+            });
+        }
+    }
+}
+
+void heap_profile_impl_t::query_class_instances(const query_t& query, query_cursor_impl_t& cursor) const {
+    struct batch_t {
+        const heap_item_ptr_t* const* items;
+        size_t count;
+    };
+
+    struct chunk_t {
+        size_t first;
+        size_t last;
+    };
+
+    // Batches never mix classes, small classes are grouped into chunks of about CHUNK_SIZE items
+    auto& plan = cursor.plan();
+    auto batches = std::make_shared<std::vector<batch_t>>();
+    std::vector<chunk_t> chunks;
+    size_t chunk_items = 0;
+    for (auto& hierarchy : plan.hierarchies) {
+        if (hierarchy.enter == 0) {
+            continue;
+        }
+
+        u_int32_t last = std::min<u_int32_t>(hierarchy.exit, _class_instances.size() - 1);
+        for (u_int32_t index = hierarchy.enter; index <= last; ++index) {
+            auto& instances = _class_instances[index];
+            for (size_t first = 0; first < instances.size(); first += column_kernels_t::BATCH_SIZE) {
+                size_t count = std::min(column_kernels_t::BATCH_SIZE, instances.size() - first);
+                if (chunks.empty() || chunk_items >= CHUNK_SIZE) {
+                    chunks.push_back({ batches->size(), batches->size() });
+                    chunk_items = 0;
+                }
+                batches->push_back({ instances.data() + first, count });
+                chunks.back().last = batches->size();
+                chunk_items += count;
+            }
+        }
+    }
+
+    auto token = cursor.token();
+    for (auto& chunk : chunks) {
+        cursor.add([this, &query, &plan, token, batches, chunk] (query_cache_t::items_t& out) {
+            for (size_t index = chunk.first; index < chunk.last; ++index) {
+                if (stop_requested(token, (index - chunk.first) * column_kernels_t::BATCH_SIZE)) {
+                    return stopped_chunk(token);
+                }
+                auto result = query_batch(query, plan, nullptr, (*batches)[index].items, (*batches)[index].count, out);
+                if (result != query_cursor_impl_t::Scanned) {
+                    return result;
+                }
+            }
+            return query_cursor_impl_t::Scanned;
+        });
+    }
+}
+
+void heap_profile_impl_t::query_indexed(const query_t& query, query_cursor_impl_t& cursor) const {
+    auto& plan = cursor.plan();
+    auto token = cursor.token();
+    auto candidates = std::make_shared<std::vector<const heap_item_ptr_t*>>();
+    plan.index->lookup(plan.index_filter->comparison(), plan.index_filter->value(), *candidates);
+
+    for (size_t first = 0; first < candidates->size(); first += CHUNK_SIZE) {
+        size_t count = std::min(CHUNK_SIZE, candidates->size() - first);
+        cursor.add([this, &query, &plan, token, candidates, first, count] (query_cache_t::items_t& out) {
+            return query_items(query, plan, token, candidates->data() + first, count, out);
+        });
+    }
+}
+
+/// Candidates are holders or referents of the subquery results in the order of their ids
+void heap_profile_impl_t::query_related(const query_t& query, query_cursor_impl_t& cursor, query_profiler_t* profiler) const {
+    std::vector<heap_item_ptr_t> targets;
+    if (query.related == nullptr || !open(*query.related, cursor.token(), profiler)->fetch(std::numeric_limits<size_t>::max(), targets)) {
+        cursor.add([] (query_cache_t::items_t&) { return query_cursor_impl_t::Failed; });
+        return;
+    }
+
+    auto candidates = std::make_shared<std::vector<const heap_item_ptr_t*>>();
+    std::vector<jvm_id_t> references;
+    for (auto& target : targets) {
+        if (query.relation == query_t::RELATION_REFERRING_TO) {
+            referrers_of(object_of(target)->id(), *candidates);
+            continue;
+        }
+
+        references.clear();
+        references_of(target, references);
+        for (jvm_id_t id : references) {
+            auto item = locate(id);
+            if (item != nullptr) {
+                candidates->push_back(item);
+            }
+        }
+    }
+
+    bool classes = query.source == query_t::SOURCE_CLASSES;
+    candidates->erase(std::remove_if(std::begin(*candidates), std::end(*candidates),
+        [classes] (auto item) { return ((*item)->type() == heap_item_t::Class) != classes; }), std::end(*candidates));
+    std::sort(std::begin(*candidates), std::end(*candidates), [] (auto left, auto right) { return object_of(*left)->id() < object_of(*right)->id(); });
+    candidates->erase(std::unique(std::begin(*candidates), std::end(*candidates)), std::end(*candidates));
+
+    auto& plan = cursor.plan();
+    auto token = cursor.token();
+    for (size_t first = 0; first < candidates->size(); first += CHUNK_SIZE) {
+        size_t count = std::min(CHUNK_SIZE, candidates->size() - first);
+        cursor.add([this, &query, &plan, token, candidates, first, count] (query_cache_t::items_t& out) {
+            return query_items(query, plan, token, candidates->data() + first, count, out);
+        });
+    }
+}
+
+query_cursor_impl_t::chunk_result_t heap_profile_impl_t::query_batch(const query_t& query, const query_plan_t& plan, const query_token_t* token, const heap_item_ptr_t* const* items, size_t count, query_cache_t::items_t& result) const {
+    // Instances of a single class are checked by columns when the filter allows
+    u_int64_t selection[column_kernels_t::BATCH_SIZE / 64];
+    if (plan.use_columns && query.filter != nullptr && query.filter->select(items, count, selection)) {
+        for (size_t word = 0; word < column_kernels_t::selection_size(count); ++word) {
+            for (u_int64_t bits = selection[word]; bits != 0; bits &= bits - 1) {
+                auto item = items[word * 64 + __builtin_ctzll(bits)];
+                if (in_heaps(query.heaps, heap_type_of(*item)) && plan.sample.contains(object_of(*item)->id())) {
+                    result.push_back(item);
+                }
+            }
+        }
+        return query_cursor_impl_t::Scanned;
+    }
+
+    return query_items(query, plan, token, items, count, result);
+}
+
+query_cursor_impl_t::chunk_result_t heap_profile_impl_t::query_items(const query_t& query, const query_plan_t& plan, const query_token_t* token, const heap_item_ptr_t* const* items, size_t count, query_cache_t::items_t& result) const {
+    for (size_t index = 0; index < count; ++index) {
+        if (stop_requested(token, index)) {
+            return stopped_chunk(token);
+        }
+        auto item = items[index];
+        if (!in_heaps(query.heaps, heap_type_of(*item)) || !plan.sample.contains(object_of(*item)->id())) {
+            continue;
+        }
+
+        switch (plan.program(*item, *this)) {
             case filter_t::Match:
-                result.push_back(item.second);
+                result.push_back(item);
                 continue;
             case filter_t::NoMatch:
                 continue;
             case filter_t::Fail:
-                return false;
+                return query_cursor_impl_t::Failed;
         }
         assert(false);
     }
-    return true;
+    return query_cursor_impl_t::Scanned;
 }
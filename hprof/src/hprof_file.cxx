@@ -24,7 +24,7 @@ file_t::file_t(const std::string& name) : _file_name(name) {
 file_t::~file_t() {
 }
 
-std::unique_ptr<heap_profile_t> file_t::read_dump(const data_reader_factory_t& factory, const progress_callback& callback) const {
+std::unique_ptr<heap_profile_t> file_t::read_dump(const data_reader_factory_t& factory, const progress_callback& callback, const load_options_t& options) const {
     auto in = std::ifstream { _file_name, std::ios::binary };
     if (!in.is_open()) {
         return nullptr;
@@ -50,7 +50,7 @@ std::unique_ptr<heap_profile_t> file_t::read_dump(const data_reader_factory_t& f
     }
 
     u_int32_t prepare_progress = std::numeric_limits<u_int32_t>::max();
-    return reader->build(stream, [&callback, &prepare_progress] (auto done, auto total) {
+    return reader->build(stream, options, [&callback, &prepare_progress] (auto done, auto total) {
         auto progress = done * 100 / total;
         if (prepare_progress != progress) {
             prepare_progress = progress;
@@ -0,0 +1,301 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#include "query_aggregator.h"
+#include "query_projection.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+using namespace hprof;
+
+query_aggregator_t::query_aggregator_t(const query_t& query, const objects_index_t& objects, const classes_index_t& classes) :
+    _query(query), _objects(objects), _classes(classes), _sample(query.sample, query.sample_seed) {
+    for (auto& aggregation : _query.aggregations) {
+        if (aggregation.field != nullptr) {
+            aggregation.field->bind(classes);
+        }
+    }
+    if (_query.group_field != nullptr) {
+        _query.group_field->bind(classes);
+    }
+}
+
+void query_aggregator_t::add(const heap_item_ptr_t& item, partial_t& partial) const {
+    group_t& group = find_group(item, partial);
+    ++group.count;
+
+    for (size_t index = 0; index < _query.aggregations.size(); ++index) {
+        auto& aggregation = _query.aggregations[index];
+        if (aggregation.function == query_t::AGGREGATE_COUNT || aggregation.field == nullptr) {
+            continue;
+        }
+
+        state_t& state = group.states[index];
+        aggregation.field->apply(item, _objects, [&aggregation, &state] (auto& value) -> bool {
+            accumulate(aggregation.function, value, state);
+            return true;
+        });
+    }
+}
+
+void query_aggregator_t::merge(partial_t&& partial) {
+    for (auto& group : partial.classes) {
+        auto& total = _total.classes[group.first];
+        merge_group(std::move(group.second), total);
+    }
+    for (auto& group : partial.groups) {
+        auto& total = _total.groups[group.first];
+        merge_group(std::move(group.second), total);
+    }
+}
+
+void query_aggregator_t::finish(size_t offset, size_t limit, std::vector<aggregate_row_t>& rows) {
+    // Classes of several class loaders may share the name
+    for (auto& group : _total.classes) {
+        auto& total = _total.groups[group.first->name()];
+        merge_group(std::move(group.second), total);
+    }
+    _total.classes.clear();
+
+    // A query without groups returns a single row even when nothing matched
+    if (_query.group == query_t::GROUP_NONE && _total.groups.empty()) {
+        _total.groups[std::string {}].states.resize(_query.aggregations.size());
+    }
+
+    std::vector<const std::pair<const std::string, group_t>*> groups;
+    groups.reserve(_total.groups.size());
+    for (auto& group : _total.groups) {
+        groups.push_back(&group);
+    }
+    std::sort(std::begin(groups), std::end(groups), [] (auto left, auto right) { return left->first < right->first; });
+
+    size_t first = std::min(offset, groups.size());
+    size_t last = first + std::min(limit, groups.size() - first);
+    for (size_t index = first; index < last; ++index) {
+        aggregate_row_t row { groups[index]->first, {} };
+        for (size_t value = 0; value < _query.aggregations.size(); ++value) {
+            row.values.push_back(value_of(groups[index]->second, value));
+        }
+        rows.push_back(std::move(row));
+    }
+}
+
+query_aggregator_t::group_t& query_aggregator_t::find_group(const heap_item_ptr_t& item, partial_t& partial) const {
+    group_t* group = nullptr;
+    switch (_query.group) {
+        case query_t::GROUP_NONE:
+            group = &partial.groups[std::string {}];
+            break;
+        case query_t::GROUP_CLASS: {
+            const class_info_t* cls = nullptr;
+            if (item->type() == heap_item_t::Object) {
+                cls = static_cast<const instance_info_t*>(*item)->get_class();
+            } else if (item->type() == heap_item_t::String) {
+                cls = static_cast<const string_info_t*>(*item)->get_class();
+            }
+            group = cls != nullptr ? &partial.classes[cls] : &partial.groups[query_projection_t::class_name(item, _classes)];
+            break;
+        }
+        case query_t::GROUP_FIELD: {
+            std::string key = "<none>";
+            if (_query.group_field != nullptr) {
+                _query.group_field->apply(item, _objects, [this, &key] (auto& value) -> bool {
+                    key = query_projection_t::render(value, _objects, _classes);
+                    return true;
+                });
+            }
+            group = &partial.groups[key];
+            break;
+        }
+    }
+
+    if (group->states.size() != _query.aggregations.size()) {
+        group->states.resize(_query.aggregations.size());
+    }
+    return *group;
+}
+
+void query_aggregator_t::merge_group(group_t&& from, group_t& to) const {
+    to.count += from.count;
+    if (to.states.size() != _query.aggregations.size()) {
+        to.states.resize(_query.aggregations.size());
+    }
+
+    for (size_t index = 0; index < from.states.size(); ++index) {
+        auto function = _query.aggregations[index].function;
+        if (from.states[index].has_int) {
+            combine_int(function, from.states[index].int_value, to.states[index]);
+        }
+        if (from.states[index].has_double) {
+            combine_double(function, from.states[index].double_value, to.states[index]);
+        }
+        to.states[index].squares += from.states[index].squares;
+    }
+}
+
+aggregate_value_t query_aggregator_t::value_of(const group_t& group, size_t index) const {
+    aggregate_value_t result = exact_value_of(group, index);
+    auto function = _query.aggregations[index].function;
+    if (_sample.all() || result.empty || (function != query_t::AGGREGATE_COUNT && function != query_t::AGGREGATE_SUM)) {
+        return result;
+    }
+
+    double total = 0;
+    if (function == query_t::AGGREGATE_COUNT) {
+        _sample.estimate_count(group.count, total, result.error);
+    } else {
+        double sum = result.integral ? static_cast<double>(result.int_value) : result.double_value;
+        _sample.estimate_sum(sum, group.states[index].squares, total, result.error);
+    }
+
+    result.estimated = true;
+    if (result.integral) {
+        result.int_value = std::llround(total);
+    } else {
+        result.double_value = total;
+    }
+    return result;
+}
+
+/// Integral and floating point values of a field are kept apart, a mix gives a double
+aggregate_value_t query_aggregator_t::exact_value_of(const group_t& group, size_t index) const {
+    aggregate_value_t result { true, true, 0, 0, false, 0 };
+    auto function = _query.aggregations[index].function;
+    if (function == query_t::AGGREGATE_COUNT) {
+        result.empty = false;
+        result.int_value = static_cast<int64_t>(group.count);
+        return result;
+    }
+
+    const state_t& state = group.states[index];
+    if (!state.has_int && !state.has_double) {
+        return result;
+    }
+
+    result.empty = false;
+    if (!state.has_double) {
+        result.int_value = state.int_value;
+        return result;
+    }
+
+    result.integral = false;
+    result.double_value = state.double_value;
+    if (state.has_int) {
+        double integral = static_cast<double>(state.int_value);
+        switch (function) {
+            case query_t::AGGREGATE_SUM:
+                result.double_value += integral;
+                break;
+            case query_t::AGGREGATE_MIN:
+                result.double_value = std::min(result.double_value, integral);
+                break;
+            case query_t::AGGREGATE_MAX:
+                result.double_value = std::max(result.double_value, integral);
+                break;
+            case query_t::AGGREGATE_COUNT:
+                break;
+        }
+    }
+    return result;
+}
+
+void query_aggregator_t::accumulate(query_t::aggregate_t function, const field_value_t& value, state_t& state) {
+    switch (value.type()) {
+        case jvm_type_t::JVM_TYPE_BYTE:
+            add_int(function, static_cast<jvm_byte_t>(value), state);
+            break;
+        case jvm_type_t::JVM_TYPE_SHORT:
+            add_int(function, static_cast<jvm_short_t>(value), state);
+            break;
+        case jvm_type_t::JVM_TYPE_CHAR:
+            add_int(function, static_cast<jvm_char_t>(value), state);
+            break;
+        case jvm_type_t::JVM_TYPE_INT:
+            add_int(function, static_cast<jvm_int_t>(value), state);
+            break;
+        case jvm_type_t::JVM_TYPE_LONG:
+            add_int(function, static_cast<jvm_long_t>(value), state);
+            break;
+        case jvm_type_t::JVM_TYPE_FLOAT:
+            add_double(function, static_cast<jvm_float_t>(value), state);
+            break;
+        case jvm_type_t::JVM_TYPE_DOUBLE:
+            add_double(function, static_cast<jvm_double_t>(value), state);
+            break;
+        default:
+            break;
+    }
+}
+
+void query_aggregator_t::add_int(query_t::aggregate_t function, int64_t value, state_t& state) {
+    combine_int(function, value, state);
+    if (function == query_t::AGGREGATE_SUM) {
+        state.squares += static_cast<double>(value) * static_cast<double>(value);
+    }
+}
+
+void query_aggregator_t::add_double(query_t::aggregate_t function, double value, state_t& state) {
+    combine_double(function, value, state);
+    if (function == query_t::AGGREGATE_SUM) {
+        state.squares += value * value;
+    }
+}
+
+/// Sums wrap around like java long arithmetic
+void query_aggregator_t::combine_int(query_t::aggregate_t function, int64_t value, state_t& state) {
+    if (!state.has_int) {
+        state.has_int = true;
+        state.int_value = value;
+        return;
+    }
+
+    switch (function) {
+        case query_t::AGGREGATE_SUM:
+            state.int_value = static_cast<int64_t>(static_cast<u_int64_t>(state.int_value) + static_cast<u_int64_t>(value));
+            break;
+        case query_t::AGGREGATE_MIN:
+            state.int_value = std::min(state.int_value, value);
+            break;
+        case query_t::AGGREGATE_MAX:
+            state.int_value = std::max(state.int_value, value);
+            break;
+        case query_t::AGGREGATE_COUNT:
+            break;
+    }
+}
+
+void query_aggregator_t::combine_double(query_t::aggregate_t function, double value, state_t& state) {
+    if (!state.has_double) {
+        state.has_double = true;
+        state.double_value = value;
+        return;
+    }
+
+    switch (function) {
+        case query_t::AGGREGATE_SUM:
+            state.double_value += value;
+            break;
+        case query_t::AGGREGATE_MIN:
+            state.double_value = std::min(state.double_value, value);
+            break;
+        case query_t::AGGREGATE_MAX:
+            state.double_value = std::max(state.double_value, value);
+            break;
+        case query_t::AGGREGATE_COUNT:
+            break;
+    }
+}
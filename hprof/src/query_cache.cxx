@@ -0,0 +1,126 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#include "query_cache.h"
+#include "query_sample.h"
+
+using namespace hprof;
+
+bool query_cache_t::key(const query_t& query, std::string& key) {
+    key.clear();
+    switch (query.source) {
+        case query_t::SOURCE_OBJECTS:
+            key += "objects";
+            break;
+        case query_t::SOURCE_CLASSES:
+            key += "classes";
+            break;
+    }
+
+    key += '|';
+    key += std::to_string(query.heaps);
+    key += '|';
+    if (query.filter != nullptr && !query.filter->key(key)) {
+        return false;
+    }
+    // Samples of the same fraction and seed pick the same candidates
+    query_sample_t sample { query.sample, query.sample_seed };
+    if (!sample.all()) {
+        key += "|sample(" + std::to_string(sample.threshold()) + ',' + std::to_string(sample.seed()) + ')';
+    }
+    if (query.relation == query_t::RELATION_NONE) {
+        return true;
+    }
+
+    // The related items depend on the whole subquery result, ordered ones are not keyed
+    if (query.related == nullptr || query.related->order != query_t::ORDER_NONE) {
+        return false;
+    }
+
+    std::string related;
+    if (!query_cache_t::key(*query.related, related)) {
+        return false;
+    }
+    key += query.relation == query_t::RELATION_REFERRING_TO ? "|referring(" : "|referenced(";
+    key += related;
+    key += '|';
+    key += std::to_string(query.related->offset);
+    key += '|';
+    key += std::to_string(query.related->limit);
+    key += ')';
+    return true;
+}
+
+size_t query_cache_t::cost(const std::string& key, const entry_t& entry) {
+    return sizeof(entry_t) + key.size() + entry.items.capacity() * sizeof(items_t::value_type);
+}
+
+size_t query_cache_t::used() const {
+    std::lock_guard<std::mutex> lock { _lock };
+    return _used;
+}
+
+size_t query_cache_t::entries() const {
+    std::lock_guard<std::mutex> lock { _lock };
+    return _entries.size();
+}
+
+std::shared_ptr<const query_cache_t::entry_t> query_cache_t::find(const std::string& key) {
+    std::lock_guard<std::mutex> lock { _lock };
+    auto it = _entries.find(key);
+    if (it == std::end(_entries)) {
+        return nullptr;
+    }
+
+    _lru.splice(std::begin(_lru), _lru, it->second);
+    return it->second->second;
+}
+
+void query_cache_t::clear() {
+    std::lock_guard<std::mutex> lock { _lock };
+    _entries.clear();
+    _lru.clear();
+    _used = 0;
+}
+
+void query_cache_t::store(const std::string& key, std::shared_ptr<const entry_t>&& entry) {
+    size_t entry_cost = cost(key, *entry);
+    if (entry_cost > _capacity) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock { _lock };
+    auto it = _entries.find(key);
+    if (it != std::end(_entries)) {
+        auto& stored = *it->second->second;
+        if (stored.complete || (!entry->complete && stored.items.size() >= entry->items.size())) {
+            return;
+        }
+        _used -= cost(key, stored);
+        _lru.erase(it->second);
+        _entries.erase(it);
+    }
+
+    while (!_lru.empty() && _used + entry_cost > _capacity) {
+        auto& last = _lru.back();
+        _used -= cost(last.first, *last.second);
+        _entries.erase(last.first);
+        _lru.pop_back();
+    }
+
+    _lru.emplace_front(key, std::move(entry));
+    _entries.emplace(key, std::begin(_lru));
+    _used += entry_cost;
+}
@@ -0,0 +1,247 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#include "query_cursor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <limits>
+
+using namespace hprof;
+
+query_cursor_impl_t::query_cursor_impl_t(query_pool_t* pool, query_plan_t&& plan, size_t offset, size_t limit, const query_token_t* token) :
+    _pool(pool), _plan(std::move(plan)), _next_chunk(0), _wave(0), _ready_pos(0), _skip(offset), _left(limit), _failed(false),
+    _token(token), _truncated(false), _cache(nullptr) {
+    if (_pool != nullptr && _pool->threads() > 1) {
+        _wave = _pool->threads() * 2;
+    }
+}
+
+query_cursor_impl_t::~query_cursor_impl_t() {
+    bool complete = _next_chunk == _chunks.size();
+    if (_cache == nullptr || _failed || (!complete && _recorded.empty())) {
+        return;
+    }
+    // A stopped chunk may have kept only a part of its matches, a token stopped after the scan changes nothing
+    if (_truncated) {
+        return;
+    }
+
+    _recorded.shrink_to_fit();
+    auto entry = std::make_shared<query_cache_t::entry_t>();
+    entry->items = std::move(_recorded);
+    entry->complete = complete;
+    _cache->store(_cache_key, std::move(entry));
+}
+
+void query_cursor_impl_t::record(query_cache_t* cache, std::string&& key) {
+    _cache = cache;
+    _cache_key = std::move(key);
+}
+
+bool query_cursor_impl_t::fetch(size_t count, std::vector<heap_item_ptr_t>& page) {
+    if (_failed) {
+        return false;
+    }
+
+    size_t wanted = std::min(count, _left);
+    size_t added = 0;
+    while (added < wanted) {
+        if (_ready_pos == _ready.size()) {
+            if (_next_chunk == _chunks.size()) {
+                break;
+            }
+            if (stopped()) {
+                if (_failed) {
+                    return false;
+                }
+                break;
+            }
+            if (!scan(wanted - added)) {
+                _failed = true;
+                return false;
+            }
+            continue;
+        }
+
+        size_t take = std::min(wanted - added, _ready.size() - _ready_pos);
+        page.reserve(page.size() + take);
+        for (size_t index = _ready_pos; index < _ready_pos + take; ++index) {
+            page.push_back(*_ready[index]);
+        }
+        _ready_pos += take;
+        added += take;
+    }
+
+    _left -= added;
+    if (_ready_pos == _ready.size()) {
+        _ready.clear();
+        _ready_pos = 0;
+    }
+    return true;
+}
+
+bool query_cursor_impl_t::done() const {
+    return _failed || _left == 0 || (_ready_pos == _ready.size() && (_truncated || _next_chunk == _chunks.size()));
+}
+
+bool query_cursor_impl_t::stopped() {
+    if (_token == nullptr || !_token->stopped()) {
+        return false;
+    }
+
+    if (_token->cancelled()) {
+        _failed = true;
+    } else {
+        _truncated = true;
+    }
+    return true;
+}
+
+bool query_cursor_impl_t::drain(const consumer_t& consume) {
+    if (_failed) {
+        return false;
+    }
+
+    size_t first = _next_chunk;
+    size_t count = _chunks.size() - first;
+    _next_chunk = _chunks.size();
+
+    std::atomic<bool> failed { false };
+    std::atomic<bool> cut { false };
+    auto run = [this, first, &consume, &failed, &cut] (size_t index) {
+        query_cache_t::items_t matches;
+        if (failed.load(std::memory_order_relaxed)) {
+            _chunks[first + index] = nullptr;
+            return;
+        }
+
+        // A chunk skipped for the token is cut as a whole
+        auto result = Cut;
+        if (_token == nullptr || !_token->stopped()) {
+            result = _chunks[first + index](matches);
+        } else if (_token->cancelled()) {
+            result = Failed;
+        }
+
+        if (result == Failed) {
+            failed.store(true);
+        } else if (result == Cut) {
+            cut.store(true);
+        }
+        if (result != Failed && !matches.empty()) {
+            consume(first + index, matches);
+        }
+        _chunks[first + index] = nullptr;
+    };
+
+    if (_pool != nullptr && _pool->threads() > 1 && count > 1) {
+        _pool->run(count, run);
+    } else {
+        for (size_t index = 0; index < count; ++index) {
+            run(index);
+        }
+    }
+
+    return finish(failed.load(), cut.load());
+}
+
+bool query_cursor_impl_t::finish(bool failed, bool cut) {
+    _failed = _failed || failed;
+    // Only a chunk skipped or cut short loses matches, a token stopped after the wave changes nothing
+    _truncated = _truncated || (cut && !_failed);
+    return !_failed;
+}
+
+bool query_cursor_impl_t::scan(size_t wanted) {
+    _ready.clear();
+    _ready_pos = 0;
+
+    size_t first = _next_chunk;
+    size_t count = 1;
+    if (_wave != 0) {
+        // Nothing is saved by stopping early when everything is wanted
+        count = wanted == std::numeric_limits<size_t>::max() ? _chunks.size() - first : std::min(_wave, _chunks.size() - first);
+        _wave *= 2;
+    }
+    _next_chunk += count;
+
+    if (count == 1) {
+        auto result = _chunks[first](_ready);
+        _chunks[first] = nullptr;
+        if (!finish(result == Failed, result == Cut)) {
+            return false;
+        }
+    } else {
+        std::vector<query_cache_t::items_t> buffers(count);
+        std::atomic<bool> failed { false };
+        std::atomic<bool> cut { false };
+        _pool->run(count, [this, first, &buffers, &failed, &cut] (size_t index) {
+            if (!failed.load(std::memory_order_relaxed)) {
+                auto result = _chunks[first + index](buffers[index]);
+                if (result == Failed) {
+                    failed.store(true);
+                } else if (result == Cut) {
+                    cut.store(true);
+                }
+            }
+            _chunks[first + index] = nullptr;
+        });
+
+        if (!finish(failed.load(), cut.load())) {
+            return false;
+        }
+
+        size_t total = 0;
+        for (auto& buffer : buffers) {
+            total += buffer.size();
+        }
+        _ready.reserve(total);
+        for (auto& buffer : buffers) {
+            _ready.insert(std::end(_ready), std::begin(buffer), std::end(buffer));
+        }
+    }
+
+    if (_cache != nullptr) {
+        // Results larger than the whole cache are not worth recording
+        if ((_recorded.size() + _ready.size()) * sizeof(query_cache_t::items_t::value_type) > _cache->capacity()) {
+            _cache = nullptr;
+            query_cache_t::items_t {}.swap(_recorded);
+        } else {
+            _recorded.insert(std::end(_recorded), std::begin(_ready), std::end(_ready));
+        }
+    }
+
+    _ready_pos = std::min(_skip, _ready.size());
+    _skip -= _ready_pos;
+    return true;
+}
+
+query_cache_cursor_impl_t::query_cache_cursor_impl_t(std::shared_ptr<const query_cache_t::entry_t>&& entry, size_t offset, size_t limit, bool truncated) :
+    _entry(std::move(entry)), _truncated(truncated) {
+    _next = std::min(offset, _entry->items.size());
+    _last = _next + std::min(limit, _entry->items.size() - _next);
+}
+
+bool query_cache_cursor_impl_t::fetch(size_t count, std::vector<heap_item_ptr_t>& page) {
+    size_t take = std::min(count, _last - _next);
+    page.reserve(page.size() + take);
+    for (size_t index = _next; index < _next + take; ++index) {
+        page.push_back(*_entry->items[index]);
+    }
+    _next += take;
+    return true;
+}
@@ -0,0 +1,90 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#include "query_planner.h"
+
+#include <limits>
+
+using namespace hprof;
+
+query_plan_t query_planner_t::plan(const query_t& query) const {
+    query_plan_t result { false, {}, query.source == query_t::SOURCE_CLASSES ? _classes_count : _objects_count, {}, nullptr, nullptr, true,
+                          query_sample_t { query.sample, query.sample_seed } };
+    if (query.filter == nullptr) {
+        return result;
+    }
+
+    query.filter->bind_once(_classes);
+    result.program.compile(query.filter.get());
+    if (query.source != query_t::SOURCE_OBJECTS || !query.filter->restrict_classes(result.hierarchies)) {
+        result.hierarchies.clear();
+        return result;
+    }
+
+    class_hierarchy_t::merge(result.hierarchies);
+    size_t estimated = 0;
+    for (auto& hierarchy : result.hierarchies) {
+        estimated += _classes.count_instances(hierarchy);
+    }
+
+    if (estimated < result.estimated_items) {
+        result.use_class_index = true;
+        result.estimated_items = estimated;
+        pick_index(query.filter.get(), result);
+    } else {
+        result.hierarchies.clear();
+    }
+    return result;
+}
+
+/// Any comparison AND-ed to the whole filter can narrow candidates down, the index has to cover
+/// every class the scan visits. It's taken when it returns less than half of the scanned items
+void query_planner_t::pick_index(const filter_t* filter, query_plan_t& plan) const {
+    size_t best = std::numeric_limits<size_t>::max();
+    std::vector<const filter_t*> pending { filter };
+    while (!pending.empty()) {
+        const filter_t* current = pending.back();
+        pending.pop_back();
+
+        auto operation = dynamic_cast<const filter_and_t*>(current);
+        if (operation != nullptr) {
+            pending.push_back(&operation->right());
+            pending.push_back(&operation->left());
+            continue;
+        }
+
+        auto compare = dynamic_cast<const filter_compare_field_t*>(current);
+        if (compare == nullptr || compare->field().depth() != 1) {
+            continue;
+        }
+
+        for (auto index : _indexes) {
+            size_t count = 0;
+            if (index->field() != compare->field().first() || !index->covers(plan.hierarchies)
+                || !index->estimate(compare->comparison(), compare->value(), count) || count >= best) {
+                continue;
+            }
+            best = count;
+            if (count * 2 < plan.estimated_items) {
+                plan.index = index;
+                plan.index_filter = compare;
+            }
+        }
+    }
+
+    if (plan.index != nullptr) {
+        plan.estimated_items = best;
+    }
+}
@@ -0,0 +1,124 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#include "query_pool.h"
+
+using namespace hprof;
+
+query_pool_t::query_pool_t(size_t threads) : _threads(threads), _generation(0), _stop(false), _task(nullptr), _pending(0) {
+    if (_threads == 0) {
+        _threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+    }
+
+    _queues.reset(new (std::nothrow) queue_t[_threads]);
+    if (_queues == nullptr) {
+        _threads = 0;
+        return;
+    }
+
+    for (size_t index = 1; index < _threads; ++index) {
+        _workers.emplace_back(&query_pool_t::worker, this, index);
+    }
+}
+
+query_pool_t::~query_pool_t() {
+    {
+        std::lock_guard<std::mutex> lock { _lock };
+        _stop = true;
+    }
+    _wake.notify_all();
+    for (auto& thread : _workers) {
+        thread.join();
+    }
+}
+
+void query_pool_t::run(size_t chunks, const task_t& task) {
+    if (_threads <= 1 || chunks <= 1) {
+        for (size_t chunk = 0; chunk < chunks; ++chunk) {
+            task(chunk);
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> run_lock { _run_lock };
+    // Task and counter are published before any chunk can be taken
+    _task = &task;
+    _pending.store(chunks);
+    for (size_t chunk = 0; chunk < chunks; ++chunk) {
+        queue_t& queue = _queues[chunk % _threads];
+        std::lock_guard<std::mutex> lock { queue.lock };
+        queue.chunks.push_back(chunk);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock { _lock };
+        ++_generation;
+    }
+    _wake.notify_all();
+
+    work(0);
+
+    std::unique_lock<std::mutex> lock { _lock };
+    _done.wait(lock, [this] { return _pending.load() == 0; });
+}
+
+void query_pool_t::worker(size_t index) {
+    u_int64_t generation = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock { _lock };
+            _wake.wait(lock, [this, generation] { return _stop || _generation != generation; });
+            if (_stop) {
+                return;
+            }
+            generation = _generation;
+        }
+        work(index);
+    }
+}
+
+void query_pool_t::work(size_t index) {
+    size_t chunk = 0;
+    while (take(index, chunk)) {
+        (*_task)(chunk);
+        if (_pending.fetch_sub(1) == 1) {
+            std::lock_guard<std::mutex> lock { _lock };
+            _done.notify_all();
+        }
+    }
+}
+
+bool query_pool_t::take(size_t index, size_t& chunk) {
+    {
+        queue_t& own = _queues[index];
+        std::lock_guard<std::mutex> lock { own.lock };
+        if (!own.chunks.empty()) {
+            chunk = own.chunks.front();
+            own.chunks.pop_front();
+            return true;
+        }
+    }
+
+    for (size_t offset = 1; offset < _threads; ++offset) {
+        queue_t& victim = _queues[(index + offset) % _threads];
+        std::lock_guard<std::mutex> lock { victim.lock };
+        if (!victim.chunks.empty()) {
+            chunk = victim.chunks.back();
+            victim.chunks.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
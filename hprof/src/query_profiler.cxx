@@ -0,0 +1,226 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#include "query_profiler.h"
+#include "filters/logical.h"
+#include "types/string_instance.h"
+
+#include <atomic>
+#include <cstdio>
+#include <limits>
+
+using namespace hprof;
+
+using std::chrono::steady_clock;
+using std::chrono::duration_cast;
+using std::chrono::nanoseconds;
+
+namespace {
+    std::atomic<u_int64_t> g_profiler_runs { 0 };
+
+    /// Block of counters the thread works with, valid while the run matches
+    struct thread_slot_t {
+        u_int64_t run = 0;
+        void* counters = nullptr;
+    };
+    thread_local thread_slot_t g_thread_slot;
+
+    /// Counts lookups of one node, lookups of operands come through it
+    class counting_objects_t : public objects_index_t {
+    public:
+        explicit counting_objects_t(const objects_index_t& objects) : _objects(objects), _calls(0) {}
+        virtual ~counting_objects_t() {}
+
+        virtual heap_item_ptr_t find_object(jvm_id_t id) const override {
+            ++_calls;
+            return _objects.find_object(id);
+        }
+
+        virtual bool find_strings(const std::string& value, std::vector<jvm_id_t>& result) const override {
+            return _objects.find_strings(value, result);
+        }
+
+        virtual bool find_referrers(jvm_id_t id, incoming_links_t& links) const override {
+            return _objects.find_referrers(id, links);
+        }
+
+        size_t calls() const { return _calls; }
+    private:
+        const objects_index_t& _objects;
+        mutable size_t _calls;
+    };
+}
+
+query_profiler_t::query_profiler_t() : _run(++g_profiler_runs) {}
+
+void query_profiler_t::attach(const filter_t* filter) {
+    _nodes.clear();
+    if (filter != nullptr) {
+        add(filter, 0);
+    }
+    std::lock_guard<std::mutex> lock { _threads_lock };
+    _threads.clear();
+    _run = ++g_profiler_runs;
+}
+
+query_profiler_t::thread_counters_t& query_profiler_t::local() const {
+    if (g_thread_slot.run != _run) {
+        std::lock_guard<std::mutex> lock { _threads_lock };
+        _threads.push_back(std::make_unique<thread_counters_t>(_nodes.size() + 1));
+        g_thread_slot.run = _run;
+        g_thread_slot.counters = _threads.back().get();
+    }
+    return *static_cast<thread_counters_t*>(g_thread_slot.counters);
+}
+
+query_profiler_t::counters_t query_profiler_t::total(size_t index) const {
+    counters_t result;
+    std::lock_guard<std::mutex> lock { _threads_lock };
+    for (auto& counters : _threads) {
+        auto& thread = (*counters)[index];
+        result.items_in += thread.items_in;
+        result.items_out += thread.items_out;
+        result.find_object_calls += thread.find_object_calls;
+        result.strings_decoded += thread.strings_decoded;
+        result.nanoseconds += thread.nanoseconds;
+    }
+    return result;
+}
+
+size_t query_profiler_t::add(const filter_t* filter, size_t depth) {
+    size_t index = _nodes.size();
+    _nodes.push_back({ KIND_LEAF, filter, depth, 0, 0 });
+
+    // Nodes are stored by index, adding operands moves them
+    auto operation_and = dynamic_cast<const filter_and_t*>(filter);
+    auto operation_or = dynamic_cast<const filter_or_t*>(filter);
+    auto operation_not = dynamic_cast<const filter_not_t*>(filter);
+    if (operation_and != nullptr) {
+        size_t left = add(&operation_and->left(), depth + 1);
+        size_t right = add(&operation_and->right(), depth + 1);
+        _nodes[index] = { KIND_AND, filter, depth, left, right };
+    } else if (operation_or != nullptr) {
+        size_t left = add(&operation_or->left(), depth + 1);
+        size_t right = add(&operation_or->right(), depth + 1);
+        _nodes[index] = { KIND_OR, filter, depth, left, right };
+    } else if (operation_not != nullptr) {
+        size_t operand = add(&operation_not->filter(), depth + 1);
+        _nodes[index] = { KIND_NOT, filter, depth, operand, 0 };
+    }
+    return index;
+}
+
+query_profiler_t* query_profiler_t::related() {
+    if (_related == nullptr) {
+        _related = std::make_unique<query_profiler_t>();
+    }
+    return _related.get();
+}
+
+filter_t::filter_result_t query_profiler_t::operator()(const heap_item_ptr_t& item, const objects_index_t& objects) const {
+    auto& counters = local();
+    auto start = steady_clock::now();
+    filter_result_t result = _nodes.empty() ? Match : evaluate(0, item, objects, counters);
+
+    auto& scan = counters.back();
+    ++scan.items_in;
+    if (result == Match) {
+        ++scan.items_out;
+    }
+    scan.nanoseconds += duration_cast<nanoseconds>(steady_clock::now() - start).count();
+    return result;
+}
+
+filter_t::filter_result_t query_profiler_t::evaluate(size_t index, const heap_item_ptr_t& item, const objects_index_t& objects, thread_counters_t& counters) const {
+    auto& node = _nodes[index];
+    counting_objects_t counting { objects };
+    size_t decoded = strings_cache_t::thread_decodes();
+    auto start = steady_clock::now();
+
+    filter_result_t result = Fail;
+    switch (node.kind) {
+        case KIND_AND:
+            result = evaluate(node.left, item, counting, counters);
+            if (result == Match) {
+                result = evaluate(node.right, item, counting, counters);
+            }
+            break;
+        case KIND_OR:
+            result = evaluate(node.left, item, counting, counters);
+            if (result == NoMatch) {
+                result = evaluate(node.right, item, counting, counters);
+            }
+            break;
+        case KIND_NOT:
+            result = evaluate(node.left, item, counting, counters);
+            if (result != Fail) {
+                result = result == Match ? NoMatch : Match;
+            }
+            break;
+        case KIND_LEAF:
+            result = (*node.filter)(item, counting);
+            break;
+    }
+
+    auto& own = counters[index];
+    own.nanoseconds += duration_cast<nanoseconds>(steady_clock::now() - start).count();
+    ++own.items_in;
+    if (result == Match) {
+        ++own.items_out;
+    }
+    own.find_object_calls += counting.calls();
+    own.strings_decoded += strings_cache_t::thread_decodes() - decoded;
+    return result;
+}
+
+void query_profiler_t::report(size_t depth, const classes_index_t& classes, std::vector<explain_node_t>& nodes) const {
+    static const char* names[] = { "and", "or", "not" };
+    for (size_t index = 0; index < _nodes.size(); ++index) {
+        auto& node = _nodes[index];
+        auto counters = total(index);
+
+        std::string name;
+        if (node.kind != KIND_LEAF) {
+            name = names[node.kind];
+        } else if (!node.filter->key(name)) {
+            name = "filter";
+        }
+
+        nodes.push_back({ depth + node.depth, std::move(name), node.filter->estimate(classes),
+            counters.items_in, counters.items_out, counters.find_object_calls, counters.strings_decoded,
+            nanoseconds { counters.nanoseconds } });
+    }
+}
+
+void query_profiler_t::format(const explain_node_t& node, bool analyzed, std::string& out) {
+    out.append(node.depth * 2, ' ');
+    out += "-> ";
+    out += node.name;
+    if (node.estimated != std::numeric_limits<size_t>::max()) {
+        out += " (estimated ";
+        out += std::to_string(node.estimated);
+        out += ')';
+    }
+    if (!analyzed) {
+        return;
+    }
+
+    char buffer[160];
+    double ratio = node.items_in == 0 ? 0. : 100. * static_cast<double>(node.items_out) / static_cast<double>(node.items_in);
+    std::snprintf(buffer, sizeof(buffer), " in=%zu out=%zu (%.1f%%) find_object=%zu decoded=%zu time=%.3fms",
+        node.items_in, node.items_out, ratio, node.find_object_calls, node.strings_decoded,
+        static_cast<double>(node.time.count()) / 1e6);
+    out += buffer;
+}
@@ -0,0 +1,117 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#include "query_projection.h"
+#include "types/text_kernels.h"
+
+#include <cstdio>
+
+using namespace hprof;
+
+query_projection_t::query_projection_t(const query_t& query, const objects_index_t& objects, const classes_index_t& classes) :
+    _query(query), _objects(objects), _classes(classes) {
+    for (auto& field : _query.projections) {
+        field->bind(classes);
+    }
+}
+
+void query_projection_t::columns(std::vector<std::string>& names) const {
+    names.clear();
+    for (auto& field : _query.projections) {
+        std::string name { "object." };
+        field->key(name);
+        names.push_back(std::move(name));
+    }
+}
+
+void query_projection_t::row(const heap_item_ptr_t& item, std::vector<std::string>& values) const {
+    values.resize(_query.projections.size());
+    for (size_t index = 0; index < _query.projections.size(); ++index) {
+        std::string& value = values[index];
+        value = "<none>";
+        _query.projections[index]->apply(item, _objects, [this, &value] (auto& field) -> bool {
+            value = render(field, _objects, _classes);
+            return true;
+        });
+    }
+}
+
+std::string query_projection_t::render(const field_value_t& value, const objects_index_t& objects, const classes_index_t& classes) {
+    char buffer[64];
+    switch (value.type()) {
+        case jvm_type_t::JVM_TYPE_BOOL:
+            return static_cast<jvm_bool_t>(value) ? "true" : "false";
+        case jvm_type_t::JVM_TYPE_BYTE:
+            return std::to_string(static_cast<int>(static_cast<jvm_byte_t>(value)));
+        case jvm_type_t::JVM_TYPE_SHORT:
+            return std::to_string(static_cast<jvm_short_t>(value));
+        case jvm_type_t::JVM_TYPE_CHAR:
+            return text_kernels_t::to_utf8(static_cast<jvm_char_t>(value));
+        case jvm_type_t::JVM_TYPE_INT:
+            return std::to_string(static_cast<jvm_int_t>(value));
+        case jvm_type_t::JVM_TYPE_LONG:
+            return std::to_string(static_cast<jvm_long_t>(value));
+        case jvm_type_t::JVM_TYPE_FLOAT:
+            std::snprintf(buffer, sizeof(buffer), "%.9g", static_cast<double>(static_cast<jvm_float_t>(value)));
+            return buffer;
+        case jvm_type_t::JVM_TYPE_DOUBLE:
+            std::snprintf(buffer, sizeof(buffer), "%.17g", static_cast<jvm_double_t>(value));
+            return buffer;
+        case jvm_type_t::JVM_TYPE_OBJECT: {
+            jvm_id_t id = static_cast<jvm_id_t>(value);
+            if (id == 0) {
+                return "null";
+            }
+
+            std::snprintf(buffer, sizeof(buffer), "@0x%llx", static_cast<unsigned long long>(id));
+            auto item = objects.find_object(id);
+            if (item == nullptr) {
+                return buffer + 1;
+            }
+            if (item->type() == heap_item_t::String) {
+                return "\"" + static_cast<const string_info_t*>(*item)->value() + "\"";
+            }
+            return class_name(item, classes) + buffer;
+        }
+        default:
+            return "<unknown>";
+    }
+}
+
+std::string query_projection_t::class_name(const heap_item_ptr_t& item, const classes_index_t& classes) {
+    static const char* primitives[] = {
+        "unknown[]", "object[]", "boolean[]", "char[]", "float[]", "double[]", "byte[]", "short[]", "int[]", "long[]"
+    };
+
+    switch (item->type()) {
+        case heap_item_t::Class:
+            return "java.lang.Class";
+        case heap_item_t::Object:
+        case heap_item_t::String: {
+            auto cls = item->type() == heap_item_t::Object ? static_cast<const instance_info_t*>(*item)->get_class()
+                                                           : static_cast<const string_info_t*>(*item)->get_class();
+            return cls != nullptr ? cls->name() : "<unknown>";
+        }
+        case heap_item_t::PrimitivesArray: {
+            size_t type = static_cast<size_t>(static_cast<const primitives_array_info_t*>(*item)->item_type());
+            return type < sizeof(primitives) / sizeof(primitives[0]) ? primitives[type] : primitives[0];
+        }
+        case heap_item_t::ObjectsArray: {
+            auto cls = classes.find_class(static_cast<const objects_array_info_t*>(*item)->class_id());
+            return cls != nullptr ? static_cast<const class_info_t*>(*cls)->name() : "java.lang.Object[]";
+        }
+    }
+    return "<unknown>";
+}
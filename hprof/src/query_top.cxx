@@ -0,0 +1,191 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#include "query_top.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace hprof;
+
+query_top_t::query_top_t(const query_t& query, const objects_index_t& objects, const classes_index_t& classes, size_t count) :
+    _query(query), _objects(objects), _count(count) {
+    if (_query.order_field != nullptr) {
+        _query.order_field->bind(classes);
+    }
+}
+
+void query_top_t::add(size_t chunk, const query_cache_t::items_t& matches) {
+    if (_count == 0) {
+        return;
+    }
+
+    std::vector<entry_t> heap;
+    heap.reserve(std::min(_count, matches.size()));
+    for (size_t index = 0; index < matches.size(); ++index) {
+        push(entry_t { key_of(*matches[index]), chunk, index, matches[index] }, heap);
+    }
+
+    std::lock_guard<std::mutex> lock { _lock };
+    for (auto& entry : heap) {
+        push(std::move(entry), _heap);
+    }
+}
+
+void query_top_t::finish(query_cache_t::items_t& items) {
+    std::sort(std::begin(_heap), std::end(_heap), [this] (auto& left, auto& right) { return this->before(left, right); });
+    items.reserve(items.size() + _heap.size());
+    for (auto& entry : _heap) {
+        items.push_back(entry.item);
+    }
+    _heap.clear();
+}
+
+size_t query_top_t::shallow_size(const heap_item_ptr_t& item) {
+    switch (item->type()) {
+        case heap_item_t::Object:
+        case heap_item_t::String: {
+            const class_info_t* cls = item->type() == heap_item_t::Object ? static_cast<const instance_info_t*>(*item)->get_class()
+                                                                           : static_cast<const string_info_t*>(*item)->get_class();
+            if (cls == nullptr) {
+                return 0;
+            }
+            if (cls->instance_size() != 0) {
+                return cls->instance_size();
+            }
+
+            size_t size = 0;
+            for (; cls != nullptr; cls = cls->super()) {
+                size += cls->fields().data_size();
+            }
+            return size;
+        }
+        case heap_item_t::PrimitivesArray: {
+            auto array = static_cast<const primitives_array_info_t*>(*item);
+            return array->length() * jvm_type_t::size(array->item_type(), array->id_size());
+        }
+        case heap_item_t::ObjectsArray: {
+            auto array = static_cast<const objects_array_info_t*>(*item);
+            return array->length() * array->id_size();
+        }
+        case heap_item_t::Class:
+            break;
+    }
+    return 0;
+}
+
+query_top_t::key_t query_top_t::key_of(const heap_item_ptr_t& item) const {
+    key_t key { true, true, 0, 0 };
+    switch (_query.order) {
+        case query_t::ORDER_NONE:
+            break;
+        case query_t::ORDER_SIZE:
+            key.missing = false;
+            key.int_value = static_cast<int64_t>(shallow_size(item));
+            break;
+        case query_t::ORDER_LENGTH:
+            if (item->type() == heap_item_t::PrimitivesArray) {
+                key.missing = false;
+                key.int_value = static_cast<int64_t>(static_cast<const primitives_array_info_t*>(*item)->length());
+            } else if (item->type() == heap_item_t::ObjectsArray) {
+                key.missing = false;
+                key.int_value = static_cast<int64_t>(static_cast<const objects_array_info_t*>(*item)->length());
+            }
+            break;
+        case query_t::ORDER_FIELD:
+            if (_query.order_field == nullptr) {
+                break;
+            }
+            // The first numeric value of the path is the key, references have none
+            _query.order_field->apply(item, _objects, [&key] (auto& value) -> bool {
+                switch (value.type()) {
+                    case jvm_type_t::JVM_TYPE_BOOL:
+                        key.int_value = static_cast<jvm_bool_t>(value) ? 1 : 0;
+                        break;
+                    case jvm_type_t::JVM_TYPE_BYTE:
+                        key.int_value = static_cast<jvm_byte_t>(value);
+                        break;
+                    case jvm_type_t::JVM_TYPE_CHAR:
+                        key.int_value = static_cast<jvm_char_t>(value);
+                        break;
+                    case jvm_type_t::JVM_TYPE_SHORT:
+                        key.int_value = static_cast<jvm_short_t>(value);
+                        break;
+                    case jvm_type_t::JVM_TYPE_INT:
+                        key.int_value = static_cast<jvm_int_t>(value);
+                        break;
+                    case jvm_type_t::JVM_TYPE_LONG:
+                        key.int_value = static_cast<jvm_long_t>(value);
+                        break;
+                    case jvm_type_t::JVM_TYPE_FLOAT:
+                        key.integral = false;
+                        key.double_value = static_cast<jvm_float_t>(value);
+                        break;
+                    case jvm_type_t::JVM_TYPE_DOUBLE:
+                        key.integral = false;
+                        key.double_value = static_cast<jvm_double_t>(value);
+                        break;
+                    default:
+                        return true;
+                }
+                key.missing = false;
+                return false;
+            });
+            break;
+    }
+    return key;
+}
+
+bool query_top_t::before(const entry_t& left, const entry_t& right) const {
+    if (left.key.missing != right.key.missing) {
+        return right.key.missing;
+    }
+
+    if (!left.key.missing) {
+        int order = compare(left.key, right.key);
+        if (order != 0) {
+            return _query.order_descending ? order > 0 : order < 0;
+        }
+    }
+    return left.chunk != right.chunk ? left.chunk < right.chunk : left.index < right.index;
+}
+
+void query_top_t::push(entry_t&& entry, std::vector<entry_t>& heap) const {
+    auto worse = [this] (auto& left, auto& right) { return this->before(left, right); };
+    if (heap.size() < _count) {
+        heap.push_back(std::move(entry));
+        std::push_heap(std::begin(heap), std::end(heap), worse);
+    } else if (before(entry, heap.front())) {
+        std::pop_heap(std::begin(heap), std::end(heap), worse);
+        heap.back() = std::move(entry);
+        std::push_heap(std::begin(heap), std::end(heap), worse);
+    }
+}
+
+/// Integers are compared exactly, mixed values as long double. NaN goes after numbers like in java
+int query_top_t::compare(const key_t& left, const key_t& right) {
+    if (left.integral && right.integral) {
+        return left.int_value < right.int_value ? -1 : (left.int_value > right.int_value ? 1 : 0);
+    }
+
+    long double left_value = left.integral ? static_cast<long double>(left.int_value) : left.double_value;
+    long double right_value = right.integral ? static_cast<long double>(right.int_value) : right.double_value;
+    bool left_nan = std::isnan(left_value);
+    bool right_nan = std::isnan(right_value);
+    if (left_nan || right_nan) {
+        return left_nan == right_nan ? 0 : (left_nan ? 1 : -1);
+    }
+    return left_value < right_value ? -1 : (left_value > right_value ? 1 : 0);
+}
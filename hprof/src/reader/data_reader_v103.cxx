@@ -16,6 +16,7 @@
 #include "hprof.h"
 #include "heap_profile.h"
 #include "reader/data_reader_v103.h"
+#include "types/array_kernels.h"
 
 #include <vector>
 
@@ -76,8 +77,68 @@ static jvm_type_t to_jvm_type(hprof_type_t type) {
     return jvm_type_t::JVM_TYPE_UNKNOWN;
 }
 
-unique_ptr<heap_profile_t> data_reader_v103_t::build(hprof_istream_t& in, const progress_callback& callback) const {
+// NOTE: http://androidxref.com/7.1.1_r6/xref/art/runtime/hprof/hprof.cc#110
+enum hprof_heap_id_t : int32_t {
+    HPROF_HEAP_DEFAULT = 0,
+    HPROF_HEAP_ZYGOTE = 'Z',
+    HPROF_HEAP_APP = 'A',
+    HPROF_HEAP_IMAGE = 'I'
+};
+
+static int32_t to_heap_type(int32_t heap_id) {
+    switch (heap_id) {
+        case HPROF_HEAP_ZYGOTE: return heap_info_t::HEAP_ZYGOTE;
+        case HPROF_HEAP_APP: return heap_info_t::HEAP_APP;
+        case HPROF_HEAP_IMAGE: return heap_info_t::HEAP_IMAGE;
+        default: return heap_info_t::HEAP_UNKNOWN;
+    }
+}
+
+// Iterative DFS over the class tree, classes are numbered in pre-order and exit is the last number in the subtree
+static void number_class_hierarchy(const std::vector<heap_item_impl_ptr_t>& classes) {
+    std::unordered_map<const class_info_t*, std::vector<class_info_impl_t*>> children;
+    std::vector<class_info_impl_t*> roots;
+    for (auto& item : classes) {
+        auto cls = static_cast<class_info_impl_t *>(*item);
+        if (cls->super() == nullptr) {
+            roots.push_back(cls);
+        } else {
+            children[cls->super()].push_back(cls);
+        }
+    }
+
+    u_int32_t counter = 0;
+    std::vector<std::pair<class_info_impl_t*, size_t>> stack;
+    for (auto root : roots) {
+        root->set_hierarchy({ ++counter, 0 });
+        stack.emplace_back(root, 0);
+        while (!stack.empty()) {
+            auto& top = stack.back();
+            auto it = children.find(top.first);
+            if (it != std::end(children) && top.second < it->second.size()) {
+                auto child = it->second[top.second++];
+                child->set_hierarchy({ ++counter, 0 });
+                stack.emplace_back(child, 0);
+                continue;
+            }
+
+            top.first->set_hierarchy({ top.first->hierarchy().enter, counter });
+            stack.pop_back();
+        }
+    }
+}
+
+template<typename T>
+static void assign_heap_type(std::vector<T>& items, size_t& index, int32_t heap_type) {
+    for (; index < items.size(); ++index) {
+        items[index]->set_heap_type(heap_type);
+    }
+}
+
+unique_ptr<heap_profile_t> data_reader_v103_t::build(hprof_istream_t& in, const load_options_t& options, const progress_callback& callback) const {
     heap_profile_data_t data;
+    data.deduplicate_arrays = options.deduplicate_arrays;
+    data.heap_type = heap_info_t::HEAP_UNKNOWN;
     // Read id size
     data.id_size = static_cast<u_int8_t>(in.read_int32());
     if (data.id_size == 0 || in.eof()) {
@@ -118,7 +179,9 @@ unique_ptr<heap_profile_t> data_reader_v103_t::build(hprof_istream_t& in, const
     } while(read_result != DONE);
 
     auto result = std::make_unique<heap_profile_impl_t>(std::move(data.gc_roots));
-    if (!prepare(data, *result, callback)) return std::make_unique<heap_profile_impl_t>("Error occuried while perapring data");
+    if (!prepare(data, *result, options, callback)) return std::make_unique<heap_profile_impl_t>("Error occuried while perapring data");
+    result->set_query_threads(options.query_threads);
+    result->set_query_cache_size(options.query_cache_size);
     return result;
 }
 
@@ -226,8 +289,6 @@ bool data_reader_v103_t::read_stack_trace(hprof_section_reader& reader, heap_pro
 }
 
 bool data_reader_v103_t::read_heap_dump_segment(hprof_section_reader& reader, heap_profile_data_t& data) const {
-    heap_info_t heap_info { 0, 0 };
-
     size_t index_instances = data.instances.size();
     size_t index_primitives_arrays = data.primitives_arrays.size();
     size_t index_objects_arrays = data.objects_arrays.size();
@@ -260,7 +321,7 @@ bool data_reader_v103_t::read_heap_dump_segment(hprof_section_reader& reader, he
             }
 
             case DUMP_PRIMITIVE_ARRAY_DUMP: {
-                if (!read_primitives_array_dump(reader, data.id_size, data.primitives_arrays)) {
+                if (!read_primitives_array_dump(reader, data)) {
                     return false;
                 }
                 break;
@@ -276,8 +337,13 @@ bool data_reader_v103_t::read_heap_dump_segment(hprof_section_reader& reader, he
             }
 
             case DUMP_HEAP_DUMP_INFO: {
-                heap_info.type = reader.read_int32();
-                heap_info.name = reader.read_id();
+                // Heap info applies to all following records, up to the next heap info even in other segments
+                assign_heap_type(data.instances, index_instances, data.heap_type);
+                assign_heap_type(data.classes, index_classes, data.heap_type);
+                assign_heap_type(data.primitives_arrays, index_primitives_arrays, data.heap_type);
+                assign_heap_type(data.objects_arrays, index_objects_arrays, data.heap_type);
+                data.heap_type = to_heap_type(reader.read_int32());
+                /* jvm_id_t name = */reader.read_id();
                 break;
             }
 
@@ -289,21 +355,10 @@ bool data_reader_v103_t::read_heap_dump_segment(hprof_section_reader& reader, he
         }
     }
 
-    for (; index_instances < data.instances.size(); ++index_instances) {
-        data.instances[index_instances]->set_heap_type(heap_info.type);
-    }
-
-    for (; index_classes < data.classes.size(); ++index_classes) {
-        data.classes[index_classes]->set_heap_type(heap_info.type);
-    }
-
-    for (; index_primitives_arrays < data.primitives_arrays.size(); ++index_primitives_arrays) {
-        data.primitives_arrays[index_primitives_arrays]->set_heap_type(heap_info.type);
-    }
-
-    for (; index_objects_arrays < data.objects_arrays.size(); ++index_objects_arrays) {
-        data.objects_arrays[index_objects_arrays]->set_heap_type(heap_info.type);
-    }
+    assign_heap_type(data.instances, index_instances, data.heap_type);
+    assign_heap_type(data.classes, index_classes, data.heap_type);
+    assign_heap_type(data.primitives_arrays, index_primitives_arrays, data.heap_type);
+    assign_heap_type(data.objects_arrays, index_objects_arrays, data.heap_type);
 
     return true;
 }
@@ -439,7 +494,7 @@ bool data_reader_v103_t::read_objects_array_dump(hprof_section_reader& reader, u
 }
 
 // NOTE: Ref: http://androidxref.com/7.1.1_r6/xref/art/runtime/hprof/hprof.cc#1283
-bool data_reader_v103_t::read_primitives_array_dump(hprof_section_reader& reader, u_int8_t id_size, std::vector<primitives_array_info_impl_ptr_t>& objects) const {
+bool data_reader_v103_t::read_primitives_array_dump(hprof_section_reader& reader, heap_profile_data_t& data) const {
     jvm_id_t object_id = reader.read_id();
     /*  int32_t stack_trace_id =*/ reader.read_int32();
     size_t length = static_cast<size_t>(reader.read_int32());
@@ -447,19 +502,52 @@ bool data_reader_v103_t::read_primitives_array_dump(hprof_section_reader& reader
 
     if (reader.is_error_occurred()) return false;
 
-    size_t array_size = length * get_field_size(type, id_size);
+    size_t array_size = length * get_field_size(type, data.id_size);
 
-    auto result = primitives_array_info_impl_t::create(id_size, object_id,  to_jvm_type(type), length, array_size);
-    if (result == nullptr) return false;
+    if (!data.deduplicate_arrays || array_size == 0) {
+        auto result = primitives_array_info_impl_t::create(data.id_size, object_id,  to_jvm_type(type), length, array_size);
+        if (result == nullptr) return false;
 
-    reader.read_bytes(result->data(), array_size);
+        reader.read_bytes(result->data(), array_size);
+        if (reader.is_error_occurred()) return false;
+
+        data.primitives_arrays.push_back(std::move(result));
+        return true;
+    }
+
+    if (data.payload_buffer.size() < array_size) {
+        data.payload_buffer.resize(array_size);
+    }
+
+    reader.read_bytes(data.payload_buffer.data(), array_size);
     if (reader.is_error_occurred()) return false;
 
-    objects.push_back(std::move(result));
+    auto payload = find_shared_payload(data, data.payload_buffer.data(), array_size);
+    if (payload == nullptr) return false;
+
+    auto result = primitives_array_info_impl_t::create(data.id_size, object_id,  to_jvm_type(type), length, *payload, array_size);
+    if (result == nullptr) return false;
 
+    data.primitives_arrays.push_back(std::move(result));
     return true;
 }
 
+const payload_block_t* data_reader_v103_t::find_shared_payload(heap_profile_data_t& data, const u_int8_t* payload, size_t size) const {
+    u_int64_t hash = array_kernels_t::hash(payload, size);
+
+    auto range = data.payloads.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second.size == size && std::memcmp(it->second.block.data(), payload, size) == 0) {
+            return &it->second.block;
+        }
+    }
+
+    payload_block_t block { payload, size };
+    if (block.data() == nullptr) return nullptr;
+
+    return &data.payloads.emplace(hash, shared_payload_t { block, size })->second.block;
+}
+
 bool data_reader_v103_t::read_gc_root(hprof_gc_tag_t subtype, hprof_section_reader& reader, std::vector<gc_root_impl_ptr_t>& roots) const {
     switch (subtype) {
         // NOTE: http://androidxref.com/7.1.1_r6/xref/art/runtime/hprof/hprof.cc#969
@@ -616,12 +704,13 @@ bool data_reader_v103_t::read_gc_root(hprof_gc_tag_t subtype, hprof_section_read
 }
 
 // TODO: set roots for objects
-bool data_reader_v103_t::prepare(heap_profile_data_t& data, heap_profile_impl_t& hprof, const progress_callback& callback) const {
+bool data_reader_v103_t::prepare(heap_profile_data_t& data, heap_profile_impl_t& hprof, const load_options_t& options, const progress_callback& callback) const {
     jvm_id_t string_class_id = 0;
     const u_int32_t total = data.classes.size() * 2 + data.primitives_arrays.size() + data.objects_arrays.size() + data.instances.size();
     u_int32_t ready = 0;
 
     callback(ready, total);
+    auto strings = std::make_shared<strings_cache_t>(options.strings_cache_size);
     std::vector<heap_item_impl_ptr_t> classes;
     // Attach class name to each class and build map
     for (auto& klass : data.classes) {
@@ -659,6 +748,8 @@ bool data_reader_v103_t::prepare(heap_profile_data_t& data, heap_profile_impl_t&
         callback(++ready, total);
     }
 
+    number_class_hierarchy(classes);
+
     for (auto& array : data.primitives_arrays) {
         jvm_id_t id = array->id();
         hprof.add(id, std::make_shared<heap_item_impl_t>(std::move(array)));
@@ -674,9 +765,8 @@ bool data_reader_v103_t::prepare(heap_profile_data_t& data, heap_profile_impl_t&
 
         jvm_id_t id = object->id();
         if (object->class_id() == string_class_id) {
-            auto str = string_info_impl_t::create(*object, hprof);
+            auto str = string_info_impl_t::create(std::move(object), hprof, strings);
             hprof.add(id, std::make_shared<heap_item_impl_t>(std::move(str)));
-            object.reset(nullptr);
         } else {
             hprof.add(id, std::make_shared<heap_item_impl_t>(std::move(object)));
         }
@@ -689,6 +779,7 @@ bool data_reader_v103_t::prepare(heap_profile_data_t& data, heap_profile_impl_t&
         callback(++ready, total);
     }
 
+    hprof.build_indexes();
     callback(++ready, total);
     return true;
 }
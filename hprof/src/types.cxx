@@ -15,8 +15,49 @@
 ///
 #include "types.h"
 
+#include <algorithm>
+#include <cctype>
+
 using namespace hprof;
 
+namespace {
+    const char* g_heap_names[] = { "unknown", "app", "system", "zygote", "image" };
+}
+
+void class_hierarchy_t::merge(std::vector<class_hierarchy_t>& hierarchies) {
+    std::sort(hierarchies.begin(), hierarchies.end(), [] (auto& left, auto& right) { return left.enter < right.enter; });
+    size_t last = 0;
+    for (size_t index = 1; index < hierarchies.size(); ++index) {
+        if (hierarchies[index].enter <= hierarchies[last].exit + 1) {
+            hierarchies[last].exit = std::max(hierarchies[last].exit, hierarchies[index].exit);
+        } else {
+            hierarchies[++last] = hierarchies[index];
+        }
+    }
+    if (!hierarchies.empty()) {
+        hierarchies.resize(last + 1);
+    }
+}
+
+const char* heap_info_t::name_of(int32_t type) {
+    if (type < HEAP_UNKNOWN || type > HEAP_IMAGE) {
+        return g_heap_names[HEAP_UNKNOWN];
+    }
+    return g_heap_names[type];
+}
+
+int32_t heap_info_t::by_name(const std::string& name) {
+    std::string lower { name };
+    std::transform(lower.begin(), lower.end(), lower.begin(), [] (char chr) { return static_cast<char>(std::tolower(chr)); });
+    for (int32_t type = HEAP_UNKNOWN; type <= HEAP_IMAGE; ++type) {
+        // no dump format maps its heaps to the system one, queries for it would be always empty
+        if (type != HEAP_SYSTEM && lower == g_heap_names[type]) {
+            return type;
+        }
+    }
+    return -1;
+}
+
 gc_root_t::~gc_root_t() {}
 
 object_info_t::~object_info_t() {}
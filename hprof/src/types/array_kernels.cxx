@@ -0,0 +1,764 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#include "types/array_kernels.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HPROF_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+using namespace hprof;
+
+namespace {
+    template<typename T>
+    inline T load_be(const u_int8_t* data) {
+        typename std::make_unsigned<T>::type value = 0;
+        for (size_t index = 0; index < sizeof(T); ++index) {
+            value = static_cast<decltype(value)>((value << 8) | data[index]);
+        }
+        return static_cast<T>(value);
+    }
+
+    template<>
+    inline jvm_float_t load_be<jvm_float_t>(const u_int8_t* data) {
+        u_int32_t bits = load_be<u_int32_t>(data);
+        jvm_float_t value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    template<>
+    inline jvm_double_t load_be<jvm_double_t>(const u_int8_t* data) {
+        u_int64_t bits = load_be<u_int64_t>(data);
+        jvm_double_t value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    /// Continues summary over tail items, start is true when nothing was summarized yet
+    template<typename T>
+    void summarize_floating_scalar(const u_int8_t* data, size_t length, array_summary_t<double>& summary, bool start) {
+        for (size_t index = 0; index < length; ++index) {
+            double value = static_cast<double>(load_be<T>(data + index * sizeof(T)));
+            if (start) {
+                summary.min = summary.max = summary.sum = value;
+                start = false;
+                continue;
+            }
+            if (value < summary.min) summary.min = value;
+            if (value > summary.max) summary.max = value;
+            summary.sum += value;
+        }
+    }
+
+    template<typename T>
+    void summarize_scalar(const u_int8_t* data, size_t length, array_summary_t<int64_t>& summary, bool start) {
+        // sum is allowed to wrap around as java does
+        u_int64_t sum = start ? 0 : static_cast<u_int64_t>(summary.sum);
+        for (size_t index = 0; index < length; ++index) {
+            int64_t value = static_cast<int64_t>(load_be<T>(data + index * sizeof(T)));
+            if (start) {
+                summary.min = summary.max = value;
+                start = false;
+            } else {
+                if (value < summary.min) summary.min = value;
+                if (value > summary.max) summary.max = value;
+            }
+            sum += static_cast<u_int64_t>(value);
+        }
+        summary.sum = static_cast<int64_t>(sum);
+    }
+
+    template<typename T, size_t N>
+    void reduce_min_max(const T (&mins)[N], const T (&maxs)[N], int64_t& min, int64_t& max) {
+        min = *std::min_element(std::begin(mins), std::end(mins));
+        max = *std::max_element(std::begin(maxs), std::end(maxs));
+    }
+
+#if defined(HPROF_KERNELS_X86)
+    /// Vectorized kernels process whole vectors only and return the number of items consumed,
+    /// the rest of the array is finished by the scalar code. Unsigned items are shifted into the
+    /// signed range with xor so the same signed min/max instructions work for both.
+
+    __attribute__((target("sse4.1")))
+    bool is_zeroed_sse41(const u_int8_t* data, size_t data_size) {
+        size_t offset = 0;
+        for (; offset + 64 <= data_size; offset += 64) {
+            __m128i value = _mm_or_si128(
+                _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + offset)),
+                             _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + offset + 16))),
+                _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + offset + 32)),
+                             _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + offset + 48))));
+            if (!_mm_testz_si128(value, value)) {
+                return false;
+            }
+        }
+        for (; offset + 16 <= data_size; offset += 16) {
+            __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + offset));
+            if (!_mm_testz_si128(value, value)) {
+                return false;
+            }
+        }
+        for (; offset < data_size; ++offset) {
+            if (data[offset] != 0) return false;
+        }
+        return true;
+    }
+
+    __attribute__((target("avx2")))
+    bool is_zeroed_avx2(const u_int8_t* data, size_t data_size) {
+        size_t offset = 0;
+        for (; offset + 128 <= data_size; offset += 128) {
+            __m256i value = _mm256_or_si256(
+                _mm256_or_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + offset)),
+                                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + offset + 32))),
+                _mm256_or_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + offset + 64)),
+                                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + offset + 96))));
+            if (!_mm256_testz_si256(value, value)) {
+                return false;
+            }
+        }
+        for (; offset + 32 <= data_size; offset += 32) {
+            __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + offset));
+            if (!_mm256_testz_si256(value, value)) {
+                return false;
+            }
+        }
+        return is_zeroed_sse41(data + offset, data_size - offset);
+    }
+
+    /// Pattern holds the first item repeated, item_size must divide the vector size
+    __attribute__((target("sse4.1")))
+    size_t is_constant_sse41(const u_int8_t* data, size_t data_size, const u_int8_t* pattern, bool& constant) {
+        const __m128i expected = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pattern));
+        size_t offset = 0;
+        for (; offset + 16 <= data_size; offset += 16) {
+            __m128i diff = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + offset)), expected);
+            if (!_mm_testz_si128(diff, diff)) {
+                constant = false;
+                return offset;
+            }
+        }
+        constant = true;
+        return offset;
+    }
+
+    __attribute__((target("avx2")))
+    size_t is_constant_avx2(const u_int8_t* data, size_t data_size, const u_int8_t* pattern, bool& constant) {
+        const __m256i expected = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pattern));
+        size_t offset = 0;
+        for (; offset + 32 <= data_size; offset += 32) {
+            __m256i diff = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + offset)), expected);
+            if (!_mm256_testz_si256(diff, diff)) {
+                constant = false;
+                return offset;
+            }
+        }
+        constant = true;
+        return offset;
+    }
+
+    /// Pattern holds the item repeated, lanes of the item width are compared so matches stay item aligned
+    __attribute__((target("sse4.1")))
+    size_t contains_item_sse41(const u_int8_t* data, size_t data_size, const u_int8_t* pattern, size_t item_size, bool& found) {
+        const __m128i expected = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pattern));
+        size_t offset = 0;
+        for (; offset + 16 <= data_size; offset += 16) {
+            __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + offset));
+            __m128i equal;
+            switch (item_size) {
+                case 1: equal = _mm_cmpeq_epi8(value, expected); break;
+                case 2: equal = _mm_cmpeq_epi16(value, expected); break;
+                case 4: equal = _mm_cmpeq_epi32(value, expected); break;
+                default: equal = _mm_cmpeq_epi64(value, expected); break;
+            }
+            if (_mm_movemask_epi8(equal) != 0) {
+                found = true;
+                return offset;
+            }
+        }
+        found = false;
+        return offset;
+    }
+
+    __attribute__((target("avx2")))
+    size_t contains_item_avx2(const u_int8_t* data, size_t data_size, const u_int8_t* pattern, size_t item_size, bool& found) {
+        const __m256i expected = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pattern));
+        size_t offset = 0;
+        for (; offset + 32 <= data_size; offset += 32) {
+            __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + offset));
+            __m256i equal;
+            switch (item_size) {
+                case 1: equal = _mm256_cmpeq_epi8(value, expected); break;
+                case 2: equal = _mm256_cmpeq_epi16(value, expected); break;
+                case 4: equal = _mm256_cmpeq_epi32(value, expected); break;
+                default: equal = _mm256_cmpeq_epi64(value, expected); break;
+            }
+            if (_mm256_movemask_epi8(equal) != 0) {
+                found = true;
+                return offset;
+            }
+        }
+        found = false;
+        return offset;
+    }
+
+    __attribute__((target("sse4.1")))
+    size_t summarize_8bit_sse41(const u_int8_t* data, size_t length, bool is_signed, array_summary_t<int64_t>& summary) {
+        const size_t count = length / 16 * 16;
+        if (count == 0) {
+            return 0;
+        }
+
+        const __m128i bias = _mm_set1_epi8(static_cast<char>(0x80));
+        const __m128i to_signed = is_signed ? _mm_setzero_si128() : bias;
+        __m128i min = _mm_set1_epi8(std::numeric_limits<int8_t>::max());
+        __m128i max = _mm_set1_epi8(std::numeric_limits<int8_t>::min());
+        __m128i sum = _mm_setzero_si128();
+        for (size_t offset = 0; offset < count; offset += 16) {
+            __m128i value = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + offset)), to_signed);
+            min = _mm_min_epi8(min, value);
+            max = _mm_max_epi8(max, value);
+            sum = _mm_add_epi64(sum, _mm_sad_epu8(_mm_xor_si128(value, bias), _mm_setzero_si128()));
+        }
+
+        int8_t mins[16], maxs[16];
+        u_int64_t sums[2];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(mins), min);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(maxs), max);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(sums), sum);
+
+        int64_t shift = is_signed ? 0 : 128;
+        reduce_min_max(mins, maxs, summary.min, summary.max);
+        summary.min += shift;
+        summary.max += shift;
+        summary.sum = static_cast<int64_t>(sums[0] + sums[1] - (is_signed ? 128 * count : 0));
+        return count;
+    }
+
+    __attribute__((target("avx2")))
+    size_t summarize_8bit_avx2(const u_int8_t* data, size_t length, bool is_signed, array_summary_t<int64_t>& summary) {
+        const size_t count = length / 32 * 32;
+        if (count == 0) {
+            return 0;
+        }
+
+        const __m256i bias = _mm256_set1_epi8(static_cast<char>(0x80));
+        const __m256i to_signed = is_signed ? _mm256_setzero_si256() : bias;
+        __m256i min = _mm256_set1_epi8(std::numeric_limits<int8_t>::max());
+        __m256i max = _mm256_set1_epi8(std::numeric_limits<int8_t>::min());
+        __m256i sum = _mm256_setzero_si256();
+        for (size_t offset = 0; offset < count; offset += 32) {
+            __m256i value = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + offset)), to_signed);
+            min = _mm256_min_epi8(min, value);
+            max = _mm256_max_epi8(max, value);
+            sum = _mm256_add_epi64(sum, _mm256_sad_epu8(_mm256_xor_si256(value, bias), _mm256_setzero_si256()));
+        }
+
+        int8_t mins[32], maxs[32];
+        u_int64_t sums[4];
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(mins), min);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(maxs), max);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(sums), sum);
+
+        int64_t shift = is_signed ? 0 : 128;
+        reduce_min_max(mins, maxs, summary.min, summary.max);
+        summary.min += shift;
+        summary.max += shift;
+        summary.sum = static_cast<int64_t>(sums[0] + sums[1] + sums[2] + sums[3] - (is_signed ? 128 * count : 0));
+        return count;
+    }
+
+    // madd produces 32 bit pair sums, flush them to 64 bit before they are able to overflow
+    const size_t SUM_16BIT_FLUSH_PERIOD = 16384;
+
+    __attribute__((target("sse4.1")))
+    size_t summarize_16bit_sse41(const u_int8_t* data, size_t length, bool is_signed, array_summary_t<int64_t>& summary) {
+        const size_t count = length / 8 * 8;
+        if (count == 0) {
+            return 0;
+        }
+
+        const __m128i to_signed = is_signed ? _mm_setzero_si128() : _mm_set1_epi16(static_cast<short>(0x8000));
+        const __m128i ones = _mm_set1_epi16(1);
+        __m128i min = _mm_set1_epi16(std::numeric_limits<int16_t>::max());
+        __m128i max = _mm_set1_epi16(std::numeric_limits<int16_t>::min());
+        __m128i sum32 = _mm_setzero_si128();
+        __m128i sum64 = _mm_setzero_si128();
+        for (size_t index = 0, period = 0; index < count; index += 8) {
+            __m128i raw = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + index * 2));
+            __m128i value = _mm_xor_si128(_mm_or_si128(_mm_slli_epi16(raw, 8), _mm_srli_epi16(raw, 8)), to_signed);
+            min = _mm_min_epi16(min, value);
+            max = _mm_max_epi16(max, value);
+            sum32 = _mm_add_epi32(sum32, _mm_madd_epi16(value, ones));
+            if (++period == SUM_16BIT_FLUSH_PERIOD || index + 8 == count) {
+                sum64 = _mm_add_epi64(sum64, _mm_cvtepi32_epi64(sum32));
+                sum64 = _mm_add_epi64(sum64, _mm_cvtepi32_epi64(_mm_srli_si128(sum32, 8)));
+                sum32 = _mm_setzero_si128();
+                period = 0;
+            }
+        }
+
+        int16_t mins[8], maxs[8];
+        int64_t sums[2];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(mins), min);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(maxs), max);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(sums), sum64);
+
+        int64_t shift = is_signed ? 0 : 32768;
+        reduce_min_max(mins, maxs, summary.min, summary.max);
+        summary.min += shift;
+        summary.max += shift;
+        summary.sum = sums[0] + sums[1] + shift * static_cast<int64_t>(count);
+        return count;
+    }
+
+    __attribute__((target("avx2")))
+    size_t summarize_16bit_avx2(const u_int8_t* data, size_t length, bool is_signed, array_summary_t<int64_t>& summary) {
+        const size_t count = length / 16 * 16;
+        if (count == 0) {
+            return 0;
+        }
+
+        const __m256i to_signed = is_signed ? _mm256_setzero_si256() : _mm256_set1_epi16(static_cast<short>(0x8000));
+        const __m256i ones = _mm256_set1_epi16(1);
+        __m256i min = _mm256_set1_epi16(std::numeric_limits<int16_t>::max());
+        __m256i max = _mm256_set1_epi16(std::numeric_limits<int16_t>::min());
+        __m256i sum32 = _mm256_setzero_si256();
+        __m256i sum64 = _mm256_setzero_si256();
+        for (size_t index = 0, period = 0; index < count; index += 16) {
+            __m256i raw = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + index * 2));
+            __m256i value = _mm256_xor_si256(_mm256_or_si256(_mm256_slli_epi16(raw, 8), _mm256_srli_epi16(raw, 8)), to_signed);
+            min = _mm256_min_epi16(min, value);
+            max = _mm256_max_epi16(max, value);
+            sum32 = _mm256_add_epi32(sum32, _mm256_madd_epi16(value, ones));
+            if (++period == SUM_16BIT_FLUSH_PERIOD || index + 16 == count) {
+                sum64 = _mm256_add_epi64(sum64, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(sum32)));
+                sum64 = _mm256_add_epi64(sum64, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(sum32, 1)));
+                sum32 = _mm256_setzero_si256();
+                period = 0;
+            }
+        }
+
+        int16_t mins[16], maxs[16];
+        int64_t sums[4];
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(mins), min);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(maxs), max);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(sums), sum64);
+
+        int64_t shift = is_signed ? 0 : 32768;
+        reduce_min_max(mins, maxs, summary.min, summary.max);
+        summary.min += shift;
+        summary.max += shift;
+        summary.sum = sums[0] + sums[1] + sums[2] + sums[3] + shift * static_cast<int64_t>(count);
+        return count;
+    }
+
+    __attribute__((target("sse4.1")))
+    size_t summarize_32bit_sse41(const u_int8_t* data, size_t length, array_summary_t<int64_t>& summary) {
+        const size_t count = length / 4 * 4;
+        if (count == 0) {
+            return 0;
+        }
+
+        const __m128i swap = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+        __m128i min = _mm_set1_epi32(std::numeric_limits<int32_t>::max());
+        __m128i max = _mm_set1_epi32(std::numeric_limits<int32_t>::min());
+        __m128i sum = _mm_setzero_si128();
+        for (size_t index = 0; index < count; index += 4) {
+            __m128i value = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + index * 4)), swap);
+            min = _mm_min_epi32(min, value);
+            max = _mm_max_epi32(max, value);
+            sum = _mm_add_epi64(sum, _mm_cvtepi32_epi64(value));
+            sum = _mm_add_epi64(sum, _mm_cvtepi32_epi64(_mm_srli_si128(value, 8)));
+        }
+
+        int32_t mins[4], maxs[4];
+        u_int64_t sums[2];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(mins), min);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(maxs), max);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(sums), sum);
+
+        reduce_min_max(mins, maxs, summary.min, summary.max);
+        summary.sum = static_cast<int64_t>(sums[0] + sums[1]);
+        return count;
+    }
+
+    __attribute__((target("avx2")))
+    size_t summarize_32bit_avx2(const u_int8_t* data, size_t length, array_summary_t<int64_t>& summary) {
+        const size_t count = length / 8 * 8;
+        if (count == 0) {
+            return 0;
+        }
+
+        const __m256i swap = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                              3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+        __m256i min = _mm256_set1_epi32(std::numeric_limits<int32_t>::max());
+        __m256i max = _mm256_set1_epi32(std::numeric_limits<int32_t>::min());
+        __m256i sum = _mm256_setzero_si256();
+        for (size_t index = 0; index < count; index += 8) {
+            __m256i value = _mm256_shuffle_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + index * 4)), swap);
+            min = _mm256_min_epi32(min, value);
+            max = _mm256_max_epi32(max, value);
+            sum = _mm256_add_epi64(sum, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(value)));
+            sum = _mm256_add_epi64(sum, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(value, 1)));
+        }
+
+        int32_t mins[8], maxs[8];
+        u_int64_t sums[4];
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(mins), min);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(maxs), max);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(sums), sum);
+
+        reduce_min_max(mins, maxs, summary.min, summary.max);
+        summary.sum = static_cast<int64_t>(sums[0] + sums[1] + sums[2] + sums[3]);
+        return count;
+    }
+#endif
+
+    array_kernels_t::isa_t detect_isa() {
+#if defined(HPROF_KERNELS_X86)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return array_kernels_t::ISA_AVX2;
+        }
+        if (__builtin_cpu_supports("sse4.1")) {
+            return array_kernels_t::ISA_SSE41;
+        }
+#endif
+        return array_kernels_t::ISA_SCALAR;
+    }
+
+    array_kernels_t::isa_t& current_isa() {
+        static array_kernels_t::isa_t isa = detect_isa();
+        return isa;
+    }
+
+    size_t summarize_8bit(const u_int8_t* data, size_t length, bool is_signed, array_summary_t<int64_t>& summary) {
+        switch (current_isa()) {
+#if defined(HPROF_KERNELS_X86)
+            case array_kernels_t::ISA_AVX2:
+                return summarize_8bit_avx2(data, length, is_signed, summary);
+            case array_kernels_t::ISA_SSE41:
+                return summarize_8bit_sse41(data, length, is_signed, summary);
+#endif
+            default:
+                return 0;
+        }
+    }
+
+    size_t summarize_16bit(const u_int8_t* data, size_t length, bool is_signed, array_summary_t<int64_t>& summary) {
+        switch (current_isa()) {
+#if defined(HPROF_KERNELS_X86)
+            case array_kernels_t::ISA_AVX2:
+                return summarize_16bit_avx2(data, length, is_signed, summary);
+            case array_kernels_t::ISA_SSE41:
+                return summarize_16bit_sse41(data, length, is_signed, summary);
+#endif
+            default:
+                return 0;
+        }
+    }
+
+    size_t summarize_32bit(const u_int8_t* data, size_t length, array_summary_t<int64_t>& summary) {
+        switch (current_isa()) {
+#if defined(HPROF_KERNELS_X86)
+            case array_kernels_t::ISA_AVX2:
+                return summarize_32bit_avx2(data, length, summary);
+            case array_kernels_t::ISA_SSE41:
+                return summarize_32bit_sse41(data, length, summary);
+#endif
+            default:
+                return 0;
+        }
+    }
+
+    template<typename T>
+    bool summarize_integral(const u_int8_t* data, size_t length, size_t done, array_summary_t<int64_t>& summary) {
+        summarize_scalar<T>(data + done * sizeof(T), length - done, summary, done == 0);
+        return true;
+    }
+
+    template<typename T>
+    void fill_histogram(const u_int8_t* data, size_t length, int64_t min, int64_t max, std::vector<size_t>& bins) {
+        // wraps to zero only for a single bin over the whole long range
+        u_int64_t width = (static_cast<u_int64_t>(max) - static_cast<u_int64_t>(min)) / bins.size() + 1;
+        for (size_t index = 0; index < length; ++index) {
+            int64_t value = static_cast<int64_t>(load_be<T>(data + index * sizeof(T)));
+            if (value < min || value > max) {
+                continue;
+            }
+            ++bins[width == 0 ? 0 : (static_cast<u_int64_t>(value) - static_cast<u_int64_t>(min)) / width];
+        }
+    }
+}
+
+bool array_kernels_t::is_zeroed(const u_int8_t* data, size_t data_size) {
+    switch (current_isa()) {
+#if defined(HPROF_KERNELS_X86)
+        case ISA_AVX2:
+            return is_zeroed_avx2(data, data_size);
+        case ISA_SSE41:
+            return is_zeroed_sse41(data, data_size);
+#endif
+        default:
+            break;
+    }
+
+    for (size_t offset = 0; offset < data_size; ++offset) {
+        if (data[offset] != 0) return false;
+    }
+    return true;
+}
+
+bool array_kernels_t::is_constant(const u_int8_t* data, size_t data_size, size_t item_size) {
+    if (item_size == 0 || data_size <= item_size) {
+        return true;
+    }
+
+    size_t offset = 0;
+#if defined(HPROF_KERNELS_X86)
+    if (32 % item_size == 0 && current_isa() != ISA_SCALAR) {
+        u_int8_t pattern[32];
+        for (size_t index = 0; index < sizeof(pattern); ++index) {
+            pattern[index] = data[index % item_size];
+        }
+
+        bool constant = true;
+        offset = current_isa() == ISA_AVX2 ? is_constant_avx2(data, data_size, pattern, constant)
+                                           : is_constant_sse41(data, data_size, pattern, constant);
+        if (!constant) {
+            return false;
+        }
+    }
+#endif
+    // every item equals the first one when the payload equals itself shifted by one item
+    if (offset == 0) {
+        return std::memcmp(data, data + item_size, data_size - item_size) == 0;
+    }
+    return std::memcmp(data + offset - item_size, data + offset, data_size - offset) == 0;
+}
+
+bool array_kernels_t::summarize(jvm_type_t type, const u_int8_t* data, size_t length, array_summary_t<int64_t>& summary) {
+    if (length == 0) {
+        return false;
+    }
+
+    switch (type) {
+        case jvm_type_t::JVM_TYPE_BOOL:
+            return summarize_integral<jvm_bool_t>(data, length, summarize_8bit(data, length, false, summary), summary);
+        case jvm_type_t::JVM_TYPE_BYTE:
+            return summarize_integral<jvm_byte_t>(data, length, summarize_8bit(data, length, true, summary), summary);
+        case jvm_type_t::JVM_TYPE_CHAR:
+            return summarize_integral<jvm_char_t>(data, length, summarize_16bit(data, length, false, summary), summary);
+        case jvm_type_t::JVM_TYPE_SHORT:
+            return summarize_integral<jvm_short_t>(data, length, summarize_16bit(data, length, true, summary), summary);
+        case jvm_type_t::JVM_TYPE_INT:
+            return summarize_integral<jvm_int_t>(data, length, summarize_32bit(data, length, summary), summary);
+        case jvm_type_t::JVM_TYPE_LONG:
+            return summarize_integral<jvm_long_t>(data, length, 0, summary);
+        default:
+            return false;
+    }
+}
+
+bool array_kernels_t::summarize(jvm_type_t type, const u_int8_t* data, size_t length, array_summary_t<double>& summary) {
+    if (length == 0) {
+        return false;
+    }
+
+    switch (type) {
+        case jvm_type_t::JVM_TYPE_FLOAT:
+            summarize_floating_scalar<jvm_float_t>(data, length, summary, true);
+            return true;
+        case jvm_type_t::JVM_TYPE_DOUBLE:
+            summarize_floating_scalar<jvm_double_t>(data, length, summary, true);
+            return true;
+        default: {
+            array_summary_t<int64_t> integral;
+            if (!summarize(type, data, length, integral)) {
+                return false;
+            }
+            summary.min = static_cast<double>(integral.min);
+            summary.max = static_cast<double>(integral.max);
+            summary.sum = static_cast<double>(integral.sum);
+            return true;
+        }
+    }
+}
+
+void array_kernels_t::bytes_histogram(const u_int8_t* data, size_t data_size, size_t (&bins)[256]) {
+    // several partial histograms avoid stalls on repeated increments of the same counter
+    size_t partial[4][256] = {};
+    size_t offset = 0;
+    for (; offset + 4 <= data_size; offset += 4) {
+        ++partial[0][data[offset]];
+        ++partial[1][data[offset + 1]];
+        ++partial[2][data[offset + 2]];
+        ++partial[3][data[offset + 3]];
+    }
+    for (; offset < data_size; ++offset) {
+        ++partial[0][data[offset]];
+    }
+
+    for (size_t index = 0; index < 256; ++index) {
+        bins[index] = partial[0][index] + partial[1][index] + partial[2][index] + partial[3][index];
+    }
+}
+
+bool array_kernels_t::histogram(jvm_type_t type, const u_int8_t* data, size_t length, int64_t min, int64_t max, std::vector<size_t>& bins) {
+    if (bins.empty() || min > max) {
+        return false;
+    }
+
+    std::fill(std::begin(bins), std::end(bins), 0);
+    switch (type) {
+        case jvm_type_t::JVM_TYPE_BOOL:
+            fill_histogram<jvm_bool_t>(data, length, min, max, bins);
+            return true;
+        case jvm_type_t::JVM_TYPE_BYTE:
+            fill_histogram<jvm_byte_t>(data, length, min, max, bins);
+            return true;
+        case jvm_type_t::JVM_TYPE_CHAR:
+            fill_histogram<jvm_char_t>(data, length, min, max, bins);
+            return true;
+        case jvm_type_t::JVM_TYPE_SHORT:
+            fill_histogram<jvm_short_t>(data, length, min, max, bins);
+            return true;
+        case jvm_type_t::JVM_TYPE_INT:
+            fill_histogram<jvm_int_t>(data, length, min, max, bins);
+            return true;
+        case jvm_type_t::JVM_TYPE_LONG:
+            fill_histogram<jvm_long_t>(data, length, min, max, bins);
+            return true;
+        default:
+            return false;
+    }
+}
+
+double array_kernels_t::dominant_share(jvm_type_t type, const u_int8_t* data, size_t length) {
+    jvm_type_t bits = type;
+    if (type == jvm_type_t::JVM_TYPE_FLOAT) {
+        bits = jvm_type_t::JVM_TYPE_INT;
+    } else if (type == jvm_type_t::JVM_TYPE_DOUBLE) {
+        bits = jvm_type_t::JVM_TYPE_LONG;
+    }
+
+    array_summary_t<int64_t> summary;
+    if (!summarize(bits, data, length, summary)) {
+        return 0;
+    }
+
+    // A value over half of the items keeps its bucket the fullest one on every narrowing
+    int64_t min = summary.min;
+    int64_t max = summary.max;
+    size_t count = length;
+    std::vector<size_t> bins;
+    while (min != max) {
+        u_int64_t range = static_cast<u_int64_t>(max) - static_cast<u_int64_t>(min);
+        bins.resize(range < 255 ? static_cast<size_t>(range) + 1 : 256);
+        histogram(bits, data, length, min, max, bins);
+
+        auto fullest = std::max_element(std::begin(bins), std::end(bins));
+        count = *fullest;
+        if (count * 2 <= length) {
+            return 0;
+        }
+
+        // same bucket width as fill_histogram
+        u_int64_t width = range / bins.size() + 1;
+        u_int64_t first = static_cast<u_int64_t>(min) + static_cast<u_int64_t>(fullest - std::begin(bins)) * width;
+        u_int64_t last = first + (width - 1);
+        min = static_cast<int64_t>(first);
+        if (last - static_cast<u_int64_t>(min) < static_cast<u_int64_t>(max) - static_cast<u_int64_t>(min)) {
+            max = static_cast<int64_t>(last);
+        }
+    }
+    return static_cast<double>(count) / static_cast<double>(length);
+}
+
+bool array_kernels_t::contains_item(const u_int8_t* data, size_t length, const u_int8_t* item, size_t item_size) {
+    if (item_size != 1 && item_size != 2 && item_size != 4 && item_size != 8) {
+        return false;
+    }
+
+    size_t data_size = length * item_size;
+    size_t offset = 0;
+#if defined(HPROF_KERNELS_X86)
+    if (current_isa() != ISA_SCALAR) {
+        u_int8_t pattern[32];
+        for (size_t index = 0; index < sizeof(pattern); ++index) {
+            pattern[index] = item[index % item_size];
+        }
+
+        bool found = false;
+        offset = current_isa() == ISA_AVX2 ? contains_item_avx2(data, data_size, pattern, item_size, found)
+                                           : contains_item_sse41(data, data_size, pattern, item_size, found);
+        if (found) {
+            return true;
+        }
+    }
+#endif
+    for (; offset < data_size; offset += item_size) {
+        if (std::memcmp(data + offset, item, item_size) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+u_int64_t array_kernels_t::hash(const u_int8_t* data, size_t data_size) {
+    const u_int64_t m = 0xc6a4a7935bd1e995ULL;
+    const int r = 47;
+    u_int64_t result = 0x9747b28c ^ (data_size * m);
+
+    size_t offset = 0;
+    for (; offset + 8 <= data_size; offset += 8) {
+        u_int64_t value;
+        std::memcpy(&value, data + offset, sizeof(value));
+        value *= m;
+        value ^= value >> r;
+        value *= m;
+        result ^= value;
+        result *= m;
+    }
+
+    if (offset < data_size) {
+        u_int64_t value = 0;
+        for (size_t shift = 0; offset < data_size; ++offset, shift += 8) {
+            value |= static_cast<u_int64_t>(data[offset]) << shift;
+        }
+        result ^= value;
+        result *= m;
+    }
+
+    result ^= result >> r;
+    result *= m;
+    result ^= result >> r;
+    return result;
+}
+
+array_kernels_t::isa_t array_kernels_t::isa() {
+    return current_isa();
+}
+
+void array_kernels_t::force_isa(isa_t isa) {
+    current_isa() = std::min(isa, detect_isa());
+}
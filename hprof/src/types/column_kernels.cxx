@@ -0,0 +1,409 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#include "types/column_kernels.h"
+#include "types/array_kernels.h"
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HPROF_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+using namespace hprof;
+
+const size_t column_kernels_t::BATCH_SIZE;
+
+namespace {
+    using compare_t = column_kernels_t::compare_t;
+
+    template<typename T>
+    inline T load_be(const u_int8_t* data) {
+        typename std::make_unsigned<T>::type value = 0;
+        for (size_t index = 0; index < sizeof(T); ++index) {
+            value = static_cast<decltype(value)>((value << 8) | data[index]);
+        }
+        return static_cast<T>(value);
+    }
+
+    template<>
+    inline jvm_float_t load_be<jvm_float_t>(const u_int8_t* data) {
+        u_int32_t bits = load_be<u_int32_t>(data);
+        jvm_float_t value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    template<>
+    inline jvm_double_t load_be<jvm_double_t>(const u_int8_t* data) {
+        u_int64_t bits = load_be<u_int64_t>(data);
+        jvm_double_t value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    template<typename source_t, typename column_t>
+    void gather_as(const u_int8_t* const* rows, size_t count, size_t offset, column_t* column) {
+        for (size_t index = 0; index < count; ++index) {
+            column[index] = static_cast<column_t>(load_be<source_t>(rows[index] + offset));
+        }
+    }
+
+    template<typename column_t>
+    bool gather_integral(jvm_type_t type, const u_int8_t* const* rows, size_t count, size_t offset, column_t* column) {
+        switch (type) {
+            case jvm_type_t::JVM_TYPE_BOOL:
+                gather_as<jvm_bool_t>(rows, count, offset, column);
+                return true;
+            case jvm_type_t::JVM_TYPE_BYTE:
+                gather_as<jvm_byte_t>(rows, count, offset, column);
+                return true;
+            case jvm_type_t::JVM_TYPE_CHAR:
+                gather_as<jvm_char_t>(rows, count, offset, column);
+                return true;
+            case jvm_type_t::JVM_TYPE_SHORT:
+                gather_as<jvm_short_t>(rows, count, offset, column);
+                return true;
+            case jvm_type_t::JVM_TYPE_INT:
+                gather_as<jvm_int_t>(rows, count, offset, column);
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    template<compare_t compare, typename T>
+    inline bool compare_scalar(T value, T literal) {
+        switch (compare) {
+            case column_kernels_t::COMPARE_EQUALS:
+                return value == literal;
+            case column_kernels_t::COMPARE_NOT_EQUALS:
+                return value != literal;
+            case column_kernels_t::COMPARE_LESS:
+                return value < literal;
+            case column_kernels_t::COMPARE_LESS_OR_EQUALS:
+                return value <= literal;
+            case column_kernels_t::COMPARE_GREATER:
+                return value > literal;
+            case column_kernels_t::COMPARE_GREATER_OR_EQUALS:
+                return value >= literal;
+        }
+        return false;
+    }
+
+    template<compare_t compare, typename T>
+    void select_scalar(const T* column, size_t index, size_t count, T literal, u_int64_t* selection) {
+        for (; index < count; ++index) {
+            if (compare_scalar<compare>(column[index], literal)) {
+                selection[index / 64] |= u_int64_t(1) << (index % 64);
+            }
+        }
+    }
+
+#ifdef HPROF_KERNELS_X86
+    /// Lane masks of integer comparisons, only equality and greater than exist in hardware
+    template<compare_t compare>
+    __attribute__((target("sse4.1")))
+    inline u_int64_t mask_sse41(__m128i value, __m128i literal) {
+        switch (compare) {
+            case column_kernels_t::COMPARE_EQUALS:
+                return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(value, literal)));
+            case column_kernels_t::COMPARE_NOT_EQUALS:
+                return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(value, literal))) ^ 0xf;
+            case column_kernels_t::COMPARE_LESS:
+                return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(literal, value)));
+            case column_kernels_t::COMPARE_LESS_OR_EQUALS:
+                return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(value, literal))) ^ 0xf;
+            case column_kernels_t::COMPARE_GREATER:
+                return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(value, literal)));
+            case column_kernels_t::COMPARE_GREATER_OR_EQUALS:
+                return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(literal, value))) ^ 0xf;
+        }
+        return 0;
+    }
+
+    template<compare_t compare>
+    __attribute__((target("sse4.1")))
+    inline u_int64_t mask_sse41(__m128d value, __m128d literal) {
+        switch (compare) {
+            case column_kernels_t::COMPARE_EQUALS:
+                return _mm_movemask_pd(_mm_cmpeq_pd(value, literal));
+            case column_kernels_t::COMPARE_NOT_EQUALS:
+                return _mm_movemask_pd(_mm_cmpneq_pd(value, literal));
+            case column_kernels_t::COMPARE_LESS:
+                return _mm_movemask_pd(_mm_cmplt_pd(value, literal));
+            case column_kernels_t::COMPARE_LESS_OR_EQUALS:
+                return _mm_movemask_pd(_mm_cmple_pd(value, literal));
+            case column_kernels_t::COMPARE_GREATER:
+                return _mm_movemask_pd(_mm_cmpgt_pd(value, literal));
+            case column_kernels_t::COMPARE_GREATER_OR_EQUALS:
+                return _mm_movemask_pd(_mm_cmpge_pd(value, literal));
+        }
+        return 0;
+    }
+
+    template<compare_t compare>
+    __attribute__((target("avx2")))
+    inline u_int64_t mask_avx2_epi32(__m256i value, __m256i literal) {
+        switch (compare) {
+            case column_kernels_t::COMPARE_EQUALS:
+                return _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(value, literal)));
+            case column_kernels_t::COMPARE_NOT_EQUALS:
+                return _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(value, literal))) ^ 0xff;
+            case column_kernels_t::COMPARE_LESS:
+                return _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(literal, value)));
+            case column_kernels_t::COMPARE_LESS_OR_EQUALS:
+                return _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(value, literal))) ^ 0xff;
+            case column_kernels_t::COMPARE_GREATER:
+                return _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(value, literal)));
+            case column_kernels_t::COMPARE_GREATER_OR_EQUALS:
+                return _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(literal, value))) ^ 0xff;
+        }
+        return 0;
+    }
+
+    template<compare_t compare>
+    __attribute__((target("avx2")))
+    inline u_int64_t mask_avx2_epi64(__m256i value, __m256i literal) {
+        switch (compare) {
+            case column_kernels_t::COMPARE_EQUALS:
+                return _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(value, literal)));
+            case column_kernels_t::COMPARE_NOT_EQUALS:
+                return _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(value, literal))) ^ 0xf;
+            case column_kernels_t::COMPARE_LESS:
+                return _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(literal, value)));
+            case column_kernels_t::COMPARE_LESS_OR_EQUALS:
+                return _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(value, literal))) ^ 0xf;
+            case column_kernels_t::COMPARE_GREATER:
+                return _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(value, literal)));
+            case column_kernels_t::COMPARE_GREATER_OR_EQUALS:
+                return _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(literal, value))) ^ 0xf;
+        }
+        return 0;
+    }
+
+    template<compare_t compare>
+    __attribute__((target("avx2")))
+    inline u_int64_t mask_avx2_pd(__m256d value, __m256d literal) {
+        switch (compare) {
+            case column_kernels_t::COMPARE_EQUALS:
+                return _mm256_movemask_pd(_mm256_cmp_pd(value, literal, _CMP_EQ_OQ));
+            case column_kernels_t::COMPARE_NOT_EQUALS:
+                return _mm256_movemask_pd(_mm256_cmp_pd(value, literal, _CMP_NEQ_UQ));
+            case column_kernels_t::COMPARE_LESS:
+                return _mm256_movemask_pd(_mm256_cmp_pd(value, literal, _CMP_LT_OQ));
+            case column_kernels_t::COMPARE_LESS_OR_EQUALS:
+                return _mm256_movemask_pd(_mm256_cmp_pd(value, literal, _CMP_LE_OQ));
+            case column_kernels_t::COMPARE_GREATER:
+                return _mm256_movemask_pd(_mm256_cmp_pd(value, literal, _CMP_GT_OQ));
+            case column_kernels_t::COMPARE_GREATER_OR_EQUALS:
+                return _mm256_movemask_pd(_mm256_cmp_pd(value, literal, _CMP_GE_OQ));
+        }
+        return 0;
+    }
+
+    // Lane counts divide 64, so a vector never straddles selection words
+
+    template<compare_t compare>
+    __attribute__((target("sse4.1")))
+    void select_sse41(const int32_t* column, size_t count, int32_t literal, u_int64_t* selection) {
+        const __m128i wide = _mm_set1_epi32(literal);
+        size_t index = 0;
+        for (; index + 4 <= count; index += 4) {
+            __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(column + index));
+            selection[index / 64] |= mask_sse41<compare>(value, wide) << (index % 64);
+        }
+        select_scalar<compare>(column, index, count, literal, selection);
+    }
+
+    template<compare_t compare>
+    __attribute__((target("sse4.1")))
+    void select_sse41(const double* column, size_t count, double literal, u_int64_t* selection) {
+        const __m128d wide = _mm_set1_pd(literal);
+        size_t index = 0;
+        for (; index + 2 <= count; index += 2) {
+            __m128d value = _mm_loadu_pd(column + index);
+            selection[index / 64] |= mask_sse41<compare>(value, wide) << (index % 64);
+        }
+        select_scalar<compare>(column, index, count, literal, selection);
+    }
+
+    template<compare_t compare>
+    __attribute__((target("avx2")))
+    void select_avx2(const int32_t* column, size_t count, int32_t literal, u_int64_t* selection) {
+        const __m256i wide = _mm256_set1_epi32(literal);
+        size_t index = 0;
+        for (; index + 8 <= count; index += 8) {
+            __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(column + index));
+            selection[index / 64] |= mask_avx2_epi32<compare>(value, wide) << (index % 64);
+        }
+        select_scalar<compare>(column, index, count, literal, selection);
+    }
+
+    template<compare_t compare>
+    __attribute__((target("avx2")))
+    void select_avx2(const int64_t* column, size_t count, int64_t literal, u_int64_t* selection) {
+        const __m256i wide = _mm256_set1_epi64x(literal);
+        size_t index = 0;
+        for (; index + 4 <= count; index += 4) {
+            __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(column + index));
+            selection[index / 64] |= mask_avx2_epi64<compare>(value, wide) << (index % 64);
+        }
+        select_scalar<compare>(column, index, count, literal, selection);
+    }
+
+    template<compare_t compare>
+    __attribute__((target("avx2")))
+    void select_avx2(const double* column, size_t count, double literal, u_int64_t* selection) {
+        const __m256d wide = _mm256_set1_pd(literal);
+        size_t index = 0;
+        for (; index + 4 <= count; index += 4) {
+            __m256d value = _mm256_loadu_pd(column + index);
+            selection[index / 64] |= mask_avx2_pd<compare>(value, wide) << (index % 64);
+        }
+        select_scalar<compare>(column, index, count, literal, selection);
+    }
+#endif
+
+    template<compare_t compare>
+    void select_isa(const int32_t* column, size_t count, int32_t literal, u_int64_t* selection) {
+#ifdef HPROF_KERNELS_X86
+        switch (array_kernels_t::isa()) {
+            case array_kernels_t::ISA_AVX2:
+                select_avx2<compare>(column, count, literal, selection);
+                return;
+            case array_kernels_t::ISA_SSE41:
+                select_sse41<compare>(column, count, literal, selection);
+                return;
+            case array_kernels_t::ISA_SCALAR:
+                break;
+        }
+#endif
+        select_scalar<compare>(column, 0, count, literal, selection);
+    }
+
+    /// 64-bit greater than needs SSE4.2, SSE4.1 runs the scalar loop
+    template<compare_t compare>
+    void select_isa(const int64_t* column, size_t count, int64_t literal, u_int64_t* selection) {
+#ifdef HPROF_KERNELS_X86
+        if (array_kernels_t::isa() == array_kernels_t::ISA_AVX2) {
+            select_avx2<compare>(column, count, literal, selection);
+            return;
+        }
+#endif
+        select_scalar<compare>(column, 0, count, literal, selection);
+    }
+
+    template<compare_t compare>
+    void select_isa(const double* column, size_t count, double literal, u_int64_t* selection) {
+#ifdef HPROF_KERNELS_X86
+        switch (array_kernels_t::isa()) {
+            case array_kernels_t::ISA_AVX2:
+                select_avx2<compare>(column, count, literal, selection);
+                return;
+            case array_kernels_t::ISA_SSE41:
+                select_sse41<compare>(column, count, literal, selection);
+                return;
+            case array_kernels_t::ISA_SCALAR:
+                break;
+        }
+#endif
+        select_scalar<compare>(column, 0, count, literal, selection);
+    }
+
+    template<typename T>
+    void select_any(compare_t compare, const T* column, size_t count, T literal, u_int64_t* selection) {
+        std::fill(selection, selection + column_kernels_t::selection_size(count), 0);
+        switch (compare) {
+            case column_kernels_t::COMPARE_EQUALS:
+                select_isa<column_kernels_t::COMPARE_EQUALS>(column, count, literal, selection);
+                break;
+            case column_kernels_t::COMPARE_NOT_EQUALS:
+                select_isa<column_kernels_t::COMPARE_NOT_EQUALS>(column, count, literal, selection);
+                break;
+            case column_kernels_t::COMPARE_LESS:
+                select_isa<column_kernels_t::COMPARE_LESS>(column, count, literal, selection);
+                break;
+            case column_kernels_t::COMPARE_LESS_OR_EQUALS:
+                select_isa<column_kernels_t::COMPARE_LESS_OR_EQUALS>(column, count, literal, selection);
+                break;
+            case column_kernels_t::COMPARE_GREATER:
+                select_isa<column_kernels_t::COMPARE_GREATER>(column, count, literal, selection);
+                break;
+            case column_kernels_t::COMPARE_GREATER_OR_EQUALS:
+                select_isa<column_kernels_t::COMPARE_GREATER_OR_EQUALS>(column, count, literal, selection);
+                break;
+        }
+    }
+}
+
+void column_kernels_t::fill(u_int64_t* selection, size_t count, bool value) {
+    std::fill(selection, selection + selection_size(count), value ? ~u_int64_t(0) : 0);
+    if (value && count % 64 != 0) {
+        selection[count / 64] = (u_int64_t(1) << (count % 64)) - 1;
+    }
+}
+
+void column_kernels_t::negate(u_int64_t* selection, size_t count) {
+    for (size_t index = 0; index < selection_size(count); ++index) {
+        selection[index] = ~selection[index];
+    }
+    if (count % 64 != 0) {
+        selection[count / 64] &= (u_int64_t(1) << (count % 64)) - 1;
+    }
+}
+
+bool column_kernels_t::gather(jvm_type_t type, const u_int8_t* const* rows, size_t count, size_t offset, int32_t* column) {
+    return gather_integral(type, rows, count, offset, column);
+}
+
+bool column_kernels_t::gather(jvm_type_t type, const u_int8_t* const* rows, size_t count, size_t offset, int64_t* column) {
+    if (type == jvm_type_t::JVM_TYPE_LONG) {
+        gather_as<jvm_long_t>(rows, count, offset, column);
+        return true;
+    }
+    return gather_integral(type, rows, count, offset, column);
+}
+
+bool column_kernels_t::gather(jvm_type_t type, const u_int8_t* const* rows, size_t count, size_t offset, double* column) {
+    switch (type) {
+        case jvm_type_t::JVM_TYPE_FLOAT:
+            gather_as<jvm_float_t>(rows, count, offset, column);
+            return true;
+        case jvm_type_t::JVM_TYPE_DOUBLE:
+            gather_as<jvm_double_t>(rows, count, offset, column);
+            return true;
+        case jvm_type_t::JVM_TYPE_LONG:
+            gather_as<jvm_long_t>(rows, count, offset, column);
+            return true;
+        default:
+            return gather_integral(type, rows, count, offset, column);
+    }
+}
+
+void column_kernels_t::select(compare_t compare, const int32_t* column, size_t count, int32_t literal, u_int64_t* selection) {
+    select_any(compare, column, count, literal, selection);
+}
+
+void column_kernels_t::select(compare_t compare, const int64_t* column, size_t count, int64_t literal, u_int64_t* selection) {
+    select_any(compare, column, count, literal, selection);
+}
+
+void column_kernels_t::select(compare_t compare, const double* column, size_t count, double literal, u_int64_t* selection) {
+    select_any(compare, column, count, literal, selection);
+}
@@ -15,11 +15,57 @@
 ///
 #include "types/primitives_array.h"
 
+#include <cstring>
+
 using namespace hprof;
 
+payload_block_t::payload_block_t(const u_int8_t* bytes, size_t size) : _data(nullptr) {
+    auto mem = new (std::nothrow) u_int8_t[sizeof(header_t) + size];
+    if (mem == nullptr) {
+        return;
+    }
+
+    new (mem) header_t { { 1 } };
+    std::memcpy(mem + sizeof(header_t), bytes, size);
+    _data = mem + sizeof(header_t);
+}
+
+payload_block_t& payload_block_t::operator=(const payload_block_t& other) {
+    retain(other._data);
+    release(_data);
+    _data = other._data;
+    return *this;
+}
+
+payload_block_t::header_t* payload_block_t::header_of(const u_int8_t* data) {
+    return reinterpret_cast<header_t*>(const_cast<u_int8_t*>(data) - sizeof(header_t));
+}
+
+void payload_block_t::retain(const u_int8_t* data) {
+    if (data != nullptr) {
+        header_of(data)->holders.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void payload_block_t::release(const u_int8_t* data) {
+    if (data == nullptr) {
+        return;
+    }
+
+    header_t* header = header_of(data);
+    if (header->holders.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        header->~header_t();
+        delete[] reinterpret_cast<u_int8_t*>(header);
+    }
+}
+
 void primitives_array_info_impl_t_deleter::operator()(primitives_array_info_impl_t* ptr) const {
     ptr->~primitives_array_info_impl_t();
     delete[] reinterpret_cast<u_int8_t*>(ptr);
 }
 
-primitives_array_info_impl_t::~primitives_array_info_impl_t() {}
+primitives_array_info_impl_t::~primitives_array_info_impl_t() {
+    if (shared()) {
+        payload_block_t::release(_data);
+    }
+}
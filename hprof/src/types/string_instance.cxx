@@ -14,37 +14,181 @@
 ///  limitations under the License.
 ///
 #include "types/string_instance.h"
+#include "types/text_kernels.h"
 
 using namespace hprof;
 
+namespace {
+    thread_local size_t g_thread_decodes = 0;
+}
+
+const size_t strings_cache_t::DEFAULT_SIZE;
+const size_t strings_cache_t::SHARDS_BITS;
+const size_t strings_cache_t::SHARDS_COUNT;
+
+strings_cache_t::strings_cache_t(size_t bytes) : _shard_budget(bytes / SHARDS_COUNT) {}
+
+strings_cache_t::shard_t& strings_cache_t::shard_of(const u_int8_t* data) {
+    // payloads are allocated apart, the low bits carry no information
+    auto hash = (reinterpret_cast<uintptr_t>(data) >> 4) * 0x9E3779B97F4A7C15ULL;
+    return _shards[hash >> (64 - SHARDS_BITS)];
+}
+
+std::string strings_cache_t::value(const primitives_array_info_t& array, encoding_t encoding) {
+    key_t key { array.data(), array.length(), encoding };
+    auto& shard = shard_of(array.data());
+    {
+        std::lock_guard<std::mutex> lock { shard.lock };
+        auto it = shard.values.find(key);
+        if (it != std::end(shard.values)) {
+            shard.entries.splice(std::begin(shard.entries), shard.entries, it->second);
+            return it->second->second;
+        }
+    }
+
+    // decode outside of the lock, the first inserted value wins if several threads raced
+    std::string value = decode(array, encoding);
+    size_t cost = cost_of(value);
+    if (cost > _shard_budget) {
+        return value;
+    }
+
+    std::lock_guard<std::mutex> lock { shard.lock };
+    auto it = shard.values.find(key);
+    if (it != std::end(shard.values)) {
+        shard.entries.splice(std::begin(shard.entries), shard.entries, it->second);
+        return it->second->second;
+    }
+
+    while (shard.bytes + cost > _shard_budget) {
+        auto& oldest = shard.entries.back();
+        shard.bytes -= cost_of(oldest.second);
+        shard.values.erase(oldest.first);
+        shard.entries.pop_back();
+    }
+    shard.entries.emplace_front(key, value);
+    shard.values.emplace(key, std::begin(shard.entries));
+    shard.bytes += cost;
+    return value;
+}
+
+size_t strings_cache_t::size() const {
+    size_t result = 0;
+    for (auto& shard : _shards) {
+        std::lock_guard<std::mutex> lock { shard.lock };
+        result += shard.values.size();
+    }
+    return result;
+}
+
+size_t strings_cache_t::bytes() const {
+    size_t result = 0;
+    for (auto& shard : _shards) {
+        std::lock_guard<std::mutex> lock { shard.lock };
+        result += shard.bytes;
+    }
+    return result;
+}
+
+size_t strings_cache_t::cost_of(const std::string& value) {
+    // list and map nodes hold the key, the string and about four pointers
+    return value.size() + sizeof(entries_t::value_type) + 4 * sizeof(void*);
+}
+
+size_t strings_cache_t::thread_decodes() {
+    return g_thread_decodes;
+}
+
+std::string strings_cache_t::decode(const primitives_array_info_t& array, encoding_t encoding) {
+    ++g_thread_decodes;
+    std::string result;
+    switch (encoding) {
+        case string_info_t::ENCODING_UTF16_BE:
+            text_kernels_t::utf16be_to_utf8(array.data(), array.length(), result);
+            break;
+        case string_info_t::ENCODING_UTF16_LE:
+            text_kernels_t::utf16le_to_utf8(array.data(), array.length() / 2, result);
+            break;
+        case string_info_t::ENCODING_LATIN1:
+            text_kernels_t::latin1_to_utf8(array.data(), array.length(), result);
+            break;
+    }
+    return result;
+}
+
 void string_info_impl_t_deleter::operator()(string_info_impl_t* ptr) const {
     ptr->~string_info_impl_t();
     delete[] reinterpret_cast<u_int8_t*>(ptr);
 }
 
-string_info_impl_t::text_converter string_info_impl_t::_converter {"\xFF ", u"\xFFFF"};
+string_info_impl_ptr_t string_info_impl_t::create(instance_info_impl_ptr_t&& instance, const objects_index_t& objects, const std::shared_ptr<strings_cache_t>& cache) {
+    heap_item_ptr_t value;
+    strings_cache_t::encoding_t encoding = string_info_t::ENCODING_UTF16_BE;
+    if (!find_value(*instance, objects, value, encoding)) {
+        value.reset();
+    }
 
-string_info_impl_t::string_info_impl_t(const instance_info_impl_t& obj, const objects_index_t& objects) : 
-                instance_info_impl_t(obj, reinterpret_cast<u_int8_t*>(this) + sizeof(string_info_impl_t)) {
-    auto field = instance_info_impl_t::fields().find("value");
-    if (field == instance_info_impl_t::fields().end() || field->type() != jvm_type_t::JVM_TYPE_OBJECT) {
-        return;
+    auto mem = new (std::nothrow) u_int8_t[sizeof(string_info_impl_t)];
+    return string_info_impl_ptr_t { new (mem) string_info_impl_t(std::move(instance), value, encoding, cache) };
+}
+
+bool string_info_impl_t::find_value(const instance_info_impl_t& instance, const objects_index_t& objects, heap_item_ptr_t& value, strings_cache_t::encoding_t& encoding) {
+    auto field = instance.fields().find("value");
+    if (field == instance.fields().end() || field->type() != jvm_type_t::JVM_TYPE_OBJECT) {
+        return false;
     }
 
-    auto item = objects.find_object(static_cast<jvm_id_t>(*field));
-    if (item == nullptr || item->type() != heap_item_t::PrimitivesArray) {
-        return;
+    value = objects.find_object(static_cast<jvm_id_t>(*field));
+    if (value == nullptr || value->type() != heap_item_t::PrimitivesArray) {
+        return false;
     }
 
-    auto array = static_cast<const primitives_array_info_t *>(*item);
-    if (array->item_type() != jvm_type_t::JVM_TYPE_CHAR) {
-        return;
+    switch (static_cast<const primitives_array_info_t *>(*value)->item_type()) {
+        case jvm_type_t::JVM_TYPE_CHAR:
+            encoding = string_info_t::ENCODING_UTF16_BE;
+            return true;
+        case jvm_type_t::JVM_TYPE_BYTE: {
+            // compact strings (JDK 9+), UTF16 coder keeps chars in the byte order of the dumped VM
+            auto coder = instance.fields().find("coder");
+            if (coder == instance.fields().end() || coder->type() != jvm_type_t::JVM_TYPE_BYTE) {
+                return false;
+            }
+            encoding = static_cast<jvm_byte_t>(*coder) == 0 ? string_info_t::ENCODING_LATIN1 : string_info_t::ENCODING_UTF16_LE;
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+std::string string_info_impl_t::value() const {
+    if (_value == nullptr || _cache == nullptr) {
+        return std::string {};
+    }
+
+    return _cache->value(*static_cast<const primitives_array_info_t *>(*_value), _encoding);
+}
+
+bool string_info_impl_t::payload(const u_int8_t*& data, size_t& size, encoding_t& encoding) const {
+    if (_value == nullptr) {
+        return false;
     }
 
-    std::u16string text;
-    for (auto chr = std::begin(*array); chr != std::end(*array); ++chr) {
-        _value += _converter.to_bytes(static_cast<jvm_char_t>(*chr));
+    auto array = static_cast<const primitives_array_info_t *>(*_value);
+    data = array->data();
+    encoding = _encoding;
+    switch (_encoding) {
+        case string_info_t::ENCODING_UTF16_BE:
+            size = array->length() * 2;
+            break;
+        case string_info_t::ENCODING_UTF16_LE:
+            size = array->length() & ~static_cast<size_t>(1);
+            break;
+        case string_info_t::ENCODING_LATIN1:
+            size = array->length();
+            break;
     }
+    return true;
 }
 
 string_info_impl_t::~string_info_impl_t() {}
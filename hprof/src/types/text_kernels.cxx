@@ -0,0 +1,342 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#include "types/text_kernels.h"
+#include "types/array_kernels.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HPROF_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+using namespace hprof;
+
+namespace {
+    template<bool big_endian>
+    inline u_int16_t load_unit(const u_int8_t* data) {
+        return big_endian ? static_cast<u_int16_t>((data[0] << 8) | data[1]) : static_cast<u_int16_t>((data[1] << 8) | data[0]);
+    }
+
+    inline char* put_code_point(char* out, u_int32_t code) {
+        if (code < 0x80) {
+            *out++ = static_cast<char>(code);
+        } else if (code < 0x800) {
+            *out++ = static_cast<char>(0xc0 | (code >> 6));
+            *out++ = static_cast<char>(0x80 | (code & 0x3f));
+        } else if (code < 0x10000) {
+            *out++ = static_cast<char>(0xe0 | (code >> 12));
+            *out++ = static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+            *out++ = static_cast<char>(0x80 | (code & 0x3f));
+        } else {
+            *out++ = static_cast<char>(0xf0 | (code >> 18));
+            *out++ = static_cast<char>(0x80 | ((code >> 12) & 0x3f));
+            *out++ = static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+            *out++ = static_cast<char>(0x80 | (code & 0x3f));
+        }
+        return out;
+    }
+
+    /// Converts units [index, end), a surrogate pair may cross end. Returns index of the next unit
+    template<bool big_endian>
+    size_t utf16_scalar(const u_int8_t* data, size_t index, size_t end, size_t length, char*& out) {
+        while (index < end) {
+            u_int32_t code = load_unit<big_endian>(data + index * 2);
+            ++index;
+            if (code >= 0xd800 && code <= 0xdfff) {
+                u_int32_t low = index < length ? load_unit<big_endian>(data + index * 2) : 0;
+                if (code <= 0xdbff && low >= 0xdc00 && low <= 0xdfff) {
+                    code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+                    ++index;
+                } else {
+                    code = 0xfffd;
+                }
+            }
+            out = put_code_point(out, code);
+        }
+        return index;
+    }
+
+    size_t latin1_scalar(const u_int8_t* data, size_t index, size_t end, char*& out) {
+        for (; index < end; ++index) {
+            out = put_code_point(out, data[index]);
+        }
+        return index;
+    }
+
+    bool contains_scalar(const u_int8_t* data, size_t size, const u_int8_t* needle, size_t length, size_t step, size_t from) {
+        for (size_t index = from; index + length <= size; index += step) {
+            if (data[index] == needle[0] && std::memcmp(data + index, needle, length) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// Appends the unit in the byte order of the payload
+    void put_unit(u_int32_t unit, std::string& be, std::string& le) {
+        be += static_cast<char>(unit >> 8);
+        be += static_cast<char>(unit & 0xff);
+        le += static_cast<char>(unit & 0xff);
+        le += static_cast<char>(unit >> 8);
+    }
+
+#ifdef HPROF_KERNELS_X86
+    template<bool big_endian>
+    __attribute__((target("sse4.1")))
+    void utf16_sse41(const u_int8_t* data, size_t length, char*& out) {
+        const __m128i swap = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+        const __m128i non_ascii = _mm_set1_epi16(static_cast<short>(0xff80));
+        size_t index = 0;
+        while (index + 16 <= length) {
+            __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + index * 2));
+            __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + index * 2 + 16));
+            if (big_endian) {
+                first = _mm_shuffle_epi8(first, swap);
+                second = _mm_shuffle_epi8(second, swap);
+            }
+            if (_mm_testz_si128(_mm_or_si128(first, second), non_ascii)) {
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(first, second));
+                out += 16;
+                index += 16;
+            } else {
+                index = utf16_scalar<big_endian>(data, index, index + 16, length, out);
+            }
+        }
+        utf16_scalar<big_endian>(data, index, length, length, out);
+    }
+
+    template<bool big_endian>
+    __attribute__((target("avx2")))
+    void utf16_avx2(const u_int8_t* data, size_t length, char*& out) {
+        const __m256i swap = _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+                                              1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+        const __m256i non_ascii = _mm256_set1_epi16(static_cast<short>(0xff80));
+        size_t index = 0;
+        while (index + 32 <= length) {
+            __m256i first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + index * 2));
+            __m256i second = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + index * 2 + 32));
+            if (big_endian) {
+                first = _mm256_shuffle_epi8(first, swap);
+                second = _mm256_shuffle_epi8(second, swap);
+            }
+            if (_mm256_testz_si256(_mm256_or_si256(first, second), non_ascii)) {
+                // packus works per 128-bit lane, restore the order of quadwords
+                __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(first, second), 0xd8);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), packed);
+                out += 32;
+                index += 32;
+            } else {
+                index = utf16_scalar<big_endian>(data, index, index + 32, length, out);
+            }
+        }
+        utf16_scalar<big_endian>(data, index, length, length, out);
+    }
+
+    __attribute__((target("sse4.1")))
+    void latin1_sse41(const u_int8_t* data, size_t length, char*& out) {
+        size_t index = 0;
+        while (index + 16 <= length) {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + index));
+            if (_mm_movemask_epi8(chunk) == 0) {
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out), chunk);
+                out += 16;
+                index += 16;
+            } else {
+                index = latin1_scalar(data, index, index + 16, out);
+            }
+        }
+        latin1_scalar(data, index, length, out);
+    }
+
+    __attribute__((target("avx2")))
+    void latin1_avx2(const u_int8_t* data, size_t length, char*& out) {
+        size_t index = 0;
+        while (index + 32 <= length) {
+            __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + index));
+            if (_mm256_movemask_epi8(chunk) == 0) {
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), chunk);
+                out += 32;
+                index += 32;
+            } else {
+                index = latin1_scalar(data, index, index + 32, out);
+            }
+        }
+        latin1_scalar(data, index, length, out);
+    }
+
+    /// Blocks of candidate offsets where both the first and the last byte of the needle match,
+    /// every candidate is checked with memcmp. Offsets of UTF-16 payloads have to be even
+    __attribute__((target("sse4.1")))
+    bool contains_sse41(const u_int8_t* data, size_t size, const u_int8_t* needle, size_t length, size_t step) {
+        const __m128i first = _mm_set1_epi8(static_cast<char>(needle[0]));
+        const __m128i last = _mm_set1_epi8(static_cast<char>(needle[length - 1]));
+        const u_int32_t offsets = step == 2 ? 0x5555u : 0xffffu;
+        size_t index = 0;
+        for (; index + length - 1 + 16 <= size; index += 16) {
+            __m128i head = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + index));
+            __m128i tail = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + index + length - 1));
+            u_int32_t mask = static_cast<u_int32_t>(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(head, first), _mm_cmpeq_epi8(tail, last)))) & offsets;
+            while (mask != 0) {
+                if (std::memcmp(data + index + __builtin_ctz(mask), needle, length) == 0) {
+                    return true;
+                }
+                mask &= mask - 1;
+            }
+        }
+        return contains_scalar(data, size, needle, length, step, index);
+    }
+
+    __attribute__((target("avx2")))
+    bool contains_avx2(const u_int8_t* data, size_t size, const u_int8_t* needle, size_t length, size_t step) {
+        const __m256i first = _mm256_set1_epi8(static_cast<char>(needle[0]));
+        const __m256i last = _mm256_set1_epi8(static_cast<char>(needle[length - 1]));
+        const u_int32_t offsets = step == 2 ? 0x55555555u : 0xffffffffu;
+        size_t index = 0;
+        for (; index + length - 1 + 32 <= size; index += 32) {
+            __m256i head = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + index));
+            __m256i tail = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + index + length - 1));
+            u_int32_t mask = static_cast<u_int32_t>(_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(head, first), _mm256_cmpeq_epi8(tail, last)))) & offsets;
+            while (mask != 0) {
+                if (std::memcmp(data + index + __builtin_ctz(mask), needle, length) == 0) {
+                    return true;
+                }
+                mask &= mask - 1;
+            }
+        }
+        return contains_scalar(data, size, needle, length, step, index);
+    }
+#endif
+
+    template<bool big_endian>
+    void utf16_to_utf8(const u_int8_t* data, size_t length, std::string& out) {
+        size_t start = out.size();
+        // every code unit takes at most 3 bytes, a surrogate pair takes 4 for two units
+        out.resize(start + length * 3);
+        char* dst = &out[0] + start;
+        switch (array_kernels_t::isa()) {
+#ifdef HPROF_KERNELS_X86
+            case array_kernels_t::ISA_AVX2:
+                utf16_avx2<big_endian>(data, length, dst);
+                break;
+            case array_kernels_t::ISA_SSE41:
+                utf16_sse41<big_endian>(data, length, dst);
+                break;
+#endif
+            default:
+                utf16_scalar<big_endian>(data, 0, length, length, dst);
+                break;
+        }
+        out.resize(dst - &out[0]);
+    }
+}
+
+void text_kernels_t::utf16be_to_utf8(const u_int8_t* data, size_t length, std::string& out) {
+    utf16_to_utf8<true>(data, length, out);
+}
+
+void text_kernels_t::utf16le_to_utf8(const u_int8_t* data, size_t length, std::string& out) {
+    utf16_to_utf8<false>(data, length, out);
+}
+
+void text_kernels_t::latin1_to_utf8(const u_int8_t* data, size_t length, std::string& out) {
+    size_t start = out.size();
+    out.resize(start + length * 2);
+    char* dst = &out[0] + start;
+    switch (array_kernels_t::isa()) {
+#ifdef HPROF_KERNELS_X86
+        case array_kernels_t::ISA_AVX2:
+            latin1_avx2(data, length, dst);
+            break;
+        case array_kernels_t::ISA_SSE41:
+            latin1_sse41(data, length, dst);
+            break;
+#endif
+        default:
+            latin1_scalar(data, 0, length, dst);
+            break;
+    }
+    out.resize(dst - &out[0]);
+}
+
+std::string text_kernels_t::to_utf8(jvm_char_t chr) {
+    char buffer[3];
+    u_int32_t code = chr >= 0xd800 && chr <= 0xdfff ? 0xfffd : chr;
+    return std::string(buffer, put_code_point(buffer, code));
+}
+
+bool text_kernels_t::encode_needle(const std::string& utf8, text_needle_t& needle) {
+    needle.latin1.clear();
+    needle.utf16be.clear();
+    needle.utf16le.clear();
+    needle.wide = false;
+
+    size_t index = 0;
+    while (index < utf8.size()) {
+        u_int8_t lead = static_cast<u_int8_t>(utf8[index]);
+        size_t length = lead < 0x80 ? 1 : (lead >> 5) == 0x6 ? 2 : (lead >> 4) == 0xe ? 3 : (lead >> 3) == 0x1e ? 4 : 0;
+        if (length == 0 || index + length > utf8.size()) {
+            return false;
+        }
+
+        u_int32_t code = length == 1 ? lead : lead & (0x7f >> length);
+        for (size_t next = 1; next < length; ++next) {
+            u_int8_t byte = static_cast<u_int8_t>(utf8[index + next]);
+            if ((byte & 0xc0) != 0x80) {
+                return false;
+            }
+            code = (code << 6) | (byte & 0x3f);
+        }
+        index += length;
+
+        static const u_int32_t shortest[] = { 0, 0, 0x80, 0x800, 0x10000 };
+        if (code < shortest[length] || code == 0xfffd || code > 0x10ffff || (code >= 0xd800 && code <= 0xdfff)) {
+            return false;
+        }
+
+        if (code < 0x100) {
+            needle.latin1 += static_cast<char>(code);
+        } else {
+            needle.wide = true;
+        }
+
+        if (code < 0x10000) {
+            put_unit(code, needle.utf16be, needle.utf16le);
+        } else {
+            put_unit(0xd800 + ((code - 0x10000) >> 10), needle.utf16be, needle.utf16le);
+            put_unit(0xdc00 + ((code - 0x10000) & 0x3ff), needle.utf16be, needle.utf16le);
+        }
+    }
+    return true;
+}
+
+bool text_kernels_t::contains(const u_int8_t* data, size_t size, const std::string& needle, size_t step) {
+    if (needle.empty()) {
+        return true;
+    }
+
+    auto bytes = reinterpret_cast<const u_int8_t*>(needle.data());
+    switch (array_kernels_t::isa()) {
+#ifdef HPROF_KERNELS_X86
+        case array_kernels_t::ISA_AVX2:
+            return contains_avx2(data, size, bytes, needle.size(), step);
+        case array_kernels_t::ISA_SSE41:
+            return contains_sse41(data, size, bytes, needle.size(), step);
+#endif
+        default:
+            return contains_scalar(data, size, bytes, needle.size(), step, 0);
+    }
+}
@@ -0,0 +1,241 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#include "types/text_pattern.h"
+
+#include <cctype>
+#include <cstring>
+
+using namespace hprof;
+
+namespace {
+    size_t utf8_length(char lead) {
+        u_int8_t byte = static_cast<u_int8_t>(lead);
+        return byte < 0xc0 ? 1 : byte < 0xe0 ? 2 : byte < 0xf0 ? 3 : 4;
+    }
+
+    void keep_longer(std::string& best, std::string& run) {
+        if (run.size() > best.size()) {
+            best = run;
+        }
+        run.clear();
+    }
+
+    /// Literal characters outside of groups and classes, a character followed by a quantifier that
+    /// allows zero repeats doesn't count. Alternations and escapes that aren't understood give up
+    std::string regex_required_text(const std::string& pattern) {
+        if (pattern.find('|') != std::string::npos) {
+            return std::string {};
+        }
+
+        std::string best;
+        std::string run;
+        size_t depth = 0;
+        size_t atom = std::string::npos;
+        size_t index = 0;
+        while (index < pattern.size()) {
+            char chr = pattern[index];
+            size_t last_atom = atom;
+            atom = std::string::npos;
+            switch (chr) {
+                case '\\': {
+                    if (index + 1 >= pattern.size()) {
+                        return std::string {};
+                    }
+                    char escaped = pattern[index + 1];
+                    index += 2;
+                    if (std::isalnum(static_cast<unsigned char>(escaped))) {
+                        if (std::strchr("dDwWsSbB", escaped) == nullptr) {
+                            return std::string {};
+                        }
+                        keep_longer(best, run);
+                    } else if (depth == 0) {
+                        atom = run.size();
+                        run += escaped;
+                    }
+                    continue;
+                }
+                case '(':
+                    ++depth;
+                    keep_longer(best, run);
+                    break;
+                case ')':
+                    if (depth == 0) {
+                        return std::string {};
+                    }
+                    --depth;
+                    keep_longer(best, run);
+                    break;
+                case '[':
+                    keep_longer(best, run);
+                    for (++index; index < pattern.size() && pattern[index] != ']'; ++index) {
+                        if (pattern[index] == '\\') {
+                            ++index;
+                        }
+                    }
+                    break;
+                case '*':
+                case '?':
+                case '{':
+                    if (last_atom != std::string::npos) {
+                        run.resize(last_atom);
+                    }
+                    keep_longer(best, run);
+                    if (chr == '{') {
+                        index = pattern.find('}', index);
+                        if (index == std::string::npos) {
+                            return best;
+                        }
+                    }
+                    break;
+                case '+':
+                case '.':
+                case '^':
+                case '$':
+                    keep_longer(best, run);
+                    break;
+                default: {
+                    size_t length = std::min(utf8_length(chr), pattern.size() - index);
+                    if (depth == 0) {
+                        atom = run.size();
+                        run.append(pattern, index, length);
+                    }
+                    index += length;
+                    continue;
+                }
+            }
+            ++index;
+        }
+        keep_longer(best, run);
+        return best;
+    }
+
+    std::string like_required_text(const std::string& pattern) {
+        std::string best;
+        std::string run;
+        for (size_t index = 0; index < pattern.size(); ++index) {
+            char chr = pattern[index];
+            if (chr == '%' || chr == '_') {
+                keep_longer(best, run);
+            } else if (chr == '\\' && index + 1 < pattern.size()) {
+                run += pattern[++index];
+            } else {
+                run += chr;
+            }
+        }
+        keep_longer(best, run);
+        return best;
+    }
+}
+
+text_pattern_t::text_pattern_t(kind_t kind, const std::string& pattern) :
+    _kind(kind), _pattern(pattern), _required(required_text(kind, pattern)), _searchable(false),
+    _regex(kind == KIND_REGEX ? pattern : std::string {}, std::regex::ECMAScript | std::regex::nosubs) {
+    _searchable = !_required.empty() && text_kernels_t::encode_needle(_required, _needle);
+}
+
+bool text_pattern_t::match(const string_info_t& str) const {
+    const u_int8_t* data = nullptr;
+    size_t size = 0;
+    string_info_t::encoding_t encoding = string_info_t::ENCODING_UTF16_BE;
+    if (_searchable && str.payload(data, size, encoding)) {
+        bool found = false;
+        switch (encoding) {
+            case string_info_t::ENCODING_UTF16_BE:
+                found = text_kernels_t::contains(data, size, _needle.utf16be, 2);
+                break;
+            case string_info_t::ENCODING_UTF16_LE:
+                found = text_kernels_t::contains(data, size, _needle.utf16le, 2);
+                break;
+            case string_info_t::ENCODING_LATIN1:
+                found = !_needle.wide && text_kernels_t::contains(data, size, _needle.latin1, 1);
+                break;
+        }
+
+        if (!found) {
+            return false;
+        }
+        if (_kind == KIND_CONTAINS) {
+            return true;
+        }
+    }
+    return match(str.value());
+}
+
+bool text_pattern_t::match(const std::string& text) const {
+    switch (_kind) {
+        case KIND_CONTAINS:
+            return text.find(_pattern) != std::string::npos;
+        case KIND_LIKE:
+            return like(_pattern, text);
+        case KIND_REGEX:
+            return std::regex_search(text, _regex);
+    }
+    return false;
+}
+
+std::string text_pattern_t::required_text(kind_t kind, const std::string& pattern) {
+    switch (kind) {
+        case KIND_CONTAINS:
+            return pattern;
+        case KIND_LIKE:
+            return like_required_text(pattern);
+        case KIND_REGEX:
+            return regex_required_text(pattern);
+    }
+    return std::string {};
+}
+
+/// Backtracks to the last % only, that is enough as % matches any run
+bool text_pattern_t::like(const std::string& pattern, const std::string& text) {
+    size_t position = 0;
+    size_t index = 0;
+    size_t star = std::string::npos;
+    size_t star_index = 0;
+    while (index < text.size()) {
+        if (position < pattern.size()) {
+            char chr = pattern[position];
+            if (chr == '%') {
+                star = ++position;
+                star_index = index;
+                continue;
+            }
+            if (chr == '_') {
+                ++position;
+                index = std::min(text.size(), index + utf8_length(text[index]));
+                continue;
+            }
+
+            size_t literal = chr == '\\' && position + 1 < pattern.size() ? position + 1 : position;
+            if (pattern[literal] == text[index]) {
+                position = literal + 1;
+                ++index;
+                continue;
+            }
+        }
+
+        if (star == std::string::npos) {
+            return false;
+        }
+        star_index = std::min(text.size(), star_index + utf8_length(text[star_index]));
+        index = star_index;
+        position = star;
+    }
+
+    while (position < pattern.size() && pattern[position] == '%') {
+        ++position;
+    }
+    return position == pattern.size();
+}
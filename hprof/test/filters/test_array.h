@@ -0,0 +1,258 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#pragma once
+#include <gtest/gtest.h>
+
+#include "filters/array.h"
+#include "types/heap_item.h"
+#include "array_waste_report.h"
+
+#include "mocks.h"
+
+using namespace hprof;
+
+using testing::Invoke;
+using testing::Return;
+using testing::SetArgReferee;
+using testing::_;
+
+static heap_item_ptr_t make_primitives_array(jvm_type_t type, const std::vector<u_int8_t>& data) {
+    size_t length = data.size() / jvm_type_t::size(type, 4);
+    auto array = primitives_array_info_impl_t::create(4, 0xc0f060, type, length, data.size());
+    std::memcpy(array->data(), data.data(), data.size());
+    return std::make_shared<heap_item_impl_t>(std::move(array));
+}
+
+TEST(filter_array_zeroed_t, When_NotArray_Expect_NoMatch) {
+    mock_objects_index_t objects;
+    auto item = std::make_shared<mock_heap_item_t>();
+    EXPECT_CALL(*item, type()).Times(1).WillOnce(Return(heap_item_t::Object));
+
+    filter_array_zeroed_t filter;
+    ASSERT_EQ(filter_t::NoMatch, filter(item, objects));
+}
+
+TEST(filter_array_zeroed_t, When_EmptyArray_Expect_NoMatch) {
+    mock_objects_index_t objects;
+    filter_array_zeroed_t filter;
+    ASSERT_EQ(filter_t::NoMatch, filter(make_primitives_array(jvm_type_t::JVM_TYPE_INT, {}), objects));
+}
+
+TEST(filter_array_zeroed_t, When_ZeroedArray_Expect_Match) {
+    mock_objects_index_t objects;
+    filter_array_zeroed_t filter;
+    ASSERT_EQ(filter_t::Match, filter(make_primitives_array(jvm_type_t::JVM_TYPE_INT, std::vector<u_int8_t>(64, 0)), objects));
+}
+
+TEST(filter_array_zeroed_t, When_NotZeroedArray_Expect_NoMatch) {
+    mock_objects_index_t objects;
+    filter_array_zeroed_t filter;
+    ASSERT_EQ(filter_t::NoMatch, filter(make_primitives_array(jvm_type_t::JVM_TYPE_INT, { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01 }), objects));
+}
+
+TEST(filter_array_constant_t, When_ConstantArray_Expect_Match) {
+    mock_objects_index_t objects;
+    filter_array_constant_t filter;
+    ASSERT_EQ(filter_t::Match, filter(make_primitives_array(jvm_type_t::JVM_TYPE_CHAR, { 0x00, 0x20, 0x00, 0x20, 0x00, 0x20 }), objects));
+}
+
+TEST(filter_array_constant_t, When_NotConstantArray_Expect_NoMatch) {
+    mock_objects_index_t objects;
+    filter_array_constant_t filter;
+    ASSERT_EQ(filter_t::NoMatch, filter(make_primitives_array(jvm_type_t::JVM_TYPE_CHAR, { 0x00, 0x20, 0x20, 0x00 }), objects));
+}
+
+TEST(filter_array_mostly_constant_t, When_ValueHoldsShare_Expect_Match) {
+    mock_objects_index_t objects;
+    filter_array_mostly_constant_t filter { 0.75 };
+    ASSERT_EQ(filter_t::Match, filter(make_primitives_array(jvm_type_t::JVM_TYPE_CHAR, { 0x00, 0x20, 0x00, 0x20, 0x00, 0x21, 0x00, 0x20 }), objects));
+    ASSERT_EQ(filter_t::NoMatch, filter(make_primitives_array(jvm_type_t::JVM_TYPE_CHAR, { 0x00, 0x20, 0x00, 0x21, 0x00, 0x21, 0x00, 0x20 }), objects));
+}
+
+TEST(filter_array_value_t, When_MaxLessThanValue_Expect_Match) {
+    mock_objects_index_t objects;
+    filter_array_value_t filter { filter_array_value_t::AGGREGATE_MAX, filter_array_value_t::COMPARE_LESS, filter_comp_value_t { 100 } };
+    ASSERT_EQ(filter_t::Match, filter(make_primitives_array(jvm_type_t::JVM_TYPE_SHORT, { 0xFF, 0x00, 0x00, 0x63 }), objects));
+}
+
+TEST(filter_array_value_t, When_MinEqualsValue_Expect_Match) {
+    mock_objects_index_t objects;
+    filter_array_value_t filter { filter_array_value_t::AGGREGATE_MIN, filter_array_value_t::COMPARE_EQUALS, filter_comp_value_t { -256 } };
+    ASSERT_EQ(filter_t::Match, filter(make_primitives_array(jvm_type_t::JVM_TYPE_SHORT, { 0xFF, 0x00, 0x00, 0x63 }), objects));
+}
+
+TEST(filter_array_value_t, When_SumGreaterThanValue_Expect_NoMatch) {
+    mock_objects_index_t objects;
+    filter_array_value_t filter { filter_array_value_t::AGGREGATE_SUM, filter_array_value_t::COMPARE_GREATER, filter_comp_value_t { 0 } };
+    ASSERT_EQ(filter_t::NoMatch, filter(make_primitives_array(jvm_type_t::JVM_TYPE_SHORT, { 0xFF, 0x00, 0x00, 0x63 }), objects));
+}
+
+TEST(filter_array_value_t, When_FloatArrayMaxGreaterOrEquals_Expect_Match) {
+    mock_objects_index_t objects;
+    filter_array_value_t filter { filter_array_value_t::AGGREGATE_MAX, filter_array_value_t::COMPARE_GREATER_OR_EQUALS, filter_comp_value_t { 1.5 } };
+    ASSERT_EQ(filter_t::Match, filter(make_primitives_array(jvm_type_t::JVM_TYPE_FLOAT, { 0x3F, 0xC8, 0xAB, 0xB4, 0xbf, 0xc8, 0xab, 0xb4 }), objects));
+}
+
+static heap_item_ptr_t make_objects_array(const std::vector<jvm_id_t>& ids) {
+    auto array = objects_array_info_impl_t::create(4, 0xc0f070, 0x100, ids.size(), ids.size() * 4);
+    for (size_t index = 0; index < ids.size(); ++index) {
+        for (size_t byte = 0; byte < 4; ++byte) {
+            array->data()[index * 4 + byte] = static_cast<u_int8_t>(ids[index] >> (24 - byte * 8));
+        }
+    }
+    return std::make_shared<heap_item_impl_t>(std::move(array));
+}
+
+TEST(filter_array_length_t, When_ArraysOfBothKinds_Expect_LengthCompared) {
+    mock_objects_index_t objects;
+    filter_array_length_t longer { filter_by_array_t::COMPARE_GREATER, filter_comp_value_t { 2 } };
+    ASSERT_EQ(filter_t::Match, longer(make_primitives_array(jvm_type_t::JVM_TYPE_SHORT, { 0, 1, 0, 2, 0, 3 }), objects));
+    ASSERT_EQ(filter_t::NoMatch, longer(make_primitives_array(jvm_type_t::JVM_TYPE_INT, { 0, 0, 0, 1, 0, 0, 0, 2 }), objects));
+    ASSERT_EQ(filter_t::Match, longer(make_objects_array({ 0, 0, 0 }), objects));
+
+    filter_array_length_t empty { filter_by_array_t::COMPARE_EQUALS, filter_comp_value_t { 0 } };
+    ASSERT_EQ(filter_t::Match, empty(make_primitives_array(jvm_type_t::JVM_TYPE_BYTE, {}), objects));
+    ASSERT_EQ(filter_t::Match, empty(make_objects_array({}), objects));
+}
+
+TEST(filter_array_of_t, When_ItemTypeDiffers_Expect_NoMatch) {
+    mock_objects_index_t objects;
+    filter_array_of_t bytes { jvm_type_t::JVM_TYPE_BYTE };
+    ASSERT_EQ(filter_t::Match, bytes(make_primitives_array(jvm_type_t::JVM_TYPE_BYTE, { 1 }), objects));
+    ASSERT_EQ(filter_t::NoMatch, bytes(make_primitives_array(jvm_type_t::JVM_TYPE_BOOL, { 1 }), objects));
+    ASSERT_EQ(filter_t::NoMatch, bytes(make_objects_array({ 1 }), objects));
+
+    filter_array_of_t references { jvm_type_t::JVM_TYPE_OBJECT };
+    ASSERT_EQ(filter_t::Match, references(make_objects_array({ 1 }), objects));
+    ASSERT_EQ(filter_t::NoMatch, references(make_primitives_array(jvm_type_t::JVM_TYPE_INT, { 0, 0, 0, 1 }), objects));
+
+    ASSERT_EQ(jvm_type_t::JVM_TYPE_CHAR, filter_array_of_t::type_by_name("CHAR"));
+    ASSERT_EQ(jvm_type_t::JVM_TYPE_BOOL, filter_array_of_t::type_by_name("boolean"));
+    ASSERT_EQ(jvm_type_t::JVM_TYPE_UNKNOWN, filter_array_of_t::type_by_name("String"));
+}
+
+TEST(filter_array_any_t, When_ItemEqualsValue_Expect_Match) {
+    mock_objects_index_t objects;
+    auto ints = make_primitives_array(jvm_type_t::JVM_TYPE_INT, { 0, 0, 0, 1, 0, 0, 0, 7, 0xFF, 0xFF, 0xFF, 0xFD });
+    ASSERT_EQ(filter_t::Match, filter_array_any_t(filter_by_array_t::COMPARE_EQUALS, filter_comp_value_t { 7 })(ints, objects));
+    ASSERT_EQ(filter_t::Match, filter_array_any_t(filter_by_array_t::COMPARE_EQUALS, filter_comp_value_t { -3 })(ints, objects));
+    ASSERT_EQ(filter_t::NoMatch, filter_array_any_t(filter_by_array_t::COMPARE_EQUALS, filter_comp_value_t { 8 })(ints, objects));
+    ASSERT_EQ(filter_t::NoMatch, filter_array_any_t(filter_by_array_t::COMPARE_EQUALS, filter_comp_value_t { "7" })(ints, objects));
+
+    auto bytes = make_primitives_array(jvm_type_t::JVM_TYPE_BYTE, { 0x2C, 0x01 });
+    ASSERT_EQ(filter_t::NoMatch, filter_array_any_t(filter_by_array_t::COMPARE_EQUALS, filter_comp_value_t { 300 })(bytes, objects));
+
+    // -0.0f and 2.5f
+    auto floats = make_primitives_array(jvm_type_t::JVM_TYPE_FLOAT, { 0x80, 0x00, 0x00, 0x00, 0x40, 0x20, 0x00, 0x00 });
+    ASSERT_EQ(filter_t::Match, filter_array_any_t(filter_by_array_t::COMPARE_EQUALS, filter_comp_value_t { 0 })(floats, objects));
+    ASSERT_EQ(filter_t::Match, filter_array_any_t(filter_by_array_t::COMPARE_EQUALS, filter_comp_value_t { 2.5 })(floats, objects));
+    ASSERT_EQ(filter_t::NoMatch, filter_array_any_t(filter_by_array_t::COMPARE_EQUALS, filter_comp_value_t { 2.6 })(floats, objects));
+}
+
+TEST(filter_array_any_t, When_Ordering_Expect_MinimumOrMaximumCompared) {
+    mock_objects_index_t objects;
+    auto shorts = make_primitives_array(jvm_type_t::JVM_TYPE_SHORT, { 0x00, 0x05, 0xFF, 0xFE, 0x00, 0x09 });
+    ASSERT_EQ(filter_t::Match, filter_array_any_t(filter_by_array_t::COMPARE_LESS, filter_comp_value_t { 0 })(shorts, objects));
+    ASSERT_EQ(filter_t::NoMatch, filter_array_any_t(filter_by_array_t::COMPARE_LESS, filter_comp_value_t { -2 })(shorts, objects));
+    ASSERT_EQ(filter_t::Match, filter_array_any_t(filter_by_array_t::COMPARE_GREATER_OR_EQUALS, filter_comp_value_t { 9 })(shorts, objects));
+    ASSERT_EQ(filter_t::NoMatch, filter_array_any_t(filter_by_array_t::COMPARE_GREATER, filter_comp_value_t { 9 })(shorts, objects));
+
+    auto constant = make_primitives_array(jvm_type_t::JVM_TYPE_SHORT, { 0x00, 0x05, 0x00, 0x05 });
+    ASSERT_EQ(filter_t::NoMatch, filter_array_any_t(filter_by_array_t::COMPARE_NOT_EQUALS, filter_comp_value_t { 5 })(constant, objects));
+    ASSERT_EQ(filter_t::Match, filter_array_any_t(filter_by_array_t::COMPARE_NOT_EQUALS, filter_comp_value_t { 5 })(shorts, objects));
+}
+
+TEST(filter_array_any_instance_of_t, When_ItemOfBoundClass_Expect_Match) {
+    auto make_class = [] (jvm_id_t id, const class_hierarchy_t& hierarchy) {
+        auto cls = class_info_impl_t::create(4, id, 0);
+        cls->set_hierarchy(hierarchy);
+        return std::make_shared<heap_item_impl_t>(std::move(cls));
+    };
+    auto make_instance = [] (jvm_id_t id, const heap_item_ptr_t& cls) {
+        auto instance = instance_info_impl_t::create(4, id, 0);
+        instance->set_class(cls);
+        return std::make_shared<heap_item_impl_t>(std::move(instance));
+    };
+
+    // View is numbered 2 with a subclass numbered 3, Context is 4
+    auto view = make_class(0x100, { 2, 3 });
+    auto view_group = make_class(0x101, { 3, 3 });
+    auto context = make_class(0x102, { 4, 4 });
+    std::unordered_map<jvm_id_t, heap_item_ptr_t> items {
+        { 0x200, make_instance(0x200, context) }, { 0x201, make_instance(0x201, view_group) }, { 0x202, make_instance(0x202, view) }
+    };
+
+    mock_objects_index_t objects;
+    EXPECT_CALL(objects, find_object(_)).WillRepeatedly(Invoke([&items] (jvm_id_t id) {
+        auto it = items.find(id);
+        return it != items.end() ? it->second : heap_item_ptr_t {};
+    }));
+
+    mock_classes_index_t classes;
+    EXPECT_CALL(classes, count_classes()).WillRepeatedly(Return(4));
+    EXPECT_CALL(classes, find_classes("android.view.View", _)).WillOnce(SetArgReferee<1>(std::vector<heap_item_ptr_t> { view }));
+
+    filter_array_any_instance_of_t filter { "android.view.View" };
+    filter.bind(classes);
+    ASSERT_EQ(filter_t::Match, filter(make_objects_array({ 0, 0x200, 0x201 }), objects));
+    ASSERT_EQ(filter_t::Match, filter(make_objects_array({ 0x202 }), objects));
+    ASSERT_EQ(filter_t::NoMatch, filter(make_objects_array({ 0, 0x200, 0x999 }), objects));
+    ASSERT_EQ(filter_t::NoMatch, filter(make_primitives_array(jvm_type_t::JVM_TYPE_INT, { 0, 0, 2, 1 }), objects));
+}
+
+TEST(filter_array_contains_text_t, When_PayloadHoldsText_Expect_Match) {
+    mock_objects_index_t objects;
+    filter_array_contains_text_t filter { "ell" };
+    ASSERT_EQ(filter_t::Match, filter(make_primitives_array(jvm_type_t::JVM_TYPE_CHAR, { 0, 'h', 0, 'e', 0, 'l', 0, 'l', 0, 'o' }), objects));
+    ASSERT_EQ(filter_t::Match, filter(make_primitives_array(jvm_type_t::JVM_TYPE_BYTE, { 'h', 'e', 'l', 'l', 'o' }), objects));
+    ASSERT_EQ(filter_t::NoMatch, filter(make_primitives_array(jvm_type_t::JVM_TYPE_CHAR, { 0, 'h', 0, 'e', 0, 'L', 0, 'l', 0, 'o' }), objects));
+    // Code units 0x6500, 0x6C00, 0x6C00 hold the bytes of "ell" off the item boundary
+    ASSERT_EQ(filter_t::NoMatch, filter(make_primitives_array(jvm_type_t::JVM_TYPE_CHAR, { 'e', 0, 'l', 0, 'l', 0 }), objects));
+    ASSERT_EQ(filter_t::NoMatch, filter(make_primitives_array(jvm_type_t::JVM_TYPE_INT, { 0, 'e', 'l', 'l' }), objects));
+}
+
+TEST(array_waste_report_t, When_ArraysAdded_Expect_ZeroedAndConstantBytes) {
+    array_waste_report_t report;
+    report.add(*static_cast<const primitives_array_info_t*>(*make_primitives_array(jvm_type_t::JVM_TYPE_INT, std::vector<u_int8_t>(64, 0))));
+    report.add(*static_cast<const primitives_array_info_t*>(*make_primitives_array(jvm_type_t::JVM_TYPE_INT, std::vector<u_int8_t>(32, 1))));
+    report.add(*static_cast<const primitives_array_info_t*>(*make_primitives_array(jvm_type_t::JVM_TYPE_INT, { 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x02 })));
+    report.add(*static_cast<const primitives_array_info_t*>(*make_primitives_array(jvm_type_t::JVM_TYPE_BYTE, { 0x00, 0x00 })));
+
+    auto entries = report.entries();
+    ASSERT_EQ(2, entries.size());
+    ASSERT_EQ(jvm_type_t::JVM_TYPE_BYTE, entries[0].type);
+    ASSERT_EQ(1, entries[0].zeroed_arrays);
+    ASSERT_EQ(jvm_type_t::JVM_TYPE_INT, entries[1].type);
+    ASSERT_EQ(3, entries[1].arrays);
+    ASSERT_EQ(104, entries[1].bytes);
+    ASSERT_EQ(64, entries[1].zeroed_bytes);
+    ASSERT_EQ(1, entries[1].constant_arrays);
+    ASSERT_EQ(32, entries[1].constant_bytes);
+    ASSERT_EQ(98, report.wasted_bytes());
+}
+
+TEST(array_waste_report_t, When_ValueHoldsMostItems_Expect_MostlyConstantBytes) {
+    array_waste_report_t report { 0.75 };
+    report.add(*static_cast<const primitives_array_info_t*>(*make_primitives_array(jvm_type_t::JVM_TYPE_SHORT, { 0x00, 0x01, 0x00, 0x01, 0x00, 0x01, 0x00, 0x02 })));
+    report.add(*static_cast<const primitives_array_info_t*>(*make_primitives_array(jvm_type_t::JVM_TYPE_SHORT, { 0x00, 0x01, 0x00, 0x01, 0x00, 0x02, 0x00, 0x02 })));
+
+    auto entries = report.entries();
+    ASSERT_EQ(1, entries.size());
+    ASSERT_EQ(1, entries[0].mostly_constant_arrays);
+    ASSERT_EQ(8, entries[0].mostly_constant_bytes);
+    ASSERT_EQ(0, entries[0].constant_arrays);
+    ASSERT_EQ(0, report.wasted_bytes());
+}
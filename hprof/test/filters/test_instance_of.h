@@ -25,6 +25,8 @@ using namespace hprof;
 
 using testing::Return;
 using testing::ReturnRef;
+using testing::SetArgReferee;
+using testing::_;
 
 TEST(filter_instance_of_t, When_nullptr_Expect_NoMatch) {
     mock_objects_index_t objects;
@@ -98,3 +100,56 @@ TEST(filter_instance_of_t, When_NotInstanceOfClass_Expect_NoMatch) {
     filter_instance_of_t filter { "com.android.View" };
     ASSERT_EQ(filter_t::NoMatch, filter(item, objects));
 }
+
+TEST(filter_instance_of_t, When_BoundAndSubClassInstance_Expect_MatchWithoutNames) {
+    mock_objects_index_t objects;
+    mock_classes_index_t classes;
+    mock_instance_info_t instance;
+    mock_class_info_t super_cls;
+    mock_class_info_t cls;
+    class_hierarchy_t super_hierarchy { 2, 5 };
+    class_hierarchy_t hierarchy { 4, 4 };
+
+    auto super_item = std::make_shared<mock_heap_item_t>();
+    EXPECT_CALL(*super_item, as_class()).WillRepeatedly(Return(&super_cls));
+    EXPECT_CALL(super_cls, hierarchy()).WillRepeatedly(ReturnRef(super_hierarchy));
+    EXPECT_CALL(classes, find_classes("com.android.View", _)).Times(1).WillOnce(SetArgReferee<1>(std::vector<heap_item_ptr_t> { super_item }));
+
+    EXPECT_CALL(cls, name()).Times(0);
+    EXPECT_CALL(cls, hierarchy()).Times(1).WillOnce(ReturnRef(hierarchy));
+    EXPECT_CALL(instance, get_class()).Times(1).WillOnce(Return(&cls));
+
+    auto item = std::make_shared<mock_heap_item_t>();
+    EXPECT_CALL(*item, type()).Times(1).WillOnce(Return(heap_item_t::Object));
+    EXPECT_CALL(*item, as_instance()).Times(1).WillOnce(Return(&instance));
+
+    filter_instance_of_t filter { "com.android.View" };
+    filter.bind(classes);
+    ASSERT_EQ(filter_t::Match, filter(item, objects));
+}
+
+TEST(filter_instance_of_t, When_BoundAndOutsideOfHierarchy_Expect_NoMatch) {
+    mock_objects_index_t objects;
+    mock_classes_index_t classes;
+    mock_instance_info_t instance;
+    mock_class_info_t super_cls;
+    mock_class_info_t cls;
+    class_hierarchy_t super_hierarchy { 2, 5 };
+    class_hierarchy_t hierarchy { 6, 6 };
+
+    auto super_item = std::make_shared<mock_heap_item_t>();
+    EXPECT_CALL(*super_item, as_class()).WillRepeatedly(Return(&super_cls));
+    EXPECT_CALL(super_cls, hierarchy()).WillRepeatedly(ReturnRef(super_hierarchy));
+    EXPECT_CALL(classes, find_classes("com.android.View", _)).Times(1).WillOnce(SetArgReferee<1>(std::vector<heap_item_ptr_t> { super_item }));
+
+    EXPECT_CALL(cls, hierarchy()).Times(1).WillOnce(ReturnRef(hierarchy));
+    EXPECT_CALL(instance, get_class()).Times(1).WillOnce(Return(&cls));
+
+    auto item = std::make_shared<mock_heap_item_t>();
+    EXPECT_CALL(*item, type()).Times(1).WillOnce(Return(heap_item_t::Object));
+    EXPECT_CALL(*item, as_instance()).Times(1).WillOnce(Return(&instance));
+
+    filter_instance_of_t filter { "com.android.View" };
+    filter.bind(classes);
+    ASSERT_EQ(filter_t::NoMatch, filter(item, objects));
+}
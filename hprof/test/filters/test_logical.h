@@ -76,7 +76,7 @@ TEST(filter_and_t, When_NoMatchAndMatch_Expect_NoMatch) {
     EXPECT_CALL(*filter_left, apply_filter(_, _)).Times(1).WillOnce(Return(filter_t::NoMatch));
 
     auto filter_right = std::make_unique<mock_filter_t>();
-    EXPECT_CALL(*filter_right, apply_filter(_, _)).Times(1).WillOnce(Return(filter_t::Match));
+    EXPECT_CALL(*filter_right, apply_filter(_, _)).Times(0);
 
 
     filter_and_t filter_and { std::move(filter_left), std::move(filter_right) };
@@ -106,7 +106,7 @@ TEST(filter_and_t, When_NoMatchAndNoMatch_Expect_NoMatch) {
     EXPECT_CALL(*filter_left, apply_filter(_, _)).Times(1).WillOnce(Return(filter_t::NoMatch));
 
     auto filter_right = std::make_unique<mock_filter_t>();
-    EXPECT_CALL(*filter_right, apply_filter(_, _)).Times(1).WillOnce(Return(filter_t::NoMatch));
+    EXPECT_CALL(*filter_right, apply_filter(_, _)).Times(0);
 
 
     filter_and_t filter_and { std::move(filter_left), std::move(filter_right) };
@@ -146,19 +146,19 @@ TEST(filter_and_t, When_MatchAndFail_Expect_Fail) {
     ASSERT_EQ(filter_t::Fail, filter_and(item, objects));
 }
 
-TEST(filter_and_t, When_NoMatchAndFail_Expect_Fail) {
+TEST(filter_and_t, When_NoMatchAndFail_Expect_NoMatch) {
     auto filter_left = std::make_unique<mock_filter_t>();
     EXPECT_CALL(*filter_left, apply_filter(_, _)).Times(1).WillOnce(Return(filter_t::NoMatch));
 
     auto filter_right = std::make_unique<mock_filter_t>();
-    EXPECT_CALL(*filter_right, apply_filter(_, _)).Times(1).WillOnce(Return(filter_t::Fail));
+    EXPECT_CALL(*filter_right, apply_filter(_, _)).Times(0);
 
 
     filter_and_t filter_and { std::move(filter_left), std::move(filter_right) };
     auto item = std::make_shared<mock_heap_item_t>();
     mock_objects_index_t objects;
 
-    ASSERT_EQ(filter_t::Fail, filter_and(item, objects));
+    ASSERT_EQ(filter_t::NoMatch, filter_and(item, objects));
 }
 
 TEST(filter_or_t, When_MatchOrMatch_Expect_Match) {
@@ -166,7 +166,7 @@ TEST(filter_or_t, When_MatchOrMatch_Expect_Match) {
     EXPECT_CALL(*filter_left, apply_filter(_, _)).Times(1).WillOnce(Return(filter_t::Match));
 
     auto filter_right = std::make_unique<mock_filter_t>();
-    EXPECT_CALL(*filter_right, apply_filter(_, _)).Times(1).WillOnce(Return(filter_t::Match));
+    EXPECT_CALL(*filter_right, apply_filter(_, _)).Times(0);
 
 
     filter_or_t filter_or { std::move(filter_left), std::move(filter_right) };
@@ -181,7 +181,7 @@ TEST(filter_or_t, When_MatchOrNoMatch_Expect_Match) {
     EXPECT_CALL(*filter_left, apply_filter(_, _)).Times(1).WillOnce(Return(filter_t::Match));
 
     auto filter_right = std::make_unique<mock_filter_t>();
-    EXPECT_CALL(*filter_right, apply_filter(_, _)).Times(1).WillOnce(Return(filter_t::NoMatch));
+    EXPECT_CALL(*filter_right, apply_filter(_, _)).Times(0);
 
 
     filter_or_t filter_or { std::move(filter_left), std::move(filter_right) };
@@ -236,19 +236,19 @@ TEST(filter_or_t, When_FailOrAny_Expect_Fail) {
     ASSERT_EQ(filter_t::Fail, filter_or(item, objects));
 }
 
-TEST(filter_or_t, When_MatchOrFail_Expect_Fail) {
+TEST(filter_or_t, When_MatchOrFail_Expect_Match) {
     auto filter_left = std::make_unique<mock_filter_t>();
     EXPECT_CALL(*filter_left, apply_filter(_, _)).Times(1).WillOnce(Return(filter_t::Match));
 
     auto filter_right = std::make_unique<mock_filter_t>();
-    EXPECT_CALL(*filter_right, apply_filter(_, _)).Times(1).WillOnce(Return(filter_t::Fail));
+    EXPECT_CALL(*filter_right, apply_filter(_, _)).Times(0);
 
 
     filter_or_t filter_or { std::move(filter_left), std::move(filter_right) };
     auto item = std::make_shared<mock_heap_item_t>();
     mock_objects_index_t objects;
 
-    ASSERT_EQ(filter_t::Fail, filter_or(item, objects));
+    ASSERT_EQ(filter_t::Match, filter_or(item, objects));
 }
 
 TEST(filter_or_t, When_NoMatchOrFail_Expect_Fail) {
@@ -0,0 +1,106 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#pragma once
+#include <gtest/gtest.h>
+
+#include "filters/text_match.h"
+
+#include "helpers.h"
+#include "mocks.h"
+
+using namespace hprof;
+
+using testing::DoAll;
+using testing::Return;
+using testing::SetArgReferee;
+
+TEST(text_pattern_t, When_Like_Expect_WildcardsMatched) {
+    ASSERT_TRUE(text_pattern_t::like("user_%", "user_42"));
+    ASSERT_TRUE(text_pattern_t::like("%", ""));
+    ASSERT_TRUE(text_pattern_t::like("a%b%c", "aXXbYbYc"));
+    ASSERT_TRUE(text_pattern_t::like("_\xc3\xa9_", "x\xc3\xa9y"));
+    ASSERT_TRUE(text_pattern_t::like("\xc3\xa9_", "\xc3\xa9\xe2\x82\xac"));
+    ASSERT_TRUE(text_pattern_t::like("100\\%", "100%"));
+    ASSERT_FALSE(text_pattern_t::like("100\\%", "1000"));
+    ASSERT_FALSE(text_pattern_t::like("a%b", "ab c"));
+    ASSERT_FALSE(text_pattern_t::like("___", "ab"));
+}
+
+TEST(text_pattern_t, When_RequiredText_Expect_LongestMandatoryLiteral) {
+    ASSERT_EQ("token", text_pattern_t::required_text(text_pattern_t::KIND_CONTAINS, "token"));
+    ASSERT_EQ("http://", text_pattern_t::required_text(text_pattern_t::KIND_LIKE, "%http://%.com%"));
+    ASSERT_EQ("50%", text_pattern_t::required_text(text_pattern_t::KIND_LIKE, "_50\\%"));
+
+    ASSERT_EQ("AKIA", text_pattern_t::required_text(text_pattern_t::KIND_REGEX, "AKIA[0-9A-Z]{16}"));
+    ASSERT_EQ("http", text_pattern_t::required_text(text_pattern_t::KIND_REGEX, "^https?://(www\\.)?ex"));
+    ASSERT_EQ("a.b", text_pattern_t::required_text(text_pattern_t::KIND_REGEX, "a\\.bc*"));
+    ASSERT_EQ("", text_pattern_t::required_text(text_pattern_t::KIND_REGEX, "cat|dog"));
+    ASSERT_EQ("", text_pattern_t::required_text(text_pattern_t::KIND_REGEX, "\\x41+"));
+}
+
+TEST(text_pattern_t, When_PayloadMissesRequiredText_Expect_NotDecoded) {
+    std::string latin1 = "caf\xe9 \xe0 la carte";
+    const u_int8_t* data = reinterpret_cast<const u_int8_t*>(latin1.data());
+    mock_string_info_t str;
+    EXPECT_CALL(str, payload(testing::_, testing::_, testing::_)).WillRepeatedly(DoAll(
+        SetArgReferee<0>(data), SetArgReferee<1>(latin1.size()), SetArgReferee<2>(string_info_t::ENCODING_LATIN1), Return(true)));
+    EXPECT_CALL(str, value()).Times(0);
+
+    ASSERT_FALSE(text_pattern_t(text_pattern_t::KIND_CONTAINS, "\xe2\x82\xac").match(str));
+    ASSERT_FALSE(text_pattern_t(text_pattern_t::KIND_LIKE, "%menu%").match(str));
+    ASSERT_TRUE(text_pattern_t(text_pattern_t::KIND_CONTAINS, "caf\xc3\xa9").match(str));
+}
+
+TEST(text_pattern_t, When_Candidate_Expect_FullMatchOnValue) {
+    std::string latin1 = "caf\xe9 \xe0 la carte";
+    std::string utf8 = "caf\xc3\xa9 \xc3\xa0 la carte";
+    const u_int8_t* data = reinterpret_cast<const u_int8_t*>(latin1.data());
+    mock_string_info_t str;
+    EXPECT_CALL(str, payload(testing::_, testing::_, testing::_)).WillRepeatedly(DoAll(
+        SetArgReferee<0>(data), SetArgReferee<1>(latin1.size()), SetArgReferee<2>(string_info_t::ENCODING_LATIN1), Return(true)));
+    EXPECT_CALL(str, value()).WillRepeatedly(Return(utf8));
+
+    ASSERT_TRUE(text_pattern_t(text_pattern_t::KIND_LIKE, "caf_ %").match(str));
+    ASSERT_FALSE(text_pattern_t(text_pattern_t::KIND_LIKE, "carte%").match(str));
+    ASSERT_TRUE(text_pattern_t(text_pattern_t::KIND_REGEX, "la c[a-z]+e$").match(str));
+    ASSERT_FALSE(text_pattern_t(text_pattern_t::KIND_REGEX, "la c[0-9]+").match(str));
+}
+
+TEST(filter_text_field_t, When_FieldRefersToString_Expect_PatternApplied) {
+    auto hprof = read_sample_dump();
+    auto& objects = hprof->objects_index();
+    auto text_view = objects.find_object(0x3002);
+    auto view = objects.find_object(0x3000);
+
+    filter_text_field_t contains { new field_fetcher_t("mText"), text_pattern_t::KIND_CONTAINS, "ell" };
+    ASSERT_EQ(filter_t::Match, contains(text_view, objects));
+    ASSERT_EQ(filter_t::NoMatch, contains(view, objects));
+
+    filter_text_field_t like { new field_fetcher_t("mText"), text_pattern_t::KIND_LIKE, "h_l%" };
+    ASSERT_EQ(filter_t::Match, like(text_view, objects));
+
+    filter_text_field_t matches { new field_fetcher_t("mText"), text_pattern_t::KIND_REGEX, "^wor" };
+    ASSERT_EQ(filter_t::NoMatch, matches(text_view, objects));
+
+    filter_text_field_t parent { new field_fetcher_t("mParent"), text_pattern_t::KIND_CONTAINS, "" };
+    ASSERT_EQ(filter_t::NoMatch, parent(text_view, objects));
+
+    std::string first;
+    std::string second;
+    ASSERT_TRUE(contains.key(first));
+    ASSERT_TRUE(like.key(second));
+    ASSERT_NE(first, second);
+}
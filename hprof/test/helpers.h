@@ -0,0 +1,88 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#pragma once
+
+#include "hprof_file.h"
+#include "heap_profile.h"
+#include "filters/array.h"
+#include "types/heap_item.h"
+#include "types/primitives_array.h"
+
+#include <atomic>
+#include <memory>
+
+using namespace hprof;
+
+/// Shared fixtures of the tests, every test header includes what it uses
+
+static std::unique_ptr<heap_profile_t> read_sample_dump(const load_options_t& options = load_options_t {}) {
+    auto factory = data_reader_factory_t::create();
+    file_t file { TEST_DATA_DIR "/sample.hprof" };
+    return file.read_dump(*factory, [] (auto, auto) {}, options);
+}
+
+static std::unique_ptr<heap_profile_t> read_sample_dump(size_t query_threads) {
+    load_options_t options;
+    options.query_threads = query_threads;
+    return read_sample_dump(options);
+}
+
+static query_t make_index_query(std::unique_ptr<filter_t>&& filter) {
+    return query_t { query_t::ACTION_SHOW, query_t::SOURCE_OBJECTS, 0, std::move(filter) };
+}
+
+static query_t make_cursor_query(size_t offset, size_t limit) {
+    query_t query { query_t::ACTION_SHOW, query_t::SOURCE_OBJECTS, 0,
+        std::make_unique<filter_array_value_t>(filter_array_value_t::AGGREGATE_MAX, filter_array_value_t::COMPARE_GREATER, filter_comp_value_t { 3 }) };
+    query.offset = offset;
+    query.limit = limit;
+    return query;
+}
+
+static query_t make_aggregate_query(query_t::group_t group) {
+    query_t query { query_t::ACTION_AGGREGATE, query_t::SOURCE_OBJECTS, 0, nullptr };
+    query.group = group;
+    return query;
+}
+
+static void add_aggregation(query_t& query, query_t::aggregate_t function, const char* field = nullptr) {
+    query.aggregations.push_back(query_t::aggregation_t { function, field != nullptr ? std::make_unique<field_fetcher_t>(field) : nullptr });
+}
+
+/// Byte arrays with ids from 1 to count holding id % 7, every third one is in the app heap
+static void fill_cursor_profile(heap_profile_impl_t& hprof, jvm_id_t count) {
+    for (jvm_id_t id = 1; id <= count; ++id) {
+        auto array = primitives_array_info_impl_t::create(4, id, jvm_type_t::JVM_TYPE_BYTE, 1, 1);
+        array->data()[0] = static_cast<u_int8_t>(id % 7);
+        array->set_heap_type(id % 3 == 0 ? heap_info_t::HEAP_APP : heap_info_t::HEAP_ZYGOTE);
+        hprof.add(id, std::make_shared<heap_item_impl_t>(std::move(array)));
+    }
+    hprof.build_indexes();
+}
+
+/// Matches any item and counts the checks, tells how far a scan went
+class filter_count_checks_t : public filter_t {
+public:
+    filter_count_checks_t(std::atomic<size_t>& checks) : _checks(checks) {}
+    virtual ~filter_count_checks_t() {}
+
+    virtual filter_result_t operator()(const heap_item_ptr_t&, const objects_index_t&) const override {
+        ++_checks;
+        return Match;
+    }
+private:
+    std::atomic<size_t>& _checks;
+};
@@ -18,6 +18,21 @@
 #include "test_name_tokenizer.h"
 #include "test_hprof_istream.h"
 #include "test_data_reader_factory.h"
+#include "test_data_reader_v103.h"
+#include "test_query_planner.h"
+#include "test_filter_program.h"
+#include "test_query_pool.h"
+#include "test_query_cursor.h"
+#include "test_query_cache.h"
+#include "test_field_index.h"
+#include "test_string_index.h"
+#include "test_query_aggregator.h"
+#include "test_query_top.h"
+#include "test_query_projection.h"
+#include "test_referrers.h"
+#include "test_query_token.h"
+#include "test_query_profiler.h"
+#include "test_query_sample.h"
 // Test types
 #include "types/test_object.h"
 #include "types/test_fields.h"
@@ -27,11 +42,16 @@
 #include "types/test_string_instance.h"
 #include "types/test_objects_array.h"
 #include "types/test_primitives_array.h"
+#include "types/test_array_kernels.h"
+#include "types/test_text_kernels.h"
+#include "types/test_column_kernels.h"
 #include "test_types.h"
 // Test filters
 #include "filters/test_classname.h"
 #include "filters/test_logical.h"
 #include "filters/test_instance_of.h"
+#include "filters/test_array.h"
+#include "filters/test_text_match.h"
 
 int main(int argc, char* argv[]) {
     ::testing::InitGoogleTest(&argc, argv);
@@ -94,6 +94,7 @@ public:
     MOCK_CONST_METHOD0(class_id, jvm_id_t());
     MOCK_CONST_METHOD0(get_class, class_info_t*());
     MOCK_CONST_METHOD0(fields, fields_values_t&());
+    MOCK_CONST_METHOD0(data, const u_int8_t*());
     MOCK_CONST_METHOD0(stack_trace_id, int32_t());
 };
 
@@ -109,8 +110,10 @@ public:
     MOCK_CONST_METHOD0(class_id, jvm_id_t());
     MOCK_CONST_METHOD0(get_class, class_info_t*());
     MOCK_CONST_METHOD0(fields, fields_values_t&());
+    MOCK_CONST_METHOD0(data, const u_int8_t*());
     MOCK_CONST_METHOD0(stack_trace_id, int32_t());
-    MOCK_CONST_METHOD0(value, const std::string&());
+    MOCK_CONST_METHOD0(value, std::string());
+    MOCK_CONST_METHOD3(payload, bool(const u_int8_t*&, size_t&, encoding_t&));
 };
 
 class mock_class_info_t : public class_info_t {
@@ -131,6 +134,7 @@ public:
     MOCK_CONST_METHOD0(instance_size, size_t());
     MOCK_CONST_METHOD0(fields, const fields_spec_t&());
     MOCK_CONST_METHOD0(static_fields, const fields_values_t&());
+    MOCK_CONST_METHOD0(hierarchy, const class_hierarchy_t&());
     MOCK_CONST_METHOD0(sequence_number, int32_t());
     MOCK_CONST_METHOD0(stack_trace_id, int32_t());
 };
@@ -148,6 +152,7 @@ public:
     MOCK_CONST_METHOD0(length, size_t());
     MOCK_CONST_METHOD0(begin, iterator());
     MOCK_CONST_METHOD0(end, iterator());
+    MOCK_CONST_METHOD0(data, const u_int8_t*());
     
     MOCK_CONST_METHOD1(access_by_index, iterator(size_t));
     virtual iterator operator[](size_t index) const override {
@@ -206,3 +211,12 @@ class mock_objects_index_t : public objects_index_t {
 public:
     MOCK_CONST_METHOD1(find_object, heap_item_ptr_t(jvm_id_t id));
 };
+
+class mock_classes_index_t : public classes_index_t {
+public:
+    MOCK_CONST_METHOD1(find_class, heap_item_ptr_t(jvm_id_t id));
+    MOCK_CONST_METHOD2(find_classes, void(const std::string& name, std::vector<heap_item_ptr_t>& result));
+    MOCK_CONST_METHOD2(find_declaring_classes, void(const std::string& field_name, std::vector<heap_item_ptr_t>& result));
+    MOCK_CONST_METHOD1(count_instances, size_t(const class_hierarchy_t& hierarchy));
+    MOCK_CONST_METHOD0(count_classes, size_t());
+};
@@ -0,0 +1,240 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include "helpers.h"
+#include "types/string_instance.h"
+
+using namespace hprof;
+
+static const primitives_array_info_t* find_primitives_array(const heap_profile_t& hprof, jvm_id_t id) {
+    auto item = hprof.objects_index().find_object(id);
+    if (item == nullptr || item->type() != heap_item_t::PrimitivesArray) {
+        return nullptr;
+    }
+    return static_cast<const primitives_array_info_t*>(*item);
+}
+
+TEST(data_reader_v103_t, When_ReadSampleDump_Expect_NoErrors) {
+    auto hprof = read_sample_dump();
+    ASSERT_NE(nullptr, hprof);
+    ASSERT_FALSE(hprof->has_errors());
+}
+
+TEST(data_reader_v103_t, When_DeduplicationDisabled_Expect_SeparatePayloads) {
+    auto hprof = read_sample_dump();
+    auto first = find_primitives_array(*hprof, 0x1000);
+    auto second = find_primitives_array(*hprof, 0x1001);
+    ASSERT_NE(nullptr, first);
+    ASSERT_NE(nullptr, second);
+    ASSERT_NE(first->data(), second->data());
+}
+
+TEST(data_reader_v103_t, When_DeduplicationEnabled_Expect_IdenticalPayloadsShared) {
+    load_options_t options;
+    options.deduplicate_arrays = true;
+    auto hprof = read_sample_dump(options);
+    auto first = find_primitives_array(*hprof, 0x1000);
+    auto second = find_primitives_array(*hprof, 0x1001);
+    auto other = find_primitives_array(*hprof, 0x1002);
+    ASSERT_NE(nullptr, first);
+    ASSERT_NE(nullptr, second);
+    ASSERT_NE(nullptr, other);
+    ASSERT_EQ(first->data(), second->data());
+    ASSERT_NE(first->data(), other->data());
+    ASSERT_NE(first->id(), second->id());
+    ASSERT_EQ(5, second->length());
+}
+
+static const string_info_t* find_string(const heap_profile_t& hprof, jvm_id_t id) {
+    auto item = hprof.objects_index().find_object(id);
+    if (item == nullptr || item->type() != heap_item_t::String) {
+        return nullptr;
+    }
+    return static_cast<const string_info_t*>(*item);
+}
+
+TEST(data_reader_v103_t, When_ReadString_Expect_ValueDecodedFromBackingArray) {
+    auto hprof = read_sample_dump();
+    auto text = find_string(*hprof, 0x2000);
+    ASSERT_NE(nullptr, text);
+    ASSERT_EQ("hello", text->value());
+    ASSERT_EQ(0x2000, text->id());
+    ASSERT_EQ(0x101, text->class_id());
+    size_t decoded = strings_cache_t::thread_decodes();
+    ASSERT_EQ(text->value(), text->value());
+    ASSERT_EQ(decoded, strings_cache_t::thread_decodes());
+}
+
+TEST(data_reader_v103_t, When_StringsShareBackingPayload_Expect_ValueDecodedOnce) {
+    load_options_t options;
+    options.deduplicate_arrays = true;
+    auto hprof = read_sample_dump(options);
+    auto first = find_string(*hprof, 0x2000);
+    auto second = find_string(*hprof, 0x2001);
+    auto other = find_string(*hprof, 0x2002);
+    ASSERT_NE(nullptr, first);
+    ASSERT_NE(nullptr, second);
+    ASSERT_NE(nullptr, other);
+    size_t decoded = strings_cache_t::thread_decodes();
+    ASSERT_EQ(first->value(), second->value());
+    ASSERT_EQ(decoded + 1, strings_cache_t::thread_decodes());
+    ASSERT_EQ("world", other->value());
+}
+
+TEST(data_reader_v103_t, When_HeapInfoRecords_Expect_HeapTypesAssigned) {
+    auto hprof = read_sample_dump();
+    auto view = hprof->classes_index().find_class(0x102);
+    ASSERT_NE(nullptr, view);
+    ASSERT_EQ(heap_info_t::HEAP_ZYGOTE, static_cast<const class_info_t*>(*view)->heap_type());
+    ASSERT_EQ(heap_info_t::HEAP_APP, find_primitives_array(*hprof, 0x1000)->heap_type());
+    ASSERT_EQ(heap_info_t::HEAP_APP, find_string(*hprof, 0x2000)->heap_type());
+    ASSERT_EQ(heap_info_t::HEAP_IMAGE, find_primitives_array(*hprof, 0x1020)->heap_type());
+}
+
+TEST(data_reader_v103_t, When_QueryInHeap_Expect_OnlyHeapObjects) {
+    auto hprof = read_sample_dump();
+    query_t query;
+    query.action = query_t::ACTION_SHOW;
+    query.source = query_t::SOURCE_OBJECTS;
+
+    std::vector<heap_item_ptr_t> all;
+    ASSERT_TRUE(hprof->query(query, all));
+    ASSERT_EQ(12, all.size());
+
+    query.heaps = 1u << heap_info_t::HEAP_IMAGE;
+    std::vector<heap_item_ptr_t> image;
+    ASSERT_TRUE(hprof->query(query, image));
+    ASSERT_EQ(1, image.size());
+    ASSERT_EQ(0x1020, static_cast<const primitives_array_info_t*>(*image[0])->id());
+
+    query.source = query_t::SOURCE_CLASSES;
+    std::vector<heap_item_ptr_t> classes;
+    ASSERT_TRUE(hprof->query(query, classes));
+    ASSERT_TRUE(classes.empty());
+}
+
+TEST(data_reader_v103_t, When_ClassesLoaded_Expect_HierarchyNumbered) {
+    auto hprof = read_sample_dump();
+    auto hierarchy = [&hprof] (jvm_id_t id) { 
+        return static_cast<const class_info_t*>(*hprof->classes_index().find_class(id))->hierarchy(); 
+    };
+    ASSERT_TRUE(hierarchy(0x102).contains(hierarchy(0x103)));
+    ASSERT_TRUE(hierarchy(0x102).contains(hierarchy(0x104)));
+    ASSERT_TRUE(hierarchy(0x102).contains(hierarchy(0x102)));
+    ASSERT_FALSE(hierarchy(0x103).contains(hierarchy(0x104)));
+    ASSERT_FALSE(hierarchy(0x102).contains(hierarchy(0x101)));
+}
+
+TEST(data_reader_v103_t, When_QueryInstanceOf_Expect_SubclassInstances) {
+    auto hprof = read_sample_dump();
+    query_t query { query_t::ACTION_SHOW, query_t::SOURCE_OBJECTS, 0, std::make_unique<filter_instance_of_t>("android.view.View") };
+    std::vector<heap_item_ptr_t> result;
+    ASSERT_TRUE(hprof->query(query, result));
+    ASSERT_EQ(3, result.size());
+}
+
+TEST(data_reader_v103_t, When_QueryOverlappingClasses_Expect_EachInstanceOnce) {
+    auto hprof = read_sample_dump();
+    query_t query { query_t::ACTION_SHOW, query_t::SOURCE_OBJECTS, 0, 
+        std::make_unique<filter_or_t>(std::make_unique<filter_instance_of_t>("android.view.ViewGroup"), std::make_unique<filter_instance_of_t>("android.view.View")) };
+    std::vector<heap_item_ptr_t> result;
+    ASSERT_TRUE(hprof->query(query, result));
+    ASSERT_EQ(3, result.size());
+}
+
+TEST(data_reader_v103_t, When_QueryInstanceOfAndField_Expect_FilteredInstances) {
+    auto hprof = read_sample_dump();
+    query_t query { query_t::ACTION_SHOW, query_t::SOURCE_OBJECTS, 1u << heap_info_t::HEAP_APP, 
+        std::make_unique<filter_and_t>(std::make_unique<filter_compare_greater_field_t>(new field_fetcher_t("mWidth"), filter_comp_value_t { 60 }), 
+                                       std::make_unique<filter_instance_of_t>("android.view.View")) };
+    std::vector<heap_item_ptr_t> result;
+    ASSERT_TRUE(hprof->query(query, result));
+    ASSERT_EQ(2, result.size());
+
+    query.heaps = 1u << heap_info_t::HEAP_IMAGE;
+    result.clear();
+    ASSERT_TRUE(hprof->query(query, result));
+    ASSERT_TRUE(result.empty());
+}
+
+TEST(data_reader_v103_t, When_BoundFieldPath_Expect_SameValuesAsLookupByName) {
+    auto hprof = read_sample_dump();
+    auto text_view = hprof->objects_index().find_object(0x3002);
+    ASSERT_NE(nullptr, text_view);
+
+    field_fetcher_t fetcher { "mWidth" };
+    fetcher.add("mParent");
+    jvm_int_t unbound = 0;
+    ASSERT_TRUE(fetcher.apply(text_view, hprof->objects_index(), [&unbound] (auto& field) { unbound = static_cast<jvm_int_t>(field); return true; }));
+
+    fetcher.bind(hprof->classes_index());
+    for (int pass = 0; pass < 2; ++pass) {
+        jvm_int_t bound = 0;
+        ASSERT_TRUE(fetcher.apply(text_view, hprof->objects_index(), [&bound] (auto& field) { bound = static_cast<jvm_int_t>(field); return true; }));
+        ASSERT_EQ(200, bound);
+        ASSERT_EQ(unbound, bound);
+    }
+
+    field_fetcher_t missing { "mChildrenCount" };
+    missing.bind(hprof->classes_index());
+    ASSERT_FALSE(missing.apply(text_view, hprof->objects_index(), [] (auto&) { return true; }));
+}
+
+TEST(data_reader_v103_t, When_QueryFieldPath_Expect_MatchingInstances) {
+    auto hprof = read_sample_dump();
+    auto fetcher = new field_fetcher_t("mWidth");
+    fetcher->add("mParent");
+    query_t query { query_t::ACTION_SHOW, query_t::SOURCE_OBJECTS, 0, 
+        std::make_unique<filter_compare_equals_field_t>(fetcher, filter_comp_value_t { 200 }) };
+    std::vector<heap_item_ptr_t> result;
+    ASSERT_TRUE(hprof->query(query, result));
+    ASSERT_EQ(2, result.size());
+}
+
+TEST(data_reader_v103_t, When_SelectBatchOfInstances_Expect_SameAsPerObject) {
+    auto hprof = read_sample_dump();
+    auto& objects = hprof->objects_index();
+
+    std::vector<std::unique_ptr<filter_t>> filters;
+    filters.push_back(std::make_unique<filter_compare_greater_field_t>(new field_fetcher_t("mWidth"), filter_comp_value_t { 60 }));
+    filters.push_back(std::make_unique<filter_compare_equals_field_t>(new field_fetcher_t("mWidth"), filter_comp_value_t { 100.7 }));
+    filters.push_back(std::make_unique<filter_compare_less_field_t>(new field_fetcher_t("mWidth"), filter_comp_value_t { 100.5 }));
+    filters.push_back(std::make_unique<filter_compare_less_field_t>(new field_fetcher_t("mWidth"), filter_comp_value_t { 5000000000.0 }));
+    filters.push_back(std::make_unique<filter_compare_not_equals_field_t>(new field_fetcher_t("mChildrenCount"), filter_comp_value_t { 1 }));
+    filters.push_back(std::make_unique<filter_compare_equals_field_t>(new field_fetcher_t("mWidth"), filter_comp_value_t { true }));
+    filters.push_back(std::make_unique<filter_not_t>(std::make_unique<filter_and_t>(
+        std::make_unique<filter_instance_of_t>("android.widget.TextView"),
+        std::make_unique<filter_compare_greater_or_equals_field_t>(new field_fetcher_t("mWidth"), filter_comp_value_t { 50 }))));
+
+    for (auto& filter : filters) {
+        filter->bind(hprof->classes_index());
+        for (jvm_id_t id : { 0x3000, 0x3001, 0x3002 }) {
+            auto item = objects.find_object(id);
+            std::vector<const heap_item_ptr_t*> batch(70, &item);
+            u_int64_t selection[2];
+            ASSERT_TRUE(filter->select(batch.data(), batch.size(), selection));
+
+            bool expected = (*filter)(item, objects) == filter_t::Match;
+            for (size_t index = 0; index < 128; ++index) {
+                bool selected = ((selection[index / 64] >> (index % 64)) & 1) != 0;
+                ASSERT_EQ(index < batch.size() && expected, selected) << std::hex << id << " at " << std::dec << index;
+            }
+        }
+    }
+}
@@ -0,0 +1,176 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include "helpers.h"
+#include "field_index.h"
+#include "query_planner.h"
+
+#include <algorithm>
+
+using namespace hprof;
+
+static std::unique_ptr<field_index_t> build_width_index(const heap_profile_t& hprof, query_t::index_t kind) {
+    std::vector<heap_item_ptr_t> classes;
+    hprof.classes_index().find_classes("android.view.View", classes);
+    EXPECT_EQ(1u, classes.size());
+    auto cls = static_cast<const class_info_t*>(*classes.front());
+
+    // Items only have to outlive the index, the order stands for the scan order
+    static std::vector<heap_item_ptr_t> views;
+    views.clear();
+    for (jvm_id_t id : { 0x3000, 0x3001, 0x3002 }) {
+        views.push_back(hprof.objects_index().find_object(id));
+    }
+
+    std::vector<const heap_item_ptr_t*> items;
+    for (auto& view : views) {
+        items.push_back(&view);
+    }
+
+    auto index = std::make_unique<field_index_t>(cls->name(), cls->hierarchy(), "mWidth");
+    EXPECT_TRUE(index->build(std::move(items), kind));
+    return index;
+}
+
+static std::unique_ptr<filter_t> make_width_filter(column_kernels_t::compare_t compare, const filter_comp_value_t& literal) {
+    auto fetcher = new field_fetcher_t("mWidth");
+    switch (compare) {
+        case column_kernels_t::COMPARE_EQUALS:
+            return std::make_unique<filter_compare_equals_field_t>(fetcher, literal);
+        case column_kernels_t::COMPARE_NOT_EQUALS:
+            return std::make_unique<filter_compare_not_equals_field_t>(fetcher, literal);
+        case column_kernels_t::COMPARE_LESS:
+            return std::make_unique<filter_compare_less_field_t>(fetcher, literal);
+        case column_kernels_t::COMPARE_LESS_OR_EQUALS:
+            return std::make_unique<filter_compare_less_or_equals_field_t>(fetcher, literal);
+        case column_kernels_t::COMPARE_GREATER:
+            return std::make_unique<filter_compare_greater_field_t>(fetcher, literal);
+        case column_kernels_t::COMPARE_GREATER_OR_EQUALS:
+            return std::make_unique<filter_compare_greater_or_equals_field_t>(fetcher, literal);
+    }
+    return nullptr;
+}
+
+static query_t make_create_index_query(const char* class_name, const char* field, query_t::index_t kind) {
+    query_t query { query_t::ACTION_CREATE_INDEX, query_t::SOURCE_OBJECTS, 0, nullptr };
+    query.index_class = class_name;
+    query.index_field = field;
+    query.index = kind;
+    return query;
+}
+
+TEST(field_index_t, When_Lookup_Expect_EveryMatchReturned) {
+    auto hprof = read_sample_dump();
+    auto& objects = hprof->objects_index();
+    const column_kernels_t::compare_t compares[] = {
+        column_kernels_t::COMPARE_EQUALS, column_kernels_t::COMPARE_LESS, column_kernels_t::COMPARE_LESS_OR_EQUALS,
+        column_kernels_t::COMPARE_GREATER, column_kernels_t::COMPARE_GREATER_OR_EQUALS
+    };
+
+    for (auto kind : { query_t::INDEX_SORTED, query_t::INDEX_HASH, query_t::INDEX_BITMAP }) {
+        auto index = build_width_index(*hprof, kind);
+        ASSERT_EQ(3u, index->size());
+
+        for (auto compare : compares) {
+            for (auto literal : { filter_comp_value_t { 100 }, filter_comp_value_t { 99.5 }, filter_comp_value_t { 500 } }) {
+                size_t count = 0;
+                if (!index->estimate(compare, literal, count)) {
+                    ASSERT_EQ(query_t::INDEX_HASH, kind);
+                    ASSERT_NE(column_kernels_t::COMPARE_EQUALS, compare);
+                    continue;
+                }
+
+                std::vector<const heap_item_ptr_t*> candidates;
+                index->lookup(compare, literal, candidates);
+                ASSERT_GE(count, candidates.size());
+
+                auto filter = make_width_filter(compare, literal);
+                for (jvm_id_t id : { 0x3000, 0x3001, 0x3002 }) {
+                    auto item = objects.find_object(id);
+                    if ((*filter)(item, objects) != filter_t::Match) {
+                        continue;
+                    }
+                    ASSERT_TRUE(std::any_of(candidates.begin(), candidates.end(), [&item] (auto candidate) { return *candidate == item; }));
+                }
+            }
+        }
+    }
+}
+
+TEST(field_index_t, When_NotEqualsOrText_Expect_NotAnswered) {
+    auto hprof = read_sample_dump();
+    auto index = build_width_index(*hprof, query_t::INDEX_SORTED);
+    size_t count = 0;
+    ASSERT_FALSE(index->estimate(column_kernels_t::COMPARE_NOT_EQUALS, filter_comp_value_t { 100 }, count));
+    ASSERT_FALSE(index->estimate(column_kernels_t::COMPARE_EQUALS, filter_comp_value_t { "100" }, count));
+}
+
+TEST(field_index_t, When_SelectiveComparison_Expect_PlannerPicksIndex) {
+    auto hprof = read_sample_dump();
+    auto index = build_width_index(*hprof, query_t::INDEX_AUTO);
+    ASSERT_EQ(field_index_t::KIND_BITMAP, index->kind());
+
+    query_planner_t planner { hprof->classes_index(), 12, 5, { index.get() } };
+    auto selective = make_index_query(std::make_unique<filter_compare_equals_field_t>(new field_fetcher_t("mWidth"), filter_comp_value_t { 100 }));
+    auto plan = planner.plan(selective);
+    ASSERT_EQ(index.get(), plan.index);
+    ASSERT_EQ(1, plan.estimated_items);
+
+    auto wide = make_index_query(std::make_unique<filter_compare_greater_field_t>(new field_fetcher_t("mWidth"), filter_comp_value_t { 10 }));
+    ASSERT_EQ(nullptr, planner.plan(wide).index);
+}
+
+TEST(field_index_t, When_IndexCreated_Expect_SameResults) {
+    auto hprof = read_sample_dump();
+    auto make_queries = [] () {
+        std::vector<query_t> queries;
+        queries.push_back(make_index_query(std::make_unique<filter_compare_equals_field_t>(new field_fetcher_t("mWidth"), filter_comp_value_t { 100 })));
+        queries.push_back(make_index_query(std::make_unique<filter_compare_less_field_t>(new field_fetcher_t("mWidth"), filter_comp_value_t { 60 })));
+        queries.push_back(make_index_query(std::make_unique<filter_and_t>(
+            std::make_unique<filter_instance_of_t>("android.widget.TextView"),
+            std::make_unique<filter_compare_greater_or_equals_field_t>(new field_fetcher_t("mWidth"), filter_comp_value_t { 200 }))));
+        return queries;
+    };
+
+    std::vector<std::vector<heap_item_ptr_t>> expected;
+    for (auto& query : make_queries()) {
+        expected.emplace_back();
+        ASSERT_TRUE(hprof->query(query, expected.back()));
+    }
+
+    for (auto kind : { query_t::INDEX_SORTED, query_t::INDEX_HASH, query_t::INDEX_BITMAP }) {
+        std::vector<heap_item_ptr_t> none;
+        ASSERT_TRUE(hprof->open(make_create_index_query("android.view.View", "mWidth", kind))->fetch(0, none));
+
+        auto queries = make_queries();
+        for (size_t index = 0; index < queries.size(); ++index) {
+            std::vector<heap_item_ptr_t> result;
+            ASSERT_TRUE(hprof->query(queries[index], result));
+            ASSERT_EQ(expected[index], result);
+        }
+    }
+}
+
+TEST(field_index_t, When_ClassOrPrimitiveFieldMissing_Expect_Failed) {
+    auto hprof = read_sample_dump();
+    std::vector<heap_item_ptr_t> none;
+    ASSERT_FALSE(hprof->open(make_create_index_query("android.view.Missing", "mWidth", query_t::INDEX_AUTO))->fetch(0, none));
+    ASSERT_FALSE(hprof->open(make_create_index_query("android.view.View", "mMissing", query_t::INDEX_AUTO))->fetch(0, none));
+    ASSERT_FALSE(hprof->open(make_create_index_query("android.view.View", "mParent", query_t::INDEX_AUTO))->fetch(0, none));
+}
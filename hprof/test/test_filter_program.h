@@ -0,0 +1,152 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include "filter_program.h"
+#include "filters/logical.h"
+#include "filters/instance_of.h"
+#include "filters/comparation.h"
+
+#include "helpers.h"
+#include "mocks.h"
+
+using namespace hprof;
+
+using testing::_;
+using testing::Return;
+
+TEST(filter_program_t, When_NoFilter_Expect_Match) {
+    filter_program_t program;
+    program.compile(nullptr);
+    auto item = std::make_shared<mock_heap_item_t>();
+    mock_objects_index_t objects;
+
+    ASSERT_EQ(0, program.size());
+    ASSERT_EQ(filter_t::Match, program(item, objects));
+}
+
+TEST(filter_program_t, When_NotFail_Expect_Fail) {
+    auto filter = std::make_unique<mock_filter_t>();
+    EXPECT_CALL(*filter, apply_filter(_, _)).Times(2).WillOnce(Return(filter_t::Fail)).WillOnce(Return(filter_t::Match));
+    filter_not_t filter_not { std::move(filter) };
+    filter_program_t program;
+    program.compile(&filter_not);
+    auto item = std::make_shared<mock_heap_item_t>();
+    mock_objects_index_t objects;
+
+    ASSERT_EQ(2, program.size());
+    ASSERT_EQ(filter_t::Fail, program(item, objects));
+    ASSERT_EQ(filter_t::NoMatch, program(item, objects));
+}
+
+TEST(filter_program_t, When_AndLeftNoMatch_Expect_RightSkipped) {
+    auto filter_left = std::make_unique<mock_filter_t>();
+    EXPECT_CALL(*filter_left, apply_filter(_, _)).Times(1).WillOnce(Return(filter_t::NoMatch));
+    auto filter_right = std::make_unique<mock_filter_t>();
+    EXPECT_CALL(*filter_right, apply_filter(_, _)).Times(0);
+
+    filter_and_t filter_and { std::move(filter_left), std::move(filter_right) };
+    filter_program_t program;
+    program.compile(&filter_and);
+    auto item = std::make_shared<mock_heap_item_t>();
+    mock_objects_index_t objects;
+
+    ASSERT_EQ(filter_t::NoMatch, program(item, objects));
+}
+
+TEST(filter_program_t, When_OrLeftNoMatch_Expect_RightResult) {
+    auto filter_left = std::make_unique<mock_filter_t>();
+    EXPECT_CALL(*filter_left, apply_filter(_, _)).Times(1).WillOnce(Return(filter_t::NoMatch));
+    auto filter_right = std::make_unique<mock_filter_t>();
+    EXPECT_CALL(*filter_right, apply_filter(_, _)).Times(1).WillOnce(Return(filter_t::Fail));
+
+    filter_or_t filter_or { std::move(filter_left), std::move(filter_right) };
+    filter_program_t program;
+    program.compile(&filter_or);
+    auto item = std::make_shared<mock_heap_item_t>();
+    mock_objects_index_t objects;
+
+    ASSERT_EQ(filter_t::Fail, program(item, objects));
+}
+
+TEST(filter_program_t, When_NestedAndInsideOr_Expect_SameResultAsTree) {
+    filter_t::filter_result_t results[][3] = {
+        { filter_t::Match, filter_t::Match, filter_t::NoMatch },
+        { filter_t::Match, filter_t::NoMatch, filter_t::Match },
+        { filter_t::NoMatch, filter_t::Match, filter_t::NoMatch },
+        { filter_t::NoMatch, filter_t::NoMatch, filter_t::Fail },
+    };
+    filter_t::filter_result_t expected[] = { filter_t::Match, filter_t::Match, filter_t::NoMatch, filter_t::Fail };
+
+    for (size_t index = 0; index < 4; ++index) {
+        auto a = std::make_unique<mock_filter_t>();
+        auto b = std::make_unique<mock_filter_t>();
+        auto c = std::make_unique<mock_filter_t>();
+        EXPECT_CALL(*a, apply_filter(_, _)).WillRepeatedly(Return(results[index][0]));
+        EXPECT_CALL(*b, apply_filter(_, _)).WillRepeatedly(Return(results[index][1]));
+        EXPECT_CALL(*c, apply_filter(_, _)).WillRepeatedly(Return(results[index][2]));
+
+        filter_or_t filter { std::make_unique<filter_and_t>(std::move(a), std::move(b)), std::move(c) };
+        filter_program_t program;
+        program.compile(&filter);
+        auto item = std::make_shared<mock_heap_item_t>();
+        mock_objects_index_t objects;
+
+        ASSERT_EQ(5, program.size());
+        ASSERT_EQ(expected[index], program(item, objects));
+        ASSERT_EQ(filter(item, objects), program(item, objects));
+    }
+}
+
+TEST(filter_program_t, When_BoundInstanceOf_Expect_InlineCheck) {
+    auto hprof = read_sample_dump();
+
+    filter_instance_of_t filter { "android.view.View" };
+    filter_program_t program;
+    program.compile(&filter);
+    ASSERT_EQ(filter_program_t::OP_CALL, program[0].opcode);
+
+    filter.bind(hprof->classes_index());
+    program.compile(&filter);
+    ASSERT_EQ(1, program.size());
+    ASSERT_EQ(filter_program_t::OP_INSTANCE_OF, program[0].opcode);
+
+    auto& objects = hprof->objects_index();
+    ASSERT_EQ(filter_t::Match, program(objects.find_object(0x3000), objects));
+    ASSERT_EQ(filter_t::Match, program(objects.find_object(0x3002), objects));
+    ASSERT_EQ(filter_t::NoMatch, program(objects.find_object(0x2000), objects));
+    ASSERT_EQ(filter_t::NoMatch, program(objects.find_object(0x1000), objects));
+}
+
+TEST(filter_program_t, When_CompareWithDoubleLiteral_Expect_ResolvedPerFieldType) {
+    auto hprof = read_sample_dump();
+    auto& objects = hprof->objects_index();
+
+    filter_compare_equals_field_t equals { new field_fetcher_t("mWidth"), filter_comp_value_t { 100.7 } };
+    ASSERT_EQ(filter_t::Match, equals(objects.find_object(0x3000), objects));
+
+    filter_compare_less_field_t less { new field_fetcher_t("mWidth"), filter_comp_value_t { 100.7 } };
+    ASSERT_EQ(filter_t::Match, less(objects.find_object(0x3000), objects));
+    ASSERT_EQ(filter_t::NoMatch, less(objects.find_object(0x3001), objects));
+
+    filter_compare_equals_field_t text { new field_fetcher_t("mWidth"), filter_comp_value_t { "100" } };
+    ASSERT_EQ(filter_t::NoMatch, text(objects.find_object(0x3000), objects));
+
+    filter_compare_not_equals_field_t not_equals { new field_fetcher_t("mText"), filter_comp_value_t { "world" } };
+    ASSERT_EQ(filter_t::Match, not_equals(objects.find_object(0x3002), objects));
+}
@@ -0,0 +1,182 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include "helpers.h"
+#include "heap_profile.h"
+#include "query_aggregator.h"
+
+#include <limits>
+
+using namespace hprof;
+
+static void expect_int(int64_t expected, const aggregate_value_t& value) {
+    EXPECT_FALSE(value.empty);
+    EXPECT_TRUE(value.integral);
+    EXPECT_EQ(expected, value.int_value);
+}
+
+TEST(query_aggregator_t, When_NoGroup_Expect_SingleRowOfAllMatches) {
+    auto hprof = read_sample_dump(1);
+    ASSERT_NE(nullptr, hprof);
+
+    auto query = make_aggregate_query(query_t::GROUP_NONE);
+    add_aggregation(query, query_t::AGGREGATE_COUNT);
+    add_aggregation(query, query_t::AGGREGATE_SUM, "mWidth");
+    add_aggregation(query, query_t::AGGREGATE_MIN, "mWidth");
+    add_aggregation(query, query_t::AGGREGATE_MAX, "mWidth");
+
+    std::vector<heap_item_ptr_t> objects;
+    ASSERT_TRUE(hprof->query(make_index_query(nullptr), objects));
+
+    std::vector<aggregate_row_t> rows;
+    ASSERT_TRUE(hprof->aggregate(query, rows));
+    ASSERT_EQ(1u, rows.size());
+    ASSERT_EQ(4u, rows[0].values.size());
+    expect_int(static_cast<int64_t>(objects.size()), rows[0].values[0]);
+    expect_int(350, rows[0].values[1]);
+    expect_int(50, rows[0].values[2]);
+    expect_int(200, rows[0].values[3]);
+}
+
+TEST(query_aggregator_t, When_NothingMatches_Expect_ZeroCountAndEmptyValues) {
+    auto hprof = read_sample_dump(1);
+    ASSERT_NE(nullptr, hprof);
+
+    auto query = make_aggregate_query(query_t::GROUP_NONE);
+    query.filter = std::make_unique<filter_instance_of_t>("no.such.Class");
+    add_aggregation(query, query_t::AGGREGATE_COUNT);
+    add_aggregation(query, query_t::AGGREGATE_SUM, "mWidth");
+
+    std::vector<aggregate_row_t> rows;
+    ASSERT_TRUE(hprof->aggregate(query, rows));
+    ASSERT_EQ(1u, rows.size());
+    expect_int(0, rows[0].values[0]);
+    EXPECT_TRUE(rows[0].values[1].empty);
+}
+
+TEST(query_aggregator_t, When_GroupByClass_Expect_RowPerClassOrderedByName) {
+    auto hprof = read_sample_dump(1);
+    ASSERT_NE(nullptr, hprof);
+
+    auto query = make_aggregate_query(query_t::GROUP_CLASS);
+    add_aggregation(query, query_t::AGGREGATE_COUNT);
+    add_aggregation(query, query_t::AGGREGATE_MAX, "mWidth");
+
+    std::vector<aggregate_row_t> rows;
+    ASSERT_TRUE(hprof->aggregate(query, rows));
+
+    std::vector<std::string> groups;
+    for (auto& row : rows) {
+        groups.push_back(row.group);
+    }
+    ASSERT_EQ((std::vector<std::string> { "android.view.View", "android.view.ViewGroup", "android.widget.TextView", "byte[]", "char[]", "int[]", "java.lang.String" }), groups);
+
+    expect_int(1, rows[0].values[0]);
+    expect_int(100, rows[0].values[1]);
+    expect_int(200, rows[1].values[1]);
+    expect_int(50, rows[2].values[1]);
+    expect_int(2, rows[3].values[0]);
+    EXPECT_TRUE(rows[3].values[1].empty);
+    expect_int(3, rows[4].values[0]);
+    expect_int(3, rows[6].values[0]);
+}
+
+TEST(query_aggregator_t, When_GroupByField_Expect_RenderedValues) {
+    auto hprof = read_sample_dump(1);
+    ASSERT_NE(nullptr, hprof);
+
+    auto query = make_aggregate_query(query_t::GROUP_FIELD);
+    query.filter = std::make_unique<filter_instance_of_t>("android.view.View");
+    query.group_field = std::make_unique<field_fetcher_t>("mParent");
+    add_aggregation(query, query_t::AGGREGATE_COUNT);
+
+    std::vector<aggregate_row_t> rows;
+    ASSERT_TRUE(hprof->aggregate(query, rows));
+    ASSERT_EQ(2u, rows.size());
+    EXPECT_EQ("android.view.ViewGroup@0x3001", rows[0].group);
+    expect_int(2, rows[0].values[0]);
+    EXPECT_EQ("null", rows[1].group);
+    expect_int(1, rows[1].values[0]);
+
+    query.group_field = std::make_unique<field_fetcher_t>("mText");
+    rows.clear();
+    ASSERT_TRUE(hprof->aggregate(query, rows));
+    ASSERT_EQ(2u, rows.size());
+    EXPECT_EQ("\"hello\"", rows[0].group);
+    EXPECT_EQ("<none>", rows[1].group);
+    expect_int(2, rows[1].values[0]);
+}
+
+TEST(query_aggregator_t, When_LimitAndOffset_Expect_SliceOfGroups) {
+    auto hprof = read_sample_dump(1);
+    ASSERT_NE(nullptr, hprof);
+
+    auto query = make_aggregate_query(query_t::GROUP_CLASS);
+    add_aggregation(query, query_t::AGGREGATE_COUNT);
+    query.offset = 3;
+    query.limit = 2;
+
+    std::vector<aggregate_row_t> rows;
+    ASSERT_TRUE(hprof->aggregate(query, rows));
+    ASSERT_EQ(2u, rows.size());
+    EXPECT_EQ("byte[]", rows[0].group);
+    EXPECT_EQ("char[]", rows[1].group);
+}
+
+TEST(query_aggregator_t, When_NotAggregate_Expect_NoRowsAndCursorFails) {
+    auto hprof = read_sample_dump(1);
+    ASSERT_NE(nullptr, hprof);
+
+    std::vector<aggregate_row_t> rows;
+    ASSERT_FALSE(hprof->aggregate(make_index_query(nullptr), rows));
+
+    auto query = make_aggregate_query(query_t::GROUP_NONE);
+    add_aggregation(query, query_t::AGGREGATE_COUNT);
+    std::vector<heap_item_ptr_t> items;
+    ASSERT_FALSE(hprof->open(query)->fetch(10, items));
+}
+
+TEST(query_aggregator_t, When_Threads_Expect_SameRowsAsSerial) {
+    heap_profile_impl_t hprof { std::vector<gc_root_impl_ptr_t> {} };
+    fill_cursor_profile(hprof, 50000);
+
+    std::vector<aggregate_row_t> expected;
+    for (size_t threads : { 1, 4 }) {
+        hprof.set_query_threads(threads);
+
+        auto query = make_cursor_query(0, std::numeric_limits<size_t>::max());
+        query.action = query_t::ACTION_AGGREGATE;
+        query.group = query_t::GROUP_CLASS;
+        add_aggregation(query, query_t::AGGREGATE_COUNT);
+
+        std::vector<aggregate_row_t> rows;
+        ASSERT_TRUE(hprof.aggregate(query, rows));
+        ASSERT_EQ(1u, rows.size());
+        EXPECT_EQ("byte[]", rows[0].group);
+        if (threads == 1) {
+            expected = rows;
+            continue;
+        }
+        expect_int(expected[0].values[0].int_value, rows[0].values[0]);
+    }
+
+    std::vector<heap_item_ptr_t> items;
+    ASSERT_TRUE(hprof.query(make_cursor_query(0, std::numeric_limits<size_t>::max()), items));
+    expect_int(static_cast<int64_t>(items.size()), expected[0].values[0]);
+}
@@ -0,0 +1,157 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include "helpers.h"
+#include "query_cache.h"
+#include "heap_profile.h"
+
+using namespace hprof;
+
+namespace {
+    class filter_keyed_count_checks_t : public filter_count_checks_t {
+    public:
+        filter_keyed_count_checks_t(std::atomic<size_t>& checks) : filter_count_checks_t(checks) {}
+        virtual ~filter_keyed_count_checks_t() {}
+
+        virtual bool key(std::string& out) const override {
+            out += "counted";
+            return true;
+        }
+    };
+}
+
+static std::unique_ptr<filter_t> make_field_equals(const char* field, int value) {
+    return std::make_unique<filter_compare_equals_field_t>(new field_fetcher_t(field), filter_comp_value_t { value });
+}
+
+static std::string query_key(std::unique_ptr<filter_t>&& filter, u_int32_t heaps = 0) {
+    query_t query { query_t::ACTION_SHOW, query_t::SOURCE_OBJECTS, heaps, std::move(filter) };
+    std::string key;
+    EXPECT_TRUE(query_cache_t::key(query, key));
+    return key;
+}
+
+TEST(query_cache_t, When_OperandsReordered_Expect_SameKey) {
+    auto first = query_key(std::make_unique<filter_and_t>(make_field_equals("a", 1),
+        std::make_unique<filter_and_t>(make_field_equals("b", 2), std::make_unique<filter_instance_of_t>("C"))));
+    auto second = query_key(std::make_unique<filter_and_t>(
+        std::make_unique<filter_and_t>(std::make_unique<filter_instance_of_t>("C"), make_field_equals("a", 1)), make_field_equals("b", 2)));
+    ASSERT_EQ(first, second);
+
+    auto mixed = query_key(std::make_unique<filter_and_t>(make_field_equals("a", 1),
+        std::make_unique<filter_or_t>(make_field_equals("b", 2), std::make_unique<filter_instance_of_t>("C"))));
+    ASSERT_NE(first, mixed);
+}
+
+TEST(query_cache_t, When_LiteralOrHeapsDiffer_Expect_DifferentKeys) {
+    auto int_literal = query_key(make_field_equals("a", 1));
+    auto double_literal = query_key(std::make_unique<filter_compare_equals_field_t>(new field_fetcher_t("a"), filter_comp_value_t { 1.0 }));
+    ASSERT_NE(int_literal, double_literal);
+    ASSERT_NE(int_literal, query_key(make_field_equals("a", 1), 1u << heap_info_t::HEAP_APP));
+    ASSERT_NE(int_literal, query_key(std::make_unique<filter_not_t>(make_field_equals("a", 1))));
+}
+
+TEST(query_cache_t, When_FilterNotKeyed_Expect_NoKey) {
+    std::atomic<size_t> checks { 0 };
+    query_t query { query_t::ACTION_SHOW, query_t::SOURCE_OBJECTS, 0,
+        std::make_unique<filter_and_t>(make_field_equals("a", 1), std::make_unique<filter_count_checks_t>(checks)) };
+    std::string key;
+    ASSERT_FALSE(query_cache_t::key(query, key));
+}
+
+TEST(query_cache_t, When_OverCapacity_Expect_LeastRecentlyUsedEvicted) {
+    heap_item_ptr_t items[3];
+    auto make_entry = [&items] (bool complete) {
+        auto entry = std::make_shared<query_cache_t::entry_t>();
+        entry->items.assign({ &items[0], &items[1], &items[2] });
+        entry->items.shrink_to_fit();
+        entry->complete = complete;
+        return entry;
+    };
+
+    size_t entry_cost = query_cache_t::cost("a", *make_entry(true));
+    query_cache_t cache { entry_cost * 2 };
+    cache.store("a", make_entry(true));
+    cache.store("b", make_entry(true));
+    ASSERT_NE(nullptr, cache.find("a"));
+
+    cache.store("c", make_entry(true));
+    ASSERT_EQ(2u, cache.entries());
+    ASSERT_NE(nullptr, cache.find("a"));
+    ASSERT_EQ(nullptr, cache.find("b"));
+    ASSERT_NE(nullptr, cache.find("c"));
+    ASSERT_GE(cache.capacity(), cache.used());
+}
+
+TEST(query_cache_t, When_ShorterPrefixStored_Expect_LongerKept) {
+    heap_item_ptr_t items[3];
+    query_cache_t cache { 1 << 20 };
+
+    auto complete = std::make_shared<query_cache_t::entry_t>();
+    complete->items.assign({ &items[0], &items[1], &items[2] });
+    complete->complete = true;
+    cache.store("a", std::move(complete));
+
+    auto prefix = std::make_shared<query_cache_t::entry_t>();
+    prefix->items.assign({ &items[0] });
+    prefix->complete = false;
+    cache.store("a", std::move(prefix));
+
+    auto found = cache.find("a");
+    ASSERT_NE(nullptr, found);
+    ASSERT_TRUE(found->complete);
+    ASSERT_EQ(3u, found->items.size());
+}
+
+TEST(query_cache_t, When_QueryRepeated_Expect_NoScan) {
+    heap_profile_impl_t hprof { std::vector<gc_root_impl_ptr_t> {} };
+    fill_cursor_profile(hprof, 50000);
+    hprof.set_query_threads(1);
+    hprof.set_query_cache_size(1 << 20);
+
+    std::atomic<size_t> checks { 0 };
+    query_t query { query_t::ACTION_SHOW, query_t::SOURCE_OBJECTS, 0, std::make_unique<filter_keyed_count_checks_t>(checks) };
+    query.limit = 10;
+
+    std::vector<heap_item_ptr_t> first;
+    ASSERT_TRUE(hprof.query(query, first));
+    size_t scanned = checks.load();
+    ASSERT_LT(scanned, 50000u);
+
+    // Served from the recorded prefix
+    query.offset = 5;
+    query.limit = 5;
+    std::vector<heap_item_ptr_t> second;
+    ASSERT_TRUE(hprof.query(query, second));
+    ASSERT_EQ(scanned, checks.load());
+    ASSERT_EQ(std::vector<heap_item_ptr_t>(first.begin() + 5, first.end()), second);
+
+    // The prefix is too short, the full scan replaces it
+    query.offset = 0;
+    query.limit = std::numeric_limits<size_t>::max();
+    std::vector<heap_item_ptr_t> all;
+    ASSERT_TRUE(hprof.query(query, all));
+    ASSERT_EQ(50000u, all.size());
+    size_t full = checks.load();
+
+    std::vector<heap_item_ptr_t> again;
+    ASSERT_TRUE(hprof.query(query, again));
+    ASSERT_EQ(full, checks.load());
+    ASSERT_EQ(all, again);
+}
@@ -0,0 +1,103 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include "helpers.h"
+#include "query_cursor.h"
+#include "heap_profile.h"
+#include "types/heap_item.h"
+#include "types/primitives_array.h"
+
+#include <atomic>
+
+using namespace hprof;
+
+TEST(query_cursor_t, When_LimitAndOffset_Expect_SliceOfFullResult) {
+    heap_profile_impl_t hprof { std::vector<gc_root_impl_ptr_t> {} };
+    fill_cursor_profile(hprof, 50000);
+
+    for (size_t threads : { 1, 4 }) {
+        hprof.set_query_threads(threads);
+
+        std::vector<heap_item_ptr_t> all;
+        ASSERT_TRUE(hprof.query(make_cursor_query(0, std::numeric_limits<size_t>::max()), all));
+
+        std::vector<heap_item_ptr_t> slice;
+        ASSERT_TRUE(hprof.query(make_cursor_query(20000, 50), slice));
+        ASSERT_EQ(std::vector<heap_item_ptr_t>(all.begin() + 20000, all.begin() + 20050), slice);
+
+        std::vector<heap_item_ptr_t> tail;
+        ASSERT_TRUE(hprof.query(make_cursor_query(all.size() - 10, 100), tail));
+        ASSERT_EQ(std::vector<heap_item_ptr_t>(all.end() - 10, all.end()), tail);
+
+        std::vector<heap_item_ptr_t> none;
+        ASSERT_TRUE(hprof.query(make_cursor_query(all.size() + 1, 100), none));
+        ASSERT_TRUE(none.empty());
+    }
+}
+
+TEST(query_cursor_t, When_FetchPages_Expect_SameAsFullResult) {
+    heap_profile_impl_t hprof { std::vector<gc_root_impl_ptr_t> {} };
+    fill_cursor_profile(hprof, 50000);
+    hprof.set_query_threads(4);
+
+    auto query = make_cursor_query(0, std::numeric_limits<size_t>::max());
+    std::vector<heap_item_ptr_t> all;
+    ASSERT_TRUE(hprof.query(query, all));
+
+    auto cursor = hprof.open(query);
+    std::vector<heap_item_ptr_t> pages;
+    while (!cursor->done()) {
+        size_t before = pages.size();
+        ASSERT_TRUE(cursor->fetch(777, pages));
+        ASSERT_GE(777u, pages.size() - before);
+    }
+    ASSERT_EQ(all, pages);
+}
+
+TEST(query_cursor_t, When_LimitReached_Expect_ScanStopped) {
+    heap_profile_impl_t hprof { std::vector<gc_root_impl_ptr_t> {} };
+    fill_cursor_profile(hprof, 50000);
+    hprof.set_query_threads(1);
+
+    std::atomic<size_t> checks { 0 };
+    query_t query { query_t::ACTION_SHOW, query_t::SOURCE_OBJECTS, 0, std::make_unique<filter_count_checks_t>(checks) };
+    query.limit = 10;
+
+    std::vector<heap_item_ptr_t> result;
+    ASSERT_TRUE(hprof.query(query, result));
+    ASSERT_EQ(10u, result.size());
+    ASSERT_LT(checks.load(), 50000u);
+}
+
+TEST(query_cursor_t, When_CallbackStops_Expect_NoMoreItems) {
+    heap_profile_impl_t hprof { std::vector<gc_root_impl_ptr_t> {} };
+    fill_cursor_profile(hprof, 50000);
+    hprof.set_query_threads(4);
+
+    auto query = make_cursor_query(0, std::numeric_limits<size_t>::max());
+    std::vector<heap_item_ptr_t> all;
+    ASSERT_TRUE(hprof.query(query, all));
+
+    std::vector<heap_item_ptr_t> seen;
+    ASSERT_TRUE(hprof.query(query, [&seen] (const heap_item_ptr_t& item) {
+        seen.push_back(item);
+        return seen.size() < 5;
+    }));
+    ASSERT_EQ(std::vector<heap_item_ptr_t>(all.begin(), all.begin() + 5), seen);
+}
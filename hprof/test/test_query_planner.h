@@ -0,0 +1,107 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include "helpers.h"
+#include "query_planner.h"
+
+using namespace hprof;
+
+TEST(query_planner_t, When_NoFilter_Expect_FullScan) {
+    auto hprof = read_sample_dump();
+    query_planner_t planner { hprof->classes_index(), 12, 5 };
+    query_t query { query_t::ACTION_SHOW, query_t::SOURCE_OBJECTS, 0, nullptr };
+    auto plan = planner.plan(query);
+    ASSERT_FALSE(plan.use_class_index);
+    ASSERT_EQ(12, plan.estimated_items);
+}
+
+TEST(query_planner_t, When_FieldFilter_Expect_DeclaringClassesOnly) {
+    auto hprof = read_sample_dump();
+    query_planner_t planner { hprof->classes_index(), 12, 5 };
+    query_t query { query_t::ACTION_SHOW, query_t::SOURCE_OBJECTS, 0, 
+        std::make_unique<filter_compare_equals_field_t>(new field_fetcher_t("mText"), filter_comp_value_t { "hello" }) };
+    auto plan = planner.plan(query);
+    ASSERT_TRUE(plan.use_class_index);
+    ASSERT_EQ(1, plan.hierarchies.size());
+    ASSERT_EQ(1, plan.estimated_items);
+}
+
+TEST(query_planner_t, When_UnknownField_Expect_NothingToVisit) {
+    auto hprof = read_sample_dump();
+    query_planner_t planner { hprof->classes_index(), 12, 5 };
+    query_t query { query_t::ACTION_SHOW, query_t::SOURCE_OBJECTS, 0, 
+        std::make_unique<filter_compare_equals_field_t>(new field_fetcher_t("mMissing"), filter_comp_value_t { 1 }) };
+    auto plan = planner.plan(query);
+    ASSERT_TRUE(plan.use_class_index);
+    ASSERT_TRUE(plan.hierarchies.empty());
+    ASSERT_EQ(0, plan.estimated_items);
+
+    std::vector<heap_item_ptr_t> result;
+    ASSERT_TRUE(hprof->query(query, result));
+    ASSERT_TRUE(result.empty());
+}
+
+TEST(query_planner_t, When_AndOperands_Expect_MostSelectiveFirst) {
+    auto hprof = read_sample_dump();
+    query_planner_t planner { hprof->classes_index(), 12, 5 };
+    query_t query { query_t::ACTION_SHOW, query_t::SOURCE_OBJECTS, 0, 
+        std::make_unique<filter_and_t>(std::make_unique<filter_instance_of_t>("android.view.View"),
+                                       std::make_unique<filter_instance_of_t>("android.widget.TextView")) };
+    auto plan = planner.plan(query);
+    ASSERT_TRUE(plan.use_class_index);
+    ASSERT_EQ(1, plan.estimated_items);
+}
+
+TEST(query_planner_t, When_SourceClasses_Expect_FullScan) {
+    auto hprof = read_sample_dump();
+    query_planner_t planner { hprof->classes_index(), 12, 5 };
+    query_t query { query_t::ACTION_SHOW, query_t::SOURCE_CLASSES, 0, std::make_unique<filter_instance_of_t>("android.view.View") };
+    auto plan = planner.plan(query);
+    ASSERT_FALSE(plan.use_class_index);
+    ASSERT_EQ(5, plan.estimated_items);
+}
+
+class filter_count_binds_t : public filter_t {
+public:
+    filter_count_binds_t(size_t& binds) : _binds(binds) {}
+    virtual ~filter_count_binds_t() {}
+
+    virtual filter_result_t operator()(const heap_item_ptr_t&, const objects_index_t&) const override { return Match; }
+    virtual void bind(const classes_index_t&) override { ++_binds; }
+    virtual void bind_objects(const objects_index_t&) override { ++_binds; }
+private:
+    size_t& _binds;
+};
+
+TEST(query_planner_t, When_QueryPlannedAgain_Expect_FilterBoundOnce) {
+    auto hprof = read_sample_dump();
+    size_t binds = 0;
+    query_t query { query_t::ACTION_SHOW, query_t::SOURCE_OBJECTS, 0, std::make_unique<filter_count_binds_t>(binds) };
+
+    auto first = hprof->open(query);
+    ASSERT_EQ(2, binds);
+    auto second = hprof->open(query);
+    std::vector<explain_node_t> nodes;
+    ASSERT_TRUE(hprof->explain(query, nodes));
+    ASSERT_EQ(2, binds);
+
+    std::vector<heap_item_ptr_t> items;
+    ASSERT_TRUE(first->fetch(std::numeric_limits<size_t>::max(), items));
+    ASSERT_FALSE(items.empty());
+}
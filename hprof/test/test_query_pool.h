@@ -0,0 +1,70 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include "helpers.h"
+#include "query_pool.h"
+#include "heap_profile.h"
+
+#include <atomic>
+#include <limits>
+
+using namespace hprof;
+
+TEST(query_pool_t, When_ZeroThreads_Expect_HardwareThreads) {
+    query_pool_t pool { 0 };
+    ASSERT_LE(1, pool.threads());
+}
+
+TEST(query_pool_t, When_SingleThread_Expect_ChunksInOrder) {
+    query_pool_t pool { 1 };
+    std::vector<size_t> chunks;
+    pool.run(5, [&chunks] (size_t chunk) { chunks.push_back(chunk); });
+    ASSERT_EQ((std::vector<size_t> { 0, 1, 2, 3, 4 }), chunks);
+}
+
+TEST(query_pool_t, When_ManyChunks_Expect_EveryChunkOnce) {
+    query_pool_t pool { 4 };
+    for (int pass = 0; pass < 50; ++pass) {
+        std::unique_ptr<std::atomic<int>[]> calls { new std::atomic<int>[1000] };
+        for (size_t index = 0; index < 1000; ++index) {
+            calls[index] = 0;
+        }
+        pool.run(1000, [&calls] (size_t chunk) { ++calls[chunk]; });
+        for (size_t index = 0; index < 1000; ++index) {
+            ASSERT_EQ(1, calls[index].load()) << "chunk " << index << " pass " << pass;
+        }
+    }
+}
+
+TEST(query_pool_t, When_QueryOnThreads_Expect_SameOrderAsSerial) {
+    heap_profile_impl_t hprof { std::vector<gc_root_impl_ptr_t> {} };
+    fill_cursor_profile(hprof, 50000);
+    auto query = make_cursor_query(0, std::numeric_limits<size_t>::max());
+
+    hprof.set_query_threads(1);
+    std::vector<heap_item_ptr_t> serial;
+    ASSERT_TRUE(hprof.query(query, serial));
+
+    hprof.set_query_threads(4);
+    std::vector<heap_item_ptr_t> parallel;
+    ASSERT_TRUE(hprof.query(query, parallel));
+
+    ASSERT_LT(20000u, serial.size());
+    ASSERT_EQ(serial, parallel);
+}
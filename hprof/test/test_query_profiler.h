@@ -0,0 +1,189 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include "helpers.h"
+#include "heap_profile.h"
+#include "query_profiler.h"
+#include "mocks.h"
+
+#include <limits>
+#include <thread>
+
+using namespace hprof;
+
+static query_t make_explain_query(query_t::explain_t explain) {
+    // Views wider than 60 are View 0x3000 and ViewGroup 0x3001
+    query_t query { query_t::ACTION_SHOW, query_t::SOURCE_OBJECTS, 0,
+        std::make_unique<filter_and_t>(
+            std::make_unique<filter_compare_greater_field_t>(new field_fetcher_t("mWidth"), filter_comp_value_t { 60 }),
+            std::make_unique<filter_instance_of_t>("android.view.View")) };
+    query.explain = explain;
+    return query;
+}
+
+TEST(query_profiler_t, When_Explain_Expect_PlanWithoutCounters) {
+    auto hprof = read_sample_dump(1);
+    ASSERT_NE(nullptr, hprof);
+
+    auto query = make_explain_query(query_t::EXPLAIN_PLAN);
+    std::vector<explain_node_t> nodes;
+    ASSERT_TRUE(hprof->explain(query, nodes));
+    ASSERT_EQ(4u, nodes.size());
+
+    EXPECT_EQ(0u, nodes[0].depth);
+    EXPECT_EQ(0u, nodes[0].name.find("scan class index"));
+    EXPECT_EQ(3u, nodes[0].estimated);
+    EXPECT_EQ("and", nodes[1].name);
+    EXPECT_EQ(1u, nodes[1].depth);
+    EXPECT_EQ(2u, nodes[2].depth);
+    EXPECT_EQ(2u, nodes[3].depth);
+    for (auto& node : nodes) {
+        EXPECT_EQ(0u, node.items_in);
+        EXPECT_EQ(0u, node.items_out);
+    }
+
+    // Explained queries have no items
+    std::vector<heap_item_ptr_t> result;
+    ASSERT_FALSE(hprof->query(query, result));
+}
+
+TEST(query_profiler_t, When_ExplainAnalyze_Expect_CountersOfEveryOperator) {
+    for (size_t threads : { 1, 4 }) {
+        auto hprof = read_sample_dump(threads);
+        ASSERT_NE(nullptr, hprof);
+
+        auto query = make_explain_query(query_t::EXPLAIN_ANALYZE);
+        std::vector<explain_node_t> nodes;
+        ASSERT_TRUE(hprof->explain(query, nodes));
+        ASSERT_EQ(4u, nodes.size());
+
+        EXPECT_EQ(3u, nodes[0].items_in);
+        EXPECT_EQ(2u, nodes[0].items_out);
+        EXPECT_EQ(3u, nodes[1].items_in);
+        EXPECT_EQ(2u, nodes[1].items_out);
+        // The right operand of AND sees only matches of the left one
+        EXPECT_EQ(nodes[2].items_out, nodes[3].items_in);
+        EXPECT_EQ(nodes[1].items_out, nodes[3].items_out);
+        EXPECT_LE(nodes[2].time.count(), nodes[1].time.count());
+    }
+}
+
+TEST(query_profiler_t, When_FieldDereferenced_Expect_FindObjectCounted) {
+    auto hprof = read_sample_dump(1);
+    ASSERT_NE(nullptr, hprof);
+
+    query_t query { query_t::ACTION_SHOW, query_t::SOURCE_OBJECTS, 0,
+        std::make_unique<filter_text_field_t>(new field_fetcher_t("mText"), text_pattern_t::KIND_CONTAINS, "ell") };
+    query.explain = query_t::EXPLAIN_ANALYZE;
+
+    std::vector<explain_node_t> nodes;
+    ASSERT_TRUE(hprof->explain(query, nodes));
+    ASSERT_EQ(2u, nodes.size());
+    EXPECT_EQ(1u, nodes[1].items_out);
+    EXPECT_LT(0u, nodes[1].find_object_calls);
+}
+
+TEST(query_profiler_t, When_SubqueryAnalyzed_Expect_ItsCountersNested) {
+    auto hprof = read_sample_dump(1);
+    ASSERT_NE(nullptr, hprof);
+
+    // View and TextView hold the ViewGroup in mParent
+    query_t query { query_t::ACTION_SHOW, query_t::SOURCE_OBJECTS, 0, nullptr };
+    query.relation = query_t::RELATION_REFERRING_TO;
+    query.related = std::make_unique<query_t>(query_t { query_t::ACTION_SHOW, query_t::SOURCE_OBJECTS, 0,
+        std::make_unique<filter_instance_of_t>("android.view.ViewGroup") });
+    query.explain = query_t::EXPLAIN_ANALYZE;
+
+    std::vector<explain_node_t> nodes;
+    ASSERT_TRUE(hprof->explain(query, nodes));
+    ASSERT_EQ(3u, nodes.size());
+    EXPECT_EQ(2u, nodes[0].items_out);
+    EXPECT_EQ(0u, nodes[1].name.find("subquery "));
+    EXPECT_EQ(1u, nodes[1].depth);
+    EXPECT_EQ(1u, nodes[1].items_out);
+    EXPECT_EQ(2u, nodes[2].depth);
+    EXPECT_EQ(1u, nodes[2].items_in);
+}
+
+TEST(query_profiler_t, When_AggregateAnalyzed_Expect_RowsCounted) {
+    auto hprof = read_sample_dump(4);
+    ASSERT_NE(nullptr, hprof);
+
+    auto query = make_aggregate_query(query_t::GROUP_CLASS);
+    add_aggregation(query, query_t::AGGREGATE_COUNT);
+    query.explain = query_t::EXPLAIN_ANALYZE;
+
+    std::vector<explain_node_t> nodes;
+    ASSERT_TRUE(hprof->explain(query, nodes));
+    ASSERT_EQ(2u, nodes.size());
+    EXPECT_EQ("aggregate group by class", nodes[0].name);
+    EXPECT_EQ(12u, nodes[0].items_in);
+    EXPECT_EQ(7u, nodes[0].items_out);
+    EXPECT_EQ("scan heaps", nodes[1].name);
+    EXPECT_EQ(1u, nodes[1].depth);
+    EXPECT_EQ(12u, nodes[1].items_out);
+
+    std::vector<aggregate_row_t> rows;
+    ASSERT_FALSE(hprof->aggregate(query, rows));
+}
+
+TEST(query_profiler_t, When_Formatted_Expect_IndentedLine) {
+    explain_node_t node { 2, "and", 10, 8, 4, 1, 0, std::chrono::milliseconds(3) };
+
+    std::string plain;
+    query_profiler_t::format(node, false, plain);
+    ASSERT_EQ("    -> and (estimated 10)", plain);
+
+    std::string analyzed;
+    query_profiler_t::format(node, true, analyzed);
+    ASSERT_EQ("    -> and (estimated 10) in=8 out=4 (50.0%) find_object=1 decoded=0 time=3.000ms", analyzed);
+}
+
+TEST(query_profiler_t, When_CalledFromThreads_Expect_CountersOfAllThreadsSummed) {
+    mock_objects_index_t objects;
+    std::atomic<size_t> checks { 0 };
+    filter_count_checks_t filter { checks };
+    query_profiler_t profiler;
+    profiler.attach(&filter);
+
+    std::vector<std::thread> threads;
+    for (size_t thread = 0; thread < 4; ++thread) {
+        threads.emplace_back([&profiler, &objects] () {
+            for (size_t index = 0; index < 1000; ++index) {
+                profiler(heap_item_ptr_t {}, objects);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    ASSERT_EQ(4000u, checks.load());
+    ASSERT_EQ(4000u, profiler.scanned());
+    ASSERT_EQ(4000u, profiler.matched());
+
+    std::vector<explain_node_t> nodes;
+    profiler.report(0, mock_classes_index_t {}, nodes);
+    ASSERT_EQ(1u, nodes.size());
+    ASSERT_EQ(4000u, nodes[0].items_in);
+    ASSERT_EQ(4000u, nodes[0].items_out);
+
+    profiler.attach(&filter);
+    ASSERT_EQ(0u, profiler.scanned());
+}
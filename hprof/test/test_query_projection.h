@@ -0,0 +1,87 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include "helpers.h"
+#include "query_projection.h"
+
+using namespace hprof;
+
+static void add_projection(query_t& query, std::initializer_list<const char*> path) {
+    std::unique_ptr<field_fetcher_t> field;
+    for (auto it = path.end(); it != path.begin(); ) {
+        --it;
+        if (field == nullptr) {
+            field = std::make_unique<field_fetcher_t>(*it);
+        } else {
+            field->add(*it);
+        }
+    }
+    query.projections.push_back(std::move(field));
+}
+
+TEST(query_projection_t, When_Projected_Expect_RowsOfFieldValues) {
+    auto hprof = read_sample_dump();
+    ASSERT_NE(nullptr, hprof);
+
+    query_t query { query_t::ACTION_SHOW, query_t::SOURCE_OBJECTS, 0, std::make_unique<filter_instance_of_t>("android.view.View") };
+    add_projection(query, { "mWidth" });
+    add_projection(query, { "mParent", "mWidth" });
+    add_projection(query, { "mText" });
+    add_projection(query, { "mParent" });
+
+    query_projection_t projection { query, hprof->objects_index(), hprof->classes_index() };
+    std::vector<std::string> columns;
+    projection.columns(columns);
+    ASSERT_EQ((std::vector<std::string> { "object.mWidth", "object.mParent.mWidth", "object.mText", "object.mParent" }), columns);
+
+    std::vector<std::string> row;
+    projection.row(hprof->objects_index().find_object(0x3002), row);
+    ASSERT_EQ((std::vector<std::string> { "50", "200", "\"hello\"", "android.view.ViewGroup@0x3001" }), row);
+
+    projection.row(hprof->objects_index().find_object(0x3001), row);
+    ASSERT_EQ((std::vector<std::string> { "200", "<none>", "<none>", "null" }), row);
+
+    std::vector<heap_item_ptr_t> items;
+    ASSERT_TRUE(hprof->query(query, items));
+    ASSERT_EQ(3u, items.size());
+}
+
+TEST(query_projection_t, When_NotInstance_Expect_NoneValues) {
+    auto hprof = read_sample_dump();
+    ASSERT_NE(nullptr, hprof);
+
+    query_t query { query_t::ACTION_SHOW, query_t::SOURCE_OBJECTS, 0, nullptr };
+    add_projection(query, { "count" });
+
+    query_projection_t projection { query, hprof->objects_index(), hprof->classes_index() };
+    std::vector<std::string> row;
+    projection.row(hprof->objects_index().find_object(0x1010), row);
+    ASSERT_EQ((std::vector<std::string> { "<none>" }), row);
+    projection.row(hprof->objects_index().find_object(0x2002), row);
+    ASSERT_EQ((std::vector<std::string> { "5" }), row);
+}
+
+TEST(query_projection_t, When_ClassName_Expect_ArraysNamedByItems) {
+    auto hprof = read_sample_dump();
+    ASSERT_NE(nullptr, hprof);
+
+    ASSERT_EQ("byte[]", query_projection_t::class_name(hprof->objects_index().find_object(0x1010), hprof->classes_index()));
+    ASSERT_EQ("int[]", query_projection_t::class_name(hprof->objects_index().find_object(0x1020), hprof->classes_index()));
+    ASSERT_EQ("java.lang.String", query_projection_t::class_name(hprof->objects_index().find_object(0x2000), hprof->classes_index()));
+}
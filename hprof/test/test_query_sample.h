@@ -0,0 +1,166 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include "helpers.h"
+#include "heap_profile.h"
+#include "query_sample.h"
+
+#include <cmath>
+#include <limits>
+
+using namespace hprof;
+
+TEST(query_sample_t, When_FullFraction_Expect_EveryIdAndExactEstimates) {
+    query_sample_t sample { 1.0 };
+    ASSERT_TRUE(sample.all());
+    for (jvm_id_t id = 0; id < 1000; ++id) {
+        ASSERT_TRUE(sample.contains(id));
+    }
+
+    double total = 0;
+    double error = 1;
+    sample.estimate_count(42, total, error);
+    ASSERT_DOUBLE_EQ(42, total);
+    ASSERT_DOUBLE_EQ(0, error);
+}
+
+TEST(query_sample_t, When_Fraction_Expect_ProportionalAndSeededPicks) {
+    query_sample_t sample { 0.1 };
+    query_sample_t same { 0.1 };
+    query_sample_t seeded { 0.1, 7 };
+    ASSERT_FALSE(sample.all());
+
+    size_t picked = 0;
+    size_t differ = 0;
+    for (jvm_id_t id = 0x10000000; id < 0x10000000 + 100000 * 16; id += 16) {
+        ASSERT_EQ(sample.contains(id), same.contains(id));
+        picked += sample.contains(id) ? 1 : 0;
+        differ += sample.contains(id) != seeded.contains(id) ? 1 : 0;
+    }
+    ASSERT_LT(9500u, picked);
+    ASSERT_GT(10500u, picked);
+    ASSERT_LT(1000u, differ);
+}
+
+TEST(query_sample_t, When_Estimate_Expect_ScaledTotalsAndIntervals) {
+    query_sample_t sample { 0.25 };
+
+    double total = 0;
+    double error = 0;
+    sample.estimate_count(100, total, error);
+    ASSERT_DOUBLE_EQ(400, total);
+    ASSERT_NEAR(1.96 * std::sqrt(75.) / 0.25, error, 0.01);
+
+    sample.estimate_sum(10, 50, total, error);
+    ASSERT_DOUBLE_EQ(40, total);
+    ASSERT_NEAR(1.96 * std::sqrt(0.75 * 50) / 0.25, error, 0.01);
+}
+
+TEST(query_sample_t, When_SampledShow_Expect_SubsetIndependentOfThreads) {
+    heap_profile_impl_t hprof { std::vector<gc_root_impl_ptr_t> {} };
+    fill_cursor_profile(hprof, 50000);
+
+    auto query = make_cursor_query(0, std::numeric_limits<size_t>::max());
+    std::vector<heap_item_ptr_t> all;
+    ASSERT_TRUE(hprof.query(query, all));
+
+    query.sample = 0.1;
+    std::vector<heap_item_ptr_t> expected;
+    for (size_t threads : { 1, 4 }) {
+        hprof.set_query_threads(threads);
+
+        std::vector<heap_item_ptr_t> sampled;
+        ASSERT_TRUE(hprof.query(query, sampled));
+        if (expected.empty()) {
+            expected = sampled;
+        }
+        ASSERT_EQ(expected, sampled);
+    }
+
+    ASSERT_LT(all.size() / 20, expected.size());
+    ASSERT_GT(all.size() / 5, expected.size());
+    size_t position = 0;
+    for (auto& item : expected) {
+        while (position < all.size() && all[position] != item) {
+            ++position;
+        }
+        ASSERT_LT(position, all.size());
+    }
+}
+
+TEST(query_sample_t, When_SampledAggregate_Expect_CountWithinInterval) {
+    heap_profile_impl_t hprof { std::vector<gc_root_impl_ptr_t> {} };
+    fill_cursor_profile(hprof, 50000);
+    hprof.set_query_threads(4);
+
+    auto query = make_cursor_query(0, std::numeric_limits<size_t>::max());
+    std::vector<heap_item_ptr_t> all;
+    ASSERT_TRUE(hprof.query(query, all));
+
+    query.action = query_t::ACTION_AGGREGATE;
+    query.sample = 0.05;
+    add_aggregation(query, query_t::AGGREGATE_COUNT);
+
+    std::vector<aggregate_row_t> rows;
+    ASSERT_TRUE(hprof.aggregate(query, rows));
+    ASSERT_EQ(1u, rows.size());
+    auto& count = rows[0].values[0];
+    ASSERT_TRUE(count.estimated);
+    ASSERT_TRUE(count.integral);
+    ASSERT_LT(0, count.error);
+    ASSERT_GE(count.error, std::abs(static_cast<double>(count.int_value) - static_cast<double>(all.size())));
+
+    query.sample = 1.0;
+    rows.clear();
+    ASSERT_TRUE(hprof.aggregate(query, rows));
+    ASSERT_FALSE(rows[0].values[0].estimated);
+    ASSERT_EQ(static_cast<int64_t>(all.size()), rows[0].values[0].int_value);
+}
+
+TEST(query_sample_t, When_SampledQueryCached_Expect_ExactQueryScanned) {
+    heap_profile_impl_t hprof { std::vector<gc_root_impl_ptr_t> {} };
+    fill_cursor_profile(hprof, 50000);
+    hprof.set_query_cache_size(1 << 20);
+
+    auto query = make_cursor_query(0, std::numeric_limits<size_t>::max());
+    query.sample = 0.01;
+    std::vector<heap_item_ptr_t> sampled;
+    ASSERT_TRUE(hprof.query(query, sampled));
+    ASSERT_EQ(1u, hprof.query_cache()->entries());
+
+    query.sample = 1.0;
+    std::vector<heap_item_ptr_t> all;
+    ASSERT_TRUE(hprof.query(query, all));
+    ASSERT_EQ(2u, hprof.query_cache()->entries());
+    ASSERT_LT(sampled.size() * 10, all.size());
+}
+
+TEST(query_sample_t, When_Explained_Expect_SampleInScanNode) {
+    auto hprof = read_sample_dump(1);
+    ASSERT_NE(nullptr, hprof);
+
+    query_t query { query_t::ACTION_SHOW, query_t::SOURCE_OBJECTS, 0, nullptr };
+    query.sample = 0.5;
+    query.explain = query_t::EXPLAIN_PLAN;
+
+    std::vector<explain_node_t> nodes;
+    ASSERT_TRUE(hprof->explain(query, nodes));
+    ASSERT_EQ(1u, nodes.size());
+    ASSERT_EQ("scan heaps sampling 50%", nodes[0].name);
+}
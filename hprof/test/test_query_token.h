@@ -0,0 +1,239 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include "helpers.h"
+#include "heap_profile.h"
+
+#include <atomic>
+#include <thread>
+
+using namespace hprof;
+
+namespace {
+    /// Stops the token of the query once the given number of items was checked
+    class filter_stop_after_t : public filter_t {
+    public:
+        filter_stop_after_t(query_token_t& token, size_t checks, bool cancel) : _token(token), _left(checks), _cancel(cancel) {}
+        virtual ~filter_stop_after_t() {}
+
+        virtual filter_result_t operator()(const heap_item_ptr_t&, const objects_index_t&) const override {
+            if (--_left == 0) {
+                if (_cancel) {
+                    _token.cancel();
+                } else {
+                    _token.set_budget(query_token_t::steady_clock_t::duration::zero());
+                }
+            }
+            return Match;
+        }
+
+        virtual bool key(std::string& out) const override {
+            out += "stop_after";
+            return true;
+        }
+    private:
+        query_token_t& _token;
+        mutable std::atomic<size_t> _left;
+        bool _cancel;
+    };
+}
+
+static query_t make_token_query(query_token_t::steady_clock_t::duration budget) {
+    query_t query { query_t::ACTION_SHOW, query_t::SOURCE_OBJECTS, 0, nullptr };
+    query.token = std::make_shared<query_token_t>();
+    query.token->set_budget(budget);
+    return query;
+}
+
+TEST(query_token_t, When_NoBudget_Expect_NotStopped) {
+    query_token_t token;
+    ASSERT_FALSE(token.stopped());
+
+    token.set_budget(std::chrono::hours(1));
+    ASSERT_FALSE(token.expired());
+
+    token.set_budget(query_token_t::steady_clock_t::duration::zero());
+    ASSERT_TRUE(token.expired());
+    ASSERT_FALSE(token.cancelled());
+
+    token.cancel();
+    ASSERT_TRUE(token.cancelled());
+    ASSERT_TRUE(token.stopped());
+}
+
+TEST(query_token_t, When_Cancelled_Expect_QueryFailed) {
+    heap_profile_impl_t hprof { std::vector<gc_root_impl_ptr_t> {} };
+    fill_cursor_profile(hprof, 50000);
+
+    for (size_t threads : { 1, 4 }) {
+        hprof.set_query_threads(threads);
+
+        auto query = make_cursor_query(0, std::numeric_limits<size_t>::max());
+        query.token = std::make_shared<query_token_t>();
+        query.token->cancel();
+
+        std::vector<heap_item_ptr_t> result;
+        ASSERT_FALSE(hprof.query(query, result));
+        ASSERT_TRUE(result.empty());
+    }
+}
+
+TEST(query_token_t, When_CancelledWhileScanning_Expect_ScanStopped) {
+    heap_profile_impl_t hprof { std::vector<gc_root_impl_ptr_t> {} };
+    fill_cursor_profile(hprof, 50000);
+    hprof.set_query_threads(1);
+
+    auto query = make_token_query(std::chrono::hours(1));
+    query.filter = std::make_unique<filter_stop_after_t>(*query.token, 100, true);
+
+    auto cursor = hprof.open(query);
+    std::vector<heap_item_ptr_t> page;
+    ASSERT_FALSE(cursor->fetch(std::numeric_limits<size_t>::max(), page));
+    ASSERT_TRUE(cursor->done());
+}
+
+TEST(query_token_t, When_BudgetSpent_Expect_PartialResultNotCached) {
+    heap_profile_impl_t hprof { std::vector<gc_root_impl_ptr_t> {} };
+    fill_cursor_profile(hprof, 50000);
+    hprof.set_query_threads(1);
+    hprof.set_query_cache_size(1 << 20);
+
+    auto query = make_token_query(std::chrono::hours(1));
+    query.filter = std::make_unique<filter_stop_after_t>(*query.token, 100, false);
+    {
+        auto cursor = hprof.open(query);
+        std::vector<heap_item_ptr_t> page;
+        ASSERT_TRUE(cursor->fetch(std::numeric_limits<size_t>::max(), page));
+        ASSERT_TRUE(cursor->done());
+        ASSERT_TRUE(cursor->truncated());
+        // The token is looked at every few thousand items
+        ASSERT_LT(100u, page.size());
+        ASSERT_GT(50000u, page.size());
+    }
+    ASSERT_EQ(0u, hprof.query_cache()->entries());
+
+    query.token = nullptr;
+    std::vector<heap_item_ptr_t> all;
+    ASSERT_TRUE(hprof.query(query, all));
+    ASSERT_EQ(50000u, all.size());
+}
+
+TEST(query_token_t, When_StoppedAfterScan_Expect_ResultCached) {
+    heap_profile_impl_t hprof { std::vector<gc_root_impl_ptr_t> {} };
+    fill_cursor_profile(hprof, 50000);
+
+    for (size_t threads : { 1, 4 }) {
+        hprof.set_query_threads(threads);
+        hprof.set_query_cache_size(1 << 20);
+
+        auto query = make_cursor_query(0, std::numeric_limits<size_t>::max());
+        query.token = std::make_shared<query_token_t>();
+        {
+            auto cursor = hprof.open(query);
+            std::vector<heap_item_ptr_t> page;
+            ASSERT_TRUE(cursor->fetch(std::numeric_limits<size_t>::max(), page));
+            ASSERT_TRUE(cursor->done());
+            ASSERT_FALSE(cursor->truncated());
+            query.token->cancel();
+        }
+        ASSERT_EQ(1u, hprof.query_cache()->entries());
+    }
+}
+
+TEST(query_token_t, When_BudgetSpentOnLastItem_Expect_NotTruncated) {
+    heap_profile_impl_t hprof { std::vector<gc_root_impl_ptr_t> {} };
+    fill_cursor_profile(hprof, 50000);
+
+    for (size_t threads : { 1, 4 }) {
+        hprof.set_query_threads(threads);
+        hprof.set_query_cache_size(1 << 20);
+
+        auto query = make_token_query(std::chrono::hours(1));
+        query.filter = std::make_unique<filter_stop_after_t>(*query.token, 50000, false);
+        {
+            auto cursor = hprof.open(query);
+            std::vector<heap_item_ptr_t> page;
+            ASSERT_TRUE(cursor->fetch(std::numeric_limits<size_t>::max(), page));
+            ASSERT_TRUE(cursor->done());
+            ASSERT_FALSE(cursor->truncated());
+            ASSERT_EQ(50000u, page.size());
+        }
+        ASSERT_EQ(1u, hprof.query_cache()->entries());
+    }
+}
+
+TEST(query_token_t, When_BudgetSpent_Expect_AggregateOfScannedItems) {
+    heap_profile_impl_t hprof { std::vector<gc_root_impl_ptr_t> {} };
+    fill_cursor_profile(hprof, 50000);
+
+    for (size_t threads : { 1, 4 }) {
+        hprof.set_query_threads(threads);
+
+        auto query = make_token_query(query_token_t::steady_clock_t::duration::zero());
+        query.action = query_t::ACTION_AGGREGATE;
+        query.aggregations.push_back({ query_t::AGGREGATE_COUNT, nullptr });
+
+        std::vector<aggregate_row_t> rows;
+        ASSERT_TRUE(hprof.aggregate(query, rows));
+        ASSERT_EQ(1u, rows.size());
+        ASSERT_GT(50000, rows[0].values[0].int_value);
+
+        query.token->cancel();
+        rows.clear();
+        ASSERT_FALSE(hprof.aggregate(query, rows));
+    }
+}
+
+TEST(query_token_t, When_OrderedOutOfBudget_Expect_Truncated) {
+    heap_profile_impl_t hprof { std::vector<gc_root_impl_ptr_t> {} };
+    fill_cursor_profile(hprof, 50000);
+    hprof.set_query_threads(4);
+
+    auto query = make_token_query(query_token_t::steady_clock_t::duration::zero());
+    query.order = query_t::ORDER_LENGTH;
+
+    auto cursor = hprof.open(query);
+    std::vector<heap_item_ptr_t> page;
+    ASSERT_TRUE(cursor->fetch(std::numeric_limits<size_t>::max(), page));
+    ASSERT_TRUE(cursor->truncated());
+    ASSERT_GT(50000u, page.size());
+}
+
+TEST(query_token_t, When_BudgetSetFromOtherThread_Expect_ScanStopped) {
+    heap_profile_impl_t hprof { std::vector<gc_root_impl_ptr_t> {} };
+    fill_cursor_profile(hprof, 50000);
+    hprof.set_query_threads(4);
+
+    auto query = make_token_query(std::chrono::hours(1));
+    auto token = query.token;
+    std::thread setter([token] {
+        for (int i = 0; i < 1000; ++i) {
+            token->set_budget(std::chrono::hours(1));
+        }
+        token->set_budget(query_token_t::steady_clock_t::duration::zero());
+    });
+
+    auto cursor = hprof.open(query);
+    std::vector<heap_item_ptr_t> page;
+    bool fetched = cursor->fetch(std::numeric_limits<size_t>::max(), page);
+    setter.join();
+    ASSERT_TRUE(fetched);
+    ASSERT_TRUE(token->expired());
+    ASSERT_GE(50000u, page.size());
+}
@@ -0,0 +1,146 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include "helpers.h"
+#include "heap_profile.h"
+#include "query_top.h"
+#include "types/heap_item.h"
+#include "types/primitives_array.h"
+
+#include <algorithm>
+#include <limits>
+
+using namespace hprof;
+
+static query_t make_top_query(query_t::order_t order, bool descending, size_t limit, const char* field = nullptr) {
+    query_t query { query_t::ACTION_SHOW, query_t::SOURCE_OBJECTS, 0, nullptr };
+    query.order = order;
+    query.order_descending = descending;
+    query.limit = limit;
+    if (field != nullptr) {
+        query.order_field = std::make_unique<field_fetcher_t>(field);
+    }
+    return query;
+}
+
+static std::vector<jvm_id_t> top_ids(const std::vector<heap_item_ptr_t>& items) {
+    std::vector<jvm_id_t> ids;
+    for (auto& item : items) {
+        switch (item->type()) {
+            case heap_item_t::Object:
+                ids.push_back(static_cast<const instance_info_t*>(*item)->id());
+                break;
+            case heap_item_t::String:
+                ids.push_back(static_cast<const string_info_t*>(*item)->id());
+                break;
+            case heap_item_t::PrimitivesArray:
+                ids.push_back(static_cast<const primitives_array_info_t*>(*item)->id());
+                break;
+            case heap_item_t::ObjectsArray:
+                ids.push_back(static_cast<const objects_array_info_t*>(*item)->id());
+                break;
+            case heap_item_t::Class:
+                ids.push_back(static_cast<const class_info_t*>(*item)->id());
+                break;
+        }
+    }
+    return ids;
+}
+
+TEST(query_top_t, When_OrderByField_Expect_MissingValuesLast) {
+    auto hprof = read_sample_dump();
+    ASSERT_NE(nullptr, hprof);
+
+    std::vector<heap_item_ptr_t> items;
+    ASSERT_TRUE(hprof->query(make_top_query(query_t::ORDER_FIELD, true, 2, "mWidth"), items));
+    ASSERT_EQ((std::vector<jvm_id_t> { 0x3001, 0x3000 }), top_ids(items));
+
+    items.clear();
+    ASSERT_TRUE(hprof->query(make_top_query(query_t::ORDER_FIELD, false, 4, "mWidth"), items));
+    ASSERT_EQ(4u, items.size());
+    auto ids = top_ids(items);
+    ASSERT_EQ((std::vector<jvm_id_t> { 0x3002, 0x3000, 0x3001 }), std::vector<jvm_id_t>(ids.begin(), ids.begin() + 3));
+}
+
+TEST(query_top_t, When_OrderByLength_Expect_TiesInScanOrder) {
+    auto hprof = read_sample_dump();
+    ASSERT_NE(nullptr, hprof);
+
+    std::vector<heap_item_ptr_t> all;
+    ASSERT_TRUE(hprof->query(make_top_query(query_t::ORDER_NONE, false, std::numeric_limits<size_t>::max()), all));
+    auto scan = top_ids(all);
+    auto first = std::find_if(scan.begin(), scan.end(), [] (auto id) { return id == 0x1010 || id == 0x1011; });
+    ASSERT_NE(scan.end(), first);
+
+    std::vector<heap_item_ptr_t> items;
+    ASSERT_TRUE(hprof->query(make_top_query(query_t::ORDER_LENGTH, true, 2), items));
+    auto ids = top_ids(items);
+    ASSERT_EQ(2u, ids.size());
+    ASSERT_EQ(*first, ids[0]);
+    ASSERT_EQ(*first == 0x1010 ? 0x1011u : 0x1010u, ids[1]);
+}
+
+TEST(query_top_t, When_OrderBySize_Expect_InstanceFieldsPayload) {
+    auto hprof = read_sample_dump();
+    ASSERT_NE(nullptr, hprof);
+
+    // Byte arrays of 32 items go first, TextView and ViewGroup instances have 16 bytes of fields
+    auto query = make_top_query(query_t::ORDER_SIZE, true, 2);
+    query.offset = 2;
+    std::vector<heap_item_ptr_t> items;
+    ASSERT_TRUE(hprof->query(query, items));
+    auto ids = top_ids(items);
+    std::sort(ids.begin(), ids.end());
+    ASSERT_EQ((std::vector<jvm_id_t> { 0x3001, 0x3002 }), ids);
+    ASSERT_EQ(16u, query_top_t::shallow_size(items[0]));
+}
+
+TEST(query_top_t, When_Threads_Expect_SameAsSortedScan) {
+    heap_profile_impl_t hprof { std::vector<gc_root_impl_ptr_t> {} };
+    for (jvm_id_t id = 1; id <= 50000; ++id) {
+        size_t length = (id * 7919) % 1000 + 1;
+        auto array = primitives_array_info_impl_t::create(4, id, jvm_type_t::JVM_TYPE_BYTE, length, length);
+        hprof.add(id, std::make_shared<heap_item_impl_t>(std::move(array)));
+    }
+    hprof.build_indexes();
+
+    hprof.set_query_threads(1);
+    std::vector<heap_item_ptr_t> expected;
+    ASSERT_TRUE(hprof.query(make_top_query(query_t::ORDER_NONE, false, std::numeric_limits<size_t>::max()), expected));
+    std::stable_sort(expected.begin(), expected.end(), [] (auto& left, auto& right) {
+        return static_cast<const primitives_array_info_t*>(*left)->length() > static_cast<const primitives_array_info_t*>(*right)->length();
+    });
+
+    for (size_t threads : { 1, 4 }) {
+        hprof.set_query_threads(threads);
+
+        auto query = make_top_query(query_t::ORDER_LENGTH, true, 100);
+        query.offset = 30;
+        std::vector<heap_item_ptr_t> items;
+        ASSERT_TRUE(hprof.query(query, items));
+        ASSERT_EQ(std::vector<heap_item_ptr_t>(expected.begin() + 30, expected.begin() + 130), items);
+
+        auto cursor = hprof.open(query);
+        std::vector<heap_item_ptr_t> pages;
+        while (!cursor->done()) {
+            ASSERT_TRUE(cursor->fetch(7, pages));
+        }
+        ASSERT_EQ(items, pages);
+    }
+}
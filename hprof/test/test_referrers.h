@@ -0,0 +1,112 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include "helpers.h"
+#include "query_cache.h"
+
+using namespace hprof;
+
+static query_t make_related_query(query_t::relation_t relation, const char* related_class, std::unique_ptr<filter_t>&& filter = nullptr) {
+    query_t query { query_t::ACTION_SHOW, query_t::SOURCE_OBJECTS, 0, std::move(filter) };
+    query.relation = relation;
+    query.related.reset(new query_t { query_t::ACTION_SHOW, query_t::SOURCE_OBJECTS, 0, std::make_unique<filter_instance_of_t>(related_class) });
+    return query;
+}
+
+static std::vector<jvm_id_t> related_ids(const heap_profile_t& hprof, const query_t& query) {
+    std::vector<heap_item_ptr_t> items;
+    EXPECT_TRUE(hprof.query(query, items));
+
+    std::vector<jvm_id_t> ids;
+    for (auto& item : items) {
+        switch (item->type()) {
+            case heap_item_t::Object:
+                ids.push_back(static_cast<const instance_info_t*>(*item)->id());
+                break;
+            case heap_item_t::String:
+                ids.push_back(static_cast<const string_info_t*>(*item)->id());
+                break;
+            default:
+                ids.push_back(0);
+                break;
+        }
+    }
+    return ids;
+}
+
+TEST(heap_profile_referrers, When_ReferringTo_Expect_HoldersOfSubqueryResults) {
+    auto hprof = read_sample_dump();
+    ASSERT_NE(nullptr, hprof);
+
+    auto query = make_related_query(query_t::RELATION_REFERRING_TO, "android.view.ViewGroup");
+    ASSERT_EQ((std::vector<jvm_id_t> { 0x3000, 0x3002 }), related_ids(*hprof, query));
+
+    auto filtered = make_related_query(query_t::RELATION_REFERRING_TO, "android.view.ViewGroup",
+        std::make_unique<filter_compare_greater_field_t>(new field_fetcher_t("mWidth"), filter_comp_value_t { 60 }));
+    ASSERT_EQ((std::vector<jvm_id_t> { 0x3000 }), related_ids(*hprof, filtered));
+
+    auto classes = make_related_query(query_t::RELATION_REFERRING_TO, "android.view.ViewGroup");
+    classes.source = query_t::SOURCE_CLASSES;
+    ASSERT_TRUE(related_ids(*hprof, classes).empty());
+}
+
+TEST(heap_profile_referrers, When_ReferencedBy_Expect_ReferentsOfSubqueryResults) {
+    auto hprof = read_sample_dump();
+    ASSERT_NE(nullptr, hprof);
+
+    auto query = make_related_query(query_t::RELATION_REFERENCED_BY, "android.widget.TextView");
+    ASSERT_EQ((std::vector<jvm_id_t> { 0x2000, 0x3001 }), related_ids(*hprof, query));
+
+    // Nested relations: holders of objects referenced by the text view
+    query_t nested { query_t::ACTION_SHOW, query_t::SOURCE_OBJECTS, 0, nullptr };
+    nested.relation = query_t::RELATION_REFERRING_TO;
+    nested.related = std::make_unique<query_t>(std::move(query));
+    ASSERT_EQ((std::vector<jvm_id_t> { 0x3000, 0x3002 }), related_ids(*hprof, nested));
+}
+
+TEST(heap_profile_referrers, When_FindReferrers_Expect_LinksOfHolders) {
+    auto hprof = read_sample_dump();
+    ASSERT_NE(nullptr, hprof);
+
+    incoming_links_t links;
+    ASSERT_TRUE(hprof->objects_index().find_referrers(0x1000, links));
+    ASSERT_EQ(1u, links.size());
+    ASSERT_EQ(0x2000u, links.begin()->from);
+    ASSERT_EQ(link_t::TYPE_INSTANCE, links.begin()->type);
+
+    links.clear();
+    ASSERT_TRUE(hprof->objects_index().find_referrers(0x3002, links));
+    ASSERT_TRUE(links.empty());
+}
+
+TEST(heap_profile_referrers, When_KeyRelated_Expect_RelationAndSubqueryInKey) {
+    std::string plain;
+    ASSERT_TRUE(query_cache_t::key(query_t { query_t::ACTION_SHOW, query_t::SOURCE_OBJECTS, 0, nullptr }, plain));
+
+    std::string referring;
+    ASSERT_TRUE(query_cache_t::key(make_related_query(query_t::RELATION_REFERRING_TO, "android.view.View"), referring));
+    std::string referenced;
+    ASSERT_TRUE(query_cache_t::key(make_related_query(query_t::RELATION_REFERENCED_BY, "android.view.View"), referenced));
+    std::string other;
+    ASSERT_TRUE(query_cache_t::key(make_related_query(query_t::RELATION_REFERRING_TO, "android.view.ViewGroup"), other));
+
+    ASSERT_NE(plain, referring);
+    ASSERT_NE(referring, referenced);
+    ASSERT_NE(referring, other);
+}
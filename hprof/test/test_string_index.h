@@ -0,0 +1,78 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include "helpers.h"
+#include "types/string_instance.h"
+
+using namespace hprof;
+
+TEST(string_index_t, When_FindStrings_Expect_AllIdsWithValue) {
+    auto hprof = read_sample_dump();
+    std::vector<jvm_id_t> ids;
+    ASSERT_TRUE(hprof->objects_index().find_strings("hello", ids));
+    ASSERT_EQ((std::vector<jvm_id_t> { 0x2000, 0x2001 }), ids);
+
+    ids.clear();
+    ASSERT_TRUE(hprof->objects_index().find_strings("missing", ids));
+    ASSERT_TRUE(ids.empty());
+}
+
+TEST(string_index_t, When_FindStrings_Expect_NoValueDecoded) {
+    auto hprof = read_sample_dump(1);
+    size_t decoded = strings_cache_t::thread_decodes();
+    std::vector<jvm_id_t> ids;
+    ASSERT_TRUE(hprof->objects_index().find_strings("world", ids));
+    ASSERT_EQ((std::vector<jvm_id_t> { 0x2002 }), ids);
+    ASSERT_EQ(decoded, strings_cache_t::thread_decodes());
+
+    ids.clear();
+    ASSERT_TRUE(hprof->objects_index().find_strings("", ids));
+    ASSERT_EQ(decoded, strings_cache_t::thread_decodes());
+}
+
+TEST(string_index_t, When_BoundToObjects_Expect_SameMatches) {
+    auto hprof = read_sample_dump();
+    auto& objects = hprof->objects_index();
+    std::vector<std::unique_ptr<filter_t>> filters;
+    for (auto text : { "hello", "world", "missing" }) {
+        filters.push_back(std::make_unique<filter_compare_equals_field_t>(new field_fetcher_t("mText"), filter_comp_value_t { text }));
+        filters.push_back(std::make_unique<filter_compare_not_equals_field_t>(new field_fetcher_t("mText"), filter_comp_value_t { text }));
+    }
+
+    for (auto& filter : filters) {
+        std::vector<filter_t::filter_result_t> expected;
+        for (jvm_id_t id : { 0x3000, 0x3001, 0x3002 }) {
+            expected.push_back((*filter)(objects.find_object(id), objects));
+        }
+
+        filter->bind_objects(objects);
+        std::vector<filter_t::filter_result_t> bound;
+        for (jvm_id_t id : { 0x3000, 0x3001, 0x3002 }) {
+            bound.push_back((*filter)(objects.find_object(id), objects));
+        }
+        ASSERT_EQ(expected, bound);
+    }
+
+    query_t query { query_t::ACTION_SHOW, query_t::SOURCE_OBJECTS, 0,
+        std::make_unique<filter_compare_equals_field_t>(new field_fetcher_t("mText"), filter_comp_value_t { "hello" }) };
+    std::vector<heap_item_ptr_t> result;
+    ASSERT_TRUE(hprof->query(query, result));
+    ASSERT_EQ(1u, result.size());
+    ASSERT_EQ(objects.find_object(0x3002), result.front());
+}
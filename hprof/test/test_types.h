@@ -172,3 +172,11 @@ TEST(field_iterator, When_CompareNotEqualsIterator_Expect_CallMockNotEquals) {
     EXPECT_CALL(iter_mock_1, not_equals(Truly(iterator_impl_matcher_t { &iter_mock_2 }))).Times(1).WillOnce(Return(true));
     ASSERT_TRUE(iter_1 != iter_2);
 }
+
+TEST(heap_info_t, When_KnownName_Expect_HeapType) {
+    ASSERT_EQ(heap_info_t::HEAP_APP, heap_info_t::by_name("app"));
+    ASSERT_EQ(heap_info_t::HEAP_IMAGE, heap_info_t::by_name("IMAGE"));
+    ASSERT_EQ(-1, heap_info_t::by_name("native"));
+    ASSERT_EQ(-1, heap_info_t::by_name("system"));
+    ASSERT_STREQ("zygote", heap_info_t::name_of(heap_info_t::HEAP_ZYGOTE));
+}
@@ -0,0 +1,277 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include "types/array_kernels.h"
+
+#include <cstring>
+#include <vector>
+
+using namespace hprof;
+
+class array_kernels_t_test : public ::testing::TestWithParam<array_kernels_t::isa_t> {
+protected:
+    virtual void SetUp() override {
+        _isa = array_kernels_t::isa();
+        array_kernels_t::force_isa(GetParam());
+    }
+
+    virtual void TearDown() override {
+        array_kernels_t::force_isa(_isa);
+    }
+
+    template<typename T>
+    static std::vector<u_int8_t> to_big_endian(const std::vector<T>& values) {
+        std::vector<u_int8_t> result;
+        for (auto value : values) {
+            auto bits = static_cast<typename std::make_unsigned<T>::type>(value);
+            for (int shift = (sizeof(T) - 1) * 8; shift >= 0; shift -= 8) {
+                result.push_back(static_cast<u_int8_t>(bits >> shift));
+            }
+        }
+        return result;
+    }
+
+    template<typename T>
+    static void expect_summary(jvm_type_t type, const std::vector<T>& values) {
+        auto data = to_big_endian(values);
+        array_summary_t<int64_t> summary;
+        ASSERT_TRUE(array_kernels_t::summarize(type, data.data(), values.size(), summary));
+        ASSERT_EQ(*std::min_element(values.begin(), values.end()), summary.min);
+        ASSERT_EQ(*std::max_element(values.begin(), values.end()), summary.max);
+        int64_t sum = 0;
+        for (auto value : values) sum += value;
+        ASSERT_EQ(sum, summary.sum);
+    }
+
+    template<typename T>
+    static std::vector<T> make_values(size_t length, int64_t seed) {
+        std::vector<T> result;
+        for (size_t index = 0; index < length; ++index) {
+            seed = seed * 6364136223846793005LL + 1442695040888963407LL;
+            result.push_back(static_cast<T>(seed >> 40));
+        }
+        return result;
+    }
+private:
+    array_kernels_t::isa_t _isa;
+};
+
+TEST_P(array_kernels_t_test, When_EmptyPayload_Expect_Zeroed) {
+    ASSERT_TRUE(array_kernels_t::is_zeroed(nullptr, 0));
+}
+
+TEST_P(array_kernels_t_test, When_AllZeros_Expect_Zeroed) {
+    std::vector<u_int8_t> data(1027, 0);
+    ASSERT_TRUE(array_kernels_t::is_zeroed(data.data(), data.size()));
+}
+
+TEST_P(array_kernels_t_test, When_SingleNonZeroByteAnywhere_Expect_NotZeroed) {
+    std::vector<u_int8_t> data(300, 0);
+    for (size_t index = 0; index < data.size(); ++index) {
+        data[index] = 0x10;
+        ASSERT_FALSE(array_kernels_t::is_zeroed(data.data(), data.size())) << index;
+        data[index] = 0;
+    }
+}
+
+TEST_P(array_kernels_t_test, When_RepeatedItem_Expect_Constant) {
+    for (size_t item_size : { 1, 2, 4, 8 }) {
+        std::vector<u_int8_t> data;
+        for (size_t index = 0; index < 77 * item_size; ++index) {
+            data.push_back(static_cast<u_int8_t>(0xA0 + index % item_size));
+        }
+        ASSERT_TRUE(array_kernels_t::is_constant(data.data(), data.size(), item_size)) << item_size;
+    }
+}
+
+TEST_P(array_kernels_t_test, When_OneItemDiffers_Expect_NotConstant) {
+    for (size_t item_size : { 1, 2, 4, 8 }) {
+        std::vector<u_int8_t> data(77 * item_size, 0x5A);
+        for (size_t index = 0; index < data.size(); ++index) {
+            data[index] = 0x5B;
+            ASSERT_FALSE(array_kernels_t::is_constant(data.data(), data.size(), item_size)) << item_size << ":" << index;
+            data[index] = 0x5A;
+        }
+    }
+}
+
+TEST_P(array_kernels_t_test, When_SingleItem_Expect_Constant) {
+    u_int8_t data[] = { 0x00, 0x00, 0x01, 0x02 };
+    ASSERT_TRUE(array_kernels_t::is_constant(data, sizeof(data), 4));
+}
+
+TEST_P(array_kernels_t_test, When_EmptyArray_Expect_NoSummary) {
+    array_summary_t<int64_t> summary;
+    ASSERT_FALSE(array_kernels_t::summarize(jvm_type_t::JVM_TYPE_INT, nullptr, 0, summary));
+}
+
+TEST_P(array_kernels_t_test, When_ObjectArray_Expect_NoSummary) {
+    u_int8_t data[] = { 0x00, 0x00, 0x01, 0x02 };
+    array_summary_t<int64_t> summary;
+    ASSERT_FALSE(array_kernels_t::summarize(jvm_type_t::JVM_TYPE_OBJECT, data, 1, summary));
+}
+
+TEST_P(array_kernels_t_test, When_ByteArray_Expect_ValidSummary) {
+    for (size_t length : { 1, 15, 16, 17, 33, 100, 1000 }) {
+        expect_summary(jvm_type_t::JVM_TYPE_BYTE, make_values<jvm_byte_t>(length, length));
+    }
+}
+
+TEST_P(array_kernels_t_test, When_BoolArray_Expect_ValidSummary) {
+    for (size_t length : { 1, 15, 16, 17, 33, 100, 1000 }) {
+        expect_summary(jvm_type_t::JVM_TYPE_BOOL, make_values<jvm_bool_t>(length, length));
+    }
+}
+
+TEST_P(array_kernels_t_test, When_CharArray_Expect_ValidSummary) {
+    for (size_t length : { 1, 7, 8, 9, 31, 100, 1000 }) {
+        expect_summary(jvm_type_t::JVM_TYPE_CHAR, make_values<jvm_char_t>(length, length));
+    }
+}
+
+TEST_P(array_kernels_t_test, When_ShortArray_Expect_ValidSummary) {
+    for (size_t length : { 1, 7, 8, 9, 31, 100, 1000 }) {
+        expect_summary(jvm_type_t::JVM_TYPE_SHORT, make_values<jvm_short_t>(length, length));
+    }
+}
+
+TEST_P(array_kernels_t_test, When_IntArray_Expect_ValidSummary) {
+    for (size_t length : { 1, 3, 4, 5, 9, 100, 1000 }) {
+        expect_summary(jvm_type_t::JVM_TYPE_INT, make_values<jvm_int_t>(length, length));
+    }
+}
+
+TEST_P(array_kernels_t_test, When_LongArray_Expect_ValidSummary) {
+    expect_summary(jvm_type_t::JVM_TYPE_LONG, std::vector<jvm_long_t> { -5, 1LL << 40, 7 });
+}
+
+TEST_P(array_kernels_t_test, When_LargeShortArray_Expect_SumDoesNotOverflow) {
+    std::vector<jvm_short_t> values(300000, 32767);
+    expect_summary(jvm_type_t::JVM_TYPE_SHORT, values);
+}
+
+TEST_P(array_kernels_t_test, When_DoubleArray_Expect_ValidSummary) {
+    u_int8_t data[] = { 0xbF, 0xe2, 0x2A, 0xf1, 0xfe, 0x8a, 0x8a, 0x70, 0x3F, 0xe2, 0x2A, 0xf1, 0xfe, 0x8a, 0x8a, 0x70 };
+    array_summary_t<double> summary;
+    ASSERT_TRUE(array_kernels_t::summarize(jvm_type_t::JVM_TYPE_DOUBLE, data, 2, summary));
+    ASSERT_FLOAT_EQ(-0.567742345, summary.min);
+    ASSERT_FLOAT_EQ(0.567742345, summary.max);
+    ASSERT_NEAR(0.0, summary.sum, 1e-9);
+}
+
+TEST_P(array_kernels_t_test, When_IntArrayAsDouble_Expect_ConvertedSummary) {
+    u_int8_t data[] = { 0xFF, 0xFF, 0xFF, 0xFE, 0x00, 0x00, 0x00, 0x20 };
+    array_summary_t<double> summary;
+    ASSERT_TRUE(array_kernels_t::summarize(jvm_type_t::JVM_TYPE_INT, data, 2, summary));
+    ASSERT_DOUBLE_EQ(-2.0, summary.min);
+    ASSERT_DOUBLE_EQ(32.0, summary.max);
+    ASSERT_DOUBLE_EQ(30.0, summary.sum);
+}
+
+TEST_P(array_kernels_t_test, When_BytesHistogram_Expect_Population) {
+    std::vector<u_int8_t> data;
+    for (size_t index = 0; index < 1003; ++index) {
+        data.push_back(static_cast<u_int8_t>(index % 3));
+    }
+    size_t bins[256];
+    array_kernels_t::bytes_histogram(data.data(), data.size(), bins);
+    ASSERT_EQ(335, bins[0]);
+    ASSERT_EQ(334, bins[1]);
+    ASSERT_EQ(334, bins[2]);
+    ASSERT_EQ(0, bins[3]);
+}
+
+TEST_P(array_kernels_t_test, When_ValuesHistogram_Expect_EqualWidthBuckets) {
+    auto data = to_big_endian(std::vector<jvm_short_t> { -10, -6, -5, 0, 4, 9, 100 });
+    std::vector<size_t> bins(4);
+    ASSERT_TRUE(array_kernels_t::histogram(jvm_type_t::JVM_TYPE_SHORT, data.data(), 7, -10, 9, bins));
+    ASSERT_EQ((std::vector<size_t> { 2, 1, 2, 1 }), bins);
+}
+
+TEST_P(array_kernels_t_test, When_SingleBinOverLongRange_Expect_AllValues) {
+    auto data = to_big_endian(std::vector<jvm_long_t> { std::numeric_limits<jvm_long_t>::min(), 0, std::numeric_limits<jvm_long_t>::max() });
+    std::vector<size_t> bins(1);
+    ASSERT_TRUE(array_kernels_t::histogram(jvm_type_t::JVM_TYPE_LONG, data.data(), 3,
+        std::numeric_limits<jvm_long_t>::min(), std::numeric_limits<jvm_long_t>::max(), bins));
+    ASSERT_EQ(3, bins[0]);
+}
+
+TEST_P(array_kernels_t_test, When_ValueHoldsMostItems_Expect_ItsShare) {
+    std::vector<jvm_int_t> ints(100, 7);
+    ints[3] = -1000000;
+    ints[50] = 1000000;
+    ASSERT_DOUBLE_EQ(0.98, array_kernels_t::dominant_share(jvm_type_t::JVM_TYPE_INT, to_big_endian(ints).data(), ints.size()));
+
+    std::vector<jvm_long_t> longs { std::numeric_limits<jvm_long_t>::min(), 5, 5, std::numeric_limits<jvm_long_t>::max(), 5 };
+    ASSERT_DOUBLE_EQ(0.6, array_kernels_t::dominant_share(jvm_type_t::JVM_TYPE_LONG, to_big_endian(longs).data(), longs.size()));
+
+    std::vector<jvm_long_t> doubles;
+    for (jvm_double_t value : { 0.5, 0.5, 0.25, 0.5 }) {
+        jvm_long_t bits = 0;
+        std::memcpy(&bits, &value, sizeof(bits));
+        doubles.push_back(bits);
+    }
+    ASSERT_DOUBLE_EQ(0.75, array_kernels_t::dominant_share(jvm_type_t::JVM_TYPE_DOUBLE, to_big_endian(doubles).data(), doubles.size()));
+
+    std::vector<jvm_short_t> shorts { 1, 1, 2, 2, 3 };
+    ASSERT_EQ(0, array_kernels_t::dominant_share(jvm_type_t::JVM_TYPE_SHORT, to_big_endian(shorts).data(), shorts.size()));
+    ASSERT_EQ(1, array_kernels_t::dominant_share(jvm_type_t::JVM_TYPE_SHORT, to_big_endian(shorts).data(), 2));
+}
+
+TEST_P(array_kernels_t_test, When_ItemPresent_Expect_Found) {
+    auto longs = to_big_endian(make_values<jvm_long_t>(101, 3));
+    for (size_t index : { 0, 37, 100 }) {
+        ASSERT_TRUE(array_kernels_t::contains_item(longs.data(), 101, longs.data() + index * 8, 8));
+    }
+    auto bytes = to_big_endian(make_values<jvm_byte_t>(77, 5));
+    ASSERT_TRUE(array_kernels_t::contains_item(bytes.data(), 77, bytes.data() + 76, 1));
+
+    auto ints = to_big_endian(std::vector<jvm_int_t>(70, 1));
+    ints[69 * 4 + 3] = 2;
+    const u_int8_t two[] = { 0, 0, 0, 2 };
+    ASSERT_TRUE(array_kernels_t::contains_item(ints.data(), 70, two, 4));
+    ASSERT_FALSE(array_kernels_t::contains_item(ints.data(), 69, two, 4));
+}
+
+TEST_P(array_kernels_t_test, When_BytesMatchOffItemBoundary_Expect_NotFound) {
+    // 0x0102 shows up only across neighbouring items 0x..01 and 0x02..
+    auto shorts = to_big_endian(std::vector<jvm_short_t>(64, 0x0201));
+    const u_int8_t item[] = { 0x01, 0x02 };
+    ASSERT_FALSE(array_kernels_t::contains_item(shorts.data(), 64, item, 2));
+
+    auto longs = to_big_endian(std::vector<jvm_long_t>(20, 0x0000000100000001LL));
+    const u_int8_t shifted[] = { 0, 0, 0, 1, 0, 0, 0, 0 };
+    ASSERT_FALSE(array_kernels_t::contains_item(longs.data(), 20, shifted, 8));
+    ASSERT_FALSE(array_kernels_t::contains_item(longs.data(), 20, shifted, 3));
+}
+
+INSTANTIATE_TEST_CASE_P(isa, array_kernels_t_test, ::testing::Values(array_kernels_t::ISA_SCALAR, array_kernels_t::ISA_SSE41, array_kernels_t::ISA_AVX2));
+
+TEST(array_kernels_t, When_SamePayload_Expect_SameHash) {
+    u_int8_t first[] = { 0x00, 0x68, 0x00, 0x65, 0x00, 0x6c, 0x00, 0x6c, 0x00, 0x6f };
+    u_int8_t second[] = { 0x00, 0x68, 0x00, 0x65, 0x00, 0x6c, 0x00, 0x6c, 0x00, 0x6f };
+    ASSERT_EQ(array_kernels_t::hash(first, sizeof(first)), array_kernels_t::hash(second, sizeof(second)));
+}
+
+TEST(array_kernels_t, When_PayloadDiffersInTail_Expect_DifferentHash) {
+    u_int8_t first[] = { 0x00, 0x68, 0x00, 0x65, 0x00, 0x6c, 0x00, 0x6c, 0x00, 0x6f };
+    u_int8_t second[] = { 0x00, 0x68, 0x00, 0x65, 0x00, 0x6c, 0x00, 0x6c, 0x00, 0x6e };
+    ASSERT_NE(array_kernels_t::hash(first, sizeof(first)), array_kernels_t::hash(second, sizeof(second)));
+    ASSERT_NE(array_kernels_t::hash(first, sizeof(first)), array_kernels_t::hash(first, sizeof(first) - 1));
+}
@@ -0,0 +1,151 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include "types/array_kernels.h"
+#include "types/column_kernels.h"
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+using namespace hprof;
+
+class column_kernels_t_test : public ::testing::TestWithParam<array_kernels_t::isa_t> {
+protected:
+    virtual void SetUp() override {
+        _isa = array_kernels_t::isa();
+        array_kernels_t::force_isa(GetParam());
+    }
+
+    virtual void TearDown() override {
+        array_kernels_t::force_isa(_isa);
+    }
+
+    template<typename T>
+    static std::vector<bool> select(column_kernels_t::compare_t compare, const std::vector<T>& column, T literal) {
+        std::vector<u_int64_t> selection(column_kernels_t::selection_size(column.size()), ~u_int64_t(0));
+        column_kernels_t::select(compare, column.data(), column.size(), literal, selection.data());
+        std::vector<bool> result;
+        for (size_t index = 0; index < selection.size() * 64; ++index) {
+            result.push_back(((selection[index / 64] >> (index % 64)) & 1) != 0);
+        }
+        return result;
+    }
+
+    template<typename T>
+    static void expect_same_as_scalar(const std::vector<T>& column, T literal) {
+        column_kernels_t::compare_t compares[] = {
+            column_kernels_t::COMPARE_EQUALS, column_kernels_t::COMPARE_NOT_EQUALS,
+            column_kernels_t::COMPARE_LESS, column_kernels_t::COMPARE_LESS_OR_EQUALS,
+            column_kernels_t::COMPARE_GREATER, column_kernels_t::COMPARE_GREATER_OR_EQUALS
+        };
+        for (auto compare : compares) {
+            auto selected = select(compare, column, literal);
+            for (size_t index = 0; index < selected.size(); ++index) {
+                bool expected = false;
+                if (index < column.size()) {
+                    T value = column[index];
+                    switch (compare) {
+                        case column_kernels_t::COMPARE_EQUALS: expected = value == literal; break;
+                        case column_kernels_t::COMPARE_NOT_EQUALS: expected = value != literal; break;
+                        case column_kernels_t::COMPARE_LESS: expected = value < literal; break;
+                        case column_kernels_t::COMPARE_LESS_OR_EQUALS: expected = value <= literal; break;
+                        case column_kernels_t::COMPARE_GREATER: expected = value > literal; break;
+                        case column_kernels_t::COMPARE_GREATER_OR_EQUALS: expected = value >= literal; break;
+                    }
+                }
+                ASSERT_EQ(expected, selected[index]) << "compare " << compare << " at " << index;
+            }
+        }
+    }
+private:
+    array_kernels_t::isa_t _isa;
+};
+
+TEST_P(column_kernels_t_test, When_SelectInt32_Expect_SameAsScalar) {
+    std::vector<int32_t> column;
+    for (int32_t index = 0; index < 203; ++index) {
+        column.push_back((index * 37) % 101 - 50);
+    }
+    column.push_back(std::numeric_limits<int32_t>::min());
+    column.push_back(std::numeric_limits<int32_t>::max());
+    expect_same_as_scalar<int32_t>(column, 7);
+    expect_same_as_scalar<int32_t>(column, std::numeric_limits<int32_t>::min());
+}
+
+TEST_P(column_kernels_t_test, When_SelectInt64_Expect_SameAsScalar) {
+    std::vector<int64_t> column;
+    for (int64_t index = 0; index < 131; ++index) {
+        column.push_back((index - 65) * 0x100000000LL);
+    }
+    expect_same_as_scalar<int64_t>(column, 0x300000000LL);
+    expect_same_as_scalar<int64_t>(column, -1);
+}
+
+TEST_P(column_kernels_t_test, When_SelectDoubleWithNaN_Expect_SameAsScalar) {
+    std::vector<double> column;
+    for (int index = 0; index < 67; ++index) {
+        column.push_back(index % 5 == 0 ? std::nan("") : index * 0.5 - 10);
+    }
+    expect_same_as_scalar<double>(column, 2.5);
+    expect_same_as_scalar<double>(column, std::nan(""));
+}
+
+TEST_P(column_kernels_t_test, When_GatherBigEndianFields_Expect_Widened) {
+    u_int8_t first[] = { 0xff, 0xfe, 0x00, 0x00, 0x00, 0x2a };
+    u_int8_t second[] = { 0x00, 0x01, 0xff, 0xff, 0xff, 0xd6 };
+    const u_int8_t* rows[] = { first, second };
+
+    int32_t shorts[2];
+    ASSERT_TRUE(column_kernels_t::gather(jvm_type_t::JVM_TYPE_SHORT, rows, 2, 0, shorts));
+    ASSERT_EQ(-2, shorts[0]);
+    ASSERT_EQ(1, shorts[1]);
+
+    int32_t chars[2];
+    ASSERT_TRUE(column_kernels_t::gather(jvm_type_t::JVM_TYPE_CHAR, rows, 2, 0, chars));
+    ASSERT_EQ(0xfffe, chars[0]);
+
+    int64_t ints[2];
+    ASSERT_TRUE(column_kernels_t::gather(jvm_type_t::JVM_TYPE_INT, rows, 2, 2, ints));
+    ASSERT_EQ(42, ints[0]);
+    ASSERT_EQ(-42, ints[1]);
+
+    double doubles[2];
+    ASSERT_TRUE(column_kernels_t::gather(jvm_type_t::JVM_TYPE_INT, rows, 2, 2, doubles));
+    ASSERT_EQ(-42.0, doubles[1]);
+
+    ASSERT_FALSE(column_kernels_t::gather(jvm_type_t::JVM_TYPE_LONG, rows, 2, 0, shorts));
+    ASSERT_FALSE(column_kernels_t::gather(jvm_type_t::JVM_TYPE_OBJECT, rows, 2, 0, doubles));
+}
+
+INSTANTIATE_TEST_CASE_P(isa, column_kernels_t_test, ::testing::Values(array_kernels_t::ISA_SCALAR, array_kernels_t::ISA_SSE41, array_kernels_t::ISA_AVX2));
+
+TEST(column_kernels_t, When_FillAndNegate_Expect_TailCleared) {
+    u_int64_t selection[2] = { 0, 0 };
+    column_kernels_t::fill(selection, 70, true);
+    ASSERT_EQ(~u_int64_t(0), selection[0]);
+    ASSERT_EQ(0x3fu, selection[1]);
+
+    column_kernels_t::negate(selection, 70);
+    ASSERT_EQ(0u, selection[0]);
+    ASSERT_EQ(0u, selection[1]);
+
+    column_kernels_t::negate(selection, 70);
+    ASSERT_EQ(0x3fu, selection[1]);
+}
@@ -184,4 +184,25 @@ TEST(primitives_array_info_impl_t, When_ElementOffset_Expect_4) {
     std::memcpy(instance->data(), data, sizeof(data));
     auto item = instance->begin();
     ASSERT_EQ(4, (++item)->offset());
-}
\ No newline at end of file
+}
+
+TEST(primitives_array_info_impl_t, When_PayloadShared_Expect_ReadOnlyAndKeptByLastArray) {
+    u_int8_t data[] = { 0x00, 0x00, 0x00, 0x0F, 0x00, 0x00, 0x00, 0x20 };
+    auto first = primitives_array_info_impl_t::create(4, 0x10, jvm_type_t::JVM_TYPE_INT, 2, sizeof(data));
+    ASSERT_FALSE(first->shared());
+    ASSERT_NE(nullptr, first->data());
+
+    primitives_array_info_impl_ptr_t second;
+    {
+        payload_block_t payload { data, sizeof(data) };
+        first = primitives_array_info_impl_t::create(4, 0x10, jvm_type_t::JVM_TYPE_INT, 2, payload, sizeof(data));
+        second = primitives_array_info_impl_t::create(4, 0x11, jvm_type_t::JVM_TYPE_INT, 2, payload, sizeof(data));
+    }
+    ASSERT_TRUE(first->shared());
+    ASSERT_EQ(nullptr, first->data());
+
+    const primitives_array_info_t& kept = *second;
+    first.reset();
+    ASSERT_EQ(0, std::memcmp(data, kept.data(), sizeof(data)));
+    ASSERT_EQ(0x20, static_cast<jvm_int_t>(*kept[1]));
+}
@@ -18,12 +18,148 @@
 #include <gtest/gtest.h>
 
 #include "mocks.h"
+#include "types/class.h"
+#include "types/heap_item.h"
 #include "types/string_instance.h"
 
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
 using namespace hprof;
+using testing::Return;
 
 TEST(string_info_impl_t, When_DefaultValue_Expect_EmptyValue) {
     mock_objects_index_t objects;
-    auto text = string_info_impl_t::create(*instance_info_impl_t::create(4, 0xc0f060, 0), objects);
+    auto text = string_info_impl_t::create(instance_info_impl_t::create(4, 0xc0f060, 0), objects, std::make_shared<strings_cache_t>());
     ASSERT_EQ("", text->value());
 }
+
+static heap_item_ptr_t make_compact_string_class() {
+    auto cls = class_info_impl_t::create(4, 0x100, 0);
+    cls->add_field(field_spec_impl_t { 1, "value", jvm_type_t::JVM_TYPE_OBJECT, 0 });
+    cls->add_field(field_spec_impl_t { 2, "coder", jvm_type_t::JVM_TYPE_BYTE, 4 });
+    return std::make_shared<heap_item_impl_t>(std::move(cls));
+}
+
+static instance_info_impl_ptr_t make_compact_string(const heap_item_ptr_t& cls, jvm_id_t value, jvm_byte_t coder) {
+    auto instance = instance_info_impl_t::create(4, 0xc0f060, 5);
+    u_int8_t* data = instance->data();
+    data[0] = static_cast<u_int8_t>(value >> 24);
+    data[1] = static_cast<u_int8_t>(value >> 16);
+    data[2] = static_cast<u_int8_t>(value >> 8);
+    data[3] = static_cast<u_int8_t>(value);
+    data[4] = static_cast<u_int8_t>(coder);
+    instance->set_class(cls);
+    return instance;
+}
+
+static heap_item_ptr_t make_bytes(jvm_id_t id, const std::string& bytes) {
+    auto array = primitives_array_info_impl_t::create(4, id, jvm_type_t::JVM_TYPE_BYTE, bytes.size(), bytes.size());
+    std::copy(bytes.begin(), bytes.end(), array->data());
+    return std::make_shared<heap_item_impl_t>(std::move(array));
+}
+
+TEST(string_info_impl_t, When_CompactLatin1String_Expect_Utf8Value) {
+    mock_objects_index_t objects;
+    EXPECT_CALL(objects, find_object(0x10)).WillRepeatedly(Return(make_bytes(0x10, "h\xe9llo")));
+
+    auto text = string_info_impl_t::create(make_compact_string(make_compact_string_class(), 0x10, 0), objects, std::make_shared<strings_cache_t>());
+    ASSERT_EQ("h\xc3\xa9llo", text->value());
+}
+
+TEST(string_info_impl_t, When_CompactUtf16String_Expect_Utf8Value) {
+    mock_objects_index_t objects;
+    EXPECT_CALL(objects, find_object(0x10)).WillRepeatedly(Return(make_bytes(0x10, std::string("h\0\x16\x04", 4))));
+
+    auto text = string_info_impl_t::create(make_compact_string(make_compact_string_class(), 0x10, 1), objects, std::make_shared<strings_cache_t>());
+    ASSERT_EQ("h\xd0\x96", text->value());
+}
+
+TEST(string_info_impl_t, When_ValueRead_Expect_ValueCached) {
+    mock_objects_index_t objects;
+    EXPECT_CALL(objects, find_object(0x10)).WillRepeatedly(Return(make_bytes(0x10, "hello")));
+
+    auto cache = std::make_shared<strings_cache_t>();
+    auto first = string_info_impl_t::create(make_compact_string(make_compact_string_class(), 0x10, 0), objects, cache);
+    auto second = string_info_impl_t::create(make_compact_string(make_compact_string_class(), 0x10, 0), objects, cache);
+    ASSERT_EQ(0, cache->size());
+    size_t decoded = strings_cache_t::thread_decodes();
+    ASSERT_EQ(first->value(), second->value());
+    ASSERT_EQ(decoded + 1, strings_cache_t::thread_decodes());
+    ASSERT_EQ(1, cache->size());
+}
+
+TEST(strings_cache_t, When_ValuesReadFromThreads_Expect_EveryArrayDecodedOnce) {
+    std::vector<heap_item_ptr_t> arrays;
+    for (jvm_id_t id = 0; id < 500; ++id) {
+        arrays.push_back(make_bytes(id, std::to_string(id)));
+    }
+
+    strings_cache_t cache;
+    std::vector<std::thread> threads;
+    std::atomic<size_t> mismatches { 0 };
+    for (size_t thread = 0; thread < 4; ++thread) {
+        threads.emplace_back([&arrays, &cache, &mismatches] () {
+            for (jvm_id_t id = 0; id < arrays.size(); ++id) {
+                auto& array = *static_cast<const primitives_array_info_t *>(*arrays[id]);
+                if (cache.value(array, string_info_t::ENCODING_LATIN1) != std::to_string(id)) {
+                    ++mismatches;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    ASSERT_EQ(0, mismatches.load());
+    ASSERT_EQ(arrays.size(), cache.size());
+}
+
+TEST(strings_cache_t, When_ArraysShareTheSamePayload_Expect_ValuesOfTheirEncodings) {
+    const u_int8_t text[] = { 0, 'h', 0, 'i' };
+    payload_block_t payload { text, sizeof(text) };
+    primitives_array_info_impl_ptr_t chars = primitives_array_info_impl_t::create(4, 0x10, jvm_type_t::JVM_TYPE_CHAR, 2, payload, 4);
+    primitives_array_info_impl_ptr_t bytes = primitives_array_info_impl_t::create(4, 0x11, jvm_type_t::JVM_TYPE_BYTE, 4, payload, 4);
+    ASSERT_EQ(static_cast<const primitives_array_info_t&>(*chars).data(), static_cast<const primitives_array_info_t&>(*bytes).data());
+
+    strings_cache_t cache;
+    ASSERT_EQ("hi", cache.value(*chars, string_info_t::ENCODING_UTF16_BE));
+    ASSERT_EQ(std::string("\0h\0i", 4), cache.value(*bytes, string_info_t::ENCODING_LATIN1));
+    ASSERT_EQ("\xe6\xa0\x80\xe6\xa4\x80", cache.value(*bytes, string_info_t::ENCODING_UTF16_LE));
+    ASSERT_EQ("hi", cache.value(*chars, string_info_t::ENCODING_UTF16_BE));
+    ASSERT_EQ(3, cache.size());
+}
+
+TEST(strings_cache_t, When_ValuesExceedBudget_Expect_OlderValuesEvicted) {
+    std::vector<heap_item_ptr_t> arrays;
+    for (jvm_id_t id = 0; id < 4000; ++id) {
+        arrays.push_back(make_bytes(id, "value number " + std::to_string(id)));
+    }
+
+    const size_t budget = 64 << 10;
+    strings_cache_t cache { budget };
+    for (auto& item : arrays) {
+        cache.value(*static_cast<const primitives_array_info_t *>(*item), string_info_t::ENCODING_LATIN1);
+    }
+    ASSERT_GT(arrays.size(), cache.size());
+    ASSERT_GE(budget, cache.bytes());
+
+    size_t decoded = strings_cache_t::thread_decodes();
+    ASSERT_EQ("value number 3999", cache.value(*static_cast<const primitives_array_info_t *>(*arrays.back()), string_info_t::ENCODING_LATIN1));
+    ASSERT_EQ(decoded, strings_cache_t::thread_decodes());
+    ASSERT_EQ("value number 0", cache.value(*static_cast<const primitives_array_info_t *>(*arrays.front()), string_info_t::ENCODING_LATIN1));
+    ASSERT_EQ(decoded + 1, strings_cache_t::thread_decodes());
+}
+
+TEST(strings_cache_t, When_NoBudget_Expect_ValuesDecodedOnEveryRead) {
+    auto item = make_bytes(0x10, "hello");
+    auto& array = *static_cast<const primitives_array_info_t *>(*item);
+    strings_cache_t cache { 0 };
+    size_t decoded = strings_cache_t::thread_decodes();
+    ASSERT_EQ("hello", cache.value(array, string_info_t::ENCODING_LATIN1));
+    ASSERT_EQ("hello", cache.value(array, string_info_t::ENCODING_LATIN1));
+    ASSERT_EQ(decoded + 2, strings_cache_t::thread_decodes());
+    ASSERT_EQ(0, cache.size());
+}
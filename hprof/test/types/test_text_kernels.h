@@ -0,0 +1,171 @@
+///
+///  Copyright 2017 Dmitry "PVOID" Petukhov
+///
+///  Licensed under the Apache License, Version 2.0 (the "License");
+///  you may not use this file except in compliance with the License.
+///  You may obtain a copy of the License at
+///
+///      http://www.apache.org/licenses/LICENSE-2.0
+///
+///  Unless required by applicable law or agreed to in writing, software
+///  distributed under the License is distributed on an "AS IS" BASIS,
+///  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+///  See the License for the specific language governing permissions and
+///  limitations under the License.
+///
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include "types/array_kernels.h"
+#include "types/text_kernels.h"
+
+#include <cstring>
+#include <vector>
+
+using namespace hprof;
+
+class text_kernels_t_test : public ::testing::TestWithParam<array_kernels_t::isa_t> {
+protected:
+    virtual void SetUp() override {
+        _isa = array_kernels_t::isa();
+        array_kernels_t::force_isa(GetParam());
+    }
+
+    virtual void TearDown() override {
+        array_kernels_t::force_isa(_isa);
+    }
+
+    static std::vector<u_int8_t> to_utf16(const std::u16string& text, bool big_endian) {
+        std::vector<u_int8_t> result;
+        for (auto chr : text) {
+            u_int8_t high = static_cast<u_int8_t>(chr >> 8);
+            u_int8_t low = static_cast<u_int8_t>(chr & 0xff);
+            result.push_back(big_endian ? high : low);
+            result.push_back(big_endian ? low : high);
+        }
+        return result;
+    }
+
+    static std::string utf16be(const std::u16string& text) {
+        auto data = to_utf16(text, true);
+        std::string result;
+        text_kernels_t::utf16be_to_utf8(data.data(), text.size(), result);
+        return result;
+    }
+
+    static std::string utf16le(const std::u16string& text) {
+        auto data = to_utf16(text, false);
+        std::string result;
+        text_kernels_t::utf16le_to_utf8(data.data(), text.size(), result);
+        return result;
+    }
+
+    static std::string latin1(const std::string& text) {
+        std::string result;
+        text_kernels_t::latin1_to_utf8(reinterpret_cast<const u_int8_t*>(text.data()), text.size(), result);
+        return result;
+    }
+private:
+    array_kernels_t::isa_t _isa;
+};
+
+TEST_P(text_kernels_t_test, When_Empty_Expect_EmptyText) {
+    ASSERT_EQ("", utf16be(u""));
+    ASSERT_EQ("", latin1(""));
+}
+
+TEST_P(text_kernels_t_test, When_LongAsciiText_Expect_SameText) {
+    std::u16string source;
+    std::string expected;
+    for (int index = 0; index < 100; ++index) {
+        source += static_cast<char16_t>('a' + index % 26);
+        expected += static_cast<char>('a' + index % 26);
+    }
+    ASSERT_EQ(expected, utf16be(source));
+    ASSERT_EQ(expected, utf16le(source));
+    ASSERT_EQ(expected, latin1(expected));
+}
+
+TEST_P(text_kernels_t_test, When_NonAsciiInsideLongText_Expect_Utf8) {
+    std::u16string source = u"0123456789abcdefghijklmnopqrstuvwxyz éЖ€ 0123456789abcdefghijklmnopqrstuvwxyz";
+    std::string expected = "0123456789abcdefghijklmnopqrstuvwxyz \xc3\xa9\xd0\x96\xe2\x82\xac 0123456789abcdefghijklmnopqrstuvwxyz";
+    ASSERT_EQ(expected, utf16be(source));
+    ASSERT_EQ(expected, utf16le(source));
+}
+
+TEST_P(text_kernels_t_test, When_SurrogatePairCrossesBlock_Expect_FourBytes) {
+    for (size_t prefix = 0; prefix < 40; ++prefix) {
+        std::u16string source(prefix, u'x');
+        source += u"\U0001F600";
+        source += std::u16string(40, u'y');
+        std::string expected = std::string(prefix, 'x') + "\xf0\x9f\x98\x80" + std::string(40, 'y');
+        ASSERT_EQ(expected, utf16be(source));
+    }
+}
+
+TEST_P(text_kernels_t_test, When_UnpairedSurrogate_Expect_ReplacementChar) {
+    std::u16string source = u"ab";
+    source += static_cast<char16_t>(0xd800);
+    source += u"cd";
+    source += static_cast<char16_t>(0xdc00);
+    ASSERT_EQ("ab\xef\xbf\xbd" "cd\xef\xbf\xbd", utf16be(source));
+}
+
+TEST_P(text_kernels_t_test, When_Latin1Text_Expect_Utf8) {
+    std::string source = std::string(20, 'a') + "\xe9\xff" + std::string(20, 'b');
+    ASSERT_EQ(std::string(20, 'a') + "\xc3\xa9\xc3\xbf" + std::string(20, 'b'), latin1(source));
+}
+
+TEST_P(text_kernels_t_test, When_Contains_Expect_SameAsNaiveSearch) {
+    std::vector<u_int8_t> data;
+    for (size_t index = 0; index < 300; ++index) {
+        data.push_back(static_cast<u_int8_t>("abcab"[index % 5] + (index % 37 == 0 ? 1 : 0)));
+    }
+
+    for (std::string needle : { "a", "ab", "bca", "cabab", "cabc", "abcabcabcabcabcabcabcabcabcabcabcab", "zz" }) {
+        for (size_t step : { 1, 2 }) {
+            for (size_t size : { 0, 1, 15, 16, 17, 33, 64, 100, 299 }) {
+                bool expected = false;
+                for (size_t index = 0; index + needle.size() <= size && !expected; index += step) {
+                    expected = std::memcmp(data.data() + index, needle.data(), needle.size()) == 0;
+                }
+                ASSERT_EQ(expected, text_kernels_t::contains(data.data(), size, needle, step)) << needle << " " << step << " " << size;
+            }
+        }
+    }
+}
+
+TEST_P(text_kernels_t_test, When_Utf16NeedleAtOddOffset_Expect_NotFound) {
+    // "\u6162\u6300" holds the bytes of "bc" at an odd offset only
+    auto data = to_utf16(std::u16string(40, u'x') + u"\u6162\u6300", true);
+    text_needle_t needle;
+    ASSERT_TRUE(text_kernels_t::encode_needle("bc", needle));
+    ASSERT_FALSE(text_kernels_t::contains(data.data(), data.size(), needle.utf16be, 2));
+    ASSERT_TRUE(text_kernels_t::contains(data.data(), data.size(), std::string("bc", 2), 1));
+}
+
+INSTANTIATE_TEST_CASE_P(isa, text_kernels_t_test, ::testing::Values(array_kernels_t::ISA_SCALAR, array_kernels_t::ISA_SSE41, array_kernels_t::ISA_AVX2));
+
+TEST(text_kernels_t, When_SingleChar_Expect_Utf8) {
+    ASSERT_EQ("a", text_kernels_t::to_utf8('a'));
+    ASSERT_EQ("\xe2\x82\xac", text_kernels_t::to_utf8(0x20ac));
+    ASSERT_EQ("\xef\xbf\xbd", text_kernels_t::to_utf8(0xd801));
+}
+
+TEST(text_kernels_t, When_EncodeNeedle_Expect_PayloadForms) {
+    text_needle_t needle;
+    ASSERT_TRUE(text_kernels_t::encode_needle("a\xc3\xa9", needle));
+    ASSERT_FALSE(needle.wide);
+    ASSERT_EQ("a\xe9", needle.latin1);
+    ASSERT_EQ(std::string("\0a\0\xe9", 4), needle.utf16be);
+    ASSERT_EQ(std::string("a\0\xe9\0", 4), needle.utf16le);
+
+    ASSERT_TRUE(text_kernels_t::encode_needle("\xf0\x9f\x98\x80", needle));
+    ASSERT_TRUE(needle.wide);
+    ASSERT_EQ(std::string("\xd8\x3d\xde\x00", 4), needle.utf16be);
+
+    ASSERT_FALSE(text_kernels_t::encode_needle("\xef\xbf\xbd", needle));
+    ASSERT_FALSE(text_kernels_t::encode_needle("\xc3", needle));
+    ASSERT_FALSE(text_kernels_t::encode_needle("\xc0\x80", needle));
+}
@@ -38,16 +38,46 @@ namespace hprof {
 
         void action(query_t::action_t action);
         void source(query_t::source_t source);
+        bool heap(const std::string& name);
         void filter(filter_t* filter);
+        /// False when the number does not fit size_t
+        bool limit(const std::string& text);
+        bool offset(const std::string& text);
+        void index_target(const std::string& class_name, const std::string& field);
+        void index_kind(query_t::index_t kind);
+        /// Takes ownership of the field, COUNT(*) has none
+        void aggregate(query_t::aggregate_t function, field_fetcher_t* field);
+        void group(query_t::group_t group, field_fetcher_t* field);
+        /// Takes ownership of the field, sizes and lengths have none
+        void order(query_t::order_t order, field_fetcher_t* field);
+        void order_descending(bool descending);
+        /// Takes ownership of the field
+        void projection(field_fetcher_t* field);
+        void explain(query_t::explain_t explain);
+        /// False when the percent is out of (0, 100]
+        bool sample(double percent);
+        /// Statements between begin and end make the subquery of the enclosing one
+        void begin_related();
+        void end_related(query_t::relation_t relation);
+        /// The profile library is built without exceptions, patterns are checked here
+        bool valid_regex(const std::string& pattern) const;
+        /// Decimal digits only, false when the value does not fit size_t
+        static bool parse_count(const std::string& text, size_t& value);
+        /// Decimal digits only, false when the value does not fit int64_t
+        static bool parse_integer(const std::string& text, int64_t& value);
 
         void error(const hprof::location& loc, const std::string& msg);
         void error(const std::string& msg);
 
         const query_t& query() const { return _query; }
+        /// Lets the caller attach a token before the query runs
+        query_t& query() { return _query; }
         bool has_errors() const { return !_errors.empty(); }
         const std::vector<parse_error>& errors() const { return _errors; }
     private:
         query_t _query;
+        // Enclosing queries of the subquery being parsed
+        std::vector<query_t> _enclosing;
         std::vector<parse_error> _errors;
     };
 }
@@ -17,8 +17,12 @@
 #include "language_scanner.h"
 #include "language_driver.h"
 
+#include <cerrno>
+#include <cstdlib>
 #include <iostream>
+#include <limits>
 #include <sstream>
+#include <regex>
 
 using namespace hprof;
 
@@ -27,6 +31,8 @@ bool language_driver::parse (const std::string& text) {
     language_scanner scanner { &in };
     language_parser parser(*this, scanner);
     _errors.clear();
+    _enclosing.clear();
+    _query = query_t {};
     return parser.parse() == 0;
 }
 
@@ -38,10 +44,114 @@ void language_driver::source(query_t::source_t source) {
     _query.source = source;
 }
 
+bool language_driver::heap(const std::string& name) {
+    int32_t type = heap_info_t::by_name(name);
+    if (type < 0) {
+        return false;
+    }
+    _query.heaps |= 1u << type;
+    return true;
+}
+
 void language_driver::filter(filter_t* filter) {
     _query.filter.reset(filter);
 }
 
+bool language_driver::limit(const std::string& text) {
+    return parse_count(text, _query.limit);
+}
+
+bool language_driver::offset(const std::string& text) {
+    return parse_count(text, _query.offset);
+}
+
+void language_driver::index_target(const std::string& class_name, const std::string& field) {
+    _query.index_class = class_name;
+    _query.index_field = field;
+}
+
+void language_driver::index_kind(query_t::index_t kind) {
+    _query.index = kind;
+}
+
+void language_driver::aggregate(query_t::aggregate_t function, field_fetcher_t* field) {
+    _query.aggregations.push_back(query_t::aggregation_t { function, std::unique_ptr<field_fetcher_t>(field) });
+}
+
+void language_driver::group(query_t::group_t group, field_fetcher_t* field) {
+    _query.group = group;
+    _query.group_field.reset(field);
+}
+
+void language_driver::order(query_t::order_t order, field_fetcher_t* field) {
+    _query.order = order;
+    _query.order_field.reset(field);
+}
+
+void language_driver::order_descending(bool descending) {
+    _query.order_descending = descending;
+}
+
+void language_driver::projection(field_fetcher_t* field) {
+    _query.projections.emplace_back(field);
+}
+
+void language_driver::explain(query_t::explain_t explain) {
+    _query.explain = explain;
+}
+
+bool language_driver::sample(double percent) {
+    if (!(percent > 0 && percent <= 100)) {
+        return false;
+    }
+    _query.sample = percent / 100;
+    return true;
+}
+
+void language_driver::begin_related() {
+    _enclosing.push_back(std::move(_query));
+    _query = query_t {};
+}
+
+void language_driver::end_related(query_t::relation_t relation) {
+    auto related = std::make_unique<query_t>(std::move(_query));
+    _query = std::move(_enclosing.back());
+    _enclosing.pop_back();
+    _query.relation = relation;
+    _query.related = std::move(related);
+}
+
+bool language_driver::valid_regex(const std::string& pattern) const {
+    try {
+        std::regex regex { pattern, std::regex::ECMAScript | std::regex::nosubs };
+        return true;
+    } catch (const std::regex_error&) {
+        return false;
+    }
+}
+
+bool language_driver::parse_count(const std::string& text, size_t& value) {
+    errno = 0;
+    char* end = nullptr;
+    unsigned long long result = std::strtoull(text.c_str(), &end, 10);
+    if (text.empty() || *end != '\0' || errno == ERANGE || result > std::numeric_limits<size_t>::max()) {
+        return false;
+    }
+    value = static_cast<size_t>(result);
+    return true;
+}
+
+bool language_driver::parse_integer(const std::string& text, int64_t& value) {
+    errno = 0;
+    char* end = nullptr;
+    long long result = std::strtoll(text.c_str(), &end, 10);
+    if (text.empty() || *end != '\0' || errno == ERANGE || result > std::numeric_limits<int64_t>::max()) {
+        return false;
+    }
+    value = static_cast<int64_t>(result);
+    return true;
+}
+
 void language_driver::error (const hprof::location& loc, const std::string& msg) {
     _errors.emplace_back(loc, msg);
 }
@@ -49,3 +159,4 @@ void language_driver::error (const hprof::location& loc, const std::string& msg)
 void language_driver::error (const std::string& msg) {
     _errors.emplace_back(msg);
 }
+
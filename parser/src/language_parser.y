@@ -9,6 +9,8 @@
 %code requires
 {
 #include <string>
+#include <cstring>
+#include <cstdlib>
 #include "hprof.h"
 
 namespace hprof {
@@ -45,7 +47,46 @@ namespace hprof {
 
 %token <strval> STRING
 %token <strval> NAME
-%token <intval> INT
+%token <strval> ARRAY
+%token <strval> ZEROED
+%token <strval> CONSTANT
+%token <strval> MIN
+%token <strval> MAX
+%token <strval> SUM
+%token <strval> HEAP
+%token <strval> LIMIT
+%token <strval> OFFSET
+%token <strval> CREATE
+%token <strval> INDEX
+%token <strval> ON
+%token <strval> USING
+%token <strval> HASH
+%token <strval> SORTED
+%token <strval> BITMAP
+%token <strval> CONTAINS
+%token <strval> LIKE
+%token <strval> MATCHES
+%token <strval> SELECT
+%token <strval> FROM
+%token <strval> COUNT
+%token <strval> GROUP
+%token <strval> BY
+%token <strval> ORDER
+%token <strval> SHALLOW
+%token <strval> SIZE
+%token <strval> LENGTH
+%token <strval> ASC
+%token <strval> DESC
+%token <strval> REFERRING
+%token <strval> TO
+%token <strval> REFERENCED
+%token <strval> EXPLAIN
+%token <strval> ANALYZE
+%token <strval> SAMPLE
+%token <strval> OF
+%token <strval> ANY
+%token <strval> IN
+%token <strval> INT
 %token <intval> BOOL
 %token <floatval> FLOAT
 
@@ -69,26 +110,146 @@ namespace hprof {
 %token FIELD_ACCESS "."
 %token LPARENT "("
 %token RPARENT ")"
+%token COMMA ","
+%token ASTERISK "*"
+%token PERCENT "%"
 
 %type <compareval> field_value
 %type <filterval> filter_stmt
 %type <field> name_stmt
+%type <strval> name_part
+%type <strval> class_name
+%type <intval> array_aggregate
+%type <intval> array_compare
+%type <intval> array_item_type
+%type <intval> field_aggregate
+%type <floatval> sample_size
 
 %left <filterval> AND
 %left <filterval> OR
 
 %%
 %start query;
-query: show_stmt END;
+query: statement END
+    | create_stmt END
+    | EXPLAIN statement END { driver.explain(query_t::EXPLAIN_PLAN); delete[] $1; }
+    | EXPLAIN ANALYZE statement END { driver.explain(query_t::EXPLAIN_ANALYZE); delete[] $1; delete[] $2; };
 
-show_stmt: SHOW show_src having_stmt { driver.action(query_t::ACTION_SHOW); };
+statement: show_stmt
+    | select_stmt;
+
+show_stmt: SHOW show_src relation_stmt heap_stmt sample_stmt having_stmt order_stmt limit_stmt offset_stmt { driver.action(query_t::ACTION_SHOW); }
+    | SHOW projections_list FROM show_src relation_stmt heap_stmt sample_stmt having_stmt order_stmt limit_stmt offset_stmt { driver.action(query_t::ACTION_SHOW); delete[] $3; };
+
+relation_stmt:
+    | REFERRING TO "(" { driver.begin_related(); } show_stmt ")" { driver.end_related(query_t::RELATION_REFERRING_TO); delete[] $1; delete[] $2; }
+    | REFERENCED BY "(" { driver.begin_related(); } show_stmt ")" { driver.end_related(query_t::RELATION_REFERENCED_BY); delete[] $1; delete[] $2; };
+
+projections_list: OBJECT FIELD_ACCESS name_stmt { driver.projection($3); }
+    | projections_list "," OBJECT FIELD_ACCESS name_stmt { driver.projection($5); };
 
 show_src: OBJECTS { driver.source(query_t::SOURCE_OBJECTS); }
     | CLASSES { driver.source(query_t::SOURCE_CLASSES); };
 
+heap_stmt:
+    | IN HEAP heaps_list { delete[] $1; delete[] $2; };
+
+heaps_list: heap_name
+    | heaps_list "," heap_name;
+
+sample_stmt:
+    | SAMPLE sample_size "%" {
+        bool valid = driver.sample($2);
+        delete[] $1;
+        if (!valid) {
+            error(@2, "Sample size has to be above 0% and up to 100%");
+            YYERROR;
+        }
+    };
+
+sample_size: INT { $$ = std::strtod($1, nullptr); delete[] $1; }
+    | FLOAT { $$ = $1; };
+
+heap_name: NAME { bool known = driver.heap($1); delete[] $1; if (!known) { error(@1, "Unknown heap"); YYERROR; } };
+
+create_stmt: CREATE INDEX ON index_target index_kind { driver.action(query_t::ACTION_CREATE_INDEX); delete[] $1; delete[] $2; delete[] $3; };
+
+index_target: STRING FIELD_ACCESS name_part { driver.index_target($1, $3); delete[] $1; delete[] $3; }
+    | class_name FIELD_ACCESS name_part { driver.index_target($1, $3); delete[] $1; delete[] $3; };
+
+class_name: name_part
+    | class_name FIELD_ACCESS name_part { 
+        size_t left = std::strlen($1);
+        size_t right = std::strlen($3);
+        $$ = new (std::nothrow) char[left + right + 2];
+        std::memcpy($$, $1, left);
+        $$[left] = '.';
+        std::memcpy($$ + left + 1, $3, right + 1);
+        delete[] $1;
+        delete[] $3;
+    };
+
+index_kind:
+    | USING HASH { driver.index_kind(query_t::INDEX_HASH); delete[] $1; delete[] $2; }
+    | USING SORTED { driver.index_kind(query_t::INDEX_SORTED); delete[] $1; delete[] $2; }
+    | USING BITMAP { driver.index_kind(query_t::INDEX_BITMAP); delete[] $1; delete[] $2; };
+
+select_stmt: SELECT aggregates_list FROM show_src relation_stmt heap_stmt sample_stmt having_stmt group_stmt limit_stmt offset_stmt {
+        driver.action(query_t::ACTION_AGGREGATE);
+        delete[] $1;
+        delete[] $3;
+    };
+
+aggregates_list: aggregate
+    | aggregates_list "," aggregate;
+
+aggregate: COUNT "(" "*" ")" { driver.aggregate(query_t::AGGREGATE_COUNT, nullptr); delete[] $1; }
+    | field_aggregate "(" OBJECT FIELD_ACCESS name_stmt ")" { driver.aggregate(static_cast<query_t::aggregate_t>($1), $5); };
+
+field_aggregate: SUM { $$ = query_t::AGGREGATE_SUM; delete[] $1; }
+    | MIN { $$ = query_t::AGGREGATE_MIN; delete[] $1; }
+    | MAX { $$ = query_t::AGGREGATE_MAX; delete[] $1; };
+
+group_stmt:
+    | GROUP BY CLASSES { driver.group(query_t::GROUP_CLASS, nullptr); delete[] $1; delete[] $2; }
+    | GROUP BY OBJECT FIELD_ACCESS name_stmt { driver.group(query_t::GROUP_FIELD, $5); delete[] $1; delete[] $2; };
+
+order_stmt:
+    | ORDER BY order_key order_direction { delete[] $1; delete[] $2; };
+
+order_key: OBJECT FIELD_ACCESS name_stmt { driver.order(query_t::ORDER_FIELD, $3); }
+    | SHALLOW SIZE { driver.order(query_t::ORDER_SIZE, nullptr); delete[] $1; delete[] $2; }
+    | ARRAY LENGTH { driver.order(query_t::ORDER_LENGTH, nullptr); delete[] $1; delete[] $2; };
+
+order_direction:
+    | ASC { delete[] $1; }
+    | DESC { driver.order_descending(true); delete[] $1; };
+
 having_stmt:
     | HAVING filter_stmt { driver.filter($2); };
 
+limit_stmt:
+    | LIMIT INT {
+        bool valid = driver.limit($2);
+        delete[] $1;
+        delete[] $2;
+        if (!valid) {
+            error(@2, "Limit is out of range");
+            YYERROR;
+        }
+    };
+
+offset_stmt:
+    | OFFSET INT {
+        bool valid = driver.offset($2);
+        delete[] $1;
+        delete[] $2;
+        if (!valid) {
+            error(@2, "Offset is out of range");
+            YYERROR;
+        }
+    };
+
 filter_stmt:
      "(" filter_stmt ")" { $$ = $2; }
     | filter_stmt AND filter_stmt { $$ = new (std::nothrow) filter_and_t($1, $3); }
@@ -100,15 +261,88 @@ filter_stmt:
     | OBJECT FIELD_ACCESS name_stmt LESS_OR_EQUALS field_value { $$ = new (std::nothrow) filter_compare_less_or_equals_field_t($3, *$5); delete $5; }
     | OBJECT FIELD_ACCESS name_stmt GREATER field_value { $$ = new (std::nothrow) filter_compare_greater_field_t($3, *$5); delete $5; }
     | OBJECT FIELD_ACCESS name_stmt GREATER_OR_EQUALS field_value { $$ = new (std::nothrow) filter_compare_greater_or_equals_field_t($3, *$5); delete $5; }
-    | OBJECT FIELD_ACCESS name_stmt INSTANCEOF STRING { $$ = new (std::nothrow) filter_apply_to_field_t($3, std::make_unique<filter_instance_of_t>($5)); delete[] $5; };
+    | OBJECT FIELD_ACCESS name_stmt INSTANCEOF STRING { $$ = new (std::nothrow) filter_apply_to_field_t($3, std::make_unique<filter_instance_of_t>($5)); delete[] $5; }
+    | OBJECT FIELD_ACCESS name_stmt CONTAINS STRING { $$ = new (std::nothrow) filter_text_field_t($3, text_pattern_t::KIND_CONTAINS, $5); delete[] $4; delete[] $5; }
+    | OBJECT FIELD_ACCESS name_stmt LIKE STRING { $$ = new (std::nothrow) filter_text_field_t($3, text_pattern_t::KIND_LIKE, $5); delete[] $4; delete[] $5; }
+    | OBJECT FIELD_ACCESS name_stmt MATCHES STRING {
+        bool valid = driver.valid_regex($5);
+        if (valid) {
+            $$ = new (std::nothrow) filter_text_field_t($3, text_pattern_t::KIND_REGEX, $5);
+        } else {
+            delete $3;
+        }
+        delete[] $4;
+        delete[] $5;
+        if (!valid) {
+            error(@5, "Invalid regular expression");
+            YYERROR;
+        }
+    }
+    | ARRAY ZEROED { $$ = new (std::nothrow) filter_array_zeroed_t(); delete[] $1; delete[] $2; }
+    | ARRAY CONSTANT { $$ = new (std::nothrow) filter_array_constant_t(); delete[] $1; delete[] $2; }
+    | ARRAY CONSTANT sample_size "%" {
+        delete[] $1;
+        delete[] $2;
+        if ($3 <= 50 || $3 > 100) {
+            error(@3, "Share of the dominant value has to be above 50% and up to 100%");
+            YYERROR;
+        }
+        $$ = new (std::nothrow) filter_array_mostly_constant_t($3 / 100);
+    }
+    | ARRAY array_aggregate EQUALS field_value { $$ = new (std::nothrow) filter_array_value_t(static_cast<filter_array_value_t::aggregate_t>($2), filter_array_value_t::COMPARE_EQUALS, *$4); delete[] $1; delete $4; }
+    | ARRAY array_aggregate NOT_EQUALS field_value { $$ = new (std::nothrow) filter_array_value_t(static_cast<filter_array_value_t::aggregate_t>($2), filter_array_value_t::COMPARE_NOT_EQUALS, *$4); delete[] $1; delete $4; }
+    | ARRAY array_aggregate LESS field_value { $$ = new (std::nothrow) filter_array_value_t(static_cast<filter_array_value_t::aggregate_t>($2), filter_array_value_t::COMPARE_LESS, *$4); delete[] $1; delete $4; }
+    | ARRAY array_aggregate LESS_OR_EQUALS field_value { $$ = new (std::nothrow) filter_array_value_t(static_cast<filter_array_value_t::aggregate_t>($2), filter_array_value_t::COMPARE_LESS_OR_EQUALS, *$4); delete[] $1; delete $4; }
+    | ARRAY array_aggregate GREATER field_value { $$ = new (std::nothrow) filter_array_value_t(static_cast<filter_array_value_t::aggregate_t>($2), filter_array_value_t::COMPARE_GREATER, *$4); delete[] $1; delete $4; }
+    | ARRAY array_aggregate GREATER_OR_EQUALS field_value { $$ = new (std::nothrow) filter_array_value_t(static_cast<filter_array_value_t::aggregate_t>($2), filter_array_value_t::COMPARE_GREATER_OR_EQUALS, *$4); delete[] $1; delete $4; }
+    | ARRAY LENGTH array_compare field_value { $$ = new (std::nothrow) filter_array_length_t(static_cast<filter_by_array_t::compare_t>($3), *$4); delete[] $1; delete[] $2; delete $4; }
+    | ARRAY OF array_item_type { $$ = new (std::nothrow) filter_array_of_t(static_cast<jvm_type_t::type_spec>($3)); delete[] $1; delete[] $2; }
+    | ARRAY ANY array_compare field_value { $$ = new (std::nothrow) filter_array_any_t(static_cast<filter_by_array_t::compare_t>($3), *$4); delete[] $1; delete[] $2; delete $4; }
+    | ARRAY ANY INSTANCEOF STRING { $$ = new (std::nothrow) filter_array_any_instance_of_t($4); delete[] $1; delete[] $2; delete[] $4; }
+    | ARRAY CONTAINS STRING { $$ = new (std::nothrow) filter_array_contains_text_t($3); delete[] $1; delete[] $2; delete[] $3; };
+
+array_compare: EQUALS { $$ = filter_by_array_t::COMPARE_EQUALS; }
+    | NOT_EQUALS { $$ = filter_by_array_t::COMPARE_NOT_EQUALS; }
+    | LESS { $$ = filter_by_array_t::COMPARE_LESS; }
+    | LESS_OR_EQUALS { $$ = filter_by_array_t::COMPARE_LESS_OR_EQUALS; }
+    | GREATER { $$ = filter_by_array_t::COMPARE_GREATER; }
+    | GREATER_OR_EQUALS { $$ = filter_by_array_t::COMPARE_GREATER_OR_EQUALS; };
+
+array_item_type: OBJECT { $$ = jvm_type_t::JVM_TYPE_OBJECT; }
+    | name_part {
+        $$ = filter_array_of_t::type_by_name($1);
+        delete[] $1;
+        if ($$ == jvm_type_t::JVM_TYPE_UNKNOWN) {
+            error(@1, "Unknown array item type");
+            YYERROR;
+        }
+    };
+
+array_aggregate: MIN { $$ = filter_array_value_t::AGGREGATE_MIN; delete[] $1; }
+    | MAX { $$ = filter_array_value_t::AGGREGATE_MAX; delete[] $1; }
+    | SUM { $$ = filter_array_value_t::AGGREGATE_SUM; delete[] $1; };
 
 field_value: STRING { $$ = new (std::nothrow) filter_comp_value_t($1); delete[] $1;}
-    | INT { $$ = new (std::nothrow) filter_comp_value_t($1); }
+    | INT {
+        int64_t value = 0;
+        bool valid = language_driver::parse_integer($1, value);
+        delete[] $1;
+        if (!valid) {
+            error(@1, "Integer is out of range");
+            YYERROR;
+        }
+        $$ = new (std::nothrow) filter_comp_value_t(value);
+    }
     | BOOL { $$ = new (std::nothrow) filter_comp_value_t($1); }
     | FLOAT { $$ = new (std::nothrow) filter_comp_value_t($1); };
 
-name_stmt: NAME { $$ = new (std::nothrow) field_fetcher_t($1); delete[] $1; }
-    | NAME FIELD_ACCESS name_stmt { $$ = $3; $3->add($1); delete[] $1; };
+name_stmt: name_part { $$ = new (std::nothrow) field_fetcher_t($1); delete[] $1; }
+    | name_part FIELD_ACCESS name_stmt { $$ = $3; $3->add($1); delete[] $1; };
+
+name_part: NAME | ARRAY | ZEROED | CONSTANT | MIN | MAX | SUM | HEAP | LIMIT | OFFSET
+    | CREATE | INDEX | ON | USING | HASH | SORTED | BITMAP | CONTAINS | LIKE | MATCHES
+    | SELECT | FROM | COUNT | GROUP | BY | ORDER | SHALLOW | SIZE | LENGTH | ASC | DESC
+    | REFERRING | TO | REFERENCED | EXPLAIN | ANALYZE | SAMPLE | OF | ANY | IN;
 %%
 
 void hprof::language_parser::error (const location_type& loc, const std::string& msg) {
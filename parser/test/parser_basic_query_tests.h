@@ -26,3 +26,320 @@ TEST(Parser, SourceObjects) {
     ASSERT_EQ(query_t::SOURCE_OBJECTS, driver.query().source);
     ASSERT_EQ(nullptr, driver.query().filter);
 }
+
+TEST(Parser, ArrayZeroed) {
+    language_driver driver;
+    ASSERT_TRUE(driver.parse("show objects having array zeroed"));
+    ASSERT_NE(nullptr, dynamic_cast<filter_array_zeroed_t*>(driver.query().filter.get()));
+}
+
+TEST(Parser, ArrayAggregateCompare) {
+    language_driver driver;
+    ASSERT_TRUE(driver.parse("show objects having array max < 10 and array constant"));
+    ASSERT_NE(nullptr, dynamic_cast<filter_and_t*>(driver.query().filter.get()));
+}
+
+TEST(Parser, ArrayMostlyConstant) {
+    language_driver driver;
+    ASSERT_TRUE(driver.parse("show objects having array constant 90% limit 5"));
+    ASSERT_NE(nullptr, dynamic_cast<filter_array_mostly_constant_t*>(driver.query().filter.get()));
+    ASSERT_EQ(5u, driver.query().limit);
+    ASSERT_TRUE(driver.parse("show objects having array constant 75.5% and array max < 10"));
+    ASSERT_FALSE(driver.parse("show objects having array constant 50%"));
+    ASSERT_TRUE(driver.has_errors());
+    ASSERT_FALSE(driver.parse("show objects having array constant 101%"));
+    ASSERT_TRUE(driver.has_errors());
+}
+
+TEST(Parser, SoftKeywordAsFieldName) {
+    language_driver driver;
+    ASSERT_TRUE(driver.parse("show objects having object.max.array = 10"));
+    ASSERT_NE(nullptr, dynamic_cast<filter_compare_equals_field_t*>(driver.query().filter.get()));
+}
+
+TEST(Parser, InHeap) {
+    language_driver driver;
+    ASSERT_TRUE(driver.parse("show objects in heap app having array zeroed"));
+    ASSERT_EQ(1u << heap_info_t::HEAP_APP, driver.query().heaps);
+    ASSERT_NE(nullptr, driver.query().filter);
+}
+
+TEST(Parser, InSeveralHeaps) {
+    language_driver driver;
+    ASSERT_TRUE(driver.parse("show classes in heap Zygote, image"));
+    ASSERT_EQ(query_t::SOURCE_CLASSES, driver.query().source);
+    ASSERT_EQ((1u << heap_info_t::HEAP_ZYGOTE) | (1u << heap_info_t::HEAP_IMAGE), driver.query().heaps);
+}
+
+TEST(Parser, UnknownHeap) {
+    language_driver driver;
+    ASSERT_FALSE(driver.parse("show objects in heap native"));
+    ASSERT_TRUE(driver.has_errors());
+}
+
+TEST(Parser, InAsFieldName) {
+    language_driver driver;
+    ASSERT_TRUE(driver.parse("show objects in heap app having object.in.count = 1"));
+    ASSERT_EQ(1u << heap_info_t::HEAP_APP, driver.query().heaps);
+    ASSERT_NE(nullptr, dynamic_cast<filter_compare_equals_field_t*>(driver.query().filter.get()));
+}
+
+TEST(Parser, SystemHeapIsUnknown) {
+    language_driver driver;
+    ASSERT_FALSE(driver.parse("show objects in heap system"));
+    ASSERT_TRUE(driver.has_errors());
+}
+
+TEST(Parser, ReparseResetsQuery) {
+    language_driver driver;
+    ASSERT_TRUE(driver.parse("show objects in heap app having array zeroed"));
+    ASSERT_TRUE(driver.parse("show objects"));
+    ASSERT_EQ(0u, driver.query().heaps);
+    ASSERT_EQ(nullptr, driver.query().filter);
+}
+
+TEST(Parser, LimitOffset) {
+    language_driver driver;
+    ASSERT_TRUE(driver.parse("show objects having array zeroed limit 10 offset 20"));
+    ASSERT_EQ(10u, driver.query().limit);
+    ASSERT_EQ(20u, driver.query().offset);
+    ASSERT_TRUE(driver.parse("show classes offset 5"));
+    ASSERT_EQ(std::numeric_limits<size_t>::max(), driver.query().limit);
+    ASSERT_EQ(5u, driver.query().offset);
+    ASSERT_TRUE(driver.parse("show objects limit 4294967296 offset 2147483648"));
+    ASSERT_EQ(4294967296ull, driver.query().limit);
+    ASSERT_EQ(2147483648ull, driver.query().offset);
+    ASSERT_FALSE(driver.parse("show objects limit 18446744073709551616"));
+    ASSERT_TRUE(driver.has_errors());
+    ASSERT_FALSE(driver.parse("show objects offset 99999999999999999999999"));
+    ASSERT_TRUE(driver.has_errors());
+}
+
+TEST(Parser, IntegerLiteralRange) {
+    language_driver driver;
+    ASSERT_TRUE(driver.parse("show objects having object.mSize > 3000000000"));
+    auto compare = dynamic_cast<const filter_compare_field_t*>(driver.query().filter.get());
+    ASSERT_NE(nullptr, compare);
+    ASSERT_EQ(filter_comp_value_t::TYPE_INT, compare->value().type);
+    ASSERT_EQ(3000000000ll, compare->value().int_value);
+
+    ASSERT_TRUE(driver.parse("show objects having array max < 9223372036854775807"));
+    ASSERT_FALSE(driver.parse("show objects having object.mSize > 9223372036854775808"));
+    ASSERT_TRUE(driver.has_errors());
+    ASSERT_EQ("Integer is out of range", driver.errors().front().message);
+    ASSERT_FALSE(driver.parse("show objects having array length = 99999999999999999999999"));
+    ASSERT_TRUE(driver.has_errors());
+}
+
+TEST(Parser, LimitAsFieldName) {
+    language_driver driver;
+    ASSERT_TRUE(driver.parse("show objects having object.limit > 0 limit 1"));
+    ASSERT_EQ(1u, driver.query().limit);
+}
+
+TEST(Parser, CreateIndex) {
+    language_driver driver;
+    ASSERT_TRUE(driver.parse("create index on android.view.View.mWidth"));
+    ASSERT_EQ(query_t::ACTION_CREATE_INDEX, driver.query().action);
+    ASSERT_EQ("android.view.View", driver.query().index_class);
+    ASSERT_EQ("mWidth", driver.query().index_field);
+    ASSERT_EQ(query_t::INDEX_AUTO, driver.query().index);
+
+    ASSERT_TRUE(driver.parse("create index on \"java.lang.String\".count using bitmap"));
+    ASSERT_EQ("java.lang.String", driver.query().index_class);
+    ASSERT_EQ("count", driver.query().index_field);
+    ASSERT_EQ(query_t::INDEX_BITMAP, driver.query().index);
+
+    ASSERT_FALSE(driver.parse("create index on mWidth"));
+}
+
+TEST(Parser, IndexKeywordsAsFieldNames) {
+    language_driver driver;
+    ASSERT_TRUE(driver.parse("create index on Map.hash using hash"));
+    ASSERT_EQ("Map", driver.query().index_class);
+    ASSERT_EQ("hash", driver.query().index_field);
+    ASSERT_EQ(query_t::INDEX_HASH, driver.query().index);
+
+    ASSERT_TRUE(driver.parse("show objects having object.index > 0 and object.sorted = 1"));
+    ASSERT_EQ(query_t::ACTION_SHOW, driver.query().action);
+}
+
+TEST(Parser, TextMatch) {
+    language_driver driver;
+    ASSERT_TRUE(driver.parse("show objects having object.mUrl contains 'http://' or object.mName like 'user_%'"));
+    ASSERT_NE(nullptr, driver.query().filter);
+    ASSERT_TRUE(driver.parse("show objects having object.mKey matches 'AKIA[0-9A-Z]{16}'"));
+    ASSERT_NE(nullptr, driver.query().filter);
+
+    ASSERT_FALSE(driver.parse("show objects having object.mKey matches 'AKIA[0-9'"));
+    ASSERT_TRUE(driver.has_errors());
+}
+
+TEST(Parser, TextMatchKeywordsAsFieldNames) {
+    language_driver driver;
+    ASSERT_TRUE(driver.parse("show objects having object.like contains 'a' and object.matches = 1"));
+}
+
+TEST(Parser, SelectAggregates) {
+    language_driver driver;
+    ASSERT_TRUE(driver.parse("select count(*), sum(object.mWidth), max(object.mParent.mWidth) from objects having object instanceof \"android.view.View\""));
+    ASSERT_EQ(query_t::ACTION_AGGREGATE, driver.query().action);
+    ASSERT_EQ(query_t::SOURCE_OBJECTS, driver.query().source);
+    ASSERT_NE(nullptr, driver.query().filter);
+    ASSERT_EQ(3u, driver.query().aggregations.size());
+    ASSERT_EQ(query_t::AGGREGATE_COUNT, driver.query().aggregations[0].function);
+    ASSERT_EQ(nullptr, driver.query().aggregations[0].field);
+    ASSERT_EQ(query_t::AGGREGATE_SUM, driver.query().aggregations[1].function);
+    ASSERT_NE(nullptr, driver.query().aggregations[1].field);
+    ASSERT_EQ(query_t::AGGREGATE_MAX, driver.query().aggregations[2].function);
+    ASSERT_EQ(query_t::GROUP_NONE, driver.query().group);
+
+    ASSERT_FALSE(driver.parse("select count(object.mWidth) from objects"));
+    ASSERT_FALSE(driver.parse("select from objects"));
+}
+
+TEST(Parser, SelectGroupBy) {
+    language_driver driver;
+    ASSERT_TRUE(driver.parse("select count(*) from objects in heap app group by class limit 10 offset 2"));
+    ASSERT_EQ(query_t::GROUP_CLASS, driver.query().group);
+    ASSERT_EQ(10u, driver.query().limit);
+    ASSERT_EQ(2u, driver.query().offset);
+
+    ASSERT_TRUE(driver.parse("select min(object.count) from objects group by object.group"));
+    ASSERT_EQ(query_t::GROUP_FIELD, driver.query().group);
+    ASSERT_NE(nullptr, driver.query().group_field);
+    ASSERT_EQ(query_t::AGGREGATE_MIN, driver.query().aggregations[0].function);
+
+    ASSERT_TRUE(driver.parse("show objects having object.from = 1 and object.by > 0"));
+    ASSERT_EQ(query_t::ACTION_SHOW, driver.query().action);
+    ASSERT_TRUE(driver.query().aggregations.empty());
+}
+
+TEST(Parser, OrderBy) {
+    language_driver driver;
+    ASSERT_TRUE(driver.parse("show objects having object instanceof \"android.graphics.Bitmap\" order by object.mWidth desc limit 50"));
+    ASSERT_EQ(query_t::ORDER_FIELD, driver.query().order);
+    ASSERT_NE(nullptr, driver.query().order_field);
+    ASSERT_TRUE(driver.query().order_descending);
+    ASSERT_EQ(50u, driver.query().limit);
+
+    ASSERT_TRUE(driver.parse("show objects order by shallow size"));
+    ASSERT_EQ(query_t::ORDER_SIZE, driver.query().order);
+    ASSERT_FALSE(driver.query().order_descending);
+
+    ASSERT_TRUE(driver.parse("show objects having array zeroed order by array length asc offset 10"));
+    ASSERT_EQ(query_t::ORDER_LENGTH, driver.query().order);
+    ASSERT_EQ(10u, driver.query().offset);
+
+    ASSERT_TRUE(driver.parse("show objects having object.size > 0 and object.order.length = 1"));
+    ASSERT_EQ(query_t::ORDER_NONE, driver.query().order);
+
+    ASSERT_FALSE(driver.parse("show objects order by size"));
+}
+
+TEST(Parser, Projections) {
+    language_driver driver;
+    ASSERT_TRUE(driver.parse("show object.mWidth, object.mHeight, object.mConfig.name from objects having object instanceof \"android.graphics.Bitmap\" order by object.mWidth desc limit 10"));
+    ASSERT_EQ(query_t::ACTION_SHOW, driver.query().action);
+    ASSERT_EQ(query_t::SOURCE_OBJECTS, driver.query().source);
+    ASSERT_EQ(3u, driver.query().projections.size());
+    ASSERT_EQ(2u, driver.query().projections[2]->depth());
+    ASSERT_EQ(query_t::ORDER_FIELD, driver.query().order);
+    ASSERT_EQ(10u, driver.query().limit);
+
+    ASSERT_TRUE(driver.parse("show objects"));
+    ASSERT_TRUE(driver.query().projections.empty());
+
+    ASSERT_FALSE(driver.parse("show object.mWidth objects"));
+    ASSERT_FALSE(driver.parse("show object.mWidth, from objects"));
+}
+
+TEST(Parser, RelatedSubqueries) {
+    language_driver driver;
+    ASSERT_TRUE(driver.parse("show objects referring to (show objects having object instanceof \"android.graphics.Bitmap\") in heap app having object.mWidth > 0"));
+    ASSERT_EQ(query_t::RELATION_REFERRING_TO, driver.query().relation);
+    ASSERT_NE(nullptr, driver.query().filter);
+    ASSERT_NE(0u, driver.query().heaps);
+    ASSERT_NE(nullptr, driver.query().related);
+    ASSERT_NE(nullptr, driver.query().related->filter);
+    ASSERT_EQ(0u, driver.query().related->heaps);
+
+    ASSERT_TRUE(driver.parse("show classes referenced by (show objects referring to (show objects limit 1))"));
+    ASSERT_EQ(query_t::SOURCE_CLASSES, driver.query().source);
+    ASSERT_EQ(query_t::RELATION_REFERENCED_BY, driver.query().relation);
+    ASSERT_EQ(query_t::RELATION_REFERRING_TO, driver.query().related->relation);
+    ASSERT_EQ(1u, driver.query().related->related->limit);
+    ASSERT_EQ(std::numeric_limits<size_t>::max(), driver.query().limit);
+
+    ASSERT_TRUE(driver.parse("select count(*) from objects referenced by (show objects) group by class"));
+    ASSERT_EQ(query_t::ACTION_AGGREGATE, driver.query().action);
+    ASSERT_EQ(query_t::RELATION_REFERENCED_BY, driver.query().relation);
+
+    ASSERT_FALSE(driver.parse("show objects referring to show objects"));
+    ASSERT_FALSE(driver.parse("show objects referring to (show objects"));
+    ASSERT_TRUE(driver.parse("show objects having object.to = 1"));
+    ASSERT_EQ(query_t::RELATION_NONE, driver.query().relation);
+}
+
+TEST(Parser, ExplainQueries) {
+    language_driver driver;
+    ASSERT_TRUE(driver.parse("explain show objects having object.mWidth > 10"));
+    ASSERT_EQ(query_t::EXPLAIN_PLAN, driver.query().explain);
+    ASSERT_EQ(query_t::ACTION_SHOW, driver.query().action);
+    ASSERT_NE(nullptr, driver.query().filter);
+
+    ASSERT_TRUE(driver.parse("explain analyze select count(*) from objects group by class"));
+    ASSERT_EQ(query_t::EXPLAIN_ANALYZE, driver.query().explain);
+    ASSERT_EQ(query_t::ACTION_AGGREGATE, driver.query().action);
+
+    ASSERT_TRUE(driver.parse("show objects"));
+    ASSERT_EQ(query_t::EXPLAIN_NONE, driver.query().explain);
+    ASSERT_TRUE(driver.parse("show objects having object.analyze = 1"));
+
+    ASSERT_FALSE(driver.parse("explain create index on \"android.view.View\".mWidth"));
+    ASSERT_FALSE(driver.parse("explain"));
+    ASSERT_FALSE(driver.parse("show objects explain"));
+}
+
+TEST(Parser, SampleQueries) {
+    language_driver driver;
+    ASSERT_TRUE(driver.parse("show objects sample 1% having object.mWidth > 10"));
+    ASSERT_DOUBLE_EQ(0.01, driver.query().sample);
+    ASSERT_NE(nullptr, driver.query().filter);
+
+    ASSERT_TRUE(driver.parse("select count(*) from objects in heap app sample 0.5% group by class"));
+    ASSERT_DOUBLE_EQ(0.005, driver.query().sample);
+    ASSERT_EQ(query_t::ACTION_AGGREGATE, driver.query().action);
+
+    ASSERT_TRUE(driver.parse("show objects referring to (show objects sample 10%) sample 100%"));
+    ASSERT_DOUBLE_EQ(1.0, driver.query().sample);
+    ASSERT_DOUBLE_EQ(0.1, driver.query().related->sample);
+
+    ASSERT_TRUE(driver.parse("show objects"));
+    ASSERT_DOUBLE_EQ(1.0, driver.query().sample);
+    ASSERT_TRUE(driver.parse("show objects having object.sample = 1"));
+
+    ASSERT_FALSE(driver.parse("show objects sample 0%"));
+    ASSERT_FALSE(driver.parse("show objects sample 101%"));
+    ASSERT_FALSE(driver.parse("show objects sample 5"));
+}
+
+TEST(Parser, ArrayPredicates) {
+    language_driver driver;
+    ASSERT_TRUE(driver.parse("show objects having array of byte and array length > 1048576"));
+    ASSERT_NE(nullptr, dynamic_cast<filter_and_t*>(driver.query().filter.get()));
+
+    ASSERT_TRUE(driver.parse("show objects having array of object and array any instanceof \"android.view.View\""));
+    ASSERT_TRUE(driver.parse("show objects having array contains 'hello'"));
+    ASSERT_NE(nullptr, dynamic_cast<filter_array_contains_text_t*>(driver.query().filter.get()));
+    ASSERT_TRUE(driver.parse("show objects having array any = 7"));
+    ASSERT_NE(nullptr, dynamic_cast<filter_array_any_t*>(driver.query().filter.get()));
+    ASSERT_TRUE(driver.parse("show objects having array any <= 1.5"));
+    ASSERT_TRUE(driver.parse("show objects having array length = 0"));
+    ASSERT_NE(nullptr, dynamic_cast<filter_array_length_t*>(driver.query().filter.get()));
+    ASSERT_TRUE(driver.parse("show objects having object.any = 1 and object.of = 2"));
+
+    ASSERT_FALSE(driver.parse("show objects having array of string"));
+    ASSERT_FALSE(driver.parse("show objects having array any instanceof 5"));
+    ASSERT_FALSE(driver.parse("show objects having array length"));
+}
@@ -29,6 +29,7 @@ namespace hprof {
             ExecuteQuery,
             FetchObject,
             FillTreeView,
+            FetchQueryPage,
         } type;
 
         Action(action_type_t action) : type(action) {}
@@ -42,12 +43,23 @@ namespace hprof {
     };
 
     struct ExecuteQueryAction : public Action {
-        ExecuteQueryAction(const std::string& query, u_int64_t seq_number) : Action(ExecuteQuery), query_text(query), seq_number(seq_number) {}
+        ExecuteQueryAction(const std::string& query, u_int64_t seq_number, bool exact) : Action(ExecuteQuery), query_text(query), seq_number(seq_number), exact(exact) {}
         std::string query_text;
         u_int64_t seq_number;
+        // Runs the whole query without a preview, queued once the preview of the same query is shown
+        bool exact;
 
-        static std::unique_ptr<Action> create(const std::string& query, u_int64_t seq_number) { 
-            return std::make_unique<ExecuteQueryAction>(std::move(query), seq_number); 
+        static std::unique_ptr<Action> create(const std::string& query, u_int64_t seq_number, bool exact = false) { 
+            return std::make_unique<ExecuteQueryAction>(std::move(query), seq_number, exact); 
+        }
+    };
+
+    struct FetchQueryPageAction : public Action {
+        FetchQueryPageAction(u_int64_t seq_number) : Action(FetchQueryPage), seq_number(seq_number) {}
+        u_int64_t seq_number;
+
+        static std::unique_ptr<Action> create(u_int64_t seq_number) {
+            return std::make_unique<FetchQueryPageAction>(seq_number);
         }
     };
 
@@ -65,15 +77,17 @@ namespace hprof {
     };
 
     struct FillTreeViewAction : public Action {
-        FillTreeViewAction(Glib::RefPtr<Gtk::TreeStore>& store, ObjectFieldsColumns* columns, const std::vector<heap_item_ptr_t>& items) : 
-            Action(FillTreeView), store(store), items(items), columns(columns) {}
+        FillTreeViewAction(Glib::RefPtr<Gtk::TreeStore>& store, ObjectFieldsColumns* columns, const std::vector<heap_item_ptr_t>& items, bool append) : 
+            Action(FillTreeView), store(store), items(items), columns(columns), append(append) {}
 
         Glib::RefPtr<Gtk::TreeStore> store;
         std::vector<heap_item_ptr_t> items;
         ObjectFieldsColumns* columns;
+        // Items are added after the rows already in the store
+        bool append;
 
-        static std::unique_ptr<Action> create(Glib::RefPtr<Gtk::TreeStore>& store, ObjectFieldsColumns* columns, const std::vector<heap_item_ptr_t>& items) {
-            return std::make_unique<FillTreeViewAction>(store, columns, items);
+        static std::unique_ptr<Action> create(Glib::RefPtr<Gtk::TreeStore>& store, ObjectFieldsColumns* columns, const std::vector<heap_item_ptr_t>& items, bool append = false) {
+            return std::make_unique<FillTreeViewAction>(store, columns, items, append);
         }
     };
 }
@@ -27,6 +27,7 @@ namespace hprof {
     protected:
         void on_startup() override;
         void on_activate() override;
+        int on_handle_local_options(const Glib::RefPtr<Glib::VariantDict>& options) override;
     private:
         void on_open_file();
         void on_quit();
@@ -21,6 +21,8 @@
 #include "language_driver.h"
 
 #include <gtkmm.h>
+#include <atomic>
+#include <chrono>
 #include <memory>
 #include <mutex>
 #include <vector>
@@ -32,31 +34,65 @@ namespace hprof {
         using type_signal_start_loading = sigc::signal<void, const std::string&>;
         using type_signal_progress_loading = sigc::signal<void, const std::string&, double>;
         using type_signal_stop_loading = sigc::signal<void>;
-        using type_signal_query_succeed = sigc::signal<void, const std::vector<heap_item_ptr_t>&, u_int64_t>;
+        /// Page items, query sequence number, is it the first page, are more pages left, did the time budget cut the result,
+        /// is it the preview of a sample
+        using type_signal_query_succeed = sigc::signal<void, const std::vector<heap_item_ptr_t>&, u_int64_t, bool, bool, bool, bool>;
         using type_signal_query_failed = sigc::signal<void, const std::vector<parse_error>&, u_int64_t>;
+        /// Plan lines of EXPLAIN, query sequence number
+        using type_signal_query_explained = sigc::signal<void, const std::vector<std::string>&, u_int64_t>;
         using type_signal_fetch_object_result = sigc::signal<void, u_int64_t, const Gtk::TreeModel::Path&, const heap_item_ptr_t&>;
     public:
         HprofStorage(std::unique_ptr<data_reader_factory_t>&& factory);
         virtual ~HprofStorage();
         void emit(const Action& action);
+        /// Cancels the running query once a newer one is queued
+        void on_enqueued(const Action& action);
+        /// Applies to dumps opened afterwards, zero means one thread per core
+        void set_query_threads(size_t threads) { _load_options.query_threads = threads; }
+        /// Queries running longer show what they found so far, zero means no limit
+        void set_query_budget(std::chrono::milliseconds budget) { _query_budget = budget; }
+        /// SHOW queries first show matches of the sampled fraction of objects, exact results replace them
+        /// once ready. The preview comes as a single page, the exact query runs as a separate action
+        /// queued with ExecuteQueryAction::exact. One and above turns previews off
+        void set_preview_sample(double fraction) { _preview_sample = fraction; }
+        /// Safe to call from any thread, the query fails with a cancel message
+        void cancel_query();
         
         type_signal_start_loading& on_start_loading() { return _signal_start_loading; }
         type_signal_progress_loading& on_progress_loading() { return _signal_progress_loading; }
         type_signal_stop_loading& on_stop_loading() { return _signal_stop_loading;  }
         type_signal_query_succeed& on_query_succeed() { return _signal_query_succeed; }
         type_signal_query_failed& on_query_failed() { return _signal_query_failed; }
+        type_signal_query_explained& on_query_explained() { return _signal_query_explained; }
         type_signal_fetch_object_result& on_fetch_object_result() { return _signal_fetch_object_result; }
     protected:
         void on_process_signal(const StorageSignal* signal);
     private:
         void load_hprof(const OpenFileAction* action);
         void execute_query(const ExecuteQueryAction* action);
+        void explain_query(u_int64_t seq_number);
+        void fetch_query_page(const FetchQueryPageAction* action);
+        void send_query_page(u_int64_t seq_number, bool first_page, bool preview = false);
         void fetch_object(const FetchObjectAction* action);
         void on_loading_progress(file_t::phase_t phase, u_int32_t progress);
     private:
         std::unique_ptr<data_reader_factory_t> _reader_factory;
         std::unique_ptr<heap_profile_t> _heap_profile;
+        load_options_t _load_options;
         language_driver _query_parser;
+        // Refers to the query held by _query_parser, reset before the next parse
+        std::unique_ptr<query_cursor_t> _query_cursor;
+        u_int64_t _query_seq_number;
+        std::chrono::milliseconds _query_budget;
+        double _preview_sample;
+        // Sequence number of the latest queued query
+        std::atomic<u_int64_t> _latest_seq_number;
+        // Token of the running query and its sequence number, set by the worker and used by other threads
+        std::mutex _token_lock;
+        std::shared_ptr<query_token_t> _query_token;
+        u_int64_t _token_seq_number;
+
+        static const size_t QUERY_PAGE_SIZE = 1000;
 
         // signals
         type_signal_start_loading _signal_start_loading;
@@ -64,6 +100,7 @@ namespace hprof {
         type_signal_stop_loading _signal_stop_loading;
         type_signal_query_succeed _signal_query_succeed;
         type_signal_query_failed _signal_query_failed;
+        type_signal_query_explained _signal_query_explained;
         type_signal_fetch_object_result _signal_fetch_object_result;
     };
 }
\ No newline at end of file
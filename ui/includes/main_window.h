@@ -28,17 +28,21 @@ namespace hprof {
         MainWindow(EventsDisparcher& dispatcher, HprofStorage& hprof_storage, TreeViewStorage& treeview_storage);
 
         void on_open_hprof_file();
+    protected:
+        bool on_key_press_event(GdkEventKey* event) override;
     private:
         void configure_header();
         void configure_query_screen(int32_t window_width, int32_t window_height);
         void configure_statusbar();
 
         void on_execute_query();
+        void on_fetch_more_results();
         void on_hprof_start_load(const std::string& file_name);
         void on_hprof_loading_progress(const std::string& action, double fraction);
         void on_hprof_stop_load();
-        void on_query_result(const std::vector<heap_item_ptr_t>& result, u_int64_t seq_number);
+        void on_query_result(const std::vector<heap_item_ptr_t>& result, u_int64_t seq_number, bool first_page, bool has_more, bool truncated, bool preview);
         void on_query_failed(const std::vector<parse_error>& errors, u_int64_t seq_number);
+        void on_query_explained(const std::vector<std::string>& lines, u_int64_t seq_number);
         void on_object_fetch_result(u_int64_t request_id, const Gtk::TreeModel::Path& path, const heap_item_ptr_t& item);
         void on_treeview_fill_progress(double fraction);
         void on_treeview_filled();
@@ -62,6 +66,7 @@ namespace hprof {
         // Header, Toolbar
         Gtk::HeaderBar _header_bar;
         Gtk::ToolButton _execute_query_button;
+        Gtk::ToolButton _more_results_button;
 
         // Status bar
         Gtk::Statusbar _statusbar;
@@ -73,6 +78,12 @@ namespace hprof {
         Gtk::Paned _query_box;
         Glib::RefPtr<Gtk::TextBuffer> _query_text_buffer;
         u_int64_t _query_seq_number;
+        // Text of the running query, its exact run is queued again after the preview
+        std::string _query_text;
+        // The preview is shown and the exact query still runs
+        bool _waiting_exact;
+        // Shown in the status bar once results are in the view, empty clears it
+        std::string _results_status;
 
         // Result view
         ObjectFieldsColumns _result_columns;
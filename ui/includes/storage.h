@@ -26,6 +26,8 @@ namespace hprof {
     public:
         virtual ~Storage() {}
         virtual void emit(const Action& action) = 0;
+        /// Called on the emitting thread before the action is queued, must not block
+        virtual void on_enqueued(const Action&) {}
     };
 
     struct StorageSignal {
@@ -34,7 +34,7 @@ public:
     void emit(std::unique_ptr<Action>&& action);
 private:
     void emit_events();
-    void emit_event_locked(const Action& action);
+    void emit_event(const Action& action);
 private:
     volatile bool _do_loop;
     std::mutex _mutex;
@@ -68,6 +68,9 @@ void EventsDisparcherImpl::subscribe(Storage* storage) {
 void EventsDisparcherImpl::emit(std::unique_ptr<Action>&& action) {
     std::unique_lock<std::mutex> lock { _mutex };
     if (!_do_loop) return;
+    for (auto storage : _storages) {
+        storage->on_enqueued(*action);
+    }
     _actions.push(std::move(action));
     _actions_conditions.notify_one();
 }
@@ -91,14 +94,20 @@ void EventsDisparcherImpl::emit_events() {
     std::unique_lock<std::mutex> lock { _mutex };
     do {
         while (!_actions.empty()) {
-            emit_event_locked(*_actions.front());
+            auto action = std::move(_actions.front());
             _actions.pop();
+            // Actions may run for long, emitting threads must not wait for them
+            lock.unlock();
+            emit_event(*action);
+            lock.lock();
+        }
+        if (_do_loop) {
+            _actions_conditions.wait(lock);
         }
-        _actions_conditions.wait(lock);
     } while(_do_loop);
 }
 
-void EventsDisparcherImpl::emit_event_locked(const Action& action) {
+void EventsDisparcherImpl::emit_event(const Action& action) {
     for (auto storage : _storages) {
         storage->emit(action);
     }
@@ -24,6 +24,26 @@ using namespace hprof;
 HprofBrowserApplication::HprofBrowserApplication() : 
     Application("com.github.pvoid.android-hprof-browser"), _dispatcher(EventsDisparcher::create()), 
     _hprof_storage(data_reader_factory_t::create()), _main_window(*_dispatcher, _hprof_storage, _treeview_storage) {
+    add_main_option_entry(OPTION_TYPE_INT, "threads", 't', "Threads running queries, one per core by default", "N");
+    add_main_option_entry(OPTION_TYPE_INT, "query-budget", 'b', "Milliseconds a query runs before partial results are shown, no limit by default", "MS");
+    add_main_option_entry(OPTION_TYPE_INT, "preview-sample", 'p', "Percent of objects a query checks for a preview shown before exact results, off by default", "PERCENT");
+}
+
+int HprofBrowserApplication::on_handle_local_options(const Glib::RefPtr<Glib::VariantDict>& options) {
+    int threads = 0;
+    if (options->lookup_value("threads", threads) && threads > 0) {
+        _hprof_storage.set_query_threads(static_cast<size_t>(threads));
+    }
+    int budget = 0;
+    if (options->lookup_value("query-budget", budget) && budget > 0) {
+        _hprof_storage.set_query_budget(std::chrono::milliseconds { budget });
+    }
+    int preview = 0;
+    if (options->lookup_value("preview-sample", preview) && preview > 0 && preview < 100) {
+        _hprof_storage.set_preview_sample(preview / 100.);
+    }
+    // keep the default processing
+    return -1;
 }
 
 void HprofBrowserApplication::on_startup() {
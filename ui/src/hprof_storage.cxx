@@ -14,6 +14,7 @@
 ///  limitations under the License.
 ///
 #include "hprof_storage.h"
+#include "query_profiler.h"
 #include <iostream>
 
 #include <functional>
@@ -33,6 +34,7 @@ enum : int32_t {
     SIGNAL_QUERY_RESULT = 4,
     SIGNAL_QUERY_FAILED = 5,
     SIGNAL_FETCH_OBJECT_RESULT = 6,
+    SIGNAL_QUERY_EXPLAINED = 7,
 };
 
 struct HprofFileLoadStartedSignal : public StorageSignal {
@@ -53,11 +55,16 @@ struct HprofFileLoadFinishedSignal : public StorageSignal {
 };
 
 struct QueryResultSignal : public StorageSignal {
-    QueryResultSignal(std::unique_ptr<std::vector<heap_item_ptr_t>>&& result, u_int64_t seq_number) : 
-        StorageSignal(SIGNAL_QUERY_RESULT), result(std::move(result)), seq_number(seq_number) {}
+    QueryResultSignal(std::unique_ptr<std::vector<heap_item_ptr_t>>&& result, u_int64_t seq_number, bool first_page, bool has_more, bool truncated, bool preview) : 
+        StorageSignal(SIGNAL_QUERY_RESULT), result(std::move(result)), seq_number(seq_number), first_page(first_page), has_more(has_more),
+        truncated(truncated), preview(preview) {}
 
     std::unique_ptr<std::vector<heap_item_ptr_t>> result;
     u_int64_t seq_number;
+    bool first_page;
+    bool has_more;
+    bool truncated;
+    bool preview;
 };
 
 struct QueryFailedSignal : public StorageSignal {
@@ -68,6 +75,14 @@ struct QueryFailedSignal : public StorageSignal {
     u_int64_t seq_number;
 };
 
+struct QueryExplainedSignal : public StorageSignal {
+    QueryExplainedSignal(std::vector<std::string>&& lines, u_int64_t seq_number) :
+        StorageSignal(SIGNAL_QUERY_EXPLAINED), lines(std::move(lines)), seq_number(seq_number) {}
+
+    std::vector<std::string> lines;
+    u_int64_t seq_number;
+};
+
 struct FetchObjectResultSignal : public StorageSignal {
     FetchObjectResultSignal(u_int64_t seq_number, const Gtk::TreeModel::Path& path, const heap_item_ptr_t& item) :
         StorageSignal(SIGNAL_FETCH_OBJECT_RESULT), item(item), seq_number(seq_number), path(path) {}
@@ -77,7 +92,10 @@ struct FetchObjectResultSignal : public StorageSignal {
     Gtk::TreeModel::Path path;
 };
 
-HprofStorage::HprofStorage(std::unique_ptr<data_reader_factory_t>&& factory) : _reader_factory(std::move(factory)) {}
+const size_t HprofStorage::QUERY_PAGE_SIZE;
+
+HprofStorage::HprofStorage(std::unique_ptr<data_reader_factory_t>&& factory) : _reader_factory(std::move(factory)), _query_seq_number(0),
+    _query_budget(0), _preview_sample(1.0), _latest_seq_number(0), _token_seq_number(0) {}
 
 HprofStorage::~HprofStorage() {}
 
@@ -92,18 +110,42 @@ void HprofStorage::emit(const Action& action) {
         case Action::FetchObject:
             fetch_object(reinterpret_cast<const FetchObjectAction *>(&action));
             break;
+        case Action::FetchQueryPage:
+            fetch_query_page(reinterpret_cast<const FetchQueryPageAction *>(&action));
+            break;
         default:
             break;
     }
 }
 
+void HprofStorage::on_enqueued(const Action& action) {
+    if (action.type != Action::ExecuteQuery) return;
+
+    auto seq_number = reinterpret_cast<const ExecuteQueryAction *>(&action)->seq_number;
+    auto latest = _latest_seq_number.load();
+    while (latest < seq_number && !_latest_seq_number.compare_exchange_weak(latest, seq_number)) {}
+
+    std::unique_lock<std::mutex> lock { _token_lock };
+    if (_query_token != nullptr && _token_seq_number < seq_number) {
+        _query_token->cancel();
+    }
+}
+
+void HprofStorage::cancel_query() {
+    std::unique_lock<std::mutex> lock { _token_lock };
+    if (_query_token != nullptr) {
+        _query_token->cancel();
+    }
+}
+
 void HprofStorage::load_hprof(const OpenFileAction* action) {
     send_signal(std::make_unique<HprofFileLoadStartedSignal>(action->file_name));
 
     auto start = steady_clock::now();
 
     file_t file { action->file_name };
-    auto dump = file.read_dump(*_reader_factory, std::bind(&HprofStorage::on_loading_progress, this, std::placeholders::_1, std::placeholders::_2));
+    _query_cursor.reset();
+    auto dump = file.read_dump(*_reader_factory, std::bind(&HprofStorage::on_loading_progress, this, std::placeholders::_1, std::placeholders::_2), _load_options);
     if (dump != nullptr) {
         _heap_profile = std::move(dump);
     }
@@ -128,7 +170,7 @@ void HprofStorage::on_process_signal(const StorageSignal* signal) {
             break;
         case SIGNAL_QUERY_RESULT: {
             auto s = static_cast<const QueryResultSignal*>(signal);
-            _signal_query_succeed.emit(*(s->result), s->seq_number);
+            _signal_query_succeed.emit(*(s->result), s->seq_number, s->first_page, s->has_more, s->truncated, s->preview);
             break;
         }
         case SIGNAL_QUERY_FAILED: {
@@ -136,6 +178,11 @@ void HprofStorage::on_process_signal(const StorageSignal* signal) {
             _signal_query_failed.emit(s->errors, s->seq_number);
             break;
         }
+        case SIGNAL_QUERY_EXPLAINED: {
+            auto s = static_cast<const QueryExplainedSignal*>(signal);
+            _signal_query_explained.emit(s->lines, s->seq_number);
+            break;
+        }
         case SIGNAL_FETCH_OBJECT_RESULT: {
             auto s = static_cast<const FetchObjectResultSignal*>(signal);
             _signal_fetch_object_result.emit(s->seq_number, s->path, s->item);
@@ -161,15 +208,92 @@ void HprofStorage::on_loading_progress(file_t::phase_t phase, u_int32_t progress
 }
 
 void HprofStorage::execute_query(const ExecuteQueryAction* action) {
+    _query_cursor.reset();
+    // Results of a query replaced by a newer one are never shown
+    if (action->seq_number < _latest_seq_number.load()) return;
+
     if (_heap_profile != nullptr && _query_parser.parse(action->query_text)) {
-        auto result = std::make_unique<std::vector<heap_item_ptr_t>>();
-        _heap_profile->query(_query_parser.query(), *result);
-        send_signal(std::make_unique<QueryResultSignal>(std::move(result), action->seq_number));
+        std::shared_ptr<query_token_t> token;
+        {
+            std::unique_lock<std::mutex> lock { _token_lock };
+            // The exact run of a previewed query goes on with its token, a cancelled preview cancels it as well
+            if (action->exact && _token_seq_number == action->seq_number) {
+                token = _query_token;
+            }
+            if (token == nullptr) {
+                token = std::make_shared<query_token_t>();
+                if (_query_budget.count() != 0) {
+                    token->set_budget(_query_budget);
+                }
+                _query_token = token;
+                _token_seq_number = action->seq_number;
+            }
+        }
+        // A newer query queued before the token was published never saw it
+        if (action->seq_number < _latest_seq_number.load()) {
+            token->cancel();
+        }
+
+        auto& query = _query_parser.query();
+        query.token = std::move(token);
+        if (query.explain != query_t::EXPLAIN_NONE) {
+            explain_query(action->seq_number);
+            return;
+        }
+        _query_seq_number = action->seq_number;
+
+        // The preview replaces the previous results and the first page of the exact query replaces the preview.
+        // The window queues the exact query once the preview is shown, so it does not wait for the exact scan
+        if (!action->exact && _preview_sample < 1 && query.action == query_t::ACTION_SHOW && query.sample >= 1) {
+            query.sample = _preview_sample;
+            _query_cursor = _heap_profile->open(query);
+            send_query_page(action->seq_number, true, true);
+            _query_cursor.reset();
+            return;
+        }
+        _query_cursor = _heap_profile->open(query);
+        send_query_page(action->seq_number, true);
     } else if (_query_parser.has_errors()) {
         send_signal(std::make_unique<QueryFailedSignal>(_query_parser.errors(), action->seq_number));
     }
 }
 
+void HprofStorage::explain_query(u_int64_t seq_number) {
+    auto& query = _query_parser.query();
+    std::vector<explain_node_t> nodes;
+    if (!_heap_profile->explain(query, nodes)) {
+        const char* message = query.token->cancelled() ? "Query cancelled" : "Query can't be explained";
+        send_signal(std::make_unique<QueryFailedSignal>(std::vector<parse_error> { parse_error { message } }, seq_number));
+        return;
+    }
+
+    std::vector<std::string> lines { nodes.size() };
+    for (size_t index = 0; index < nodes.size(); ++index) {
+        query_profiler_t::format(nodes[index], query.explain == query_t::EXPLAIN_ANALYZE, lines[index]);
+    }
+    send_signal(std::make_unique<QueryExplainedSignal>(std::move(lines), seq_number));
+}
+
+void HprofStorage::fetch_query_page(const FetchQueryPageAction* action) {
+    if (_query_cursor == nullptr || _query_seq_number != action->seq_number || _query_cursor->done()) return;
+    send_query_page(action->seq_number, false);
+}
+
+void HprofStorage::send_query_page(u_int64_t seq_number, bool first_page, bool preview) {
+    auto result = std::make_unique<std::vector<heap_item_ptr_t>>();
+    if (!_query_cursor->fetch(QUERY_PAGE_SIZE, *result)) {
+        _query_cursor.reset();
+        if (_query_parser.query().token != nullptr && _query_parser.query().token->cancelled()) {
+            send_signal(std::make_unique<QueryFailedSignal>(std::vector<parse_error> { parse_error { "Query cancelled" } }, seq_number));
+            return;
+        }
+    }
+    // Further pages come from the exact query
+    bool has_more = !preview && _query_cursor != nullptr && !_query_cursor->done();
+    bool truncated = _query_cursor != nullptr && _query_cursor->truncated();
+    send_signal(std::make_unique<QueryResultSignal>(std::move(result), seq_number, first_page, has_more, truncated, preview));
+}
+
 void HprofStorage::fetch_object(const FetchObjectAction* action) {
     if (_heap_profile == nullptr) return;
 
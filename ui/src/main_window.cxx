@@ -21,7 +21,7 @@ const std::string g_window_name { "Android Heap Profile Browser" };
 
 MainWindow::MainWindow(EventsDisparcher& dispatcher, HprofStorage& hprof_storage, TreeViewStorage& treeview_storage) : 
     _dispatcher(dispatcher), _hprof_storage(hprof_storage), _treeview_storage(treeview_storage), _query_box(Gtk::ORIENTATION_VERTICAL),
-    _query_seq_number(0), _progress_bar_in_pulse_mode(false) {
+    _query_seq_number(0), _waiting_exact(false), _progress_bar_in_pulse_mode(false) {
   
     auto screen = Gdk::Screen::get_default();
     auto width =  static_cast<int32_t>(static_cast<double>(screen->get_width()) * 0.80);
@@ -50,6 +50,7 @@ MainWindow::MainWindow(EventsDisparcher& dispatcher, HprofStorage& hprof_storage
     _hprof_storage.on_stop_loading().connect(sigc::mem_fun(*this, &MainWindow::on_hprof_stop_load));
     _hprof_storage.on_query_succeed().connect(sigc::mem_fun(*this, &MainWindow::on_query_result));
     _hprof_storage.on_query_failed().connect(sigc::mem_fun(*this, &MainWindow::on_query_failed));
+    _hprof_storage.on_query_explained().connect(sigc::mem_fun(*this, &MainWindow::on_query_explained));
     _hprof_storage.on_fetch_object_result().connect(sigc::mem_fun(*this, &MainWindow::on_object_fetch_result));
 
     _treeview_storage.on_data_filled().connect(sigc::mem_fun(*this, &MainWindow::on_treeview_filled));
@@ -76,6 +77,12 @@ void MainWindow::configure_header() {
     _execute_query_button.set_margin_start(20);
     toolbar->append(_execute_query_button, sigc::mem_fun(*this, &MainWindow::on_execute_query));
 
+    _more_results_button.set_tooltip_text("Fetch more results");
+    _more_results_button.set_icon_name("go-down");
+    _more_results_button.set_visible(true);
+    _more_results_button.set_sensitive(false);
+    toolbar->append(_more_results_button, sigc::mem_fun(*this, &MainWindow::on_fetch_more_results));
+
     _header_bar.pack_start(*toolbar);
 
     _header_bar.show();
@@ -136,6 +143,7 @@ void MainWindow::on_hprof_start_load(const std::string& file_name) {
     _query_box.hide();
 
     _execute_query_button.set_sensitive(false);
+    _more_results_button.set_sensitive(false);
 
     set_status("Loading file: " + name);
     _progress_bar.show();
@@ -154,18 +162,32 @@ void MainWindow::on_hprof_loading_progress(const std::string& action, double fra
     set_progress_fraction(fraction);
 }
 
-void MainWindow::on_query_result(const std::vector<heap_item_ptr_t>& result, u_int64_t seq_number) {
+void MainWindow::on_query_result(const std::vector<heap_item_ptr_t>& result, u_int64_t seq_number, bool first_page, bool has_more, bool truncated, bool preview) {
     if (_query_seq_number != seq_number) return;
 
-    std::cout << "Query results: " << result.size() << std::endl;
+    std::cout << "Query results: " << result.size() << (has_more ? "+" : "") << std::endl;
 
+    _results_status = truncated ? "Query time budget is spent, results are partial" : "";
+    _waiting_exact = preview && !truncated;
+    if (_waiting_exact) {
+        _results_status = "Preview of a sample, running the exact query...";
+    }
+    _more_results_button.set_sensitive(has_more);
     set_status("Building result list");
-    _dispatcher.emit(FillTreeViewAction::create(_result_model_store, &_result_columns, result));
+    if (!first_page) {
+        _results_view.unset_model();
+    }
+    _dispatcher.emit(FillTreeViewAction::create(_result_model_store, &_result_columns, result, !first_page));
+    // Queued after the preview is filled, so it is shown while the exact scan runs
+    if (_waiting_exact) {
+        _dispatcher.emit(ExecuteQueryAction::create(_query_text, seq_number, true));
+    }
 }
 
 void MainWindow::on_query_failed(const std::vector<parse_error>& errors, u_int64_t seq_number) {
     if (_query_seq_number != seq_number) return;
 
+    _waiting_exact = false;
     hide_pulse_progress();
     // Build and show error message
     assert(errors.size() > 0);
@@ -180,14 +202,37 @@ void MainWindow::on_query_failed(const std::vector<parse_error>& errors, u_int64
     _query_text_buffer->place_cursor(it);
 }
 
+void MainWindow::on_query_explained(const std::vector<std::string>& lines, u_int64_t seq_number) {
+    if (_query_seq_number != seq_number) return;
+
+    hide_pulse_progress();
+    clear_status();
+
+    std::string text;
+    for (auto& line : lines) {
+        text += line;
+        text += '\n';
+    }
+
+    Gtk::MessageDialog dialog { *this, "Query plan" };
+    dialog.set_secondary_text(text);
+    dialog.run();
+}
+
 void MainWindow::on_treeview_fill_progress(double fraction) {
     set_progress_fraction(fraction);
 }
 
 void MainWindow::on_treeview_filled() {
     _results_view.set_model(_result_model_store);
-    clear_status();
-    hide_pulse_progress();
+    if (_results_status.empty()) {
+        clear_status();
+    } else {
+        set_status(_results_status);
+    }
+    if (!_waiting_exact) {
+        hide_pulse_progress();
+    }
 }
 
 void MainWindow::on_open_hprof_file() {
@@ -222,12 +267,32 @@ void MainWindow::on_execute_query() {
     auto query_text = _query_text_buffer->get_text();
     if (query_text.empty()) return;
 
-    _dispatcher.emit(ExecuteQueryAction::create(std::string { query_text.c_str() }, ++_query_seq_number));
+    _more_results_button.set_sensitive(false);
+    _query_text = query_text.c_str();
+    _waiting_exact = false;
+    _dispatcher.emit(ExecuteQueryAction::create(_query_text, ++_query_seq_number));
     
     set_status("Running query...");
     show_pulse_progress();
 }
 
+bool MainWindow::on_key_press_event(GdkEventKey* event) {
+    // Esc stops the running query, the storage reports it as a failed one
+    if (event->keyval == GDK_KEY_Escape) {
+        _hprof_storage.cancel_query();
+        return true;
+    }
+    return Gtk::ApplicationWindow::on_key_press_event(event);
+}
+
+void MainWindow::on_fetch_more_results() {
+    _more_results_button.set_sensitive(false);
+    _dispatcher.emit(FetchQueryPageAction::create(_query_seq_number));
+
+    set_status("Fetching more results...");
+    show_pulse_progress();
+}
+
 bool MainWindow::on_test_expand_row(const Gtk::TreeModel::iterator& row, const Gtk::TreeModel::Path& path) {
     EventsDisparcher* dispatcher = &_dispatcher;
     _result_columns.populate_instance_row(_result_model_store, *row, [dispatcher] (auto path, auto request_id, auto object_id) {
@@ -14,16 +14,13 @@
 ///  limitations under the License.
 ///
 #include "object_fields_columns.h"
+#include "types/text_kernels.h"
 
-#include <codecvt>
-#include <locale>
 #include <sstream>
 #include <iomanip>
 
 using namespace hprof;
 
-std::wstring_convert<std::codecvt_utf8_utf16<char16_t, 0x10ffff, std::little_endian>, char16_t> text_converter;
-
 inline Glib::ustring get_type_name(jvm_type_t type) {
     switch (type) {
         case jvm_type_t::JVM_TYPE_OBJECT:
@@ -68,7 +65,7 @@ inline Glib::ustring get_field_value(const field_value_t& field) {
         case jvm_type_t::JVM_TYPE_BOOL:
             return static_cast<jvm_bool_t>(field) ? "true" : "false";
         case jvm_type_t::JVM_TYPE_CHAR:
-            return text_converter.to_bytes(static_cast<jvm_char_t>(field));
+            return text_kernels_t::to_utf8(static_cast<jvm_char_t>(field));
         case jvm_type_t::JVM_TYPE_FLOAT:
             return  std::to_string(static_cast<jvm_float_t>(field));
         case jvm_type_t::JVM_TYPE_DOUBLE:
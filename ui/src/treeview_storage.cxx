@@ -55,7 +55,9 @@ void TreeViewStorage::on_process_signal(const StorageSignal* signal) {
 void TreeViewStorage::on_fill_tree_view(const FillTreeViewAction* action) {
     int32_t ready = 0;
     double last_fraction = 0;
-    action->store->clear();
+    if (!action->append) {
+        action->store->clear();
+    }
     for (auto& item : action->items) {
         action->columns->assign(action->store, item);
         double fraction =  static_cast<double>((++ready * 100.) / action->items.size()) / 100;